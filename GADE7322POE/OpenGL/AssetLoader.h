@@ -0,0 +1,1179 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include "GLStats.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+// SOIL2
+#include "SOIL2/SOIL2.h"
+
+#include "Bounds.h"
+#include "CpuProfiler.h"
+#include "TextureBake.h"
+#include "TextureCache.h"
+
+// Bytes handed to the GPU per frame, one image or mesh always goes up however big it is
+const size_t ASSET_UPLOAD_BUDGET_BYTES = 4 << 20;
+
+// Pixel buffers cycling between the loader thread and the GPU, enough for a whole cube map
+const int ASSET_UPLOAD_BUFFERS = 8;
+
+// Added to the distance of assets with nothing in view, so everything visible loads first
+const float ASSET_HIDDEN_PENALTY = 1000.0f;
+
+// Half size of the box drawn in place of a mesh that hasn't loaded yet
+const float ASSET_PLACEHOLDER_SIZE = 0.25f;
+
+enum AssetType
+{
+    ASSET_TEXTURE,
+    ASSET_CUBEMAP,
+    ASSET_MESH
+};
+
+enum AssetState
+{
+    ASSET_QUEUED,
+    ASSET_LOADING,
+    ASSET_DECODED,   // waiting for the main thread to upload it
+    ASSET_STAGING,   // images being copied into pixel buffers
+    ASSET_READY,
+    ASSET_FAILED     // keeps its placeholder
+};
+
+// Loads textures, cube maps and meshes in the background, most important first.
+// Every asset gets its GL object straight away, filled with a placeholder (a flat colour or
+// a small box), so it can be drawn from the first frame. Files are read and decoded on a
+// loader thread, then Update uploads the results into the same GL objects on the main
+// thread, so nothing that holds a texture or buffer name ever has to change.
+// Images go up through pixel buffer objects: the main thread maps a buffer, the loader
+// thread copies the decoded pixels into it, and the next Update has the GPU pull them into
+// the texture with glTexSubImage2D, so the GL thread never copies or converts pixels itself.
+// Each frame only starts ASSET_UPLOAD_BUDGET_BYTES of images and meshes, so a burst of
+// finished assets is spread over several frames instead of hitching one.
+// Textures baked offline to DDS (see Tools/TextureBake.cpp) skip all of that: the loader
+// thread reads the file, and SOIL_direct_load_DDS_from_memory hands the compressed blocks
+// and their mip chain straight to the GL.
+// Textures go through a TextureCache, so asking for a file twice hands back the same texture,
+// and a file whose contents match one already read is never decoded or uploaded again, the
+// first texture is drawn in its place (see GetTexture).
+// Importance comes from where each asset is used: anything in view beats anything out of
+// view, then the nearer the better. The loader thread rather than the job system does the
+// reading, a job blocked on a file would hold up the frame's ParallelFor on whichever worker
+// picked it up.
+class AssetLoader
+{
+private:
+
+    struct Image
+    {
+        unsigned char* pixels;
+        int width;
+        int height;
+    };
+
+    struct Asset;
+
+    // Pixel unpack buffer, reused once the GPU has read it
+    struct UploadBuffer
+    {
+        GLuint buffer;
+        GLsizeiptr size;
+        GLsync fence;
+    };
+
+    // One image on its way through a mapped pixel buffer
+    struct Staging
+    {
+        Asset* asset;
+        int image;
+        UploadBuffer buffer;
+        void* mapped;
+    };
+
+    struct Asset
+    {
+        AssetType type;
+        vector<string> paths;
+        GLuint handle;   // texture, or vertex buffer for meshes
+        AssetState state;
+        float priority;
+
+        // Spheres (centre, radius) the asset is drawn at
+        vector<glm::vec4> uses;
+
+        // Decoded data, freed once uploaded
+        vector<Image> images;
+        vector<GLfloat> vertices;
+
+        // DDS file the texture was baked to, and its contents once read. Cleared if the
+        // driver won't take it, so the source images are loaded instead.
+        string bakedPath;
+        vector<unsigned char> baked;
+
+        // Texture with the same contents this one is drawn as instead of being loaded, 0 if none
+        GLuint shared;
+
+        // Every reference was released while it was loading, deleted once it is done
+        bool released;
+
+        // Images handed to pixel buffers so far, and the ones the loader thread has filled.
+        // A texture only goes up once all of its images are in buffers, so a cube map never
+        // shows a mix of real and placeholder faces.
+        int stagedImages;
+        int validImages;
+        vector<Staging> copied;
+        bool failed;
+
+        // Mesh size, the placeholder's until the real one is uploaded
+        int capacity;
+        int vertexCount;
+        Bounds bounds;
+        Bounds loadedBounds;
+    };
+
+    vector<Asset*> assets;
+    vector<int> decoded;
+    int remaining;
+    TextureCache cache;
+
+    // Buffers waiting for the loader thread to fill them, and filled ones back from it
+    vector<Staging> toCopy;
+    vector<Staging> filled;
+
+    // Main thread only
+    vector<UploadBuffer> freeBuffers;
+    vector<UploadBuffer> busyBuffers;
+    int bufferCount;
+
+    mutex lock;
+    condition_variable workReady;
+    thread loaderThread;
+    bool running;
+
+    // Read the asset's baked DDS file, false if there isn't a usable one
+    static bool LoadBaked(Asset* asset)
+    {
+        if (asset->bakedPath.empty())
+        {
+            return false;
+        }
+
+        ifstream file(asset->bakedPath.c_str(), ios::binary | ios::ate);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        // Named after the source, bakedPath is cleared when the bake is unusable and the profiler
+        // keeps the pointer until it exports
+        CpuScope scope("Read DDS", asset->paths[0].c_str());
+
+        size_t size = (size_t)file.tellg();
+        DDS_header header;
+        file.seekg(0);
+        if (size < sizeof(header) || !file.read((char*)&header, sizeof(header)) || BakedDDSSize(header) != size)
+        {
+            cout << "Asset loader: " << asset->bakedPath << " is not a baked texture, loading the source instead" << endl;
+            return false;
+        }
+
+        if (BakedSourceStamp(header) != SourceStamp(asset->paths))
+        {
+            cout << "Asset loader: " << asset->bakedPath << " was baked from an older source, loading the source instead" << endl;
+            return false;
+        }
+
+        asset->baked.resize(size);
+        memcpy(&asset->baked[0], &header, sizeof(header));
+        if (!file.read((char*)&asset->baked[sizeof(header)], size - sizeof(header)))
+        {
+            asset->baked.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool ReadFile(const string& path, vector<unsigned char>& contents)
+    {
+        ifstream file(path.c_str(), ios::binary | ios::ate);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        contents.resize((size_t)file.tellg());
+        file.seekg(0);
+        return contents.empty() || file.read((char*)&contents[0], contents.size());
+    }
+
+    // Read the baked file or else the source images, and decode them unless another texture
+    // already has the same contents. Returns that texture, or 0 when this one was decoded. The
+    // caller publishes it under the lock, AddUse reads it from the main thread.
+    GLuint LoadTexture(Asset* asset)
+    {
+        vector<vector<unsigned char> > files(asset->paths.size());
+        bool loaded = LoadBaked(asset);
+        uint64_t hash = 0;
+
+        if (loaded)
+        {
+            hash = HashContent(&asset->baked[0], asset->baked.size());
+        }
+        else
+        {
+            CpuScope scope("Read Image", asset->paths[0].c_str());
+
+            loaded = true;
+            hash = HashContent(nullptr, 0);
+            for (size_t i = 0; i < asset->paths.size(); i++)
+            {
+                loaded = ReadFile(asset->paths[i], files[i]) && !files[i].empty() && loaded;
+                if (loaded)
+                {
+                    hash = HashContent(&files[i][0], files[i].size(), hash);
+                }
+            }
+        }
+
+        // Missing files never match, they'd all look the same
+        if (loaded)
+        {
+            GLuint shared = this->cache.MatchContent(asset->handle, hash);
+            if (shared != asset->handle)
+            {
+                vector<unsigned char>().swap(asset->baked);
+                return shared;
+            }
+        }
+
+        if (!asset->baked.empty())
+        {
+            return 0;
+        }
+
+        for (size_t i = 0; i < asset->paths.size(); i++)
+        {
+            CpuScope scope("SOIL_load_image", asset->paths[i].c_str());
+
+            Image image;
+            image.pixels = nullptr;
+            if (!files[i].empty())
+            {
+                image.pixels = SOIL_load_image_from_memory(&files[i][0], (int)files[i].size(), &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+            }
+
+            if (image.pixels != nullptr)
+            {
+                unsigned char* fitted = FitPixelBudget(image.pixels, image.width, image.height);
+                if (fitted != nullptr)
+                {
+                    SOIL_free_image_data(image.pixels);
+                    image.pixels = fitted;
+                }
+            }
+            asset->images.push_back(image);
+
+            if (image.pixels == nullptr)
+            {
+                cout << "Asset loader: failed to load " << asset->paths[i] << endl;
+            }
+        }
+
+        return 0;
+    }
+
+    // Read "x y z" lines of a mesh file
+    static void LoadVertices(Asset* asset)
+    {
+        CpuScope scope("Parse Mesh", asset->paths[0].c_str());
+
+        ifstream file(asset->paths[0].c_str());
+
+        if (!file.is_open())
+        {
+            cout << "Can't open the file " << asset->paths[0] << endl;
+            return;
+        }
+
+        asset->vertices.resize(asset->capacity);
+
+        string line;
+        int i = 0;
+
+        while (!file.eof() && i + 3 <= asset->capacity)
+        {
+            getline(file, line, ' ');
+            asset->vertices[i] = stof(line);
+            i++;
+            getline(file, line, ' ');
+            asset->vertices[i] = stof(line);
+            i++;
+            getline(file, line, '\n');
+            asset->vertices[i] = stof(line);
+            i++;
+        }
+
+        asset->loadedBounds = ComputeBounds(&asset->vertices[0], asset->capacity);
+    }
+
+    // Fill a mapped pixel buffer and let go of the decoded image
+    static void CopyToBuffer(const Staging& staging)
+    {
+        Image& image = staging.asset->images[staging.image];
+        CpuScope scope("Copy To Buffer", staging.asset->paths[staging.image].c_str());
+
+        memcpy(staging.mapped, image.pixels, (size_t)image.width * image.height * 4);
+        SOIL_free_image_data(image.pixels);
+        image.pixels = nullptr;
+    }
+
+    void LoaderLoop()
+    {
+        CpuProfiler::Get().SetThreadName("Loader");
+
+        while (true)
+        {
+            Asset* asset = nullptr;
+            int index = -1;
+            Staging staging;
+            bool copying = false;
+
+            {
+                unique_lock<mutex> guard(this->lock);
+
+                while (this->running)
+                {
+                    // Buffers first, the main thread is waiting on them
+                    if (!this->toCopy.empty())
+                    {
+                        staging = this->toCopy.front();
+                        this->toCopy.erase(this->toCopy.begin());
+                        copying = true;
+                        break;
+                    }
+
+                    // Most important queued asset, ties go to the one added first
+                    for (size_t a = 0; a < this->assets.size(); a++)
+                    {
+                        Asset* candidate = this->assets[a];
+                        if (candidate->state == ASSET_QUEUED && (asset == nullptr || candidate->priority < asset->priority))
+                        {
+                            asset = candidate;
+                            index = (int)a;
+                        }
+                    }
+
+                    if (asset != nullptr)
+                    {
+                        break;
+                    }
+
+                    this->workReady.wait(guard);
+                }
+
+                if (!this->running)
+                {
+                    return;
+                }
+
+                if (!copying)
+                {
+                    asset->state = ASSET_LOADING;
+                }
+            }
+
+            if (copying)
+            {
+                CopyToBuffer(staging);
+
+                lock_guard<mutex> guard(this->lock);
+                this->filled.push_back(staging);
+                continue;
+            }
+
+            // The main thread leaves loading assets alone apart from their priority
+            GLuint shared = 0;
+            if (asset->type == ASSET_MESH)
+            {
+                LoadVertices(asset);
+            }
+            else
+            {
+                shared = this->LoadTexture(asset);
+            }
+
+            lock_guard<mutex> guard(this->lock);
+
+            // Whatever is drawn with this texture is drawn with the shared one now
+            asset->shared = shared;
+            if (asset->shared != 0)
+            {
+                int shared = this->FindTexture(asset->shared);
+                if (shared >= 0)
+                {
+                    Asset* sharedAsset = this->assets[shared];
+                    sharedAsset->uses.insert(sharedAsset->uses.end(), asset->uses.begin(), asset->uses.end());
+                }
+            }
+
+            asset->state = ASSET_DECODED;
+            this->decoded.push_back(index);
+        }
+    }
+
+    // 1x1 texture of a flat colour
+    static void UploadPlaceholderImage(GLenum target, const glm::vec3& colour)
+    {
+        unsigned char pixel[4] =
+        {
+            (unsigned char)(colour.r * 255.0f), (unsigned char)(colour.g * 255.0f), (unsigned char)(colour.b * 255.0f), 255
+        };
+        glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    }
+
+    // Box triangles, 3 floats per vertex like the mesh files
+    static vector<GLfloat> BuildPlaceholderBox(const Bounds& bounds)
+    {
+        static const int faces[36] =
+        {
+            0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5,   0, 4, 5, 0, 5, 1,
+            2, 3, 7, 2, 7, 6,   0, 2, 6, 0, 6, 4,   1, 5, 7, 1, 7, 3
+        };
+
+        vector<GLfloat> vertices;
+        for (int i = 0; i < 36; i++)
+        {
+            int corner = faces[i];
+            vertices.push_back((corner & 4) ? bounds.max.x : bounds.min.x);
+            vertices.push_back((corner & 2) ? bounds.max.y : bounds.min.y);
+            vertices.push_back((corner & 1) ? bounds.max.z : bounds.min.z);
+        }
+
+        return vertices;
+    }
+
+    // Copy a decoded mesh into its vertex buffer, main thread only
+    void UploadMesh(Asset* asset)
+    {
+        CpuScope scope("Upload Mesh", asset->paths[0].c_str());
+
+        bool loaded = !asset->vertices.empty();
+        if (loaded)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, asset->handle);
+            glBufferData(GL_ARRAY_BUFFER, asset->vertices.size() * sizeof(GLfloat), &asset->vertices[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            asset->vertexCount = (int)asset->vertices.size() / 3;
+            asset->bounds = asset->loadedBounds;
+            vector<GLfloat>().swap(asset->vertices);
+        }
+
+        asset->state = loaded ? ASSET_READY : ASSET_FAILED;
+        this->remaining--;
+    }
+
+    // Hand a baked texture's blocks and mips to the GL, main thread only. False if the driver
+    // can't take them (no S3TC), the asset then has to go back for its source images.
+    bool UploadBaked(Asset* asset)
+    {
+        CpuScope scope("Upload DDS", asset->paths[0].c_str());
+
+        bool cubemap = (asset->type == ASSET_CUBEMAP);
+        unsigned int texture = SOIL_direct_load_DDS_from_memory(&asset->baked[0], (int)asset->baked.size(), asset->handle,
+            cubemap ? 0 : SOIL_FLAG_TEXTURE_REPEATS, cubemap ? 1 : 0);
+
+        // SOIL leaves it bound. It sets trilinear filtering over the baked mips, and repeat
+        // wrapping for 2D textures or clamping for cube maps like the source upload
+        GLStats::Get().ForgetTextureBindings();
+        glBindTexture(cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 0);
+
+        size_t bytes = asset->baked.size() - sizeof(DDS_header);
+        vector<unsigned char>().swap(asset->baked);
+
+        if (texture == 0)
+        {
+            cout << "Asset loader: could not upload " << asset->bakedPath << " (" << SOIL_last_result() << "), loading the source instead" << endl;
+            asset->bakedPath.clear();
+            return false;
+        }
+
+        this->CompleteTexture(asset, true, bytes);
+        return true;
+    }
+
+    // A free pixel buffer of at least size bytes, mapped for writing. False when all of them
+    // are still in use.
+    bool AcquireBuffer(GLsizeiptr size, UploadBuffer& buffer, void*& mapped)
+    {
+        if (!this->freeBuffers.empty())
+        {
+            buffer = this->freeBuffers.back();
+            this->freeBuffers.pop_back();
+        }
+        else if (this->bufferCount < ASSET_UPLOAD_BUFFERS)
+        {
+            glGenBuffers(1, &buffer.buffer);
+            buffer.size = 0;
+            this->bufferCount++;
+        }
+        else
+        {
+            return false;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+        if (buffer.size < size)
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            buffer.size = size;
+        }
+
+        // Invalidating tells the driver the old contents are gone, so mapping never waits
+        mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.fence = 0;
+
+        if (mapped == nullptr)
+        {
+            this->freeBuffers.push_back(buffer);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Buffers the GPU has finished reading go back on the free list
+    void RecycleBuffers()
+    {
+        for (size_t i = 0; i < this->busyBuffers.size();)
+        {
+            GLenum status = glClientWaitSync(this->busyBuffers[i].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+            {
+                glDeleteSync(this->busyBuffers[i].fence);
+                this->freeBuffers.push_back(this->busyBuffers[i]);
+                this->busyBuffers.erase(this->busyBuffers.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    // Map buffers for as many of a texture's images as the budget and free buffers allow.
+    // Returns false if some are left for a later frame.
+    bool StageImages(Asset* asset, size_t& bytes, size_t budgetBytes, vector<Staging>& copies)
+    {
+        if (asset->stagedImages == 0)
+        {
+            asset->validImages = 0;
+            for (size_t i = 0; i < asset->images.size(); i++)
+            {
+                if (asset->images[i].pixels != nullptr)
+                {
+                    asset->validImages++;
+                }
+                else
+                {
+                    asset->failed = true;
+                }
+            }
+
+            // Nothing decoded, it keeps the placeholder
+            if (asset->validImages == 0)
+            {
+                this->FinishTexture(asset);
+                return true;
+            }
+        }
+
+        CpuScope scope("Stage Images", asset->paths[0].c_str());
+
+        while (asset->stagedImages < (int)asset->images.size())
+        {
+            const Image& image = asset->images[asset->stagedImages];
+            if (image.pixels == nullptr)
+            {
+                asset->stagedImages++;
+                continue;
+            }
+
+            size_t size = (size_t)image.width * image.height * 4;
+            if (bytes > 0 && bytes + size > budgetBytes)
+            {
+                return false;
+            }
+
+            Staging staging;
+            if (!this->AcquireBuffer((GLsizeiptr)size, staging.buffer, staging.mapped))
+            {
+                return false;
+            }
+
+            staging.asset = asset;
+            staging.image = asset->stagedImages++;
+            copies.push_back(staging);
+            bytes += size;
+        }
+
+        asset->state = ASSET_STAGING;
+        return true;
+    }
+
+    // Every image of the texture is in a pixel buffer, have the GPU copy them in
+    void UploadTexture(Asset* asset)
+    {
+        CpuScope scope("Upload Texture", asset->paths[0].c_str());
+
+        GLenum target = (asset->type == ASSET_CUBEMAP) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+        glBindTexture(target, asset->handle);
+
+        for (size_t i = 0; i < asset->copied.size(); i++)
+        {
+            Staging& staging = asset->copied[i];
+            const Image& image = asset->images[staging.image];
+            GLenum face = (asset->type == ASSET_CUBEMAP) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)staging.image : GL_TEXTURE_2D;
+
+            // Storage at the real size first, with no unpack buffer bound so nothing is read
+            glTexImage2D(face, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer.buffer);
+            if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+            {
+                glTexSubImage2D(face, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)0);
+            }
+            else
+            {
+                // The buffer's contents were lost, leaves this image empty
+                asset->failed = true;
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+            // Refilled once the GPU has read it
+            staging.buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            this->busyBuffers.push_back(staging.buffer);
+        }
+
+        glBindTexture(target, 0);
+        this->FinishTexture(asset);
+    }
+
+    void FinishTexture(Asset* asset)
+    {
+        // Cube maps were never mipmapped
+        bool mipmapped = (asset->type == ASSET_TEXTURE && !asset->failed);
+        if (mipmapped)
+        {
+            glBindTexture(GL_TEXTURE_2D, asset->handle);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < asset->images.size(); i++)
+        {
+            bytes += (size_t)asset->images[i].width * asset->images[i].height * 4;
+        }
+
+        asset->copied.clear();
+        asset->images.clear();
+        this->CompleteTexture(asset, !asset->failed, mipmapped ? bytes * 4 / 3 : bytes);
+    }
+
+    // A texture is done with, bytes is the texture memory it ended up using
+    void CompleteTexture(Asset* asset, bool loaded, size_t bytes)
+    {
+        asset->state = loaded ? ASSET_READY : ASSET_FAILED;
+        this->remaining--;
+
+        if (loaded && bytes > 0)
+        {
+            this->cache.SetBytes(asset->handle, bytes);
+        }
+
+        if (asset->released)
+        {
+            this->DeleteTexture(asset);
+        }
+    }
+
+    // A new texture name. The GL can hand back the name of a deleted placeholder, which callers
+    // still use to look up the texture shared in its place, so those are skipped.
+    GLuint GenTexture()
+    {
+        vector<GLuint> skipped;
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        while (this->cache.Contains(texture))
+        {
+            skipped.push_back(texture);
+            glGenTextures(1, &texture);
+        }
+
+        if (!skipped.empty())
+        {
+            glDeleteTextures((GLsizei)skipped.size(), &skipped[0]);
+        }
+        return texture;
+    }
+
+    void DeleteTexture(Asset* asset)
+    {
+        glDeleteTextures(1, &asset->handle);
+
+        // The name can be handed out again, don't let FindTexture match it
+        lock_guard<mutex> guard(this->lock);
+        asset->handle = 0;
+    }
+
+    AssetState GetState(int asset)
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->assets[asset]->state;
+    }
+
+    int Add(Asset* asset)
+    {
+        asset->state = ASSET_QUEUED;
+        asset->priority = ASSET_HIDDEN_PENALTY * 2.0f;
+        asset->stagedImages = 0;
+        asset->validImages = 0;
+        asset->failed = false;
+        asset->shared = 0;
+        asset->released = false;
+
+        lock_guard<mutex> guard(this->lock);
+        this->assets.push_back(asset);
+        this->remaining++;
+        this->workReady.notify_one();
+        return (int)this->assets.size() - 1;
+    }
+
+    // Sphere against the frustum planes of a view projection matrix
+    static bool InView(const glm::mat4& viewProjection, const glm::vec4& sphere)
+    {
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; r++)
+        {
+            rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+        }
+
+        for (int p = 0; p < 6; p++)
+        {
+            glm::vec4 plane = (p % 2 == 0) ? rows[3] + rows[p / 2] : rows[3] - rows[p / 2];
+            float distance = glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w;
+            if (distance < -sphere.w * glm::length(glm::vec3(plane)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+public:
+
+    AssetLoader() : remaining(0), bufferCount(0), running(true)
+    {
+        this->loaderThread = thread(&AssetLoader::LoaderLoop, this);
+    }
+
+    ~AssetLoader()
+    {
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->running = false;
+        }
+        this->workReady.notify_all();
+        this->loaderThread.join();
+
+        for (size_t a = 0; a < this->assets.size(); a++)
+        {
+            for (size_t i = 0; i < this->assets[a]->images.size(); i++)
+            {
+                SOIL_free_image_data(this->assets[a]->images[i].pixels);
+            }
+            delete this->assets[a];
+        }
+    }
+
+    // Queue a texture (forced to RGBA) and return its GL name, a flat placeholder colour until it
+    // loads. Asking for the same file again returns the same texture with one more reference.
+    GLuint AddTexture(const char* path, const glm::vec3& placeholder = glm::vec3(0.5f))
+    {
+        GLuint cached = this->cache.Acquire(path, TEXTURE_CACHE_2D);
+        if (cached != 0)
+        {
+            return cached;
+        }
+
+        Asset* asset = new Asset();
+        asset->type = ASSET_TEXTURE;
+        asset->paths.push_back(path);
+        asset->bakedPath = BakedTexturePath(path);
+        asset->capacity = 0;
+        asset->vertexCount = 0;
+
+        asset->handle = this->GenTexture();
+        glBindTexture(GL_TEXTURE_2D, asset->handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        UploadPlaceholderImage(GL_TEXTURE_2D, placeholder);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Cached before the loader thread can see it
+        GLuint texture = asset->handle;
+        this->cache.Insert(path, TEXTURE_CACHE_2D, texture);
+        this->Add(asset);
+        return texture;
+    }
+
+    // Queue the six faces of a cube map (+x, -x, +y, -y, +z, -z) and return its GL name
+    GLuint AddCubemap(const vector<string>& faces, const glm::vec3& placeholder = glm::vec3(0.5f))
+    {
+        string key;
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            key += faces[i] + ";";
+        }
+
+        GLuint cached = this->cache.Acquire(key, TEXTURE_CACHE_CUBEMAP);
+        if (cached != 0)
+        {
+            return cached;
+        }
+
+        Asset* asset = new Asset();
+        asset->type = ASSET_CUBEMAP;
+        asset->paths = faces;
+        asset->bakedPath = BakedCubemapPath(faces);
+        asset->capacity = 0;
+        asset->vertexCount = 0;
+
+        asset->handle = this->GenTexture();
+        glBindTexture(GL_TEXTURE_CUBE_MAP, asset->handle);
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            UploadPlaceholderImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, placeholder);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        GLuint texture = asset->handle;
+        this->cache.Insert(key, TEXTURE_CACHE_CUBEMAP, texture);
+        this->Add(asset);
+        return texture;
+    }
+
+    // Queue a mesh file of capacity floats (3 per vertex), returns the asset. Its vertex buffer
+    // holds a small box until the mesh loads.
+    int AddMesh(const char* path, int capacity)
+    {
+        Asset* asset = new Asset();
+        asset->type = ASSET_MESH;
+        asset->paths.push_back(path);
+        asset->capacity = capacity;
+        asset->bounds.min = glm::vec3(-ASSET_PLACEHOLDER_SIZE, 0.0f, -ASSET_PLACEHOLDER_SIZE);
+        asset->bounds.max = glm::vec3(ASSET_PLACEHOLDER_SIZE, 2.0f * ASSET_PLACEHOLDER_SIZE, ASSET_PLACEHOLDER_SIZE);
+
+        vector<GLfloat> box = BuildPlaceholderBox(asset->bounds);
+        asset->vertexCount = (int)box.size() / 3;
+
+        glGenBuffers(1, &asset->handle);
+        glBindBuffer(GL_ARRAY_BUFFER, asset->handle);
+        glBufferData(GL_ARRAY_BUFFER, box.size() * sizeof(GLfloat), &box[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        return this->Add(asset);
+    }
+
+    // Tell the loader an asset is drawn somewhere, textures are found with FindTexture
+    void AddUse(int asset, const glm::vec3& centre, float radius)
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->assets[asset]->uses.push_back(glm::vec4(centre, radius));
+
+        // Or wherever it is drawn it is the shared texture that needs loading
+        GLuint shared = this->assets[asset]->shared;
+        int sharedAsset = (shared != 0) ? this->FindTexture(shared) : -1;
+        if (sharedAsset >= 0)
+        {
+            this->assets[sharedAsset]->uses.push_back(glm::vec4(centre, radius));
+        }
+    }
+
+    // Texture to draw in place of one the loader returned: the one with the same contents if
+    // it found one, otherwise the texture itself
+    GLuint GetTexture(GLuint texture)
+    {
+        return this->cache.GetShared(texture);
+    }
+
+    // Give up a reference from AddTexture or AddCubemap, the texture is deleted with the last
+    void ReleaseTexture(GLuint texture)
+    {
+        vector<GLuint> unused;
+        this->cache.Release(texture, unused);
+
+        for (size_t i = 0; i < unused.size(); i++)
+        {
+            int asset = this->FindTexture(unused[i]);
+            if (asset < 0)
+            {
+                continue;
+            }
+
+            AssetState state = this->GetState(asset);
+            if (state == ASSET_READY || state == ASSET_FAILED)
+            {
+                this->DeleteTexture(this->assets[asset]);
+            }
+            else
+            {
+                this->assets[asset]->released = true;
+            }
+        }
+    }
+
+    const TextureCache& GetTextureCache()
+    {
+        return this->cache;
+    }
+
+    // Asset a texture name came from, -1 if the loader didn't make it
+    int FindTexture(GLuint texture)
+    {
+        for (size_t a = 0; a < this->assets.size(); a++)
+        {
+            if (this->assets[a]->type != ASSET_MESH && this->assets[a]->handle == texture)
+            {
+                return (int)a;
+            }
+        }
+        return -1;
+    }
+
+    // Once per frame: reorder what is still queued for the current camera, upload textures
+    // whose pixel buffers the loader thread has filled, then start on decoded assets, most
+    // important first, until budgetBytes are on their way. Returns how many became ready.
+    int Update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection, size_t budgetBytes = ASSET_UPLOAD_BUDGET_BYTES)
+    {
+        if (this->remaining == 0)
+        {
+            return 0;
+        }
+
+        vector<int> uploads;
+        vector<Staging> copies;
+        {
+            lock_guard<mutex> guard(this->lock);
+
+            for (size_t a = 0; a < this->assets.size(); a++)
+            {
+                Asset* asset = this->assets[a];
+                if (asset->state != ASSET_QUEUED)
+                {
+                    continue;
+                }
+
+                asset->priority = ASSET_HIDDEN_PENALTY * 2.0f;
+                for (size_t u = 0; u < asset->uses.size(); u++)
+                {
+                    const glm::vec4& use = asset->uses[u];
+                    float distance = max(glm::length(glm::vec3(use) - cameraPosition) - use.w, 0.0f);
+                    if (!InView(viewProjection, use))
+                    {
+                        distance += ASSET_HIDDEN_PENALTY;
+                    }
+                    asset->priority = min(asset->priority, distance);
+                }
+            }
+
+            uploads.swap(this->decoded);
+            copies.swap(this->filled);
+        }
+
+        int ready = 0;
+
+        for (size_t i = 0; i < copies.size(); i++)
+        {
+            Asset* asset = copies[i].asset;
+            asset->copied.push_back(copies[i]);
+
+            if ((int)asset->copied.size() == asset->validImages)
+            {
+                this->UploadTexture(asset);
+                ready += (asset->state == ASSET_READY) ? 1 : 0;
+            }
+        }
+
+        this->RecycleBuffers();
+
+        sort(uploads.begin(), uploads.end(), [this](int a, int b)
+        {
+            return this->assets[a]->priority < this->assets[b]->priority;
+        });
+
+        size_t bytes = 0;
+        size_t next = 0;
+        vector<Staging> stagings;
+        vector<Asset*> requeued;
+        vector<int> waiting;
+
+        for (; next < uploads.size(); next++)
+        {
+            Asset* asset = this->assets[uploads[next]];
+
+            // Textures with the contents of another one finish with it, nothing to upload
+            if (asset->shared != 0)
+            {
+                int shared = this->FindTexture(asset->shared);
+                AssetState state = (shared >= 0) ? this->GetState(shared) : ASSET_FAILED;
+                if (state == ASSET_READY || state == ASSET_FAILED)
+                {
+                    this->CompleteTexture(asset, state == ASSET_READY, 0);
+                    ready += (state == ASSET_READY) ? 1 : 0;
+
+                    // Counted as ready, so the caller swaps in the shared texture before drawing
+                    // again and the placeholder can go. Its name stays a key of the cache.
+                    if (state == ASSET_READY && asset->handle != 0)
+                    {
+                        this->DeleteTexture(asset);
+                    }
+                }
+                else
+                {
+                    waiting.push_back(uploads[next]);
+                }
+                continue;
+            }
+
+            if (asset->type == ASSET_MESH)
+            {
+                size_t size = asset->vertices.size() * sizeof(GLfloat);
+                if (bytes > 0 && bytes + size > budgetBytes)
+                {
+                    break;
+                }
+
+                this->UploadMesh(asset);
+                ready += (asset->state == ASSET_READY) ? 1 : 0;
+                bytes += size;
+            }
+            else if (!asset->baked.empty())
+            {
+                size_t size = asset->baked.size();
+                if (bytes > 0 && bytes + size > budgetBytes)
+                {
+                    break;
+                }
+
+                if (this->UploadBaked(asset))
+                {
+                    ready++;
+                }
+                else
+                {
+                    requeued.push_back(asset);
+                }
+                bytes += size;
+            }
+            else if (!this->StageImages(asset, bytes, budgetBytes, stagings))
+            {
+                break;
+            }
+        }
+
+        // Whatever didn't fit waits for the next frame
+        lock_guard<mutex> guard(this->lock);
+        this->decoded.insert(this->decoded.end(), uploads.begin() + next, uploads.end());
+        this->decoded.insert(this->decoded.end(), waiting.begin(), waiting.end());
+        for (size_t i = 0; i < requeued.size(); i++)
+        {
+            requeued[i]->state = ASSET_QUEUED;
+        }
+        if (!stagings.empty() || !requeued.empty())
+        {
+            this->toCopy.insert(this->toCopy.end(), stagings.begin(), stagings.end());
+            this->workReady.notify_one();
+        }
+
+        return ready;
+    }
+
+    // Block until everything has loaded and been uploaded, ignoring the budget
+    void Finish()
+    {
+        while (this->remaining > 0)
+        {
+            this->Update(glm::vec3(0.0f), glm::mat4(1.0f), SIZE_MAX);
+
+            if (this->remaining > 0)
+            {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        }
+    }
+
+    // Every asset uploaded (or failed and left as a placeholder)
+    bool IsComplete()
+    {
+        return this->remaining == 0;
+    }
+
+    int GetRemaining()
+    {
+        return this->remaining;
+    }
+
+    bool IsReady(int asset)
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->assets[asset]->state == ASSET_READY;
+    }
+
+    // Vertex buffer of a mesh asset
+    GLuint GetBuffer(int asset)
+    {
+        return this->assets[asset]->handle;
+    }
+
+    // Vertex count and bounds of a mesh, the placeholder box's until it is ready
+    int GetVertexCount(int asset)
+    {
+        return this->assets[asset]->vertexCount;
+    }
+
+    Bounds GetBounds(int asset)
+    {
+        return this->assets[asset]->bounds;
+    }
+};
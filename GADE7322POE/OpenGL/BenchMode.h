@@ -0,0 +1,192 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "SampleStats.h"
+
+// Frames measured, and frames rendered first and left out while caches and drivers settle
+const int BENCH_DEFAULT_FRAMES = 600;
+const int BENCH_DEFAULT_WARMUP_FRAMES = 30;
+
+// Simulated time per frame, fixed so every run follows exactly the same path
+const double BENCH_FRAME_TIME = 1.0 / 60.0;
+
+// Camera orbit around the board
+const float BENCH_ORBIT_RADIUS = 12.0f;
+const float BENCH_ORBIT_HEIGHT = 5.0f;
+
+// Command line options for --bench and input recording
+struct BenchOptions
+{
+    bool enabled;
+    int frames;
+    int warmupFrames;
+    string output;
+    string record;
+    string replay;
+};
+
+// --bench [--frames N] [--warmup N] [--output file.json]
+// --record input.bin writes the session's input, --replay input.bin plays one back (with
+// --bench the replay stands in for the scripted camera path and sets the frame count)
+inline BenchOptions ParseBenchOptions(int argc, char* argv[])
+{
+    BenchOptions options;
+    options.enabled = false;
+    options.frames = BENCH_DEFAULT_FRAMES;
+    options.warmupFrames = BENCH_DEFAULT_WARMUP_FRAMES;
+    options.output = "bench.json";
+    options.record = "";
+    options.replay = "";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+        {
+            options.enabled = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            options.frames = max(atoi(argv[++i]), 1);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            options.warmupFrames = max(atoi(argv[++i]), 0);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            options.output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            options.record = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            options.replay = argv[++i];
+        }
+        else
+        {
+            cout << "Unknown argument " << argv[i] << endl;
+        }
+    }
+
+    return options;
+}
+
+// Scripted camera for the benchmark, t runs from 0 to 1 over the run.
+// Orbits the board once, dipping low over the pieces and rising to look down on the whole
+// board twice per orbit, always facing the centre.
+inline CameraState BenchCameraPath(float t)
+{
+    float angle = t * 2.0f * glm::pi<float>();
+    float radius = BENCH_ORBIT_RADIUS + 3.0f * cos(angle * 2.0f);
+    float height = BENCH_ORBIT_HEIGHT + 3.0f * sin(angle * 2.0f);
+
+    CameraState state;
+    state.position = glm::vec3(radius * cos(angle), height, radius * sin(angle));
+    state.yaw = glm::degrees(angle) + 180.0f;
+    state.pitch = -glm::degrees(atan2(height, radius));
+    state.zoom = ZOOM;
+    return state;
+}
+
+// Collects the benchmark timings and writes them out as JSON
+class BenchRecorder
+{
+private:
+    double startupMs;
+    double firstFrameMs;
+    double assetsLoadedMs;
+    vector<double> cpuFrameMs;
+    vector<double> gpuFrameMs;
+
+    static void WriteStats(ofstream& file, const char* name, const vector<double>& values)
+    {
+        file << "  \"" << name << "\": { \"frames\": " << values.size()
+            << ", \"mean\": " << SampleMean(values)
+            << ", \"p50\": " << SamplePercentile(values, 50.0) << ", \"p99\": " << SamplePercentile(values, 99.0)
+            << ", \"max\": " << SamplePercentile(values, 100.0) << " }";
+    }
+
+public:
+
+    BenchRecorder() : startupMs(0.0), firstFrameMs(0.0), assetsLoadedMs(0.0)
+    {
+    }
+
+    // Process start until the first frame begins
+    void SetStartup(double milliseconds)
+    {
+        this->startupMs = milliseconds;
+    }
+
+    // Process start until the first frame is swapped
+    void SetFirstFrame(double milliseconds)
+    {
+        this->firstFrameMs = milliseconds;
+    }
+
+    // Process start until every asset has loaded
+    void SetAssetsLoaded(double milliseconds)
+    {
+        this->assetsLoadedMs = milliseconds;
+    }
+
+    void AddCpuFrame(double milliseconds)
+    {
+        this->cpuFrameMs.push_back(milliseconds);
+    }
+
+    // GPU times come back from the profiler all at once at the end, empty without timer queries
+    void SetGpuFrames(const vector<double>& milliseconds)
+    {
+        this->gpuFrameMs = milliseconds;
+    }
+
+    double GetCpuMean()
+    {
+        return SampleMean(this->cpuFrameMs);
+    }
+
+    double GetGpuMean()
+    {
+        return SampleMean(this->gpuFrameMs);
+    }
+
+    // All times in milliseconds
+    bool WriteJson(const string& path, const char* renderer, int width, int height)
+    {
+        ofstream file(path.c_str());
+        if (!file.is_open())
+        {
+            cout << "Benchmark: could not write " << path << endl;
+            return false;
+        }
+
+        file << "{" << endl;
+        file << "  \"renderer\": \"" << (renderer != nullptr ? renderer : "unknown") << "\"," << endl;
+        file << "  \"width\": " << width << "," << endl;
+        file << "  \"height\": " << height << "," << endl;
+        file << "  \"startupMs\": " << this->startupMs << "," << endl;
+        file << "  \"firstFrameMs\": " << this->firstFrameMs << "," << endl;
+        file << "  \"assetsLoadedMs\": " << this->assetsLoadedMs << "," << endl;
+        WriteStats(file, "cpuFrameMs", this->cpuFrameMs);
+        file << "," << endl;
+        WriteStats(file, "gpuFrameMs", this->gpuFrameMs);
+        file << endl << "}" << endl;
+        return true;
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+using namespace std;
+
+// Timing shared by the benchmarks
+
+// Best of runs, in ms
+template <typename Function>
+double Time(int runs, Function function)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        function();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+// Best of runs, in ms, calling setup untimed before each one (e.g. to restore the input of
+// something that works in place)
+template <typename Setup, typename Function>
+double Time(int runs, Setup setup, Function function)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        setup();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        function();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
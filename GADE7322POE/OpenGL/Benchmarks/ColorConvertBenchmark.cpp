@@ -0,0 +1,185 @@
+// Headless benchmark and correctness check for SOIL2's color space conversions in
+// SOIL2/image_helper.c: RGB <-> YCoCg, NTSC safe scaling and RGBE -> RGBdivA / RGBdivA2.
+// Every conversion is first run on images built to hit the edge cases (every byte value, every
+// RGBE exponent, all black HDR images rescaled to their max, sizes that leave a scalar tail) on
+// the plain C loops and each SIMD path the CPU has, checking every path gives the same bytes.
+// Then the shipped textures are timed on each path, in MPix/s. Run from the OpenGL folder so the
+// default images are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/color_convert_benchmark [runs] [image...]
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+#include "SOIL2/image_helper.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+#include "BenchmarkTime.h"
+
+const char* LEVEL_NAMES[] = { "scalar", "SSE2  ", "AVX   ", "AVX2  " };
+
+struct Conversion
+{
+    const char* name;
+    int minChannels, maxChannels;
+    bool rgbe;
+    void (*convert)(unsigned char* pixels, int width, int height, int channels);
+};
+
+const Conversion CONVERSIONS[] =
+{
+    { "RGB -> YCoCg   ", 3, 4, false, [](unsigned char* p, int w, int h, int c) { convert_RGB_to_YCoCg(p, w, h, c); } },
+    { "YCoCg -> RGB   ", 3, 4, false, [](unsigned char* p, int w, int h, int c) { convert_YCoCg_to_RGB(p, w, h, c); } },
+    { "NTSC safe      ", 1, 4, false, [](unsigned char* p, int w, int h, int c) { scale_image_RGB_to_NTSC_safe(p, w, h, c); } },
+    { "RGBdivA        ", 4, 4, true, [](unsigned char* p, int w, int h, int) { RGBE_to_RGBdivA(p, w, h, 0); } },
+    { "RGBdivA, max   ", 4, 4, true, [](unsigned char* p, int w, int h, int) { RGBE_to_RGBdivA(p, w, h, 1); } },
+    { "RGBdivA2       ", 4, 4, true, [](unsigned char* p, int w, int h, int) { RGBE_to_RGBdivA2(p, w, h, 0); } },
+    { "RGBdivA2, max  ", 4, 4, true, [](unsigned char* p, int w, int h, int) { RGBE_to_RGBdivA2(p, w, h, 1); } },
+};
+const int CONVERSION_COUNT = sizeof(CONVERSIONS) / sizeof(CONVERSIONS[0]);
+
+// Convert a copy of pixels on one SIMD level
+vector<unsigned char> Convert(const Conversion& conversion, const vector<unsigned char>& pixels, int width, int height, int channels, int level)
+{
+    vector<unsigned char> output(pixels);
+    set_image_SIMD_level(level);
+    conversion.convert(&output[0], width, height, channels);
+    return output;
+}
+
+// Test images: every byte value in every channel, random bytes, and for RGBE every exponent,
+// small exponents (denormal scales) and black
+vector<vector<unsigned char> > TestImages(int width, int height, int channels, bool rgbe)
+{
+    vector<vector<unsigned char> > images(rgbe ? 4 : 2, vector<unsigned char>((size_t)width * height * channels));
+    for (size_t i = 0; i < images[0].size(); i++)
+    {
+        images[0][i] = (unsigned char)(i / channels + i % channels * 85);
+        images[1][i] = (unsigned char)rand();
+        if (rgbe)
+        {
+            bool exponent = i % 4 == 3;
+            images[2][i] = (unsigned char)(exponent ? rand() % 3 : rand());
+            images[3][i] = (unsigned char)(exponent ? 0 : rand() % 2);
+        }
+    }
+    return images;
+}
+
+// Best of runs, in MPix/s. The conversions work in place, so each run starts from a fresh copy.
+double Throughput(const Conversion& conversion, const vector<unsigned char>& pixels, int width, int height, int channels, int runs)
+{
+    vector<unsigned char> output(pixels.size());
+    double ms = Time(runs, [&]() { output = pixels; }, [&]() { conversion.convert(&output[0], width, height, channels); });
+    return (double)width * height / 1e3 / ms;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/Paper.png");
+        images.push_back("res/images/Skyboxs/Pink/px.png");
+    }
+
+    int best = set_image_SIMD_level(-1);
+    bool exact = true;
+    int checked = 0;
+
+    // Odd sizes so every path also leaves a scalar tail
+    const int SIZES[][2] = { { 1, 1 }, { 7, 3 }, { 64, 4 }, { 97, 31 }, { 256, 256 } };
+    for (int c = 0; c < CONVERSION_COUNT; c++)
+    {
+        const Conversion& conversion = CONVERSIONS[c];
+        for (int channels = conversion.minChannels; channels <= conversion.maxChannels; channels++)
+        {
+            for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++)
+            {
+                int width = SIZES[s][0];
+                int height = SIZES[s][1];
+                vector<vector<unsigned char> > tests = TestImages(width, height, channels, conversion.rgbe);
+                for (size_t t = 0; t < tests.size(); t++)
+                {
+                    vector<unsigned char> reference = Convert(conversion, tests[t], width, height, channels, IMAGE_SIMD_NONE);
+                    for (int level = IMAGE_SIMD_SSE2; level <= best; level++)
+                    {
+                        checked++;
+                        if (Convert(conversion, tests[t], width, height, channels, level) != reference)
+                        {
+                            exact = false;
+                            cout << conversion.name << LEVEL_NAMES[level] << " differs from scalar on test image " << t << ", "
+                                << width << "x" << height << "x" << channels << endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    cout << checked << " conversions checked against the scalar code" << endl;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        for (int channels = 3; channels <= 4; channels++)
+        {
+            int width, height, fileChannels;
+            unsigned char* loaded = stbi_load(images[i].c_str(), &width, &height, &fileChannels, channels);
+            if (loaded == nullptr)
+            {
+                cout << "Color convert benchmark: could not load " << images[i] << endl;
+                break;
+            }
+
+            vector<unsigned char> pixels(loaded, loaded + (size_t)width * height * channels);
+            stbi_image_free(loaded);
+
+            cout << images[i] << "  " << width << "x" << height << "x" << channels << endl;
+
+            for (int c = 0; c < CONVERSION_COUNT; c++)
+            {
+                const Conversion& conversion = CONVERSIONS[c];
+                if (channels < conversion.minChannels || channels > conversion.maxChannels)
+                {
+                    continue;
+                }
+
+                // The texture's bytes read as RGBE
+                vector<unsigned char> reference = Convert(conversion, pixels, width, height, channels, IMAGE_SIMD_NONE);
+                double scalar = 0.0;
+                cout << "    " << conversion.name;
+                for (int level = IMAGE_SIMD_NONE; level <= best; level++)
+                {
+                    if (level == IMAGE_SIMD_AVX)
+                    {
+                        // Nothing here uses AVX without AVX2
+                        continue;
+                    }
+
+                    set_image_SIMD_level(level);
+                    double mpix = Throughput(conversion, pixels, width, height, channels, runs);
+                    scalar = level == IMAGE_SIMD_NONE ? mpix : scalar;
+
+                    bool same = Convert(conversion, pixels, width, height, channels, level) == reference;
+                    exact = exact && same;
+
+                    cout << "  " << LEVEL_NAMES[level] << " " << mpix << " MPix/s";
+                    if (level != IMAGE_SIMD_NONE)
+                    {
+                        cout << " x" << mpix / scalar << (same ? "" : " DIFFERS FROM SCALAR");
+                    }
+                }
+                cout << endl;
+            }
+        }
+    }
+
+    set_image_SIMD_level(-1);
+    cout << (exact ? "All SIMD output matches the scalar conversions" : "Output does NOT match the scalar conversions") << endl;
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,91 @@
+// Headless benchmark for the CPU scope profiler (CpuProfiler.h).
+// Measures what a recorded scope costs on one thread and with every thread recording at once,
+// against an empty loop, then writes the events out as a Chrome trace, by default next to the
+// executable in the build directory:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/cpu_profiler_benchmark [scopes] [threads] [trace.json]
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+using namespace std;
+
+#include "CpuProfiler.h"
+
+// Set by CMake to a path in the build directory
+#ifndef CPU_PROFILER_BENCHMARK_TRACE
+#define CPU_PROFILER_BENCHMARK_TRACE "cpu_profiler_benchmark.json"
+#endif
+
+typedef chrono::steady_clock Clock;
+
+// Keeps the empty loop from being optimised away
+volatile int sink = 0;
+
+double ScopesPerThread(int scopes)
+{
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < scopes; i++)
+    {
+        CpuScope scope("Benchmark Scope");
+        sink = i;
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / scopes;
+}
+
+double EmptyLoop(int scopes)
+{
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < scopes; i++)
+    {
+        sink = i;
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / scopes;
+}
+
+int main(int argc, char* argv[])
+{
+    int scopes = argc > 1 ? atoi(argv[1]) : 2000000;
+    int threads = argc > 2 ? atoi(argv[2]) : (int)max(thread::hardware_concurrency(), 2u);
+    const char* tracePath = argc > 3 ? argv[3] : CPU_PROFILER_BENCHMARK_TRACE;
+
+    CpuProfiler::Get().SetThreadName("Main");
+
+    // First call registers the thread, keep it out of the timing
+    ScopesPerThread(1000);
+
+    double baseline = EmptyLoop(scopes);
+    double single = ScopesPerThread(scopes);
+    cout << "1 thread:   " << single - baseline << " ns per scope" << endl;
+
+    vector<double> perThread(threads);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([t, scopes, &perThread]()
+        {
+            CpuProfiler::Get().SetThreadName("Worker");
+            perThread[t] = ScopesPerThread(scopes);
+        }));
+    }
+
+    double worst = 0.0;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+        worst = max(worst, perThread[t] - baseline);
+    }
+    cout << threads << " threads:  " << worst << " ns per scope (slowest thread"
+        << (threads > (int)thread::hardware_concurrency() ? ", more threads than cores so this is wall time" : "") << ")" << endl;
+
+    CpuProfiler::Get().SetEnabled(false);
+    double disabled = ScopesPerThread(scopes);
+    cout << "disabled:   " << disabled - baseline << " ns per scope" << endl;
+
+    if (CpuProfiler::Get().WriteChromeTrace(tracePath))
+    {
+        cout << CpuProfiler::Get().GetEventCount() << " events written to " << tracePath << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+// Headless benchmark for SOIL2's DXT compressor (SOIL2/image_DXT.c).
+// Compresses the shipped textures to DXT1 and DXT5 with the plain C block compressor and each
+// SIMD path the CPU has, checks every path gives byte for byte the same blocks, and prints
+// throughput in MPix/s. Then compresses the largest image on 1, 2, 4... threads up to at least
+// 16 to show how the block rows scale across cores. Run from the OpenGL folder so the default
+// images are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/dxt_benchmark [runs] [image...]
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+extern "C"
+{
+#include "SOIL2/image_DXT.h"
+}
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+const char* LEVEL_NAMES[] = { "scalar", "SSE2  ", "AVX2  " };
+
+// Best of runs, in MPix/s, with the output of the last run
+double Compress(const unsigned char* pixels, int width, int height, bool dxt5, int runs, vector<unsigned char>& output)
+{
+    double best = 0.0;
+    for (int run = 0; run < runs; run++)
+    {
+        int size = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        unsigned char* blocks = dxt5 ? convert_image_to_DXT5(pixels, width, height, 4, &size)
+            : convert_image_to_DXT1(pixels, width, height, 4, &size);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        output.assign(blocks, blocks + size);
+        free(blocks);
+
+        double mpix = (double)width * height / 1e6 / seconds;
+        best = mpix > best ? mpix : best;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/Light square.png");
+        images.push_back("res/images/Dark square 2.png");
+        images.push_back("res/images/Paper.png");
+        images.push_back("res/images/water.png");
+        images.push_back("res/images/Skyboxs/Pink/px.png");
+    }
+
+    int best = set_DXT_SIMD_level(-1);
+    bool exact = true;
+
+    // SIMD paths are compared on one thread, scaling is measured after
+    set_DXT_thread_count(1);
+
+    string largest;
+    int largestPixels = 0;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(images[i].c_str(), &width, &height, &channels, 4);
+        if (pixels == nullptr)
+        {
+            cout << "DXT benchmark: could not load " << images[i] << endl;
+            continue;
+        }
+
+        cout << images[i] << "  " << width << "x" << height << endl;
+
+        if (width * height > largestPixels)
+        {
+            largest = images[i];
+            largestPixels = width * height;
+        }
+
+        for (int dxt5 = 0; dxt5 < 2; dxt5++)
+        {
+            vector<unsigned char> reference;
+            double scalar = 0.0;
+
+            for (int level = DXT_SIMD_NONE; level <= best; level++)
+            {
+                set_DXT_SIMD_level(level);
+
+                vector<unsigned char> output;
+                double mpix = Compress(pixels, width, height, dxt5 != 0, runs, output);
+
+                bool same = true;
+                if (level == DXT_SIMD_NONE)
+                {
+                    reference.swap(output);
+                    scalar = mpix;
+                }
+                else
+                {
+                    same = output == reference;
+                    exact = exact && same;
+                }
+
+                cout << "    " << (dxt5 ? "DXT5 " : "DXT1 ") << LEVEL_NAMES[level] << "  " << mpix << " MPix/s  x"
+                    << mpix / scalar << (same ? "" : "  OUTPUT DIFFERS FROM SCALAR") << endl;
+            }
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    set_DXT_SIMD_level(-1);
+
+    int width, height, channels;
+    unsigned char* pixels = largest.empty() ? nullptr : stbi_load(largest.c_str(), &width, &height, &channels, 4);
+    if (pixels != nullptr)
+    {
+        int cores = (int)thread::hardware_concurrency();
+        int maxThreads = cores > 16 ? cores : 16;
+        cout << largest << " on " << cores << " cores, " << LEVEL_NAMES[best] << endl;
+
+        for (int dxt5 = 0; dxt5 < 2; dxt5++)
+        {
+            vector<unsigned char> reference;
+            double single = 0.0;
+
+            for (int threads = 1; threads <= maxThreads; threads *= 2)
+            {
+                set_DXT_thread_count(threads);
+
+                vector<unsigned char> output;
+                double mpix = Compress(pixels, width, height, dxt5 != 0, runs, output);
+
+                bool same = true;
+                if (threads == 1)
+                {
+                    reference.swap(output);
+                    single = mpix;
+                }
+                else
+                {
+                    same = output == reference;
+                    exact = exact && same;
+                }
+
+                cout << "    " << (dxt5 ? "DXT5 " : "DXT1 ") << threads << " threads  " << mpix << " MPix/s  x"
+                    << mpix / single << (same ? "" : "  OUTPUT DIFFERS FROM ONE THREAD") << endl;
+            }
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    set_DXT_thread_count(0);
+    cout << (exact ? "All SIMD and threaded output matches the scalar compressor" : "Output does NOT match the scalar compressor") << endl;
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,50 @@
+// Headless benchmark for the frame rate limiter (FramePacer.h).
+// Runs fake frames with a little busy work against a frame rate cap and compares how close
+// sleeping alone and sleep-then-spin get to the target frame time:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/frame_pacer_benchmark
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+#include "FramePacer.h"
+
+// Stand in for a frame's CPU work
+void BusyWork(double seconds)
+{
+    chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+    while (chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+void Run(const char* name, double targetFps, bool spin, int frames, double workMs)
+{
+    FramePacer pacer(targetFps);
+    pacer.SetSpin(spin);
+
+    for (int frame = 0; frame <= frames; frame++)
+    {
+        pacer.BeginFrame();
+        BusyWork(workMs / 1000.0 * (0.5 + (frame % 7) / 6.0));
+        pacer.Limit();
+    }
+
+    cout << name << "  target " << 1000.0 / targetFps << " ms  mean " << pacer.GetMean()
+        << " ms  p50 " << pacer.GetPercentile(50.0) << " ms  p99 " << pacer.GetPercentile(99.0)
+        << " ms  max " << pacer.GetPercentile(100.0) << " ms" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    double targetFps = argc > 1 ? atof(argv[1]) : 120.0;
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    double workMs = argc > 3 ? atof(argv[3]) : 2.0;
+
+    cout << frames << " frames of " << workMs * 0.5 << "-" << workMs * 1.5 << " ms work" << endl;
+
+    Run("sleep only      ", targetFps, false, frames, workMs);
+    Run("sleep then spin ", targetFps, true, frames, workMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// Micro benchmarks for the work stealing job system (JobSystem.h):
+//   spawn    - create, run and finish empty jobs on one thread (no stealing possible)
+//   steal    - one thread pushes empty jobs, every other worker has to steal them
+//   scaling  - parallel-for over a frame's worth of matrix work on 1..N threads
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/job_system_benchmark
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "JobSystem.h"
+
+double ElapsedMs(chrono::high_resolution_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+void EmptyJob(Job*, const void*)
+{
+}
+
+// Batches stay well inside the per worker job pool
+const int SPAWN_BATCH = 1024;
+
+// Average ns per job for creating, running and finishing children of a root job
+double MeasureSpawn(JobSystem& jobs, int jobCount)
+{
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+    for (int done = 0; done < jobCount; done += SPAWN_BATCH)
+    {
+        Job* root = jobs.CreateJob(&EmptyJob);
+        for (int i = 0; i < SPAWN_BATCH; i++)
+        {
+            jobs.Run(jobs.CreateChildJob(root, &EmptyJob));
+        }
+        jobs.Run(root);
+        jobs.Wait(root);
+    }
+
+    return ElapsedMs(start) * 1.0e6 / jobCount;
+}
+
+// Stand in for per frame scene work: build a model matrix for every object
+struct MatrixWork
+{
+    vector<glm::mat4>* results;
+    int repeats;
+
+    void operator()(int begin, int end) const
+    {
+        for (int i = begin; i < end; i++)
+        {
+            glm::mat4 model(1.0f);
+            for (int r = 0; r < this->repeats; r++)
+            {
+                model = glm::translate(model, glm::vec3((float)i * 0.001f, 0.5f, 0.0f));
+                model = glm::rotate(model, 0.01f * (float)r, glm::vec3(0.0f, 1.0f, 0.0f));
+                model = glm::scale(model, glm::vec3(1.0001f));
+            }
+            (*this->results)[i] = model;
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    int jobCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    int objects = argc > 2 ? atoi(argv[2]) : 100000;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+
+    int maxThreads = max(1, (int)thread::hardware_concurrency());
+    cout << "Hardware threads " << maxThreads << ", " << jobCount << " empty jobs, " << objects << " objects x " << iterations << " iterations" << endl;
+
+    {
+        JobSystem jobs(1);
+        MeasureSpawn(jobs, SPAWN_BATCH * 16);
+        cout << "spawn   1 thread   " << MeasureSpawn(jobs, jobCount) << " ns/job" << endl;
+    }
+
+    for (int threads = 2; threads <= max(2, maxThreads); threads *= 2)
+    {
+        JobSystem jobs(threads);
+        MeasureSpawn(jobs, SPAWN_BATCH * 16);
+        uint64_t stolenBefore = jobs.GetJobsStolen();
+        double ns = MeasureSpawn(jobs, jobCount);
+        uint64_t stolen = jobs.GetJobsStolen() - stolenBefore;
+
+        cout << "steal   " << threads << " threads  " << ns << " ns/job  "
+            << (100.0 * stolen / jobCount) << "% stolen" << endl;
+    }
+
+    vector<glm::mat4> results(objects);
+    MatrixWork work = { &results, 8 };
+    double singleMs = 0.0;
+
+    for (int threads = 1; threads <= maxThreads; threads++)
+    {
+        JobSystem jobs(threads);
+        jobs.ParallelFor(objects, 256, work);
+
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        for (int it = 0; it < iterations; it++)
+        {
+            jobs.ParallelFor(objects, 256, work);
+        }
+        double ms = ElapsedMs(start) / iterations;
+
+        if (threads == 1)
+        {
+            singleMs = ms;
+        }
+
+        cout << "scaling " << threads << " threads  " << ms << " ms  speedup " << singleMs / ms << "x" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
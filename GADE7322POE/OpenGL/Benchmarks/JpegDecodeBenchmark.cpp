@@ -0,0 +1,520 @@
+// Headless benchmark for stb_image's JPEG decoding (SOIL2/stb_image.h), the path the heightmaps and
+// board textures take through SOIL_load_OGL_texture. Each image is decoded on the plain C kernels
+// and each SIMD level the CPU has (IDCT, upsampling and YCbCr -> RGB), which must all give the same
+// pixels. Then the image is written again with a restart marker every MCU row and every 8 MCUs, the
+// entropy coded data otherwise untouched, and those copies are decoded from memory and through the
+// callbacks (the way stbi_load reads files) on one thread and on several, which must give the
+// original pixels. Prints MPix/s of decoded RGBA. Run from the OpenGL folder so the default images
+// are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/jpeg_decode_benchmark [runs] [image...]
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+#include "BenchmarkTime.h"
+
+typedef vector<unsigned char> Bytes;
+
+const char* LEVEL_NAMES[] = { "scalar", "SSE2  ", "AVX2  " };
+
+// Reads the entropy coded data of a scan, skipping stuffed zero bytes. At a marker it stops and
+// gives zero bits, the way decoders do.
+struct BitReader
+{
+    const Bytes& data;
+    size_t at;
+    unsigned int buffer;
+    int bits;
+    bool marker;
+
+    BitReader(const Bytes& data, size_t at) : data(data), at(at), buffer(0), bits(0), marker(false) {}
+
+    int Bit()
+    {
+        if (this->bits == 0)
+        {
+            unsigned int byte = 0;
+            if (!this->marker && this->at < this->data.size())
+            {
+                byte = this->data[this->at];
+                if (byte == 0xff && this->at + 1 < this->data.size() && this->data[this->at + 1] != 0)
+                {
+                    this->marker = true;
+                    byte = 0;
+                }
+                else
+                {
+                    this->at += byte == 0xff ? 2 : 1;
+                }
+            }
+            this->buffer = byte;
+            this->bits = 8;
+        }
+        this->bits--;
+        return (this->buffer >> this->bits) & 1;
+    }
+
+    int Bits(int count)
+    {
+        int value = 0;
+        for (int i = 0; i < count; i++)
+        {
+            value = value << 1 | this->Bit();
+        }
+        return value;
+    }
+
+    // Past a restart marker, dropping the rest of the current byte
+    void Restart()
+    {
+        this->bits = 0;
+        this->marker = false;
+        while (this->at < this->data.size() && this->data[this->at] == 0xff)
+        {
+            this->at++;
+        }
+        this->at++;
+    }
+};
+
+struct BitWriter
+{
+    Bytes& data;
+    unsigned int buffer;
+    int bits;
+
+    BitWriter(Bytes& data) : data(data), buffer(0), bits(0) {}
+
+    void Bits(unsigned int value, int count)
+    {
+        for (int i = count - 1; i >= 0; i--)
+        {
+            this->buffer = this->buffer << 1 | ((value >> i) & 1);
+            if (++this->bits == 8)
+            {
+                this->data.push_back((unsigned char)this->buffer);
+                if (this->buffer == 0xff)
+                {
+                    this->data.push_back(0);
+                }
+                this->buffer = 0;
+                this->bits = 0;
+            }
+        }
+    }
+
+    // Pads the last byte with ones
+    void Flush()
+    {
+        while (this->bits != 0)
+        {
+            this->Bits(1, 1);
+        }
+    }
+};
+
+struct HuffmanTable
+{
+    unsigned char counts[16];
+    vector<unsigned char> symbols;
+    vector<unsigned int> codes;
+    vector<int> lengths;
+    int codeOf[256], lengthOf[256];
+
+    void Build()
+    {
+        unsigned int code = 0;
+        this->codes.clear();
+        this->lengths.clear();
+        for (int length = 1; length <= 16; length++)
+        {
+            for (int i = 0; i < this->counts[length - 1]; i++)
+            {
+                this->codes.push_back(code++);
+                this->lengths.push_back(length);
+            }
+            code <<= 1;
+        }
+        for (int s = 0; s < 256; s++)
+        {
+            this->lengthOf[s] = 0;
+        }
+        for (size_t i = 0; i < this->symbols.size() && i < this->codes.size(); i++)
+        {
+            this->codeOf[this->symbols[i]] = this->codes[i];
+            this->lengthOf[this->symbols[i]] = this->lengths[i];
+        }
+    }
+
+    // The next symbol, or -1 for a code that is not in the table
+    int Decode(BitReader& reader) const
+    {
+        unsigned int code = 0;
+        size_t i = 0;
+        for (int length = 1; length <= 16; length++)
+        {
+            code = code << 1 | reader.Bit();
+            for (; i < this->codes.size() && this->lengths[i] == length; i++)
+            {
+                if (this->codes[i] == code)
+                {
+                    return this->symbols[i];
+                }
+            }
+        }
+        return -1;
+    }
+};
+
+void WriteSegment(Bytes& jpeg, unsigned char marker, const Bytes& payload)
+{
+    jpeg.push_back(0xff);
+    jpeg.push_back(marker);
+    jpeg.push_back((unsigned char)((payload.size() + 2) >> 8));
+    jpeg.push_back((unsigned char)(payload.size() + 2));
+    jpeg.insert(jpeg.end(), payload.begin(), payload.end());
+}
+
+// A copy of a baseline JPEG with a restart marker every interval MCUs (0 for every MCU row), or empty for JPEGs this
+// does not handle (progressive, several scans). The coefficients are decoded and written back with
+// the same AC codes; the DC tables are swapped for ones with a 4 bit code for every DC category,
+// since the DC differences change where the prediction starts again.
+Bytes AddRestartMarkers(const Bytes& jpeg, int interval)
+{
+    HuffmanTable tables[2][4];
+    vector<pair<unsigned char, Bytes> > segments;
+    int width = 0, height = 0, inputInterval = 0;
+    int componentCount = 0, ids[4], h[4], v[4], dcTable[4], acTable[4];
+    size_t at = 2;
+    bool baseline = false;
+
+    // Every segment up to the start of the scan
+    for (;;)
+    {
+        if (at + 4 > jpeg.size() || jpeg[at] != 0xff)
+        {
+            return Bytes();
+        }
+        unsigned char marker = jpeg[at + 1];
+        size_t length = (size_t)jpeg[at + 2] << 8 | jpeg[at + 3];
+        if (at + 2 + length > jpeg.size())
+        {
+            return Bytes();
+        }
+        Bytes payload(jpeg.begin() + at + 4, jpeg.begin() + at + 2 + length);
+        at += 2 + length;
+
+        if (marker == 0xc0 || marker == 0xc1)
+        {
+            baseline = payload[0] == 8;
+            height = payload[1] << 8 | payload[2];
+            width = payload[3] << 8 | payload[4];
+            componentCount = payload[5];
+            for (int c = 0; c < componentCount && c < 4; c++)
+            {
+                ids[c] = payload[6 + c * 3];
+                h[c] = payload[7 + c * 3] >> 4;
+                v[c] = payload[7 + c * 3] & 15;
+            }
+        }
+        else if (marker == 0xc4)
+        {
+            for (size_t p = 0; p + 17 <= payload.size();)
+            {
+                HuffmanTable& table = tables[payload[p] >> 4 & 1][payload[p] & 3];
+                int symbols = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    table.counts[i] = payload[p + 1 + i];
+                    symbols += table.counts[i];
+                }
+                table.symbols.assign(payload.begin() + p + 17, payload.begin() + min(p + 17 + symbols, payload.size()));
+                table.Build();
+                p += 17 + symbols;
+            }
+            continue;
+        }
+        else if (marker == 0xdd)
+        {
+            inputInterval = payload[0] << 8 | payload[1];
+            continue;
+        }
+        else if (marker == 0xda)
+        {
+            if (!baseline || componentCount < 1 || componentCount > 4 || payload[0] != componentCount)
+            {
+                return Bytes();
+            }
+            for (int s = 0; s < componentCount; s++)
+            {
+                int c = 0;
+                while (c < componentCount && ids[c] != payload[1 + s * 2])
+                {
+                    c++;
+                }
+                if (c != s)
+                {
+                    return Bytes();
+                }
+                dcTable[c] = payload[2 + s * 2] >> 4 & 3;
+                acTable[c] = payload[2 + s * 2] & 3;
+            }
+        }
+        else if (marker >= 0xc2 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+        {
+            return Bytes();
+        }
+        segments.push_back(make_pair(marker, payload));
+        if (marker == 0xda)
+        {
+            break;
+        }
+    }
+
+    // A single component scan has one block per MCU
+    int hMax = 1, vMax = 1;
+    for (int c = 0; c < componentCount; c++)
+    {
+        h[c] = componentCount == 1 ? 1 : h[c];
+        v[c] = componentCount == 1 ? 1 : v[c];
+        hMax = max(hMax, h[c]);
+        vMax = max(vMax, v[c]);
+    }
+    int mcusPerRow = (width + 8 * hMax - 1) / (8 * hMax);
+    int mcus = mcusPerRow * ((height + 8 * vMax - 1) / (8 * vMax));
+    interval = interval > 0 ? interval : mcusPerRow;
+
+    // The JPEG up to the scan, with the new DC tables and the restart interval
+    Bytes output(jpeg.begin(), jpeg.begin() + 2);
+    for (size_t s = 0; s < segments.size(); s++)
+    {
+        if (segments[s].first == 0xda)
+        {
+            Bytes dht;
+            for (int id = 0; id < 4; id++)
+            {
+                if (!tables[1][id].symbols.empty())
+                {
+                    dht.push_back((unsigned char)(0x10 | id));
+                    dht.insert(dht.end(), tables[1][id].counts, tables[1][id].counts + 16);
+                    dht.insert(dht.end(), tables[1][id].symbols.begin(), tables[1][id].symbols.end());
+                }
+                dht.push_back((unsigned char)id);
+                for (int i = 0; i < 16; i++)
+                {
+                    dht.push_back(i == 3 ? 12 : 0);
+                }
+                for (int category = 0; category < 12; category++)
+                {
+                    dht.push_back((unsigned char)category);
+                }
+            }
+            WriteSegment(output, 0xc4, dht);
+            WriteSegment(output, 0xdd, Bytes({ (unsigned char)(interval >> 8), (unsigned char)interval }));
+        }
+        WriteSegment(output, segments[s].first, segments[s].second);
+    }
+
+    BitReader reader(jpeg, at);
+    BitWriter writer(output);
+    int inputPrediction[4] = { 0, 0, 0, 0 }, outputPrediction[4] = { 0, 0, 0, 0 };
+    for (int mcu = 0; mcu < mcus; mcu++)
+    {
+        if (inputInterval > 0 && mcu > 0 && mcu % inputInterval == 0)
+        {
+            reader.Restart();
+            memset(inputPrediction, 0, sizeof(inputPrediction));
+        }
+        if (mcu > 0 && mcu % interval == 0)
+        {
+            writer.Flush();
+            output.push_back(0xff);
+            output.push_back((unsigned char)(0xd0 + (mcu / interval - 1) % 8));
+            memset(outputPrediction, 0, sizeof(outputPrediction));
+        }
+
+        for (int c = 0; c < componentCount; c++)
+        {
+            const HuffmanTable& dc = tables[0][dcTable[c]];
+            const HuffmanTable& ac = tables[1][acTable[c]];
+            for (int block = 0; block < h[c] * v[c]; block++)
+            {
+                int category = dc.Decode(reader);
+                if (category < 0 || category > 11)
+                {
+                    return Bytes();
+                }
+                int bits = reader.Bits(category);
+                int difference = category == 0 ? 0 : bits < (1 << (category - 1)) ? bits - (1 << category) + 1 : bits;
+                inputPrediction[c] += difference;
+
+                difference = inputPrediction[c] - outputPrediction[c];
+                outputPrediction[c] = inputPrediction[c];
+                int magnitude = abs(difference);
+                category = 0;
+                while (magnitude >> category)
+                {
+                    category++;
+                }
+                writer.Bits(category, 4);
+                writer.Bits(difference < 0 ? difference - 1 : difference, category);
+
+                for (int k = 1; k < 64; k++)
+                {
+                    int symbol = ac.Decode(reader);
+                    if (symbol < 0 || ac.lengthOf[symbol] == 0)
+                    {
+                        return Bytes();
+                    }
+                    writer.Bits(ac.codeOf[symbol], ac.lengthOf[symbol]);
+                    writer.Bits(reader.Bits(symbol & 15), symbol & 15);
+                    if (symbol == 0)
+                    {
+                        break;
+                    }
+                    k += symbol >> 4;
+                }
+            }
+        }
+    }
+    writer.Flush();
+    output.push_back(0xff);
+    output.push_back(0xd9);
+    return output;
+}
+
+// Decoded RGBA pixels, or empty if it did not load
+Bytes Decode(const Bytes& jpeg)
+{
+    int width, height, channels;
+    unsigned char* pixels = stbi_load_from_memory(&jpeg[0], (int)jpeg.size(), &width, &height, &channels, 4);
+    if (pixels == nullptr)
+    {
+        return Bytes();
+    }
+    Bytes decoded(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+    return decoded;
+}
+
+// The same through stbi_load_from_callbacks, a few hundred bytes at a time like a file
+struct Reader
+{
+    const Bytes* data;
+    size_t at;
+};
+
+Bytes DecodeFromCallbacks(const Bytes& jpeg)
+{
+    stbi_io_callbacks callbacks;
+    callbacks.read = [](void* user, char* out, int size) -> int
+    {
+        Reader* reader = (Reader*)user;
+        size_t count = min((size_t)min(size, 300), reader->data->size() - reader->at);
+        memcpy(out, &(*reader->data)[0] + reader->at, count);
+        reader->at += count;
+        return (int)count;
+    };
+    callbacks.skip = [](void* user, int n) { ((Reader*)user)->at += n; };
+    callbacks.eof = [](void* user) -> int { Reader* reader = (Reader*)user; return reader->at >= reader->data->size(); };
+
+    Reader reader = { &jpeg, 0 };
+    int width, height, channels;
+    unsigned char* pixels = stbi_load_from_callbacks(&callbacks, &reader, &width, &height, &channels, 4);
+    if (pixels == nullptr)
+    {
+        return Bytes();
+    }
+    Bytes decoded(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+    return decoded;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/HM1.jpg");
+        images.push_back("res/images/Light square.JPG");
+        images.push_back("res/images/Dark square 2.JPG");
+        images.push_back("res/images/Paper texture.jpg");
+    }
+
+    int best = stbi_set_jpeg_simd_level(-1);
+    int threads = stbi_set_jpeg_thread_count(0);
+    // Checked on a few threads even on a single core, so the split is exercised everywhere
+    int checkThreads = max(threads, 4);
+    bool exact = true;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        ifstream file(images[i].c_str(), ios::binary);
+        Bytes jpeg((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        int width, height, channels;
+        if (jpeg.empty() || !stbi_info_from_memory(&jpeg[0], (int)jpeg.size(), &width, &height, &channels))
+        {
+            cout << "JPEG decode benchmark: could not load " << images[i] << endl;
+            continue;
+        }
+
+        cout << images[i] << "  " << width << "x" << height << "x" << channels << ", " << jpeg.size() / 1024 << " KB" << endl;
+        double mpix = (double)width * height / 1e3;
+
+        // Every SIMD level against the plain C kernels
+        stbi_set_jpeg_thread_count(1);
+        stbi_set_jpeg_simd_level(0);
+        Bytes reference = Decode(jpeg);
+        double scalar = 0.0;
+        for (int level = 0; level <= best; level++)
+        {
+            stbi_set_jpeg_simd_level(level);
+            double ms = Time(runs, [&]() { Decode(jpeg); });
+            bool same = Decode(jpeg) == reference;
+            exact = exact && same;
+            scalar = level == 0 ? ms : scalar;
+            cout << "    " << LEVEL_NAMES[level] << "           " << ms << " ms, " << mpix / ms << " MPix/s  x" << scalar / ms
+                << (same ? "" : "  DIFFERS FROM SCALAR") << endl;
+        }
+        stbi_set_jpeg_simd_level(-1);
+
+        // Restart markers every MCU row and every 8 MCUs
+        int intervals[] = { 0, 8 };
+        const char* intervalNames[] = { "row ", "8   " };
+        for (int r = 0; r < 2; r++)
+        {
+            Bytes restarts = AddRestartMarkers(jpeg, intervals[r]);
+            if (restarts.empty())
+            {
+                cout << "    could not add restart markers" << endl;
+                break;
+            }
+
+            stbi_set_jpeg_thread_count(1);
+            double one = Time(runs, [&]() { Decode(restarts); });
+            bool same = Decode(restarts) == reference && DecodeFromCallbacks(restarts) == reference;
+            stbi_set_jpeg_thread_count(checkThreads);
+            same = same && Decode(restarts) == reference && DecodeFromCallbacks(restarts) == reference;
+            stbi_set_jpeg_thread_count(0);
+            double all = Time(runs, [&]() { Decode(restarts); });
+            exact = exact && same;
+
+            cout << "    restart every MCU " << intervalNames[r] << "  1 thread " << mpix / one << " MPix/s, " << threads << " threads "
+                << mpix / all << " MPix/s  x" << one / all << (same ? "" : "  DOES NOT DECODE TO THE SAME PIXELS") << endl;
+        }
+    }
+
+    cout << (exact ? "Every SIMD level and thread count decodes the same pixels" : "Decoding does NOT check out") << endl;
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
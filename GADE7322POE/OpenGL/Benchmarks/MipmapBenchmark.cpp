@@ -0,0 +1,85 @@
+// Headless benchmark for SOIL2's mip chain builder (build_mipmap_chain in SOIL2/image_helper.c).
+// Builds every mip level of the shipped textures the way SOIL used to, box filtering each level
+// from the full image, then with the chain builder, which filters each level from the one above
+// with SIMD, on one thread and on all of them, and with the sRGB filter. Prints the time per chain.
+// Run from the OpenGL folder so the default images are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/mipmap_benchmark [runs] [image...]
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+#include "SOIL2/image_helper.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+#include "BenchmarkTime.h"
+
+// Every level from the full image with a growing block, as SOIL's createMipmaps did
+void MipmapFromBase(const unsigned char* pixels, int width, int height, int channels, vector<unsigned char>& level)
+{
+    level.resize((size_t)max(width / 2, 1) * max(height / 2, 1) * channels);
+    for (int i = 1; (1 << i) <= width || (1 << i) <= height; i++)
+    {
+        mipmap_image(pixels, width, height, channels, &level[0], 1 << i, 1 << i);
+    }
+}
+
+void Chain(const unsigned char* pixels, int width, int height, int channels, int srgb)
+{
+    int levels = 0;
+    int offsets[MIPMAP_CHAIN_MAX_LEVELS];
+    free(build_mipmap_chain(pixels, width, height, channels, srgb, &levels, offsets));
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/Light square.png");
+        images.push_back("res/images/Paper.png");
+        images.push_back("res/images/Skyboxs/Pink/px.png");
+    }
+
+    int threads = set_mipmap_thread_count(0);
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        for (int channels = 3; channels <= 4; channels++)
+        {
+            int width, height, fileChannels;
+            unsigned char* pixels = stbi_load(images[i].c_str(), &width, &height, &fileChannels, channels);
+            if (pixels == nullptr)
+            {
+                cout << "Mipmap benchmark: could not load " << images[i] << endl;
+                break;
+            }
+
+            vector<unsigned char> level;
+            double fromBase = Time(runs, [&]() { MipmapFromBase(pixels, width, height, channels, level); });
+
+            set_mipmap_thread_count(1);
+            double single = Time(runs, [&]() { Chain(pixels, width, height, channels, 0); });
+            double srgb = Time(runs, [&]() { Chain(pixels, width, height, channels, 1); });
+
+            set_mipmap_thread_count(0);
+            double threaded = Time(runs, [&]() { Chain(pixels, width, height, channels, 0); });
+
+            cout << images[i] << "  " << width << "x" << height << "x" << channels << endl;
+            cout << "    from the base image   " << fromBase << " ms" << endl;
+            cout << "    chain, 1 thread       " << single << " ms  x" << fromBase / single << endl;
+            cout << "    chain, " << threads << " threads" << (threads < 10 ? " " : "") << "      " << threaded
+                << " ms  x" << fromBase / threaded << endl;
+            cout << "    sRGB chain, 1 thread  " << srgb << " ms" << endl;
+
+            stbi_image_free(pixels);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
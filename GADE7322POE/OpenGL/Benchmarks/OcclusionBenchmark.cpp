@@ -0,0 +1,122 @@
+// Headless benchmark for the CPU occlusion culler (SoftwareOcclusion.h).
+// Needs no GL context, so it runs on a CPU only Linux box:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/occlusion_benchmark
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SoftwareOcclusion.h"
+
+// Same maths as Camera::GetViewMatrix for a position and euler angles
+glm::mat4 ViewFromAngles(glm::vec3 position, float yaw, float pitch)
+{
+    glm::vec3 front;
+    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front = glm::normalize(front);
+
+    glm::vec3 right = glm::normalize(glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::normalize(glm::cross(right, front));
+    return glm::lookAt(position, position + front, up);
+}
+
+double ElapsedMs(chrono::high_resolution_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    int stressObjects = argc > 2 ? atoi(argv[2]) : 20000;
+
+    // Low camera preset camPos3 looking across the board
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100000.0f);
+    glm::mat4 viewProjection = projection * ViewFromAngles(glm::vec3(7.0f, 2.0f, 7.0f), -135.0f, -10.0f);
+
+    // Board slab plus a 5x5 grid of terrain chunks like the 50x50 heightmap produces
+    Bounds board = { glm::vec3(-3.5f, 0.1f, -3.5f), glm::vec3(4.5f, 0.4f, 4.5f) };
+    vector<Bounds> occluders(1, board);
+    for (int cz = 0; cz < 5; cz++)
+    {
+        for (int cx = 0; cx < 5; cx++)
+        {
+            float top = -10.0f + (float)((cx * 7 + cz * 3) % 5);
+            Bounds chunk = { glm::vec3(-25.0f + cx * 10, top - 1.0f, -25.0f + cz * 10), glm::vec3(-15.0f + cx * 10, top, -15.0f + cz * 10) };
+            occluders.push_back(chunk);
+        }
+    }
+
+    // Piece sized boxes scattered over and below the board
+    Bounds piece = { glm::vec3(-0.3f, 0.0f, -0.3f), glm::vec3(0.3f, 0.9f, 0.3f) };
+    vector<glm::mat4> objects;
+    srand(7322);
+    for (int i = 0; i < stressObjects; i++)
+    {
+        glm::vec3 position((rand() % 2000) / 100.0f - 10.0f, (rand() % 1200) / 100.0f - 11.0f, (rand() % 2000) / 100.0f - 10.0f);
+        objects.push_back(glm::translate(glm::mat4(1.0f), position));
+    }
+
+    cout << "Occlusion buffer " << OCCLUSION_WIDTH << "x" << OCCLUSION_HEIGHT << ", " << occluders.size() << " occluder boxes, "
+        << stressObjects << " test objects, " << iterations << " iterations" << endl;
+#ifdef SOFTWARE_OCCLUSION_SSE2
+    cout << "Rasterizer: SSE2" << endl;
+#else
+    cout << "Rasterizer: scalar" << endl;
+#endif
+
+    int maxThreads = (int)thread::hardware_concurrency();
+    if (maxThreads < 1)
+    {
+        maxThreads = 1;
+    }
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem jobs(threads);
+        SoftwareOcclusion culler(&jobs);
+        double rasterMs = 0.0, testMs = 0.0;
+        int culled = 0;
+
+        for (int it = 0; it < iterations; it++)
+        {
+            culler.BeginFrame(viewProjection);
+            for (size_t i = 0; i < occluders.size(); i++)
+            {
+                culler.AddOccluderBox(glm::mat4(1.0f), occluders[i]);
+            }
+
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            culler.Rasterize();
+            rasterMs += ElapsedMs(start);
+
+            start = chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < objects.size(); i++)
+            {
+                culler.IsVisible(objects[i], piece);
+            }
+            testMs += ElapsedMs(start);
+            culled = culler.GetCulledObjects();
+        }
+
+        cout << "threads " << threads
+            << "  rasterize " << rasterMs / iterations << " ms"
+            << "  test " << testMs / iterations << " ms (" << testMs * 1.0e6 / ((double)iterations * objects.size()) << " ns/object)"
+            << "  culled " << culled << "/" << objects.size() << endl;
+
+        if (threads * 2 > maxThreads && threads != maxThreads)
+        {
+            threads = maxThreads / 2;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+// Headless benchmark for stb_image's PNG decoding (SOIL2/stb_image.h), the path every .png texture
+// takes through SOIL_load_OGL_texture. For each image it times inflating the IDAT stream alone with
+// stbi_zlib_decode_malloc and the whole stbi_load_from_memory, in MPix/s of decoded RGBA and MB/s
+// of compressed input. It also checks the decoder: the inflated stream must match the Adler-32 sum
+// the encoder stored after it, and the decoded pixels, filtered again row by row with every PNG
+// filter as RGBA and as RGB, wrapped in uncompressed deflate blocks and decoded back, must give the
+// same pixels. Run from the OpenGL folder so the default images are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/png_decode_benchmark [runs] [image...]
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+#include "BenchmarkTime.h"
+
+typedef vector<unsigned char> Bytes;
+
+const char* FILTER_NAMES[] = { "none", "sub", "up", "average", "Paeth" };
+
+unsigned int ReadBigEndian(const unsigned char* bytes)
+{
+    return (unsigned int)bytes[0] << 24 | (unsigned int)bytes[1] << 16 | (unsigned int)bytes[2] << 8 | bytes[3];
+}
+
+void WriteBigEndian(Bytes& bytes, unsigned int value)
+{
+    bytes.push_back((unsigned char)(value >> 24));
+    bytes.push_back((unsigned char)(value >> 16));
+    bytes.push_back((unsigned char)(value >> 8));
+    bytes.push_back((unsigned char)value);
+}
+
+unsigned int Adler32(const unsigned char* bytes, size_t size)
+{
+    unsigned int a = 1, b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a = (a + bytes[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+// The zlib stream of a PNG file: every IDAT chunk's data joined together
+Bytes ZlibStream(const Bytes& png)
+{
+    Bytes stream;
+    for (size_t at = 8; at + 12 <= png.size();)
+    {
+        unsigned int length = ReadBigEndian(&png[at]);
+        if (at + 12 + length > png.size())
+        {
+            break;
+        }
+        if (string(png.begin() + at + 4, png.begin() + at + 8) == "IDAT")
+        {
+            stream.insert(stream.end(), png.begin() + at + 8, png.begin() + at + 8 + length);
+        }
+        at += 12 + length;
+    }
+    return stream;
+}
+
+int Paeth(int a, int b, int c)
+{
+    int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// An 8 bit PNG of pixels with every row filtered by filter, or by each filter in turn when filter
+// is -1, in uncompressed deflate blocks. stb_image skips the CRCs, so they are left at zero.
+Bytes EncodePng(const unsigned char* pixels, int width, int height, int channels, int filter)
+{
+    size_t stride = (size_t)width * channels;
+    Bytes filtered;
+    for (int y = 0; y < height; y++)
+    {
+        int rowFilter = filter < 0 ? y % 5 : filter;
+        const unsigned char* row = pixels + stride * y;
+        const unsigned char* prior = y > 0 ? row - stride : nullptr;
+        filtered.push_back((unsigned char)rowFilter);
+        for (size_t i = 0; i < stride; i++)
+        {
+            int a = i >= (size_t)channels ? row[i - channels] : 0;
+            int b = prior ? prior[i] : 0;
+            int c = prior && i >= (size_t)channels ? prior[i - channels] : 0;
+            int predicted[] = { 0, a, b, (a + b) / 2, Paeth(a, b, c) };
+            filtered.push_back((unsigned char)(row[i] - predicted[rowFilter]));
+        }
+    }
+
+    Bytes zlib = { 0x78, 0x01 };
+    for (size_t at = 0; at < filtered.size() || at == 0; at += 65535)
+    {
+        size_t length = min(filtered.size() - at, (size_t)65535);
+        zlib.push_back(at + length == filtered.size() ? 1 : 0);
+        zlib.push_back((unsigned char)length);
+        zlib.push_back((unsigned char)(length >> 8));
+        zlib.push_back((unsigned char)~length);
+        zlib.push_back((unsigned char)(~length >> 8));
+        zlib.insert(zlib.end(), filtered.begin() + at, filtered.begin() + at + length);
+    }
+    WriteBigEndian(zlib, Adler32(&filtered[0], filtered.size()));
+
+    Bytes png = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    Bytes header;
+    WriteBigEndian(header, width);
+    WriteBigEndian(header, height);
+    unsigned char colorTypes[] = { 0, 0, 4, 2, 6 };
+    header.insert(header.end(), { 8, colorTypes[channels], 0, 0, 0 });
+    const Bytes* chunks[] = { &header, &zlib, nullptr };
+    const char* types[] = { "IHDR", "IDAT", "IEND" };
+    for (int c = 0; c < 3; c++)
+    {
+        WriteBigEndian(png, chunks[c] ? (unsigned int)chunks[c]->size() : 0);
+        png.insert(png.end(), types[c], types[c] + 4);
+        if (chunks[c])
+        {
+            png.insert(png.end(), chunks[c]->begin(), chunks[c]->end());
+        }
+        WriteBigEndian(png, 0);
+    }
+    return png;
+}
+
+// Decoded pixels of png with channels components, or empty if it did not load
+Bytes Decode(const Bytes& png, int channels)
+{
+    int width, height, fileChannels;
+    unsigned char* pixels = stbi_load_from_memory(&png[0], (int)png.size(), &width, &height, &fileChannels, channels);
+    if (pixels == nullptr)
+    {
+        return Bytes();
+    }
+    Bytes decoded(pixels, pixels + (size_t)width * height * channels);
+    stbi_image_free(pixels);
+    return decoded;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/Paper.png");
+        images.push_back("res/images/water.png");
+        images.push_back("res/images/Light square.png");
+        images.push_back("res/images/StandardCubeMap.png");
+        const char* faces[] = { "px", "nx", "py", "ny", "pz", "nz" };
+        for (int f = 0; f < 6; f++)
+        {
+            images.push_back(string("res/images/Skyboxs/Pink/") + faces[f] + ".png");
+        }
+    }
+
+    bool exact = true;
+    double totalMpix = 0.0, totalMs = 0.0;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        ifstream file(images[i].c_str(), ios::binary);
+        Bytes png((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        int width, height, channels;
+        if (png.empty() || !stbi_info_from_memory(&png[0], (int)png.size(), &width, &height, &channels))
+        {
+            cout << "PNG decode benchmark: could not load " << images[i] << endl;
+            continue;
+        }
+
+        cout << images[i] << "  " << width << "x" << height << "x" << channels << ", " << png.size() / 1024 << " KB" << endl;
+
+        // Inflate alone, checked against the stream's Adler-32
+        Bytes stream = ZlibStream(png);
+        int inflatedSize = 0;
+        char* inflated = stbi_zlib_decode_malloc((const char*)&stream[0], (int)stream.size(), &inflatedSize);
+        bool inflateOk = inflated != nullptr && stream.size() >= 4
+            && Adler32((const unsigned char*)inflated, inflatedSize) == ReadBigEndian(&stream[stream.size() - 4]);
+        free(inflated);
+        exact = exact && inflateOk;
+
+        double mpix = (double)width * height / 1e3;
+        double inflateMs = Time(runs, [&]() { free(stbi_zlib_decode_malloc((const char*)&stream[0], (int)stream.size(), &inflatedSize)); });
+        double decodeMs = Time(runs, [&]() { Decode(png, 4); });
+        totalMpix += mpix;
+        totalMs += decodeMs;
+
+        cout << "    inflate  " << inflateMs << " ms, " << png.size() / 1e3 / inflateMs << " MB/s in"
+            << (inflateOk ? "" : "  ADLER-32 DOES NOT MATCH") << endl;
+        cout << "    decode   " << decodeMs << " ms, " << mpix / decodeMs << " MPix/s, " << png.size() / 1e3 / decodeMs << " MB/s in" << endl;
+
+        // Every filter, on RGBA and on RGB (which stb_image expands to RGBA while unfiltering)
+        Bytes rgba = Decode(png, 4);
+        Bytes rgb = Decode(png, 3);
+        Bytes opaque = rgba;
+        for (size_t a = 3; a < opaque.size(); a += 4)
+        {
+            opaque[a] = 255;
+        }
+        for (int filter = -1; filter <= 4; filter++)
+        {
+            bool same = Decode(EncodePng(&rgba[0], width, height, 4, filter), 4) == rgba
+                && Decode(EncodePng(&rgb[0], width, height, 3, filter), 3) == rgb
+                && Decode(EncodePng(&rgb[0], width, height, 3, filter), 4) == opaque;
+            exact = exact && same;
+            if (!same)
+            {
+                cout << "    re-encoded with " << (filter < 0 ? "mixed" : FILTER_NAMES[filter]) << " filters DOES NOT decode to the same pixels" << endl;
+            }
+        }
+    }
+
+    if (totalMs > 0.0)
+    {
+        cout << "All images: " << totalMpix / totalMs << " MPix/s" << endl;
+    }
+    cout << (exact ? "Inflate and unfiltering check out on every image" : "Decoding does NOT check out") << endl;
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+// Headless benchmark for SOIL2's resampler (resample_image in SOIL2/image_helper.c).
+// Pads the shipped textures up to a power of two with SOIL's old bilinear up_scale_image and with
+// resample_image, then shrinks them to half size with each filter on the plain C loops and each
+// SIMD path the CPU has, checking every path gives the same bytes, and on all threads. Prints
+// throughput in output MPix/s. Run from the OpenGL folder so the default images are found:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/resample_benchmark [runs] [image...]
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+#include "SOIL2/image_helper.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+#include "BenchmarkTime.h"
+
+const char* FILTER_NAMES[] = { "box     ", "bilinear", "Lanczos3", "Mitchell" };
+const char* LEVEL_NAMES[] = { "scalar", "SSE2  ", "AVX   ", "AVX2  " };
+
+int NextPowerOfTwo(int size)
+{
+    int power = 1;
+    while (power < size)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+
+    vector<string> images(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (images.empty())
+    {
+        images.push_back("res/images/Light square.png");
+        images.push_back("res/images/Paper.png");
+        images.push_back("res/images/Skyboxs/Pink/px.png");
+    }
+
+    int best = set_image_SIMD_level(-1);
+    int threads = set_resample_thread_count(0);
+    bool exact = true;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(images[i].c_str(), &width, &height, &channels, 4);
+        if (pixels == nullptr)
+        {
+            cout << "Resample benchmark: could not load " << images[i] << endl;
+            continue;
+        }
+
+        cout << images[i] << "  " << width << "x" << height << endl;
+
+        int potWidth = NextPowerOfTwo(width);
+        int potHeight = NextPowerOfTwo(height);
+        double potMpix = (double)potWidth * potHeight / 1e3;
+        vector<unsigned char> pot((size_t)potWidth * potHeight * 4);
+
+        double upScale = Time(runs, [&]() { up_scale_image(pixels, width, height, 4, &pot[0], potWidth, potHeight); });
+        double mitchell = Time(runs, [&]() { resample_image(pixels, width, height, 4, &pot[0], potWidth, potHeight, RESAMPLE_FILTER_MITCHELL); });
+        cout << "    to " << potWidth << "x" << potHeight << "  up_scale_image " << potMpix / upScale << " MPix/s, Mitchell "
+            << potMpix / mitchell << " MPix/s" << endl;
+
+        int halfWidth = max(width / 2, 1);
+        int halfHeight = max(height / 2, 1);
+        double halfMpix = (double)halfWidth * halfHeight / 1e3;
+        vector<unsigned char> half((size_t)halfWidth * halfHeight * 4);
+
+        for (int filter = RESAMPLE_FILTER_BOX; filter <= RESAMPLE_FILTER_MITCHELL; filter++)
+        {
+            vector<unsigned char> reference;
+            double scalar = 0.0;
+
+            set_resample_thread_count(1);
+            for (int level = IMAGE_SIMD_NONE; level <= min(best, (int)IMAGE_SIMD_AVX); level++)
+            {
+                set_image_SIMD_level(level);
+                double ms = Time(runs, [&]() { resample_image(pixels, width, height, 4, &half[0], halfWidth, halfHeight, filter); });
+
+                bool same = true;
+                if (level == IMAGE_SIMD_NONE)
+                {
+                    reference = half;
+                    scalar = ms;
+                }
+                else
+                {
+                    same = half == reference;
+                    exact = exact && same;
+                }
+
+                cout << "    to " << halfWidth << "x" << halfHeight << "  " << FILTER_NAMES[filter] << "  " << LEVEL_NAMES[level]
+                    << "  " << halfMpix / ms << " MPix/s  x" << scalar / ms << (same ? "" : "  OUTPUT DIFFERS FROM SCALAR") << endl;
+            }
+
+            set_image_SIMD_level(-1);
+            set_resample_thread_count(0);
+            double ms = Time(runs, [&]() { resample_image(pixels, width, height, 4, &half[0], halfWidth, halfHeight, filter); });
+            bool same = half == reference;
+            exact = exact && same;
+            cout << "    to " << halfWidth << "x" << halfHeight << "  " << FILTER_NAMES[filter] << "  " << threads << " threads  "
+                << halfMpix / ms << " MPix/s  x" << scalar / ms << (same ? "" : "  OUTPUT DIFFERS FROM ONE THREAD") << endl;
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    cout << (exact ? "All SIMD and threaded output matches the scalar resampler" : "Output does NOT match the scalar resampler") << endl;
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
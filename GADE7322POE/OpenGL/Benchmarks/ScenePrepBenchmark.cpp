@@ -0,0 +1,123 @@
+// Headless benchmark for parallel scene preparation (ScenePrep.h).
+// Builds a stress scene of animated pieces and measures the CPU time to animate, cull and
+// build every draw packet, from 1 thread up to one per core:
+//     cmake -S Benchmarks -B build && cmake --build build && ./build/scene_prep_benchmark
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "ScenePrep.h"
+
+double ElapsedMs(chrono::high_resolution_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+// Same mix of meshes, animations and sizes as the real board, repeated over a big area
+void BuildStressScene(ScenePrep& scene, int objects)
+{
+    const int animations[] = { ANIMATION_LIFT_TILT, ANIMATION_NONE, ANIMATION_NONE, ANIMATION_LIFT_SPIN, ANIMATION_NONE };
+    const int meshCount = sizeof(animations) / sizeof(int);
+
+    for (int m = 0; m < meshCount; m++)
+    {
+        SceneMesh mesh = {};
+        mesh.vertexCount = 8000;
+        mesh.bounds.min = glm::vec3(-0.3f, 0.0f, -0.3f);
+        mesh.bounds.max = glm::vec3(0.3f, 0.9f + 0.1f * m, 0.3f);
+        mesh.cull = true;
+        scene.AddMesh(mesh);
+    }
+
+    srand(7322);
+    for (int m = 0; m < meshCount; m++)
+    {
+        for (int i = 0; i < objects / meshCount; i++)
+        {
+            SceneObject object;
+            object.mesh = m;
+            object.texture = i % 2;
+            object.position = glm::vec3((rand() % 4000) / 100.0f - 20.0f, (rand() % 1200) / 100.0f - 11.0f, (rand() % 4000) / 100.0f - 20.0f);
+            object.scale = glm::vec3(1.0f);
+            object.axis = glm::vec3(1.0f, 0.0f, 0.0f);
+            object.angle = 0.0f;
+            object.animation = animations[m];
+            object.occlusionSlot = -1;
+            scene.AddObject(object);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int objects = argc > 1 ? atoi(argv[1]) : 100000;
+    int frames = argc > 2 ? atoi(argv[2]) : 50;
+
+    // Low camera preset looking across the board, with the board slab as the only occluder
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(7.0f, 2.0f, 7.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Bounds board = { glm::vec3(-3.5f, 0.1f, -3.5f), glm::vec3(4.5f, 0.4f, 4.5f) };
+
+    int maxThreads = max(1, (int)thread::hardware_concurrency());
+    cout << objects << " objects, " << frames << " frames, " << maxThreads << " hardware threads" << endl;
+
+    double singleMs = 0.0;
+
+    for (int threads = 0; threads <= maxThreads; threads++)
+    {
+        // threads 0 is the old way: every object prepared inline on the GL thread
+        JobSystem jobs(max(threads, 1));
+        ScenePrep scene(threads > 0 ? &jobs : nullptr);
+        BuildStressScene(scene, objects);
+
+        SoftwareOcclusion culler(&jobs);
+        double prepareMs = 0.0;
+        int visible = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            culler.BeginFrame(projection * view);
+            culler.AddOccluderBox(glm::mat4(1.0f), board);
+            culler.Rasterize();
+
+            SceneFrame sceneFrame;
+            sceneFrame.animate = true;
+            sceneFrame.animationTime = frame / 60.0f;
+            sceneFrame.culler = &culler;
+
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            scene.Prepare(sceneFrame);
+            prepareMs += ElapsedMs(start);
+
+            visible = 0;
+            const vector<DrawPacket>& packets = scene.GetPackets();
+            for (size_t p = 0; p < packets.size(); p++)
+            {
+                visible += packets[p].visible ? 1 : 0;
+            }
+        }
+
+        double ms = prepareMs / frames;
+        if (threads <= 1)
+        {
+            singleMs = ms;
+        }
+
+        if (threads == 0)
+        {
+            cout << "inline      " << ms << " ms/frame  visible " << visible << "/" << scene.GetObjectCount() << endl;
+        }
+        else
+        {
+            cout << "threads " << threads << "   " << ms << " ms/frame  speedup " << singleMs / ms << "x  visible " << visible << "/" << scene.GetObjectCount() << endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cfloat>
+
+// GLM (no GL here so the CPU side culling can be used without a context)
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box
+struct Bounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Work out the local bounds of a mesh from its vertex data (3 floats per vertex)
+inline Bounds ComputeBounds(const float* vertices, int floatCount)
+{
+    Bounds bounds;
+    bounds.min = glm::vec3(FLT_MAX);
+    bounds.max = glm::vec3(-FLT_MAX);
+
+    for (int i = 0; i + 2 < floatCount; i += 3)
+    {
+        glm::vec3 vertex(vertices[i], vertices[i + 1], vertices[i + 2]);
+        bounds.min = glm::min(bounds.min, vertex);
+        bounds.max = glm::max(bounds.max, vertex);
+    }
+
+    return bounds;
+}
+
+// Get the world space bounds of a box after it has been moved by a model matrix
+inline Bounds TransformBounds(const Bounds& bounds, const glm::mat4& model)
+{
+    Bounds world;
+    world.min = glm::vec3(FLT_MAX);
+    world.max = glm::vec3(-FLT_MAX);
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 local(
+            (corner & 1) ? bounds.max.x : bounds.min.x,
+            (corner & 2) ? bounds.max.y : bounds.min.y,
+            (corner & 4) ? bounds.max.z : bounds.min.z);
+
+        glm::vec3 point = glm::vec3(model * glm::vec4(local, 1.0f));
+        world.min = glm::min(world.min, point);
+        world.max = glm::max(world.max, point);
+    }
+
+    return world;
+}
+
+// Check if a point sits inside the box, grown by a margin on every side
+inline bool BoundsContain(const Bounds& bounds, const glm::vec3& point, float margin = 0.0f)
+{
+    return point.x >= bounds.min.x - margin && point.x <= bounds.max.x + margin &&
+        point.y >= bounds.min.y - margin && point.y <= bounds.max.y + margin &&
+        point.z >= bounds.min.z - margin && point.z <= bounds.max.z + margin;
+}
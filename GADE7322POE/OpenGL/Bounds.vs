@@ -0,0 +1,10 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+
+uniform mat4 mvp;
+
+void main()
+{
+    gl_Position = mvp * vec4(position, 1.0f);
+};
\ No newline at end of file
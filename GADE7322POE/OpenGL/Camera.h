@@ -28,6 +28,43 @@ const GLfloat SPEED = 10.0f;
 const GLfloat SENSITIVITY = 0.25f;
 const GLfloat ZOOM = 45.0f;
 
+// Everything needed to rebuild the camera, kept per simulation tick for interpolation
+struct CameraState
+{
+    glm::vec3 position;
+    GLfloat yaw;
+    GLfloat pitch;
+    GLfloat zoom;
+};
+
+// Blend between two camera states, alpha 0 gives from and 1 gives to
+inline CameraState InterpolateCameraState(const CameraState& from, const CameraState& to, GLfloat alpha)
+{
+    CameraState state;
+    state.position = glm::mix(from.position, to.position, alpha);
+    state.yaw = from.yaw + (to.yaw - from.yaw) * alpha;
+    state.pitch = from.pitch + (to.pitch - from.pitch) * alpha;
+    state.zoom = from.zoom + (to.zoom - from.zoom) * alpha;
+    return state;
+}
+
+// Keep a state within a turn (in degrees of yaw and pitch) and a distance of another one
+inline CameraState LimitCameraState(const CameraState& state, const CameraState& around, GLfloat maxTurn, GLfloat maxMove)
+{
+    CameraState limited = state;
+    limited.yaw = glm::clamp(state.yaw, around.yaw - maxTurn, around.yaw + maxTurn);
+    limited.pitch = glm::clamp(state.pitch, around.pitch - maxTurn, around.pitch + maxTurn);
+
+    glm::vec3 offset = state.position - around.position;
+    GLfloat distance = glm::length(offset);
+    if (distance > maxMove)
+    {
+        limited.position = around.position + offset * (maxMove / distance);
+    }
+
+    return limited;
+}
+
 class Camera
 {
 private:
@@ -190,6 +227,27 @@ public:
         return this->position;
     }
 
+    // Getter for the state used to interpolate between simulation ticks
+    CameraState GetState()
+    {
+        CameraState state;
+        state.position = this->position;
+        state.yaw = this->yaw;
+        state.pitch = this->pitch;
+        state.zoom = this->zoom;
+        return state;
+    }
+
+    // Setter, used to place the render camera between the last two simulation ticks
+    void SetState(const CameraState& state)
+    {
+        this->position = state.position;
+        this->yaw = state.yaw;
+        this->pitch = state.pitch;
+        this->zoom = state.zoom;
+        this->updateCameraVectors();
+    }
+
     void CycleCamera(string str)
     {
         //Initial values
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// GLM
+#include <glm/glm.hpp>
+
+// Uniform buffer binding point shared by every shader that declares CameraBlock
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// Frames the buffer is split into so the CPU never writes what the GPU is still reading
+const int CAMERA_BUFFER_FRAMES = 3;
+
+// Matches the std140 CameraBlock uniform block in the shaders
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 skyboxView;
+    glm::mat4 skyboxProjection;
+};
+
+// Camera matrices for every shader in one small uniform buffer.
+// When ARB_buffer_storage is there the buffer stays persistently mapped, so the matrices can
+// be rewritten right up to the point the draws are submitted without a glBufferSubData copy
+// in the command stream. Older drivers fall back to glBufferSubData.
+class CameraBuffer
+{
+private:
+    GLuint buffer;
+    GLsizeiptr regionSize;
+    char* mapped;
+    GLsync fences[CAMERA_BUFFER_FRAMES];
+    int region;
+
+public:
+
+    CameraBuffer() : buffer(0), regionSize(0), mapped(nullptr), region(0)
+    {
+        for (int i = 0; i < CAMERA_BUFFER_FRAMES; i++)
+        {
+            this->fences[i] = 0;
+        }
+    }
+
+    ~CameraBuffer()
+    {
+        this->Release();
+    }
+
+    // Free the GL objects, call while the context is still current
+    void Release()
+    {
+        for (int i = 0; i < CAMERA_BUFFER_FRAMES; i++)
+        {
+            if (this->fences[i] != 0)
+            {
+                glDeleteSync(this->fences[i]);
+                this->fences[i] = 0;
+            }
+        }
+
+        if (this->buffer != 0)
+        {
+            if (this->mapped != nullptr)
+            {
+                glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+                glUnmapBuffer(GL_UNIFORM_BUFFER);
+                this->mapped = nullptr;
+            }
+            glDeleteBuffers(1, &this->buffer);
+            this->buffer = 0;
+        }
+    }
+
+    void Init()
+    {
+        // Every frame's region has to start on the driver's uniform buffer alignment
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        this->regionSize = ((sizeof(CameraBlock) + alignment - 1) / alignment) * alignment;
+
+        GLsizeiptr size = this->regionSize * CAMERA_BUFFER_FRAMES;
+
+        glGenBuffers(1, &this->buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+
+        if (GLEW_ARB_buffer_storage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+            this->mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        }
+
+        if (this->mapped == nullptr)
+        {
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            cout << "Camera buffer: persistent mapping not supported, using glBufferSubData" << endl;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Point a shader's CameraBlock at the shared binding
+    static void BindShader(GLuint program)
+    {
+        GLuint index = glGetUniformBlockIndex(program, "CameraBlock");
+
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, index, CAMERA_BLOCK_BINDING);
+        }
+    }
+
+    // Move on to the next region, waiting only if the GPU is somehow three frames behind
+    void BeginFrame()
+    {
+        this->region = (this->region + 1) % CAMERA_BUFFER_FRAMES;
+
+        if (this->fences[this->region] != 0)
+        {
+            glClientWaitSync(this->fences[this->region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            glDeleteSync(this->fences[this->region]);
+            this->fences[this->region] = 0;
+        }
+    }
+
+    // Write this frame's matrices and bind them. Can be called again before the draws are
+    // submitted to latch a fresher camera.
+    void Write(const CameraBlock& block)
+    {
+        GLintptr offset = this->regionSize * this->region;
+
+        if (this->mapped != nullptr)
+        {
+            memcpy(this->mapped + offset, &block, sizeof(CameraBlock));
+        }
+        else
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(CameraBlock), &block);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, this->buffer, offset, sizeof(CameraBlock));
+    }
+
+    // Fence the region once every draw that reads it has been submitted
+    void EndFrame()
+    {
+        this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    bool IsPersistent()
+    {
+        return this->mapped != nullptr;
+    }
+};
@@ -8,8 +8,15 @@ out vec3 Position;
 out vec2 TexCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Camera matrices, shared by every shader through one uniform buffer
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 skyboxView;
+    mat4 skyboxProjection;
+};
 
 void main()
 {
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+// The time stamp counter is about half the cost of a steady_clock read
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#endif
+
+// Events kept per thread, the oldest are overwritten once it fills (power of two)
+const unsigned int CPU_PROFILER_EVENTS = 1 << 16;
+
+// One finished scope
+struct CpuEvent
+{
+    const char* name;
+    const char* detail;     // Optional, e.g. the file being loaded
+    long long start;
+    long long end;
+};
+
+// CPU scope profiler with Chrome trace export.
+// Every thread records into its own ring of events, found through a thread_local pointer, so
+// recording takes no locks and shares no cache lines: a scope costs two time stamp counter reads
+// and one 32 byte store. Ticks are turned into time against steady_clock when exporting. The
+// mutex is only taken the first time a thread records and when exporting.
+// Names and details are stored as pointers, so they must outlive the export (string literals).
+// Export while the other threads are idle (e.g. between frames), a scope being written at the
+// same moment can come out torn.
+class CpuProfiler
+{
+private:
+    typedef chrono::steady_clock Clock;
+
+    struct ThreadBuffer
+    {
+        int id;
+        const char* name;
+        vector<CpuEvent> events;
+        atomic<unsigned int> count;
+    };
+
+    vector<ThreadBuffer*> buffers;
+    mutex buffersMutex;
+    atomic<bool> enabled;
+    Clock::time_point epoch;
+    long long epochTicks;
+
+    static ThreadBuffer*& LocalBuffer()
+    {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        return buffer;
+    }
+
+    ThreadBuffer* RegisterThread()
+    {
+        ThreadBuffer* buffer = new ThreadBuffer();
+        buffer->name = nullptr;
+        buffer->events.resize(CPU_PROFILER_EVENTS);
+        buffer->count.store(0, memory_order_relaxed);
+
+        lock_guard<mutex> lock(this->buffersMutex);
+        buffer->id = (int)this->buffers.size();
+        this->buffers.push_back(buffer);
+        return buffer;
+    }
+
+    CpuProfiler() : enabled(true), epoch(Clock::now()), epochTicks(Now())
+    {
+    }
+
+    // Microseconds per tick, measured over the profiler's lifetime so far
+    double TickLength()
+    {
+#ifdef CPU_PROFILER_RDTSC
+        long long ticks = Now() - this->epochTicks;
+        double microseconds = chrono::duration<double, micro>(Clock::now() - this->epoch).count();
+        return ticks > 0 ? microseconds / ticks : 0.0;
+#else
+        return 1.0e6 * Clock::period::num / Clock::period::den;
+#endif
+    }
+
+    // Write text as a quoted JSON string, escaping quotes, backslashes and control characters
+    // (Windows paths end up in the details)
+    static void WriteString(ostream& out, const char* text)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        out << '"';
+        for (const unsigned char* c = (const unsigned char*)text; *c != 0; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                out << '\\' << (char)*c;
+            }
+            else if (*c < 0x20)
+            {
+                out << "\\u00" << hex[*c >> 4] << hex[*c & 15];
+            }
+            else
+            {
+                out << (char)*c;
+            }
+        }
+        out << '"';
+    }
+
+public:
+
+    ~CpuProfiler()
+    {
+        for (size_t i = 0; i < this->buffers.size(); i++)
+        {
+            delete this->buffers[i];
+        }
+    }
+
+    // The one profiler every thread records into
+    static CpuProfiler& Get()
+    {
+        static CpuProfiler profiler;
+        return profiler;
+    }
+
+    static long long Now()
+    {
+#ifdef CPU_PROFILER_RDTSC
+        return (long long)__rdtsc();
+#else
+        return Clock::now().time_since_epoch().count();
+#endif
+    }
+
+    void SetEnabled(bool enable)
+    {
+        this->enabled.store(enable, memory_order_relaxed);
+    }
+
+    bool IsEnabled()
+    {
+        return this->enabled.load(memory_order_relaxed);
+    }
+
+    // Label the calling thread in the trace
+    void SetThreadName(const char* name)
+    {
+        ThreadBuffer*& buffer = LocalBuffer();
+        if (buffer == nullptr)
+        {
+            buffer = this->RegisterThread();
+        }
+        buffer->name = name;
+    }
+
+    void Record(const char* name, const char* detail, long long start, long long end)
+    {
+        ThreadBuffer*& buffer = LocalBuffer();
+        if (buffer == nullptr)
+        {
+            buffer = this->RegisterThread();
+        }
+
+        // Only this thread writes the count, the release publishes the event to the exporter
+        unsigned int index = buffer->count.load(memory_order_relaxed);
+        CpuEvent& event = buffer->events[index & (CPU_PROFILER_EVENTS - 1)];
+        event.name = name;
+        event.detail = detail;
+        event.start = start;
+        event.end = end;
+        buffer->count.store(index + 1, memory_order_release);
+    }
+
+    // Forget everything recorded so far
+    void Clear()
+    {
+        lock_guard<mutex> lock(this->buffersMutex);
+        for (size_t i = 0; i < this->buffers.size(); i++)
+        {
+            this->buffers[i]->count.store(0, memory_order_relaxed);
+        }
+    }
+
+    // Events still in the buffers, across all threads
+    size_t GetEventCount()
+    {
+        lock_guard<mutex> lock(this->buffersMutex);
+
+        size_t total = 0;
+        for (size_t i = 0; i < this->buffers.size(); i++)
+        {
+            total += min(this->buffers[i]->count.load(memory_order_acquire), CPU_PROFILER_EVENTS);
+        }
+        return total;
+    }
+
+    // Chrome Trace Event format, opens in chrome://tracing and ui.perfetto.dev
+    bool WriteChromeTrace(const char* path)
+    {
+        ofstream file(path);
+        if (!file.is_open())
+        {
+            cout << "CPU profiler: could not write " << path << endl;
+            return false;
+        }
+
+        lock_guard<mutex> lock(this->buffersMutex);
+
+        long long epochTicks = this->epochTicks;
+        double microsecondsPerTick = this->TickLength();
+        bool first = true;
+
+        // Microseconds with nanosecond decimals, never in exponent form
+        file << fixed << setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+
+        for (size_t b = 0; b < this->buffers.size(); b++)
+        {
+            ThreadBuffer* buffer = this->buffers[b];
+
+            if (buffer->name != nullptr)
+            {
+                file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"args\":{\"name\":";
+                WriteString(file, buffer->name);
+                file << "}}";
+                first = false;
+            }
+
+            unsigned int count = buffer->count.load(memory_order_acquire);
+            unsigned int oldest = count > CPU_PROFILER_EVENTS ? count - CPU_PROFILER_EVENTS : 0;
+
+            for (unsigned int e = oldest; e < count; e++)
+            {
+                const CpuEvent& event = buffer->events[e & (CPU_PROFILER_EVENTS - 1)];
+
+                file << (first ? "" : ",\n") << "{\"name\":";
+                WriteString(file, event.name);
+                file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"ts\":" << (event.start - epochTicks) * microsecondsPerTick << ",\"dur\":" << (event.end - event.start) * microsecondsPerTick;
+
+                if (event.detail != nullptr)
+                {
+                    file << ",\"args\":{\"detail\":";
+                    WriteString(file, event.detail);
+                    file << "}";
+                }
+
+                file << "}";
+                first = false;
+            }
+        }
+
+        file << "\n]}" << endl;
+        return true;
+    }
+};
+
+// Records the time between construction and destruction (or End) as one event
+class CpuScope
+{
+private:
+    const char* name;
+    const char* detail;
+    long long start;
+    bool open;
+
+public:
+
+    CpuScope(const char* scopeName, const char* scopeDetail = nullptr) : name(scopeName), detail(scopeDetail),
+        start(0), open(CpuProfiler::Get().IsEnabled())
+    {
+        if (this->open)
+        {
+            this->start = CpuProfiler::Now();
+        }
+    }
+
+    ~CpuScope()
+    {
+        this->End();
+    }
+
+    // Close the scope early, for regions that aren't a block of their own
+    void End()
+    {
+        if (this->open)
+        {
+            CpuProfiler::Get().Record(this->name, this->detail, this->start, CpuProfiler::Now());
+            this->open = false;
+        }
+    }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// GPU time the controller tries to stay under, in milliseconds (60 Hz with some headroom)
+const double RESOLUTION_BUDGET_MS = 14.0;
+
+// Range the render scale is kept in, per axis
+const float RESOLUTION_MIN_SCALE = 0.5f;
+const float RESOLUTION_MAX_SCALE = 1.0f;
+
+// Hysteresis: drop quickly when over budget, only climb back after a run of cheap frames
+const int RESOLUTION_DOWN_FRAMES = 3;
+const int RESOLUTION_UP_FRAMES = 30;
+const double RESOLUTION_UP_THRESHOLD = 0.8;
+const float RESOLUTION_UP_STEP = 0.05f;
+
+// Timer queries in flight, so reading one back never waits on the GPU
+const int RESOLUTION_QUERY_FRAMES = 4;
+
+// Dynamic resolution scaling.
+// The scene renders into the corner of a full size offscreen target, using a viewport that is
+// scaled to keep the measured GPU time under budget. The result is stretched onto the back
+// buffer with a linear blit. The target is only ever allocated once, changing the scale just
+// changes the viewport.
+class DynamicResolution
+{
+private:
+    GLuint framebuffer;
+    GLuint colorTexture;
+    GLuint depthBuffer;
+    GLuint output;
+    int width;
+    int height;
+
+    float scale;
+    double budgetMs;
+    double lastGpuMs;
+    int overBudgetFrames;
+    int underBudgetFrames;
+
+    GLuint queries[RESOLUTION_QUERY_FRAMES];
+    bool queryPending[RESOLUTION_QUERY_FRAMES];
+    int frame;
+
+    // Feed the controller with a finished GPU time
+    void Update(double gpuMs)
+    {
+        this->lastGpuMs = gpuMs;
+
+        if (gpuMs > this->budgetMs)
+        {
+            this->underBudgetFrames = 0;
+
+            if (++this->overBudgetFrames >= RESOLUTION_DOWN_FRAMES)
+            {
+                // GPU time goes with the pixel count, so scale each axis by the square root
+                float target = this->scale * (float)sqrt(this->budgetMs / gpuMs);
+                this->scale = max(RESOLUTION_MIN_SCALE, max(target, this->scale - 0.25f));
+                this->overBudgetFrames = 0;
+            }
+        }
+        else if (gpuMs < this->budgetMs * RESOLUTION_UP_THRESHOLD)
+        {
+            this->overBudgetFrames = 0;
+
+            if (++this->underBudgetFrames >= RESOLUTION_UP_FRAMES)
+            {
+                this->scale = min(RESOLUTION_MAX_SCALE, this->scale + RESOLUTION_UP_STEP);
+                this->underBudgetFrames = 0;
+            }
+        }
+        else
+        {
+            // Inside the dead band, hold
+            this->overBudgetFrames = 0;
+            this->underBudgetFrames = 0;
+        }
+    }
+
+public:
+
+    DynamicResolution() : framebuffer(0), colorTexture(0), depthBuffer(0), output(0), width(0), height(0),
+        scale(1.0f), budgetMs(RESOLUTION_BUDGET_MS), lastGpuMs(0.0), overBudgetFrames(0), underBudgetFrames(0), frame(0)
+    {
+    }
+
+    ~DynamicResolution()
+    {
+        this->Release();
+    }
+
+    // Free the GL objects, call while the context is still current
+    void Release()
+    {
+        if (this->framebuffer != 0)
+        {
+            glDeleteFramebuffers(1, &this->framebuffer);
+            glDeleteTextures(1, &this->colorTexture);
+            glDeleteRenderbuffers(1, &this->depthBuffer);
+            glDeleteQueries(RESOLUTION_QUERY_FRAMES, this->queries);
+            this->framebuffer = 0;
+        }
+    }
+
+    // Create the offscreen target at the full framebuffer size. outputFramebuffer is what the
+    // frame ends up in, the window's (0) unless rendering headless.
+    bool Init(int framebufferWidth, int framebufferHeight, GLuint outputFramebuffer = 0)
+    {
+        this->output = outputFramebuffer;
+        this->width = framebufferWidth;
+        this->height = framebufferHeight;
+
+        glGenTextures(1, &this->colorTexture);
+        glBindTexture(GL_TEXTURE_2D, this->colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenRenderbuffers(1, &this->depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, this->width, this->height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &this->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, this->output);
+
+        if (!complete)
+        {
+            cout << "Dynamic resolution: framebuffer is not complete" << endl;
+        }
+
+        glGenQueries(RESOLUTION_QUERY_FRAMES, this->queries);
+        for (int i = 0; i < RESOLUTION_QUERY_FRAMES; i++)
+        {
+            this->queryPending[i] = false;
+        }
+
+        return complete;
+    }
+
+    // Bind the offscreen target at the current scale and start timing the frame
+    void BeginFrame()
+    {
+        this->frame = (this->frame + 1) % RESOLUTION_QUERY_FRAMES;
+
+        // This slot was last used RESOLUTION_QUERY_FRAMES ago, normally long finished
+        if (this->queryPending[this->frame])
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(this->queries[this->frame], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(this->queries[this->frame], GL_QUERY_RESULT, &elapsed);
+                this->Update(elapsed / 1.0e6);
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+        glViewport(0, 0, this->GetRenderWidth(), this->GetRenderHeight());
+
+        glBeginQuery(GL_TIME_ELAPSED, this->queries[this->frame]);
+        this->queryPending[this->frame] = true;
+    }
+
+    // Stop timing and stretch the rendered area over the whole output framebuffer
+    void EndFrame()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->output);
+        glBlitFramebuffer(0, 0, this->GetRenderWidth(), this->GetRenderHeight(), 0, 0, this->width, this->height,
+            GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->output);
+        glViewport(0, 0, this->width, this->height);
+    }
+
+    void SetBudget(double milliseconds)
+    {
+        this->budgetMs = milliseconds;
+    }
+
+    double GetBudget()
+    {
+        return this->budgetMs;
+    }
+
+    // Go back to full resolution, e.g. when scaling is switched off
+    void Reset()
+    {
+        this->scale = RESOLUTION_MAX_SCALE;
+        this->overBudgetFrames = 0;
+        this->underBudgetFrames = 0;
+    }
+
+    float GetScale()
+    {
+        return this->scale;
+    }
+
+    int GetRenderWidth()
+    {
+        return max(1, (int)(this->width * this->scale));
+    }
+
+    int GetRenderHeight()
+    {
+        return max(1, (int)(this->height * this->scale));
+    }
+
+    // Latest GPU time read back, in milliseconds
+    double GetGpuMs()
+    {
+        return this->lastGpuMs;
+    }
+};
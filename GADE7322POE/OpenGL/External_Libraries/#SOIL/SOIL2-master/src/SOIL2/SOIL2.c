@@ -1381,19 +1381,30 @@ static void createMipmaps(const unsigned char *const img,
 	}
 	else
 	{
-		int MIPlevel = 1;
-		int MIPwidth = (width+1) / 2;
-		int MIPheight = (height+1) / 2;
-		unsigned char *resampled = (unsigned char*)malloc( channels*MIPwidth*MIPheight );
-
-		while( ((1<<MIPlevel) <= width) || ((1<<MIPlevel) <= height) )
+		/*	the whole chain first, each level filtered from the one above,
+			sRGB textures averaged in linear light	*/
+		int MIPlevel, MIPlevels;
+		int MIPoffsets[MIPMAP_CHAIN_MAX_LEVELS];
+		unsigned char *chain = build_mipmap_chain( img, width, height, channels,
+				(flags & SOIL_FLAG_SRGB_COLOR_SPACE) != 0, &MIPlevels, MIPoffsets );
+		if( NULL == chain )
 		{
-			/*	do this MIPmap level	*/
-			mipmap_image(
-					img, width, height, channels,
-					resampled,
-					(1 << MIPlevel), (1 << MIPlevel) );
+			return;
+		}
 
+		for( MIPlevel = 1; MIPlevel < MIPlevels; ++MIPlevel )
+		{
+			int MIPwidth = width >> MIPlevel;
+			int MIPheight = height >> MIPlevel;
+			unsigned char *resampled = chain + MIPoffsets[MIPlevel];
+			if( MIPwidth < 1 )
+			{
+				MIPwidth = 1;
+			}
+			if( MIPheight < 1 )
+			{
+				MIPheight = 1;
+			}
 			/*  upload the MIPmaps	*/
 			if( DXT_mode == SOIL_CAPABILITY_PRESENT )
 			{
@@ -1437,13 +1448,9 @@ static void createMipmaps(const unsigned char *const img,
 					original_texture_format, GL_UNSIGNED_BYTE, resampled );
 				check_for_GL_errors( "glTexImage2D" );
 			}
-			/*	prep for the next level	*/
-			++MIPlevel;
-			MIPwidth = (MIPwidth + 1) / 2;
-			MIPheight = (MIPheight + 1) / 2;
 		}
 
-		SOIL_free_image_data( resampled );
+		SOIL_free_image_data( chain );
 	}
 }
 
@@ -1601,9 +1608,9 @@ unsigned int
 		{
 			/*	yep, resize	*/
 			unsigned char *resampled = (unsigned char*)malloc( channels*new_width*new_height );
-			up_scale_image(
+			resample_image(
 					NULL != img ? img : data, iwidth, iheight, channels,
-					resampled, new_width, new_height );
+					resampled, new_width, new_height, RESAMPLE_FILTER_MITCHELL );
 
 			/*	nuke the old guy ( if a copy exists ), then point it at the new guy	*/
 			SOIL_free_image_data( img );
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "soil_parallel_c.h"
 
 /*	set this =1 if you want to use the covarince matrix method...
 	which is better than my method of using standard deviations
@@ -19,6 +20,9 @@
 	method fails for finding the largest eigenvector	*/
 #define USE_COV_MAT	1
 
+/*	SIMD block compressors for x86, picked at run time by what the CPU has	*/
+#include "soil_cpu_c.h"
+
 /********* Function Prototypes *********/
 /*
 	Takes a 4x4 block of pixels and compresses it into 8 bytes
@@ -37,6 +41,16 @@ void compress_DDS_color_block(
 void compress_DDS_alpha_block(
 				const unsigned char *const uncompressed,
 				unsigned char compressed[8] );
+/*
+	Compresses a whole image into the preallocated output, 8 bytes per
+	block for DXT1 or 16 with the alpha block in front for DXT5, splitting
+	the rows of blocks between threads.
+*/
+static void compress_image_threaded(
+				const unsigned char *const uncompressed,
+				int width, int height, int channels,
+				int with_alpha,
+				unsigned char *compressed );
 
 /********* Actual Exposed Functions *********/
 int
@@ -104,11 +118,6 @@ unsigned char* convert_image_to_DXT1(
 		int *out_size )
 {
 	unsigned char *compressed;
-	int i, j, x, y;
-	unsigned char ublock[16*3];
-	unsigned char cblock[8];
-	int index = 0, chan_step = 1;
-	int block_count = 0;
 	/*	error check	*/
 	*out_size = 0;
 	if( (width < 1) || (height < 1) ||
@@ -117,17 +126,57 @@ unsigned char* convert_image_to_DXT1(
 	{
 		return NULL;
 	}
+	/*	get the RAM for the compressed image
+		(8 bytes per 4x4 pixel block)	*/
+	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 8;
+	compressed = (unsigned char*)malloc( *out_size );
+	/*	compress the rows of blocks, on several threads for big images	*/
+	compress_image_threaded( uncompressed, width, height, channels, 0, compressed );
+	return compressed;
+}
+
+unsigned char* convert_image_to_DXT5(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int *out_size )
+{
+	unsigned char *compressed;
+	/*	error check	*/
+	*out_size = 0;
+	if( (width < 1) || (height < 1) ||
+		(NULL == uncompressed) ||
+		(channels < 1) || ( channels > 4) )
+	{
+		return NULL;
+	}
+	/*	get the RAM for the compressed image
+		(16 bytes per 4x4 pixel block)	*/
+	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 16;
+	compressed = (unsigned char*)malloc( *out_size );
+	/*	compress the rows of blocks, on several threads for big images	*/
+	compress_image_threaded( uncompressed, width, height, channels, 1, compressed );
+	return compressed;
+}
+
+/********* Block Row Compressors *********/
+static void compress_rows_DXT1(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int first_row, int last_row,
+		unsigned char *compressed )
+{
+	int i, j, x, y;
+	unsigned char ublock[16*3];
+	unsigned char cblock[8];
+	int index = first_row * ((width+3) >> 2) * 8, chan_step = 1;
+	int block_count = 0;
 	/*	for channels == 1 or 2, I do not step forward for R,G,B values	*/
 	if( channels < 3 )
 	{
 		chan_step = 0;
 	}
-	/*	get the RAM for the compressed image
-		(8 bytes per 4x4 pixel block)	*/
-	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 8;
-	compressed = (unsigned char*)malloc( *out_size );
 	/*	go through each block	*/
-	for( j = 0; j < height; j += 4 )
+	for( j = first_row*4; (j < last_row*4) && (j < height); j += 4 )
 	{
 		for( i = 0; i < width; i += 4 )
 		{
@@ -176,28 +225,19 @@ unsigned char* convert_image_to_DXT1(
 			}
 		}
 	}
-	return compressed;
 }
 
-unsigned char* convert_image_to_DXT5(
+static void compress_rows_DXT5(
 		const unsigned char *const uncompressed,
 		int width, int height, int channels,
-		int *out_size )
+		int first_row, int last_row,
+		unsigned char *compressed )
 {
-	unsigned char *compressed;
 	int i, j, x, y;
 	unsigned char ublock[16*4];
 	unsigned char cblock[8];
-	int index = 0, chan_step = 1;
+	int index = first_row * ((width+3) >> 2) * 16, chan_step = 1;
 	int block_count = 0, has_alpha;
-	/*	error check	*/
-	*out_size = 0;
-	if( (width < 1) || (height < 1) ||
-		(NULL == uncompressed) ||
-		(channels < 1) || ( channels > 4) )
-	{
-		return NULL;
-	}
 	/*	for channels == 1 or 2, I do not step forward for R,G,B vales	*/
 	if( channels < 3 )
 	{
@@ -205,12 +245,8 @@ unsigned char* convert_image_to_DXT5(
 	}
 	/*	# channels = 1 or 3 have no alpha, 2 & 4 do have alpha	*/
 	has_alpha = 1 - (channels & 1);
-	/*	get the RAM for the compressed image
-		(16 bytes per 4x4 pixel block)	*/
-	*out_size = ((width+3) >> 2) * ((height+3) >> 2) * 16;
-	compressed = (unsigned char*)malloc( *out_size );
 	/*	go through each block	*/
-	for( j = 0; j < height; j += 4 )
+	for( j = first_row*4; (j < last_row*4) && (j < height); j += 4 )
 	{
 		for( i = 0; i < width; i += 4 )
 		{
@@ -271,7 +307,253 @@ unsigned char* convert_image_to_DXT5(
 			}
 		}
 	}
-	return compressed;
+}
+
+/*	-1 until the CPU has been checked	*/
+static int DXT_SIMD_level = -1;
+
+static int detect_DXT_SIMD_level( void )
+{
+	int level = DXT_SIMD_NONE;
+	#if SOIL_HAVE_SSE2
+	level = DXT_SIMD_SSE2;
+	#endif
+	#if SOIL_HAVE_AVX
+	if( soil_cpu_avx_level() >= 2 )
+	{
+		level = DXT_SIMD_AVX2;
+	}
+	#endif
+	return level;
+}
+
+int get_DXT_SIMD_level( void )
+{
+	if( DXT_SIMD_level < 0 )
+	{
+		DXT_SIMD_level = detect_DXT_SIMD_level();
+	}
+	return DXT_SIMD_level;
+}
+
+int set_DXT_SIMD_level( int level )
+{
+	int supported = detect_DXT_SIMD_level();
+	if( (level < 0) || (level > supported) )
+	{
+		level = supported;
+	}
+	DXT_SIMD_level = level;
+	return level;
+}
+
+#if SOIL_HAVE_SSE2
+#define DXT_SIMD_SSE2_PATH
+#include "image_DXT_simd_c.h"
+#undef DXT_SIMD_SSE2_PATH
+#endif
+#if SOIL_HAVE_AVX
+#define DXT_SIMD_AVX2_PATH
+#include "image_DXT_simd_c.h"
+#undef DXT_SIMD_AVX2_PATH
+#endif
+
+/*
+	The block at (i,j) as 16 packed pixels, padded past the edges
+	of the image the same way the scalar converters pad theirs.
+*/
+static void extract_block_packed(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int i, int j,
+		unsigned int block[16] )
+{
+	int x, y;
+	int mx = 4, my = 4;
+	/*	for channels == 1 or 2, I do not step forward for R,G,B values	*/
+	int chan_step = (channels < 3) ? 0 : 1;
+	int has_alpha = 1 - (channels & 1);
+	if( j+4 >= height )
+	{
+		my = height - j;
+	}
+	if( i+4 >= width )
+	{
+		mx = width - i;
+	}
+	for( y = 0; y < my; ++y )
+	{
+		for( x = 0; x < mx; ++x )
+		{
+			const unsigned char *p = uncompressed + (j+y)*width*channels + (i+x)*channels;
+			unsigned int a = has_alpha ? p[channels-1] : 255;
+			block[y*4+x] = p[0] | (p[chan_step] << 8) | (p[chan_step+chan_step] << 16) | (a << 24);
+		}
+		for( x = mx; x < 4; ++x )
+		{
+			block[y*4+x] = block[0];
+		}
+	}
+	for( y = my; y < 4; ++y )
+	{
+		for( x = 0; x < 4; ++x )
+		{
+			block[y*4+x] = block[0];
+		}
+	}
+}
+
+/*
+	Block rows [first_row,last_row) with the SIMD block compressors, the
+	same bytes the scalar row compressors write, several blocks at a time.
+*/
+static void compress_rows_SIMD(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int with_alpha, int level,
+		int first_row, int last_row,
+		unsigned char *compressed )
+{
+	#if SOIL_HAVE_SSE2
+	unsigned int blocks[8*16];
+	unsigned char tail[8*16];
+	int lanes = (level == DXT_SIMD_AVX2) ? 8 : 4;
+	int block_size = with_alpha ? 16 : 8;
+	/*	the color block follows the alpha block in DXT5	*/
+	int color_offset = with_alpha ? 8 : 0;
+	int i, j, x;
+	int index = first_row * ((width+3) >> 2) * block_size;
+	int count = 0, first = index;
+	for( j = first_row*4; (j < last_row*4) && (j < height); j += 4 )
+	{
+		for( i = 0; i < width; i += 4 )
+		{
+			extract_block_packed( uncompressed, width, height, channels, i, j, blocks + count*16 );
+			if( with_alpha )
+			{
+				/*	x86 is little endian, so the packed pixels are R,G,B,A bytes	*/
+				compress_DDS_alpha_block( (const unsigned char*)(blocks + count*16), compressed + index );
+			}
+			index += block_size;
+			if( ++count == lanes )
+			{
+				#if SOIL_HAVE_AVX
+				if( lanes == 8 )
+				{
+					compress_DDS_color_blocks_avx2( blocks, compressed + first + color_offset, block_size );
+				} else
+				#endif
+				{
+					compress_DDS_color_blocks_sse2( blocks, compressed + first + color_offset, block_size );
+				}
+				count = 0;
+				first = index;
+			}
+		}
+	}
+	if( count > 0 )
+	{
+		/*	fill the unused lanes with copies of the last block	*/
+		for( i = count; i < lanes; ++i )
+		{
+			memcpy( blocks + i*16, blocks + (count-1)*16, 16*sizeof( unsigned int ) );
+		}
+		#if SOIL_HAVE_AVX
+		if( lanes == 8 )
+		{
+			compress_DDS_color_blocks_avx2( blocks, tail, 16 );
+		} else
+		#endif
+		{
+			compress_DDS_color_blocks_sse2( blocks, tail, 16 );
+		}
+		for( i = 0; i < count; ++i )
+		{
+			for( x = 0; x < 8; ++x )
+			{
+				compressed[first + i*block_size + color_offset + x] = tail[i*16 + x];
+			}
+		}
+	}
+	#else
+	(void)uncompressed; (void)width; (void)height; (void)channels;
+	(void)with_alpha; (void)level; (void)first_row; (void)last_row; (void)compressed;
+	#endif
+}
+
+/********* Threads *********/
+/*
+	Each thread takes DXT_ROWS_PER_TAKE block rows at a time until the image
+	is done, writing straight into the output. Images smaller than
+	DXT_BLOCKS_PER_THREAD blocks per thread use fewer threads, down to just
+	the calling one for the small mip levels.
+*/
+#define DXT_ROWS_PER_TAKE	4
+#define DXT_BLOCKS_PER_THREAD	4096
+
+typedef struct
+{
+	const unsigned char *uncompressed;
+	int width, height, channels;
+	int with_alpha, level;
+	unsigned char *compressed;
+}
+DXT_job;
+
+/*	0 for one per CPU	*/
+static int DXT_thread_count = 0;
+
+int get_DXT_thread_count( void )
+{
+	return (DXT_thread_count > 0) ? DXT_thread_count : soil_cpu_count();
+}
+
+int set_DXT_thread_count( int count )
+{
+	DXT_thread_count = (count > SOIL_MAX_THREADS) ? SOIL_MAX_THREADS : count;
+	return get_DXT_thread_count();
+}
+
+static void compress_rows( void *user, int first_row, int last_row )
+{
+	DXT_job *job = (DXT_job*)user;
+	if( job->level != DXT_SIMD_NONE )
+	{
+		compress_rows_SIMD( job->uncompressed, job->width, job->height, job->channels,
+			job->with_alpha, job->level, first_row, last_row, job->compressed );
+	} else if( job->with_alpha )
+	{
+		compress_rows_DXT5( job->uncompressed, job->width, job->height, job->channels,
+			first_row, last_row, job->compressed );
+	} else
+	{
+		compress_rows_DXT1( job->uncompressed, job->width, job->height, job->channels,
+			first_row, last_row, job->compressed );
+	}
+}
+
+static void compress_image_threaded(
+		const unsigned char *const uncompressed,
+		int width, int height, int channels,
+		int with_alpha,
+		unsigned char *compressed )
+{
+	DXT_job job;
+	int threads = get_DXT_thread_count();
+	int blocks = ((width+3) >> 2) * ((height+3) >> 2);
+	job.uncompressed = uncompressed;
+	job.width = width;
+	job.height = height;
+	job.channels = channels;
+	job.with_alpha = with_alpha;
+	/*	checked here, so the workers never race on the first check	*/
+	job.level = get_DXT_SIMD_level();
+	job.compressed = compressed;
+	if( threads > blocks / DXT_BLOCKS_PER_THREAD )
+	{
+		threads = blocks / DXT_BLOCKS_PER_THREAD;
+	}
+	soil_parallel_rows( compress_rows, &job, (height+3) >> 2, DXT_ROWS_PER_TAKE, threads );
 }
 
 /********* Helper Functions *********/
@@ -8,7 +8,62 @@
 
 #include "image_helper.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include "soil_parallel_c.h"
+#include "soil_cpu_c.h"
+
+/********* SIMD dispatch *********/
+/*	-1 until the CPU has been checked	*/
+static int image_SIMD_level = -1;
+
+static int detect_image_SIMD_level( void )
+{
+	int level = IMAGE_SIMD_NONE;
+	#if SOIL_HAVE_SSE2
+	level = IMAGE_SIMD_SSE2;
+	#endif
+	#if SOIL_HAVE_AVX
+	switch( soil_cpu_avx_level() )
+	{
+	case 2:	level = IMAGE_SIMD_AVX2;	break;
+	case 1:	level = IMAGE_SIMD_AVX;	break;
+	default:	break;
+	}
+	#endif
+	return level;
+}
+
+int get_image_SIMD_level( void )
+{
+	if( image_SIMD_level < 0 )
+	{
+		image_SIMD_level = detect_image_SIMD_level();
+	}
+	return image_SIMD_level;
+}
+
+int set_image_SIMD_level( int level )
+{
+	int supported = detect_image_SIMD_level();
+	if( (level < 0) || (level > supported) )
+	{
+		level = supported;
+	}
+	image_SIMD_level = level;
+	return level;
+}
+
+#if SOIL_HAVE_SSE2
+#define IMG_SIMD_SSE2_PATH
+#include "image_helper_simd_c.h"
+#undef IMG_SIMD_SSE2_PATH
+#endif
+#if SOIL_HAVE_AVX
+#define IMG_SIMD_AVX2_PATH
+#include "image_helper_simd_c.h"
+#undef IMG_SIMD_AVX2_PATH
+#endif
 
 /*	Upscaling the image uses simple bilinear interpolation	*/
 int
@@ -151,6 +206,716 @@ int
 	return 1;
 }
 
+/********* MIPmap chains *********/
+/*
+	Levels with at least MIP_PIXELS_PER_THREAD pixels for each thread are
+	split between threads, MIP_ROWS_PER_TAKE output rows at a time.
+*/
+#define MIP_PIXELS_PER_THREAD	65536
+#define MIP_ROWS_PER_TAKE	16
+
+/*	0 for one per CPU	*/
+static int mip_thread_count = 0;
+
+int get_mipmap_thread_count( void )
+{
+	return (mip_thread_count > 0) ? mip_thread_count : soil_cpu_count();
+}
+
+int set_mipmap_thread_count( int count )
+{
+	mip_thread_count = (count > SOIL_MAX_THREADS) ? SOIL_MAX_THREADS : count;
+	return get_mipmap_thread_count();
+}
+
+/*	sRGB byte -> linear light, and the linear light halfway between
+	sRGB bytes k and k+1, where encoding rounds up to k+1	*/
+static float srgb_to_linear[256];
+static float srgb_midpoints[255];
+/*	sRGB byte at the start of each of SRGB_ENCODE_STEPS equal steps of
+	linear light. The steps are finer than the closest two midpoints, so
+	each has at most one midpoint in it and one compare finishes the job.	*/
+#define SRGB_ENCODE_STEPS	4096
+static unsigned char srgb_encode[SRGB_ENCODE_STEPS];
+static int srgb_tables_ready = 0;
+
+static float decode_sRGB( float c )
+{
+	return (c <= 0.04045f) ? c / 12.92f : (float)pow( (c + 0.055f) / 1.055f, 2.4 );
+}
+
+static void build_sRGB_tables( void )
+{
+	int i, k = 0;
+	if( srgb_tables_ready )
+	{
+		return;
+	}
+	for( i = 0; i < 256; ++i )
+	{
+		srgb_to_linear[i] = decode_sRGB( i / 255.0f );
+	}
+	for( i = 0; i < 255; ++i )
+	{
+		srgb_midpoints[i] = decode_sRGB( (i + 0.5f) / 255.0f );
+	}
+	for( i = 0; i < SRGB_ENCODE_STEPS; ++i )
+	{
+		while( (k < 255) && ((float)i / (SRGB_ENCODE_STEPS - 1) >= srgb_midpoints[k]) )
+		{
+			++k;
+		}
+		srgb_encode[i] = (unsigned char)k;
+	}
+	srgb_tables_ready = 1;
+}
+
+/*	linear light [0,1] to the nearest sRGB byte	*/
+static unsigned char linear_to_sRGB( float linear )
+{
+	int k = srgb_encode[(int)(linear * (SRGB_ENCODE_STEPS - 1))];
+	/*	either side, in case the step index rounded over a midpoint	*/
+	if( (k < 255) && (linear >= srgb_midpoints[k]) )
+	{
+		++k;
+	} else if( (k > 0) && (linear < srgb_midpoints[k-1]) )
+	{
+		--k;
+	}
+	return (unsigned char)k;
+}
+
+typedef struct
+{
+	const unsigned char *src;
+	int width, height, channels;
+	unsigned char *dst;
+	int mip_width;
+	int srgb;
+}
+mip_job;
+
+/*
+	Output rows [first_row,last_row) of the next level, each pixel the
+	rounded average of a 2x2 block. A side that is already 1 pixel uses
+	the same pixel twice, which averages the 2 others with the same rounding.
+*/
+static void mip_rows( void *user, int first_row, int last_row )
+{
+	const mip_job *job = (const mip_job*)user;
+	const int channels = job->channels;
+	const int row_bytes = job->width * channels;
+	/*	pixel 2i+1 is 1 pixel over, unless the level is 1 wide	*/
+	const int next_x = (job->width > 1) ? channels : 0;
+	/*	channels that are color, for sRGB: alpha (the last of 2 or 4) is linear	*/
+	const int color_channels = channels - (1 - (channels & 1));
+	int i, j, c;
+	for( j = first_row; j < last_row; ++j )
+	{
+		const unsigned char *row0 = job->src + ((job->height > 1) ? 2*j : j) * row_bytes;
+		const unsigned char *row1 = (job->height > 1) ? row0 + row_bytes : row0;
+		unsigned char *out = job->dst + j * job->mip_width * channels;
+		i = 0;
+		if( job->srgb )
+		{
+			for( ; i < job->mip_width; ++i )
+			{
+				const int a = (next_x ? 2*i : i) * channels;
+				const int b = a + next_x;
+				for( c = 0; c < color_channels; ++c )
+				{
+					out[i*channels+c] = linear_to_sRGB( 0.25f * (
+						srgb_to_linear[row0[a+c]] + srgb_to_linear[row0[b+c]] +
+						srgb_to_linear[row1[a+c]] + srgb_to_linear[row1[b+c]] ) );
+				}
+				for( ; c < channels; ++c )
+				{
+					out[i*channels+c] = (row0[a+c] + row0[b+c] + row1[a+c] + row1[b+c] + 2) >> 2;
+				}
+			}
+			continue;
+		}
+		#if SOIL_HAVE_SSE2
+		if( next_x && (channels == 4) )
+		{
+			/*	4 output pixels from 8 pixels of each row	*/
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16( 2 );
+			for( ; i + 4 <= job->mip_width; i += 4 )
+			{
+				__m128i a0 = _mm_loadu_si128( (const __m128i*)(row0 + 8*i) );
+				__m128i b0 = _mm_loadu_si128( (const __m128i*)(row0 + 8*i + 16) );
+				__m128i a1 = _mm_loadu_si128( (const __m128i*)(row1 + 8*i) );
+				__m128i b1 = _mm_loadu_si128( (const __m128i*)(row1 + 8*i + 16) );
+				/*	column sums of pixels 0,1 / 2,3 / 4,5 / 6,7 as 16 bit	*/
+				__m128i a_lo = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( a1, zero ) );
+				__m128i a_hi = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( a1, zero ) );
+				__m128i b_lo = _mm_add_epi16( _mm_unpacklo_epi8( b0, zero ), _mm_unpacklo_epi8( b1, zero ) );
+				__m128i b_hi = _mm_add_epi16( _mm_unpackhi_epi8( b0, zero ), _mm_unpackhi_epi8( b1, zero ) );
+				/*	add the even pixel to the odd one next to it	*/
+				__m128i sum_a = _mm_add_epi16( _mm_unpacklo_epi64( a_lo, a_hi ), _mm_unpackhi_epi64( a_lo, a_hi ) );
+				__m128i sum_b = _mm_add_epi16( _mm_unpacklo_epi64( b_lo, b_hi ), _mm_unpackhi_epi64( b_lo, b_hi ) );
+				sum_a = _mm_srli_epi16( _mm_add_epi16( sum_a, two ), 2 );
+				sum_b = _mm_srli_epi16( _mm_add_epi16( sum_b, two ), 2 );
+				_mm_storeu_si128( (__m128i*)(out + 4*i), _mm_packus_epi16( sum_a, sum_b ) );
+			}
+		} else if( next_x && (channels == 1) )
+		{
+			/*	16 output pixels from 32 pixels of each row	*/
+			const __m128i low_bytes = _mm_set1_epi16( 0x00FF );
+			const __m128i two = _mm_set1_epi16( 2 );
+			for( ; i + 16 <= job->mip_width; i += 16 )
+			{
+				__m128i a0 = _mm_loadu_si128( (const __m128i*)(row0 + 2*i) );
+				__m128i b0 = _mm_loadu_si128( (const __m128i*)(row0 + 2*i + 16) );
+				__m128i a1 = _mm_loadu_si128( (const __m128i*)(row1 + 2*i) );
+				__m128i b1 = _mm_loadu_si128( (const __m128i*)(row1 + 2*i + 16) );
+				/*	even + odd bytes of both rows, as 16 bit	*/
+				__m128i sum_a = _mm_add_epi16(
+					_mm_add_epi16( _mm_and_si128( a0, low_bytes ), _mm_srli_epi16( a0, 8 ) ),
+					_mm_add_epi16( _mm_and_si128( a1, low_bytes ), _mm_srli_epi16( a1, 8 ) ) );
+				__m128i sum_b = _mm_add_epi16(
+					_mm_add_epi16( _mm_and_si128( b0, low_bytes ), _mm_srli_epi16( b0, 8 ) ),
+					_mm_add_epi16( _mm_and_si128( b1, low_bytes ), _mm_srli_epi16( b1, 8 ) ) );
+				sum_a = _mm_srli_epi16( _mm_add_epi16( sum_a, two ), 2 );
+				sum_b = _mm_srli_epi16( _mm_add_epi16( sum_b, two ), 2 );
+				_mm_storeu_si128( (__m128i*)(out + i), _mm_packus_epi16( sum_a, sum_b ) );
+			}
+		}
+		#endif
+		/*	the rest (and 2 or 3 channels) one byte at a time	*/
+		for( ; i < job->mip_width; ++i )
+		{
+			const int a = (next_x ? 2*i : i) * channels;
+			const int b = a + next_x;
+			for( c = 0; c < channels; ++c )
+			{
+				out[i*channels+c] = (row0[a+c] + row0[b+c] + row1[a+c] + row1[b+c] + 2) >> 2;
+			}
+		}
+	}
+}
+
+unsigned char*
+	build_mipmap_chain
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		int srgb,
+		int *levels,
+		int level_offsets[MIPMAP_CHAIN_MAX_LEVELS]
+	)
+{
+	unsigned char *chain;
+	int level, w, h, size = 0;
+	int threads = get_mipmap_thread_count();
+	/*	error check	*/
+	*levels = 0;
+	if( (width < 1) || (height < 1) ||
+		(channels < 1) || (channels > 4) ||
+		(orig == NULL) || (level_offsets == NULL) )
+	{
+		return NULL;
+	}
+	/*	lay out the levels, down to 1x1	*/
+	w = width;
+	h = height;
+	for( level = 0; level < MIPMAP_CHAIN_MAX_LEVELS; ++level )
+	{
+		level_offsets[level] = size;
+		size += w * h * channels;
+		*levels = level + 1;
+		if( (w == 1) && (h == 1) )
+		{
+			break;
+		}
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+	chain = (unsigned char*)malloc( size );
+	if( chain == NULL )
+	{
+		*levels = 0;
+		return NULL;
+	}
+	if( srgb )
+	{
+		build_sRGB_tables();
+	}
+	memcpy( chain, orig, width * height * channels );
+	/*	each level from the one above it	*/
+	w = width;
+	h = height;
+	for( level = 1; level < *levels; ++level )
+	{
+		mip_job job;
+		int pixels;
+		job.src = chain + level_offsets[level-1];
+		job.width = w;
+		job.height = h;
+		job.channels = channels;
+		job.dst = chain + level_offsets[level];
+		job.mip_width = (w > 1) ? w / 2 : 1;
+		job.srgb = srgb;
+		w = job.mip_width;
+		h = (h > 1) ? h / 2 : 1;
+		pixels = w * h;
+		soil_parallel_rows( mip_rows, &job, h, MIP_ROWS_PER_TAKE,
+			(threads < pixels / MIP_PIXELS_PER_THREAD) ? threads : pixels / MIP_PIXELS_PER_THREAD );
+	}
+	return chain;
+}
+
+/********* Resampling *********/
+/*
+	Separable: every output row is filtered horizontally from the source
+	rows it needs into floats, then vertically into bytes.  Each output
+	pixel along an axis has the same number of taps, starting at first[o],
+	so the inner loops have no edge cases; taps that would fall outside the
+	image are folded onto the edge pixel.  Output rows are split between
+	threads RESAMPLE_ROWS_PER_TAKE at a time, each take filtering the
+	source rows it needs on its own.  Every path sums the taps in the same
+	order with the same float operations, so SSE2 and AVX give the same
+	bytes as the plain C loops.
+*/
+#define RESAMPLE_PIXELS_PER_THREAD	65536
+#define RESAMPLE_ROWS_PER_TAKE	32
+
+typedef struct
+{
+	int taps;
+	int *first;
+	float *weights;	/*	taps for each output pixel	*/
+}
+resample_axis;
+
+typedef struct
+{
+	const unsigned char *src;
+	int width, height, channels;
+	unsigned char *dst;
+	int resampled_width;
+	resample_axis x, y;
+	int level;
+	int failed;	/*	set if a take ran out of memory	*/
+}
+resample_job;
+
+/*	0 for one per CPU	*/
+static int resample_thread_count = 0;
+
+int get_resample_thread_count( void )
+{
+	return (resample_thread_count > 0) ? resample_thread_count : soil_cpu_count();
+}
+
+int set_resample_thread_count( int count )
+{
+	resample_thread_count = (count > SOIL_MAX_THREADS) ? SOIL_MAX_THREADS : count;
+	return get_resample_thread_count();
+}
+
+/*	how far from the center each filter reaches, at 1 source pixel per output pixel	*/
+static float resample_support( int filter )
+{
+	switch( filter )
+	{
+	case RESAMPLE_FILTER_BOX:		return 0.5f;
+	case RESAMPLE_FILTER_BILINEAR:	return 1.0f;
+	case RESAMPLE_FILTER_LANCZOS3:	return 3.0f;
+	default:						return 2.0f;
+	}
+}
+
+static double resample_sinc( double x )
+{
+	const double pi = 3.14159265358979323846;
+	return (x == 0.0) ? 1.0 : sin( pi * x ) / (pi * x);
+}
+
+static double resample_kernel( int filter, double x )
+{
+	x = fabs( x );
+	switch( filter )
+	{
+	case RESAMPLE_FILTER_BOX:
+		return (x < 0.5) ? 1.0 : 0.0;
+	case RESAMPLE_FILTER_BILINEAR:
+		return (x < 1.0) ? 1.0 - x : 0.0;
+	case RESAMPLE_FILTER_LANCZOS3:
+		return (x < 3.0) ? resample_sinc( x ) * resample_sinc( x / 3.0 ) : 0.0;
+	default:
+		/*	Mitchell-Netravali, B = C = 1/3	*/
+		if( x < 1.0 )
+		{
+			return (7.0 * x*x*x - 12.0 * x*x + 16.0 / 3.0) / 6.0;
+		}
+		if( x < 2.0 )
+		{
+			return (-7.0 / 3.0 * x*x*x + 12.0 * x*x - 20.0 * x + 32.0 / 3.0) / 6.0;
+		}
+		return 0.0;
+	}
+}
+
+/*	the weight table for size source pixels to resampled_size, 0 if out of memory	*/
+static int build_resample_axis( resample_axis *axis, int size, int resampled_size, int filter )
+{
+	double scale = (double)size / resampled_size;
+	/*	shrinking widens the filter to cover every source pixel	*/
+	double filter_scale = (scale > 1.0) ? scale : 1.0;
+	double radius = resample_support( filter ) * filter_scale;
+	int taps = (int)ceil( 2.0 * radius ) + 1;
+	int o, k;
+	axis->first = (int*)malloc( resampled_size * sizeof(int) );
+	axis->weights = NULL;
+	if( axis->first == NULL )
+	{
+		return 0;
+	}
+	/*	the same size is copied, even by the filters that would blur it	*/
+	if( size == resampled_size )
+	{
+		axis->taps = 1;
+		axis->weights = (float*)malloc( size * sizeof(float) );
+		if( axis->weights == NULL )
+		{
+			return 0;
+		}
+		for( o = 0; o < size; ++o )
+		{
+			axis->first[o] = o;
+			axis->weights[o] = 1.0f;
+		}
+		return 1;
+	}
+	axis->taps = (taps < size) ? taps : size;
+	axis->weights = (float*)calloc( resampled_size * axis->taps, sizeof(float) );
+	if( axis->weights == NULL )
+	{
+		return 0;
+	}
+	for( o = 0; o < resampled_size; ++o )
+	{
+		float *weights = axis->weights + o * axis->taps;
+		double center = (o + 0.5) * scale - 0.5;
+		double sum = 0.0;
+		int start = (int)floor( center - radius );
+		int first = (start > 0) ? start : 0;
+		if( first > size - axis->taps )
+		{
+			first = size - axis->taps;
+		}
+		axis->first[o] = first;
+		for( k = 0; k < taps; ++k )
+		{
+			int i = start + k;
+			double w = resample_kernel( filter, (i - center) / filter_scale );
+			i = (i < 0) ? 0 : ((i >= size) ? size - 1 : i);
+			weights[i - first] += (float)w;
+			sum += w;
+		}
+		if( sum != 0.0 )
+		{
+			for( k = 0; k < axis->taps; ++k )
+			{
+				weights[k] = (float)(weights[k] / sum);
+			}
+		} else
+		{
+			/*	nothing in reach, take the nearest pixel	*/
+			int nearest = (int)floor( center + 0.5 );
+			nearest = (nearest < first) ? first : ((nearest >= first + axis->taps) ? first + axis->taps - 1 : nearest);
+			weights[nearest - first] = 1.0f;
+		}
+	}
+	return 1;
+}
+
+/*	a source row as floats, with room for a 4 float load past the end	*/
+static void resample_bytes_to_floats( const unsigned char *src, float *dst, int count, int level )
+{
+	int i = 0;
+	#if SOIL_HAVE_SSE2
+	if( level >= IMAGE_SIMD_SSE2 )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for( ; i + 16 <= count; i += 16 )
+		{
+			__m128i bytes = _mm_loadu_si128( (const __m128i*)(src + i) );
+			__m128i lo = _mm_unpacklo_epi8( bytes, zero );
+			__m128i hi = _mm_unpackhi_epi8( bytes, zero );
+			_mm_storeu_ps( dst + i, _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) ) );
+			_mm_storeu_ps( dst + i + 4, _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) ) );
+			_mm_storeu_ps( dst + i + 8, _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) ) );
+			_mm_storeu_ps( dst + i + 12, _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) ) );
+		}
+	}
+	#else
+	(void)level;
+	#endif
+	for( ; i < count; ++i )
+	{
+		dst[i] = (float)src[i];
+	}
+	for( i = 0; i < 4; ++i )
+	{
+		dst[count + i] = 0.0f;
+	}
+}
+
+#if SOIL_HAVE_AVX
+/*	2 RGBA output pixels at once, one in each 128 bit half	*/
+SOIL_TARGET_AVX
+static int resample_row_x_avx( const resample_job *job, const float *row, float *out )
+{
+	const int taps = job->x.taps;
+	int o;
+	for( o = 0; o + 2 <= job->resampled_width; o += 2 )
+	{
+		const float *p0 = row + job->x.first[o] * 4;
+		const float *p1 = row + job->x.first[o+1] * 4;
+		const float *w0 = job->x.weights + o * taps;
+		const float *w1 = w0 + taps;
+		__m256 acc = _mm256_setzero_ps();
+		int k;
+		for( k = 0; k < taps; ++k )
+		{
+			__m256 pixels = _mm256_insertf128_ps(
+				_mm256_castps128_ps256( _mm_loadu_ps( p0 + 4*k ) ), _mm_loadu_ps( p1 + 4*k ), 1 );
+			__m256 weights = _mm256_insertf128_ps(
+				_mm256_castps128_ps256( _mm_set1_ps( w0[k] ) ), _mm_set1_ps( w1[k] ), 1 );
+			acc = _mm256_add_ps( acc, _mm256_mul_ps( pixels, weights ) );
+		}
+		_mm256_storeu_ps( out + o * 4, acc );
+	}
+	return o;
+}
+
+SOIL_TARGET_AVX
+static int resample_row_y_avx( const float *const *rows, const float *weights, int taps, float *out, int count )
+{
+	int i;
+	for( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m256 acc = _mm256_setzero_ps();
+		int k;
+		for( k = 0; k < taps; ++k )
+		{
+			acc = _mm256_add_ps( acc, _mm256_mul_ps( _mm256_loadu_ps( rows[k] + i ), _mm256_set1_ps( weights[k] ) ) );
+		}
+		_mm256_storeu_ps( out + i, acc );
+	}
+	return i;
+}
+#endif
+
+/*	one source row (as floats) filtered across to resampled_width pixels	*/
+static void resample_row_x( const resample_job *job, const float *row, float *out )
+{
+	const int channels = job->channels;
+	const int taps = job->x.taps;
+	int o = 0, k, c;
+	#if SOIL_HAVE_AVX
+	if( (job->level >= IMAGE_SIMD_AVX) && (channels == 4) )
+	{
+		o = resample_row_x_avx( job, row, out );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (job->level >= IMAGE_SIMD_SSE2) && ((channels == 3) || (channels == 4)) )
+	{
+		/*	all channels of a pixel in one register, the 4th of RGB is ignored	*/
+		for( ; o < job->resampled_width; ++o )
+		{
+			const float *p = row + job->x.first[o] * channels;
+			const float *w = job->x.weights + o * taps;
+			__m128 acc = _mm_setzero_ps();
+			for( k = 0; k < taps; ++k )
+			{
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( p + k * channels ), _mm_set1_ps( w[k] ) ) );
+			}
+			if( channels == 4 )
+			{
+				_mm_storeu_ps( out + o * 4, acc );
+			} else
+			{
+				float pixel[4];
+				_mm_storeu_ps( pixel, acc );
+				out[o*3] = pixel[0];
+				out[o*3+1] = pixel[1];
+				out[o*3+2] = pixel[2];
+			}
+		}
+	}
+	#endif
+	for( ; o < job->resampled_width; ++o )
+	{
+		const float *p = row + job->x.first[o] * channels;
+		const float *w = job->x.weights + o * taps;
+		for( c = 0; c < channels; ++c )
+		{
+			float acc = 0.0f;
+			for( k = 0; k < taps; ++k )
+			{
+				acc += p[k * channels + c] * w[k];
+			}
+			out[o * channels + c] = acc;
+		}
+	}
+}
+
+/*	taps rows filtered down into one row of bytes	*/
+static void resample_row_y( const resample_job *job, const float *const *rows, const float *weights, float *sums, unsigned char *out )
+{
+	const int taps = job->y.taps;
+	const int count = job->resampled_width * job->channels;
+	int i = 0, k;
+	#if SOIL_HAVE_AVX
+	if( job->level >= IMAGE_SIMD_AVX )
+	{
+		i = resample_row_y_avx( rows, weights, taps, sums, count );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( job->level >= IMAGE_SIMD_SSE2 )
+	{
+		for( ; i + 4 <= count; i += 4 )
+		{
+			__m128 acc = _mm_setzero_ps();
+			for( k = 0; k < taps; ++k )
+			{
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( rows[k] + i ), _mm_set1_ps( weights[k] ) ) );
+			}
+			_mm_storeu_ps( sums + i, acc );
+		}
+	}
+	#endif
+	for( ; i < count; ++i )
+	{
+		float acc = 0.0f;
+		for( k = 0; k < taps; ++k )
+		{
+			acc += rows[k][i] * weights[k];
+		}
+		sums[i] = acc;
+	}
+	/*	clamp, then round to the nearest byte	*/
+	i = 0;
+	#if SOIL_HAVE_SSE2
+	if( job->level >= IMAGE_SIMD_SSE2 )
+	{
+		const __m128 lo = _mm_setzero_ps();
+		const __m128 hi = _mm_set1_ps( 255.0f );
+		const __m128 half = _mm_set1_ps( 0.5f );
+		for( ; i + 16 <= count; i += 16 )
+		{
+			__m128i a = _mm_cvttps_epi32( _mm_add_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( sums + i ), lo ), hi ), half ) );
+			__m128i b = _mm_cvttps_epi32( _mm_add_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( sums + i + 4 ), lo ), hi ), half ) );
+			__m128i c = _mm_cvttps_epi32( _mm_add_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( sums + i + 8 ), lo ), hi ), half ) );
+			__m128i d = _mm_cvttps_epi32( _mm_add_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( sums + i + 12 ), lo ), hi ), half ) );
+			_mm_storeu_si128( (__m128i*)(out + i), _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+		}
+	}
+	#endif
+	for( ; i < count; ++i )
+	{
+		float v = sums[i];
+		v = (v > 0.0f) ? v : 0.0f;
+		v = (v < 255.0f) ? v : 255.0f;
+		out[i] = (unsigned char)(int)(v + 0.5f);
+	}
+}
+
+/*	output rows [first_row,last_row), from the source rows they reach	*/
+static void resample_rows( void *user, int first_row, int last_row )
+{
+	const resample_job *job = (const resample_job*)user;
+	const int row_floats = job->resampled_width * job->channels;
+	const int src_first = job->y.first[first_row];
+	const int src_rows = job->y.first[last_row-1] + job->y.taps - src_first;
+	float *filtered, *row, *sums;
+	const float **rows;
+	int j, k;
+	/*	the filtered rows, one source row, one output row of sums	*/
+	filtered = (float*)malloc(
+		(src_rows * row_floats + job->width * job->channels + 4 + row_floats) * sizeof(float) );
+	rows = (const float**)malloc( job->y.taps * sizeof(float*) );
+	if( (filtered == NULL) || (rows == NULL) )
+	{
+		free( filtered );
+		free( (void*)rows );
+		((resample_job*)user)->failed = 1;
+		return;
+	}
+	row = filtered + src_rows * row_floats;
+	sums = row + job->width * job->channels + 4;
+	for( j = 0; j < src_rows; ++j )
+	{
+		resample_bytes_to_floats( job->src + (src_first + j) * job->width * job->channels,
+			row, job->width * job->channels, job->level );
+		resample_row_x( job, row, filtered + j * row_floats );
+	}
+	for( j = first_row; j < last_row; ++j )
+	{
+		for( k = 0; k < job->y.taps; ++k )
+		{
+			rows[k] = filtered + (job->y.first[j] - src_first + k) * row_floats;
+		}
+		resample_row_y( job, rows, job->y.weights + j * job->y.taps, sums,
+			job->dst + j * row_floats );
+	}
+	free( filtered );
+	free( (void*)rows );
+}
+
+int
+	resample_image
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		unsigned char* resampled,
+		int resampled_width, int resampled_height,
+		int filter
+	)
+{
+	resample_job job;
+	int threads = get_resample_thread_count();
+	int pixels = resampled_width * resampled_height;
+	int ok;
+	/*	error check	*/
+	if( (width < 1) || (height < 1) ||
+		(resampled_width < 1) || (resampled_height < 1) ||
+		(channels < 1) || (channels > 4) ||
+		(filter < RESAMPLE_FILTER_BOX) || (filter > RESAMPLE_FILTER_MITCHELL) ||
+		(orig == NULL) || (resampled == NULL) )
+	{
+		/*	nothing to do	*/
+		return 0;
+	}
+	job.src = orig;
+	job.width = width;
+	job.height = height;
+	job.channels = channels;
+	job.dst = resampled;
+	job.resampled_width = resampled_width;
+	job.level = get_image_SIMD_level();
+	job.failed = 0;
+	ok = build_resample_axis( &job.x, width, resampled_width, filter );
+	ok = build_resample_axis( &job.y, height, resampled_height, filter ) && ok;
+	if( ok )
+	{
+		soil_parallel_rows( resample_rows, &job, resampled_height, RESAMPLE_ROWS_PER_TAKE,
+			(threads < pixels / RESAMPLE_PIXELS_PER_THREAD) ? threads : pixels / RESAMPLE_PIXELS_PER_THREAD );
+		ok = !job.failed;
+	}
+	free( job.x.first );
+	free( job.x.weights );
+	free( job.y.first );
+	free( job.y.weights );
+	return ok;
+}
+
 int
 	scale_image_RGB_to_NTSC_safe
 	(
@@ -177,8 +942,22 @@ int
 	}
 	/*	for channels = 2 or 4, ignore the alpha component	*/
 	nc -= 1 - (channels & 1);
+	/*	whole registers of pixels at a time, then the rest	*/
+	i = 0;
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = scale_NTSC_safe_avx2( orig, width*height*channels, channels );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = scale_NTSC_safe_sse2( orig, width*height*channels, channels );
+	}
+	#endif
 	/*	OK, go through the image and scale any non-alpha components	*/
-	for( i = 0; i < width*height*channels; i += channels )
+	for( ; i < width*height*channels; i += channels )
 	{
 		for( j = 0; j < nc; ++j )
 		{
@@ -213,10 +992,24 @@ int
 		/*	nothing to do	*/
 		return -1;
 	}
+	/*	whole registers of pixels at a time, then the rest	*/
+	i = 0;
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = (channels == 3) ? RGB_to_YCoCg_avx2( orig, width*height ) : RGBA_to_YCoCg_avx2( orig, width*height );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (channels == 4) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = RGBA_to_YCoCg_sse2( orig, width*height );
+	}
+	#endif
 	/*	do the conversion	*/
 	if( channels == 3 )
 	{
-		for( i = 0; i < width*height*3; i += 3 )
+		for( i *= 3; i < width*height*3; i += 3 )
 		{
 			int r = orig[i+0];
 			int g = (orig[i+1] + 1) >> 1;
@@ -231,7 +1024,7 @@ int
 		}
 	} else
 	{
-		for( i = 0; i < width*height*4; i += 4 )
+		for( i *= 4; i < width*height*4; i += 4 )
 		{
 			int r = orig[i+0];
 			int g = (orig[i+1] + 1) >> 1;
@@ -272,10 +1065,24 @@ int
 		/*	nothing to do	*/
 		return -1;
 	}
+	/*	whole registers of pixels at a time, then the rest	*/
+	i = 0;
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = (channels == 3) ? YCoCg_to_RGB_avx2( orig, width*height ) : YCoCg_to_RGBA_avx2( orig, width*height );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (channels == 4) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = YCoCg_to_RGBA_sse2( orig, width*height );
+	}
+	#endif
 	/*	do the conversion	*/
 	if( channels == 3 )
 	{
-		for( i = 0; i < width*height*3; i += 3 )
+		for( i *= 3; i < width*height*3; i += 3 )
 		{
 			int co = orig[i+0] - 128;
 			int y  = orig[i+1];
@@ -289,7 +1096,7 @@ int
 		}
 	} else
 	{
-		for( i = 0; i < width*height*4; i += 4 )
+		for( i *= 4; i < width*height*4; i += 4 )
 		{
 			int co = orig[i+0] - 128;
 			int cg = orig[i+1] - 128;
@@ -318,8 +1125,22 @@ find_max_RGBE
 {
 	float max_val = 0.0f;
 	unsigned char *img = image;
-	int i, j;
-	for( i = width * height; i > 0; --i )
+	int i = 0, j;
+	/*	whole registers of pixels at a time, then the rest	*/
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = find_max_RGBE_avx2( image, width * height, &max_val );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = find_max_RGBE_sse2( image, width * height, &max_val );
+	}
+	#endif
+	img += 4 * i;
+	for( i = width * height - i; i > 0; --i )
 	{
 		/* float scale = powf( 2.0f, img[3] - 128.0f ) / 255.0f; */
 		float scale = (float)ldexp( 1.0f / 255.0f, (int)(img[3]) - 128 );
@@ -358,7 +1179,22 @@ RGBE_to_RGBdivA
 	{
 		scale = 255.0f / find_max_RGBE( image, width, height );
 	}
-	for( i = width * height; i > 0; --i )
+	/*	whole registers of pixels at a time, then the rest	*/
+	i = 0;
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = RGBE_to_RGBdivA_avx2( image, width * height, scale, 0 );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = RGBE_to_RGBdivA_sse2( image, width * height, scale, 0 );
+	}
+	#endif
+	img += 4 * i;
+	for( i = width * height - i; i > 0; --i )
 	{
 		/* decode this pixel, and find the max */
 		float r,g,b,e, m;
@@ -407,7 +1243,22 @@ RGBE_to_RGBdivA2
 	{
 		scale = 255.0f * 255.0f / find_max_RGBE( image, width, height );
 	}
-	for( i = width * height; i > 0; --i )
+	/*	whole registers of pixels at a time, then the rest	*/
+	i = 0;
+	#if SOIL_HAVE_AVX
+	if( get_image_SIMD_level() >= IMAGE_SIMD_AVX2 )
+	{
+		i = RGBE_to_RGBdivA_avx2( image, width * height, scale, 1 );
+	}
+	#endif
+	#if SOIL_HAVE_SSE2
+	if( (i == 0) && (get_image_SIMD_level() >= IMAGE_SIMD_SSE2) )
+	{
+		i = RGBE_to_RGBdivA_sse2( image, width * height, scale, 1 );
+	}
+	#endif
+	img += 4 * i;
+	for( i = width * height - i; i > 0; --i )
 	{
 		/* decode this pixel, and find the max */
 		float r,g,b,e, m;
@@ -13,6 +13,39 @@
 extern "C" {
 #endif
 
+/**
+	Which code path the functions here use.  Each picks
+	the best it has up to this level: the color space
+	conversions use SSE2 and AVX2 (which 3 channel images
+	need), resample_image SSE2 and AVX.
+**/
+#define IMAGE_SIMD_NONE	0
+#define IMAGE_SIMD_SSE2	1
+#define IMAGE_SIMD_AVX	2
+#define IMAGE_SIMD_AVX2	3
+
+/**
+	\return the IMAGE_SIMD_ level in use, by default
+	the best this CPU supports
+**/
+int
+	get_image_SIMD_level
+	(
+		void
+	);
+
+/**
+	Use a slower IMAGE_SIMD_ level than the CPU
+	supports, for testing; -1 goes back to the best.
+	Every level gives the same bytes.
+	\return the level now in use
+**/
+int
+	set_image_SIMD_level
+	(
+		int level
+	);
+
 /**
 	This function upscales an image.
 	Not to be used to create MIPmaps,
@@ -43,6 +76,95 @@ int
 		int block_size_x, int block_size_y
 	);
 
+/**	Most levels build_mipmap_chain can return	**/
+#define MIPMAP_CHAIN_MAX_LEVELS	32
+
+/**
+	This function builds a whole MIPmap chain at once, for
+	uploading every level in one go.  Level i is
+	(width >> i) x (height >> i), at least 1, down to 1x1,
+	and is box filtered 2x2 from level i-1 (SIMD, big
+	levels split between threads).  With srgb set, color
+	channels are averaged as linear light; alpha (the last
+	of 2 or 4 channels) never is.
+	\return all the levels, level 0 being a copy of orig,
+	in one buffer to free(); level i starts at
+	level_offsets[i], and *levels is set to the count.
+	NULL if failed.
+**/
+unsigned char*
+	build_mipmap_chain
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		int srgb,
+		int *levels,
+		int level_offsets[MIPMAP_CHAIN_MAX_LEVELS]
+	);
+
+/**
+	How many threads build_mipmap_chain may split a big
+	level between, by default one per CPU.  Set 0 to go
+	back to that.
+	\return the count now in use
+**/
+int
+	get_mipmap_thread_count
+	(
+		void
+	);
+
+int
+	set_mipmap_thread_count
+	(
+		int count
+	);
+
+/**	Filters for resample_image	**/
+#define RESAMPLE_FILTER_BOX		0
+#define RESAMPLE_FILTER_BILINEAR	1
+#define RESAMPLE_FILTER_LANCZOS3	2
+#define RESAMPLE_FILTER_MITCHELL	3
+
+/**
+	This function resamples an image to any size, up or
+	down, with one of the RESAMPLE_FILTER_ kernels (box,
+	bilinear, Lanczos3 or Mitchell).  Shrinking widens the
+	kernel so every source pixel counts.  Separable, with
+	the weights worked out once per row and column, SIMD
+	inner loops and big images split between threads.
+	
+eturn 0 if failed, otherwise returns 1
+**/
+int
+	resample_image
+	(
+		const unsigned char* const orig,
+		int width, int height, int channels,
+		unsigned char* resampled,
+		int resampled_width, int resampled_height,
+		int filter
+	);
+
+/**
+	How many threads resample_image may split a big
+	image between, by default one per CPU.  Set 0 to go
+	back to that.
+	
+eturn the count now in use
+**/
+int
+	get_resample_thread_count
+	(
+		void
+	);
+
+int
+	set_resample_thread_count
+	(
+		int count
+	);
+
 /**
 	This function takes the RGB components of the image
 	and scales each channel from [0,255] to [16,235].
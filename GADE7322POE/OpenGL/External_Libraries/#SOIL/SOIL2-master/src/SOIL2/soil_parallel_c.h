@@ -0,0 +1,152 @@
+/*
+	Splitting rows of work between threads, for the image code.
+
+	Included by the .c files that use it, everything here is static.
+	Plain Win32 or pthreads threads are started for each call, the calling
+	thread works too, and every thread takes rows_per_take rows at a time
+	from a shared counter until all rows are done. Elsewhere it all runs on
+	the calling thread.
+*/
+
+#ifndef SOIL_PARALLEL_C_H
+#define SOIL_PARALLEL_C_H
+
+#define SOIL_MAX_THREADS	64
+
+#if defined( _WIN32 )
+	#define SOIL_THREADS_WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	typedef volatile LONG soil_counter;
+	#define soil_fetch_add( counter, n )	InterlockedExchangeAdd( counter, n )
+#elif defined( __unix__ ) || defined( __APPLE__ ) || defined( __HAIKU__ )
+	#define SOIL_THREADS_PTHREAD
+	#include <pthread.h>
+	#include <unistd.h>
+	typedef volatile long soil_counter;
+	#define soil_fetch_add( counter, n )	__sync_fetch_and_add( counter, n )
+#endif
+
+/*	does rows [first_row,last_row) of the work	*/
+typedef void (*soil_rows_func)( void *user, int first_row, int last_row );
+
+typedef struct
+{
+	soil_rows_func func;
+	void *user;
+	int rows, rows_per_take;
+	#if defined( SOIL_THREADS_WIN32 ) || defined( SOIL_THREADS_PTHREAD )
+	soil_counter next_row;
+	#endif
+}
+soil_parallel_job;
+
+static int soil_cpu_count( void )
+{
+	int count = 1;
+	#if defined( SOIL_THREADS_WIN32 )
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	count = (int)info.dwNumberOfProcessors;
+	#elif defined( SOIL_THREADS_PTHREAD ) && defined( _SC_NPROCESSORS_ONLN )
+	count = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	#endif
+	if( count < 1 )
+	{
+		count = 1;
+	}
+	return count > SOIL_MAX_THREADS ? SOIL_MAX_THREADS : count;
+}
+
+#if defined( SOIL_THREADS_WIN32 ) || defined( SOIL_THREADS_PTHREAD )
+static void soil_parallel_worker( soil_parallel_job *job )
+{
+	int first_row;
+	while( (first_row = (int)soil_fetch_add( &job->next_row, job->rows_per_take )) < job->rows )
+	{
+		int last_row = first_row + job->rows_per_take;
+		job->func( job->user, first_row, (last_row < job->rows) ? last_row : job->rows );
+	}
+}
+
+#if defined( SOIL_THREADS_WIN32 )
+static DWORD WINAPI soil_thread_main( LPVOID job )
+{
+	soil_parallel_worker( (soil_parallel_job*)job );
+	return 0;
+}
+#else
+static void* soil_thread_main( void *job )
+{
+	soil_parallel_worker( (soil_parallel_job*)job );
+	return NULL;
+}
+#endif
+#endif
+
+/*	run func over rows on up to threads threads, never more than there are takes	*/
+static void soil_parallel_rows(
+		soil_rows_func func, void *user,
+		int rows, int rows_per_take, int threads )
+{
+	soil_parallel_job job;
+	job.func = func;
+	job.user = user;
+	job.rows = rows;
+	job.rows_per_take = (rows_per_take < 1) ? 1 : rows_per_take;
+	if( threads > (rows + job.rows_per_take - 1) / job.rows_per_take )
+	{
+		threads = (rows + job.rows_per_take - 1) / job.rows_per_take;
+	}
+	if( threads > SOIL_MAX_THREADS )
+	{
+		threads = SOIL_MAX_THREADS;
+	}
+	#if defined( SOIL_THREADS_WIN32 ) || defined( SOIL_THREADS_PTHREAD )
+	if( threads > 1 )
+	{
+		#if defined( SOIL_THREADS_WIN32 )
+		HANDLE handles[SOIL_MAX_THREADS];
+		#else
+		pthread_t handles[SOIL_MAX_THREADS];
+		#endif
+		int started = 0, i;
+		job.next_row = 0;
+		/*	the calling thread is one of the workers	*/
+		for( i = 1; i < threads; ++i )
+		{
+			#if defined( SOIL_THREADS_WIN32 )
+			handles[started] = CreateThread( NULL, 0, soil_thread_main, &job, 0, NULL );
+			if( handles[started] != NULL )
+			{
+				++started;
+			}
+			#else
+			if( pthread_create( &handles[started], NULL, soil_thread_main, &job ) == 0 )
+			{
+				++started;
+			}
+			#endif
+		}
+		soil_parallel_worker( &job );
+		for( i = 0; i < started; ++i )
+		{
+			#if defined( SOIL_THREADS_WIN32 )
+			WaitForSingleObject( handles[i], INFINITE );
+			CloseHandle( handles[i] );
+			#else
+			pthread_join( handles[i], NULL );
+			#endif
+		}
+		return;
+	}
+	#endif
+	if( rows > 0 )
+	{
+		func( user, 0, rows );
+	}
+}
+
+#endif /* SOIL_PARALLEL_C_H	*/
@@ -233,6 +233,11 @@ RECENT REVISION HISTORY:
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
 //
+// The JPEG decoder also has AVX2 kernels, used when a run-time test finds
+// AVX2; define STBI_NO_AVX2 to leave them out. Big baseline JPEGs with
+// restart markers have their restart intervals decoded on several threads;
+// define STBI_NO_THREADS to keep decoding on the calling thread.
+//
 // ===========================================================================
 //
 // HDR image support   (disable by defining STBI_NO_HDR)
@@ -475,6 +480,15 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 // calling it will fail to link if your compiler doesn't
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// JPEG decoding uses SSE2 or AVX2 kernels for the IDCT, upsampling and color conversion,
+// whichever is the best the CPU has, and decodes the restart intervals of big baseline
+// JPEGs on one thread per CPU. these change that for every thread, mainly for testing:
+// level 0 is plain C, 1 SSE2 (or NEON), 2 AVX2 and -1 the best there is; count 0 is one
+// thread per CPU. every level and count give the same pixels. both return the setting
+// now in use
+STBIDEF int stbi_set_jpeg_simd_level(int level);
+STBIDEF int stbi_set_jpeg_thread_count(int count);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -603,12 +617,14 @@ typedef unsigned short stbi__uint16;
 typedef   signed short stbi__int16;
 typedef unsigned int   stbi__uint32;
 typedef   signed int   stbi__int32;
+typedef unsigned __int64 stbi__uint64;
 #else
 #include <stdint.h>
 typedef uint16_t stbi__uint16;
 typedef int16_t  stbi__int16;
 typedef uint32_t stbi__uint32;
 typedef int32_t  stbi__int32;
+typedef uint64_t stbi__uint64;
 #endif
 
 // should produce compiler error if size is wrong
@@ -723,6 +739,57 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels for the JPEG decoder live in functions marked STBI__AVX2_TARGET, so
+// they build without -mavx2, and are only used once the CPU (and the OS, for the
+// wider registers) are checked to support them
+#if defined(STBI_SSE2) && !defined(STBI_NO_JPEG) && !defined(STBI_NO_AVX2) && (defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1800))
+#define STBI_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+static int stbi__avx2_available(void)
+{
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7) return 0;
+   __cpuid(info,1);
+   if (!((info[2] >> 27) & 1) || !((info[2] >> 28) & 1) || (_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return (info[1] >> 5) & 1;
+}
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+static int stbi__avx2_available(void)
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+#endif
+
+// threads, for decoding the restart intervals of big baseline JPEGs side by side.
+// #define STBI_NO_THREADS to keep everything on the calling thread
+#if !defined(STBI_NO_JPEG) && !defined(STBI_NO_THREADS)
+#if defined(_WIN32)
+#define STBI__THREADS
+#define STBI__THREADS_WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef volatile LONG stbi__counter;
+#define stbi__fetch_add(counter, n)  InterlockedExchangeAdd(counter, n)
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+#define STBI__THREADS
+#define STBI__THREADS_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+typedef volatile long stbi__counter;
+#define stbi__fetch_add(counter, n)  __sync_fetch_and_add(counter, n)
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -1679,51 +1746,199 @@ static stbi_uc stbi__compute_y(int r, int g, int b)
 }
 #endif
 
+#if defined(STBI_SSE2) && !defined(STBI_NO_JPEG)
+// SSE2 pixel format conversions, shared by the jpeg output stage and stbi__convert_format.
+// The runs that add channels go 16 bytes of output at a time from the end of the image back,
+// and return how many pixels they left at the front; the ones that drop channels go from the
+// front and return how many they did. Either way dest may be the same buffer as src.
+
+// four rgba pixels to rgb in the low 12 bytes
+static __m128i stbi__sse2_pack_rgb(__m128i rgba)
+{
+   // close the alpha gap in each 64-bit half, then the 2-byte gap between the halves
+   __m128i lo   = _mm_and_si128(rgba, _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff));
+   __m128i hi   = _mm_and_si128(_mm_srli_epi64(rgba, 8), _mm_set_epi32(0x0000ffff, (int) 0xff000000, 0x0000ffff, (int) 0xff000000));
+   __m128i half = _mm_or_si128(lo, hi);
+   return _mm_or_si128(_mm_and_si128(half, _mm_set_epi32(0, 0, 0x0000ffff, -1)),
+                       _mm_and_si128(_mm_srli_si128(half, 2), _mm_set_epi32(0, -1, (int) 0xffff0000, 0)));
+}
+
+static int stbi__sse2_gray_to_rgba(stbi_uc *dest, stbi_uc const *src, int count)
+{
+   __m128i alpha = _mm_set1_epi32((int) 0xff000000);
+   for (; count >= 16; count -= 16) {
+      __m128i g   = _mm_loadu_si128((__m128i const *) (src + count - 16));
+      __m128i glo = _mm_unpacklo_epi8(g, g);
+      __m128i ghi = _mm_unpackhi_epi8(g, g);
+      stbi_uc *out = dest + (count - 16) * 4;
+      _mm_storeu_si128((__m128i *) (out +  0), _mm_or_si128(_mm_unpacklo_epi16(glo, glo), alpha));
+      _mm_storeu_si128((__m128i *) (out + 16), _mm_or_si128(_mm_unpackhi_epi16(glo, glo), alpha));
+      _mm_storeu_si128((__m128i *) (out + 32), _mm_or_si128(_mm_unpacklo_epi16(ghi, ghi), alpha));
+      _mm_storeu_si128((__m128i *) (out + 48), _mm_or_si128(_mm_unpackhi_epi16(ghi, ghi), alpha));
+   }
+   return count;
+}
+#endif
+
 #if defined(STBI_NO_PNG) && defined(STBI_NO_BMP) && defined(STBI_NO_PSD) && defined(STBI_NO_TGA) && defined(STBI_NO_GIF) && defined(STBI_NO_PIC) && defined(STBI_NO_PNM)
 // nothing
 #else
+#if defined(STBI_SSE2) && !defined(STBI_NO_JPEG)
+#define STBI__SSE2_CONVERT
+
+// four rgb pixels from the first 12 bytes to rgba, with garbage in the alpha bytes
+static __m128i stbi__sse2_spread_rgb(__m128i rgb)
+{
+   __m128i p01 = _mm_unpacklo_epi32(rgb, _mm_srli_si128(rgb, 3));
+   __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(rgb, 6), _mm_srli_si128(rgb, 9));
+   return _mm_unpacklo_epi64(p01, p23);
+}
+
+// every load reads 4 bytes past the 12 it uses, so src needs 4 readable bytes past the image
+static int stbi__sse2_rgb_to_rgba(stbi_uc *dest, stbi_uc const *src, int count)
+{
+   __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+   __m128i alpha = _mm_set1_epi32((int) 0xff000000);
+   for (; count >= 4; count -= 4) {
+      __m128i rgb = _mm_loadu_si128((__m128i const *) (src + (count - 4) * 3));
+      __m128i rgba = _mm_or_si128(_mm_and_si128(stbi__sse2_spread_rgb(rgb), rgb_mask), alpha);
+      _mm_storeu_si128((__m128i *) (dest + (count - 4) * 4), rgba);
+   }
+   return count;
+}
+
+static int stbi__sse2_gray_alpha_to_rgba(stbi_uc *dest, stbi_uc const *src, int count)
+{
+   __m128i gray_mask = _mm_set1_epi32(0xff);
+   __m128i keep_mask = _mm_set1_epi32((int) 0xffff00ff);
+   for (; count >= 8; count -= 8) {
+      __m128i ga  = _mm_loadu_si128((__m128i const *) (src + (count - 8) * 2));
+      // each gray,alpha pair doubled to gray,alpha,gray,alpha, then the first alpha made gray
+      __m128i lo  = _mm_unpacklo_epi16(ga, ga);
+      __m128i hi  = _mm_unpackhi_epi16(ga, ga);
+      stbi_uc *out = dest + (count - 8) * 4;
+      _mm_storeu_si128((__m128i *) (out +  0), _mm_or_si128(_mm_and_si128(lo, keep_mask), _mm_slli_epi32(_mm_and_si128(lo, gray_mask), 8)));
+      _mm_storeu_si128((__m128i *) (out + 16), _mm_or_si128(_mm_and_si128(hi, keep_mask), _mm_slli_epi32(_mm_and_si128(hi, gray_mask), 8)));
+   }
+   return count;
+}
+
+// writes 16 bytes for every 12 it keeps, so dest needs 4 writable bytes past the rgb image
+static int stbi__sse2_rgba_to_rgb(stbi_uc *dest, stbi_uc const *src, int count)
+{
+   int i;
+   for (i=0; i+4 <= count; i += 4) {
+      __m128i rgba = _mm_loadu_si128((__m128i const *) (src + i * 4));
+      _mm_storeu_si128((__m128i *) (dest + i * 3), stbi__sse2_pack_rgb(rgba));
+   }
+   return i;
+}
+
+// stbi__compute_y of four rgba pixels (or rgb spread to rgba), in the low byte of each dword
+static __m128i stbi__sse2_compute_y(__m128i rgba)
+{
+   __m128i weights = _mm_set_epi16(0, 29, 150, 77, 0, 29, 150, 77);
+   __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(rgba, _mm_setzero_si128()), weights);
+   __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(rgba, _mm_setzero_si128()), weights);
+   // r*77 + g*150 in the even dwords, b*29 in the odd ones
+   lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+   hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+   return _mm_srli_epi32(_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2,0,2,0))), 8);
+}
+
+// img_n 3 or 4 to gray, 16 pixels at a time; the rgb loads read 4 bytes past the 12 they use,
+// so those stop early enough to stay inside the image
+static int stbi__sse2_to_gray(stbi_uc *dest, stbi_uc const *src, int img_n, int count)
+{
+   int i, end = (img_n == 4) ? count : count - 2;
+   for (i=0; i+16 <= end; i += 16) {
+      __m128i y[4];
+      int k;
+      for (k=0; k < 4; ++k) {
+         __m128i px = _mm_loadu_si128((__m128i const *) (src + (i + k*4) * img_n));
+         y[k] = stbi__sse2_compute_y(img_n == 4 ? px : stbi__sse2_spread_rgb(px));
+      }
+      _mm_storeu_si128((__m128i *) (dest + i), _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]), _mm_packs_epi32(y[2], y[3])));
+   }
+   return i;
+}
+#endif
+
 static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int req_comp, unsigned int x, unsigned int y)
 {
-   int i,j;
-   unsigned char *good;
+   int i,j,n;
+   unsigned char *good, *src, *dest;
 
    if (req_comp == img_n) return data;
    STBI_ASSERT(req_comp >= 1 && req_comp <= 4);
 
-   good = (unsigned char *) stbi__malloc_mad3(req_comp, x, y, 0);
-   if (good == NULL) {
-      STBI_FREE(data);
-      return stbi__errpuc("outofmem", "Out of memory");
-   }
+   // convert in place: adding channels runs from the end back and dropping them from the
+   // front on, so every pixel is read before anything is written over it. the image is
+   // tightly packed, so it is all one long row of n pixels
+   n = (int) (x * y);
 
-   for (j=0; j < (int) y; ++j) {
-      unsigned char *src  = data + j * x * img_n   ;
-      unsigned char *dest = good + j * x * req_comp;
+   #define STBI__COMBO(a,b)  ((a)*8+(b))
+   if (req_comp > img_n) {
+      if (!stbi__mad3sizes_valid(req_comp, x, y, 0) ||
+          (good = (unsigned char *) STBI_REALLOC_SIZED(data, img_n * n, req_comp * n)) == NULL) {
+         STBI_FREE(data);
+         return stbi__errpuc("outofmem", "Out of memory");
+      }
 
-      #define STBI__COMBO(a,b)  ((a)*8+(b))
-      #define STBI__CASE(a,b)   case STBI__COMBO(a,b): for(i=x-1; i >= 0; --i, src += a, dest += b)
-      // convert source image with img_n components to one with req_comp components;
-      // avoid switch per pixel, so use switch per scanline and massive macros
+      i = n;
+      #ifdef STBI__SSE2_CONVERT
+      if (stbi__sse2_available()) {
+         switch (STBI__COMBO(img_n, req_comp)) {
+            case STBI__COMBO(1,4): i = stbi__sse2_gray_to_rgba(good, good, n); break;
+            case STBI__COMBO(2,4): i = stbi__sse2_gray_alpha_to_rgba(good, good, n); break;
+            case STBI__COMBO(3,4): i = stbi__sse2_rgb_to_rgba(good, good, n); break;
+         }
+      }
+      #endif
+
+      // pixels [0,i) are left, last first; a pixel's sources are read before its first write
+      #define STBI__CASE(a,b)   case STBI__COMBO(a,b): for(src = good + i*a, dest = good + i*b; src != good && (src -= a, dest -= b, 1); )
       switch (STBI__COMBO(img_n, req_comp)) {
-         STBI__CASE(1,2) { dest[0]=src[0]; dest[1]=255;                                     } break;
-         STBI__CASE(1,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
-         STBI__CASE(1,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=255;                     } break;
-         STBI__CASE(2,1) { dest[0]=src[0];                                                  } break;
-         STBI__CASE(2,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
-         STBI__CASE(2,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=src[1];                  } break;
-         STBI__CASE(3,4) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];dest[3]=255;        } break;
-         STBI__CASE(3,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
-         STBI__CASE(3,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = 255;    } break;
-         STBI__CASE(4,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
-         STBI__CASE(4,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = src[3]; } break;
-         STBI__CASE(4,3) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];                    } break;
+         STBI__CASE(1,2) { dest[0]=src[0]; dest[1]=255;                                        } break;
+         STBI__CASE(1,3) { dest[0]=dest[1]=dest[2]=src[0];                                     } break;
+         STBI__CASE(1,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=255;                        } break;
+         STBI__CASE(2,3) { dest[0]=dest[1]=dest[2]=src[0];                                     } break;
+         STBI__CASE(2,4) { stbi_uc a=src[1]; dest[0]=dest[1]=dest[2]=src[0]; dest[3]=a;        } break;
+         STBI__CASE(3,4) { stbi_uc r=src[0],g=src[1],b=src[2]; dest[0]=r;dest[1]=g;dest[2]=b;dest[3]=255; } break;
          default: STBI_ASSERT(0);
       }
       #undef STBI__CASE
+      return good;
    }
 
-   STBI_FREE(data);
-   return good;
+   i = 0;
+   #ifdef STBI__SSE2_CONVERT
+   if (stbi__sse2_available()) {
+      switch (STBI__COMBO(img_n, req_comp)) {
+         case STBI__COMBO(3,1): i = stbi__sse2_to_gray(data, data, 3, n); break;
+         case STBI__COMBO(4,1): i = stbi__sse2_to_gray(data, data, 4, n); break;
+         case STBI__COMBO(4,3): i = stbi__sse2_rgba_to_rgb(data, data, n); break;
+      }
+   }
+   #endif
+
+   // pixels [i,n) are left, first first; a pixel is written no further on than it was read from
+   #define STBI__CASE(a,b)   case STBI__COMBO(a,b): for(j=i, src = data + i*a, dest = data + i*b; j < n; ++j, src += a, dest += b)
+   // avoid switch per pixel, so use switch per image and massive macros
+   switch (STBI__COMBO(img_n, req_comp)) {
+      STBI__CASE(2,1) { dest[0]=src[0];                                                  } break;
+      STBI__CASE(3,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
+      STBI__CASE(3,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = 255;    } break;
+      STBI__CASE(4,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
+      STBI__CASE(4,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = src[3]; } break;
+      STBI__CASE(4,3) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];                    } break;
+      default: STBI_ASSERT(0);
+   }
+   #undef STBI__CASE
+
+   // hand back the memory the dropped channels used
+   good = (unsigned char *) STBI_REALLOC_SIZED(data, img_n * n, req_comp * n);
+   return good ? good : data;
 }
 #endif
 
@@ -1857,7 +2072,8 @@ static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp)
 //      - quality integer IDCT derived from IJG's 'slow'
 //    performance
 //      - fast huffman; reasonable integer IDCT
-//      - some SIMD kernels for common paths on targets with SSE2/NEON
+//      - some SIMD kernels for common paths on targets with SSE2/NEON/AVX2
+//      - restart intervals decoded on several threads
 //      - uses a lot of intermediate memory, could cache poorly
 
 #ifndef STBI_NO_JPEG
@@ -1926,10 +2142,64 @@ typedef struct
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
+   void (*idct_block2_kernel)(stbi_uc *out0, stbi_uc *out1, int out_stride, short data[128]); // two blocks at once, or NULL
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
    stbi_uc *(*resample_row_hv_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
 } stbi__jpeg;
 
+// kernel and thread settings, see stbi_set_jpeg_simd_level and stbi_set_jpeg_thread_count
+static int stbi__jpeg_simd_level = -1;
+static int stbi__jpeg_thread_count = 0;
+
+static int stbi__jpeg_best_simd_level(void)
+{
+#if defined(STBI_AVX2)
+   if (!stbi__sse2_available()) return 0;
+   return stbi__avx2_available() ? 2 : 1;
+#elif defined(STBI_SSE2)
+   return stbi__sse2_available() ? 1 : 0;
+#elif defined(STBI_NEON)
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+STBIDEF int stbi_set_jpeg_simd_level(int level)
+{
+   int best = stbi__jpeg_best_simd_level();
+   stbi__jpeg_simd_level = level < 0 ? -1 : (level < best ? level : best);
+   return stbi__jpeg_simd_level < 0 ? best : stbi__jpeg_simd_level;
+}
+
+#define STBI__MAX_THREADS  64
+
+// number of threads to decode restart intervals on
+static int stbi__jpeg_threads(void)
+{
+#if defined(STBI__THREADS)
+   int n = stbi__jpeg_thread_count;
+   if (n == 0) {
+#if defined(STBI__THREADS_WIN32)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      n = (int) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+      n = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+   }
+   return n < 1 ? 1 : (n > STBI__MAX_THREADS ? STBI__MAX_THREADS : n);
+#else
+   return 1;
+#endif
+}
+
+STBIDEF int stbi_set_jpeg_thread_count(int count)
+{
+   stbi__jpeg_thread_count = count > 0 ? count : 0;
+   return stbi__jpeg_threads();
+}
+
 static int stbi__build_huffman(stbi__huffman *h, int *count)
 {
    int i,j,k=0;
@@ -2620,6 +2890,210 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// avx2 version of the above, the two blocks in data side by side: the first in the
+// low 128 bits of each register and the second in the high 128 bits. every step
+// stays within its 128 bits, so each block gets exactly what stbi__idct_simd gives.
+STBI__AVX2_TARGET
+static void stbi__idct_avx2(stbi_uc *out0, stbi_uc *out1, int out_stride, short data[128])
+{
+   __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m256i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_set1_epi32((int) (((stbi__uint32) (y) << 16) | (stbi__uint16) (x)))
+
+   // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+   // out(1) = c1[even]*x + c1[odd]*y
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+   // wide add
+   #define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+   // wide sub
+   #define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   // row r of each block
+   #define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128((const __m128i *) (data + r*8))), \
+                              _mm_load_si128((const __m128i *) (data + 64 + r*8)), 1)
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = dct_load(0);
+   row1 = dct_load(1);
+   row2 = dct_load(2);
+   row3 = dct_load(3);
+   row4 = dct_load(4);
+   row5 = dct_load(5);
+   row6 = dct_load(6);
+   row7 = dct_load(7);
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose pass 1
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      // transpose pass 2
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      // transpose pass 3
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m256i p0 = _mm256_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m256i p1 = _mm256_packus_epi16(row2, row3);
+      __m256i p2 = _mm256_packus_epi16(row4, row5);
+      __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose pass 1
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      // transpose pass 2
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      // transpose pass 3
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      // store: each register holds two rows of each block
+      if (out1 == out0 + 8) {
+         // blocks next to each other in the same rows, so a row of both goes out at once
+         #define dct_store2(p) \
+            tmp = _mm256_permute4x64_epi64(p, 0xd8); \
+            _mm_storeu_si128((__m128i *) out0, _mm256_castsi256_si128(tmp)); out0 += out_stride; \
+            _mm_storeu_si128((__m128i *) out0, _mm256_extracti128_si256(tmp, 1)); out0 += out_stride
+         dct_store2(p0);
+         dct_store2(p2);
+         dct_store2(p1);
+         dct_store2(p3);
+         #undef dct_store2
+      } else {
+         #define dct_store2(p) \
+            { \
+               __m128i lo = _mm256_castsi256_si128(p), hi = _mm256_extracti128_si256(p, 1); \
+               _mm_storel_epi64((__m128i *) out0, lo); out0 += out_stride; \
+               _mm_storel_epi64((__m128i *) out0, _mm_shuffle_epi32(lo, 0x4e)); out0 += out_stride; \
+               _mm_storel_epi64((__m128i *) out1, hi); out1 += out_stride; \
+               _mm_storel_epi64((__m128i *) out1, _mm_shuffle_epi32(hi, 0x4e)); out1 += out_stride; \
+            }
+         dct_store2(p0);
+         dct_store2(p2);
+         dct_store2(p1);
+         dct_store2(p3);
+         #undef dct_store2
+      }
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+}
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -2862,67 +3336,112 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
-static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+// baseline blocks go through here on their way to the IDCT, so that with the AVX2
+// kernel two blocks of the same component are transformed at once
+typedef struct
 {
-   stbi__jpeg_reset(z);
-   if (!z->progressive) {
+   STBI_SIMD_ALIGN(short, data[2][64]);
+   stbi_uc *out;
+   int out_stride;
+   int count;
+} stbi__idct_pair;
+
+// where the next block of the component gets decoded
+static short *stbi__idct_next(stbi__idct_pair *p)
+{
+   return p->data[p->count];
+}
+
+static void stbi__idct_add(stbi__jpeg *z, stbi__idct_pair *p, stbi_uc *out, int out_stride)
+{
+   if (!z->idct_block2_kernel) {
+      z->idct_block_kernel(out, out_stride, p->data[0]);
+   } else if (p->count == 0) {
+      p->out = out;
+      p->out_stride = out_stride;
+      p->count = 1;
+   } else {
+      z->idct_block2_kernel(p->out, out, out_stride, p->data[0]);
+      p->count = 0;
+   }
+}
+
+static void stbi__idct_flush(stbi__jpeg *z, stbi__idct_pair *p)
+{
+   if (p->count) {
+      z->idct_block_kernel(p->out, p->out_stride, p->data[0]);
+      p->count = 0;
+   }
+}
+
+// number of MCUs in the current scan
+static int stbi__jpeg_scan_mcus(stbi__jpeg *z)
+{
+   if (z->scan_n == 1) {
+      // non-interleaved data, every block is an MCU
+      int n = z->order[0];
+      return ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   }
+   return z->img_mcu_x * z->img_mcu_y;
+}
+
+// decode MCUs first to last-1 of a baseline scan, counting down the restart interval
+// after each one. returns 0 on bad data, 2 if a restart interval ended without a
+// restart marker (the rest of the scan is then left alone, so we get corrupt data
+// rather than no data) and 1 otherwise
+static int stbi__parse_baseline_mcus(stbi__jpeg *z, int first, int last)
+{
+   stbi__idct_pair pair[4];
+   int m,k,x,y,result = 1;
+   for (k=0; k < 4; ++k)
+      pair[k].count = 0;
+   for (m=first; m < last; ++m) {
       if (z->scan_n == 1) {
-         int i,j;
-         STBI_SIMD_ALIGN(short, data[64]);
-         int n = z->order[0];
          // non-interleaved data, we just need to process one block at a time,
          // in trivial scanline order
          // number of blocks to do just depends on how many actual "pixels" this
          // component has, independent of interleaved MCU blocking and such
+         int n = z->order[0];
          int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               int ha = z->img_comp[n].ha;
-               if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
-               // every data block is an MCU, so countdown the restart interval
-               if (--z->todo <= 0) {
-                  if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                  // if it's NOT a restart, then just bail, so we get corrupt data
-                  // rather than no data
-                  if (!STBI__RESTART(z->marker)) return 1;
-                  stbi__jpeg_reset(z);
-               }
-            }
-         }
-         return 1;
+         int i = m % w, j = m / w;
+         int ha = z->img_comp[n].ha;
+         if (!stbi__jpeg_decode_block(z, stbi__idct_next(&pair[n]), z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+         stbi__idct_add(z, &pair[n], z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2);
       } else { // interleaved
-         int i,j,k,x,y;
-         STBI_SIMD_ALIGN(short, data[64]);
-         for (j=0; j < z->img_mcu_y; ++j) {
-            for (i=0; i < z->img_mcu_x; ++i) {
-               // scan an interleaved mcu... process scan_n components in order
-               for (k=0; k < z->scan_n; ++k) {
-                  int n = z->order[k];
-                  // scan out an mcu's worth of this component; that's just determined
-                  // by the basic H and V specified for the component
-                  for (y=0; y < z->img_comp[n].v; ++y) {
-                     for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
-                     }
-                  }
-               }
-               // after all interleaved components, that's an interleaved MCU,
-               // so now count down the restart interval
-               if (--z->todo <= 0) {
-                  if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                  if (!STBI__RESTART(z->marker)) return 1;
-                  stbi__jpeg_reset(z);
+         int i = m % z->img_mcu_x, j = m / z->img_mcu_x;
+         // scan an interleaved mcu... process scan_n components in order
+         for (k=0; k < z->scan_n; ++k) {
+            int n = z->order[k];
+            // scan out an mcu's worth of this component; that's just determined
+            // by the basic H and V specified for the component
+            for (y=0; y < z->img_comp[n].v; ++y) {
+               for (x=0; x < z->img_comp[n].h; ++x) {
+                  int x2 = (i*z->img_comp[n].h + x)*8;
+                  int y2 = (j*z->img_comp[n].v + y)*8;
+                  int ha = z->img_comp[n].ha;
+                  if (!stbi__jpeg_decode_block(z, stbi__idct_next(&pair[n]), z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                  stbi__idct_add(z, &pair[n], z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2);
                }
             }
          }
-         return 1;
       }
+      // that's an MCU, so now count down the restart interval
+      if (--z->todo <= 0) {
+         if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+         if (!STBI__RESTART(z->marker)) { result = 2; break; }
+         stbi__jpeg_reset(z);
+      }
+   }
+   for (k=0; k < 4; ++k)
+      stbi__idct_flush(z, &pair[k]);
+   return result;
+}
+
+static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+{
+   stbi__jpeg_reset(z);
+   if (!z->progressive) {
+      return stbi__parse_baseline_mcus(z, 0, stbi__jpeg_scan_mcus(z)) != 0;
    } else {
       if (z->scan_n == 1) {
          int i,j;
@@ -3004,8 +3523,16 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
          for (j=0; j < h; ++j) {
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+               stbi_uc *out = z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8;
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               if (z->idct_block2_kernel && i+1 < w) {
+                  // the next block along is right after this one
+                  stbi__jpeg_dequantize(data+64, z->dequant[z->img_comp[n].tq]);
+                  z->idct_block2_kernel(out, out+8, z->img_comp[n].w2, data);
+                  ++i;
+               } else {
+                  z->idct_block_kernel(out, z->img_comp[n].w2, data);
+               }
             }
          }
       }
@@ -3292,6 +3819,310 @@ static int stbi__decode_jpeg_header(stbi__jpeg *z, int scan)
    return 1;
 }
 
+// after a scan's entropy-coded data, find the marker that follows it
+static void stbi__jpeg_skip_to_marker(stbi__jpeg *j)
+{
+   if (j->marker == STBI__MARKER_none ) {
+      // handle 0s at the end of image data from IP Kamera 9060
+      while (!stbi__at_eof(j->s)) {
+         int x = stbi__get8(j->s);
+         if (x == 255) {
+            j->marker = stbi__get8(j->s);
+            break;
+         }
+      }
+      // if we reach eof without hitting a marker, stbi__get_marker() below will fail and we'll eventually return 0
+   }
+}
+
+#ifdef STBI__THREADS
+// big baseline scans with restart markers are decoded an interval at a time on
+// several threads. each interval starts with a fresh entropy decoder and dc
+// prediction, so all that's needed is to read ahead to find where they start
+#define STBI__JPEG_THREAD_MIN_PIXELS  (256*256)
+
+// the entropy-coded data of a scan, up to and including the marker after it
+typedef struct
+{
+   stbi_uc *data;    // in the memory buffer, or a copy of what the callbacks read
+   int len;          // scan data, including the marker after it if there is one
+   int read;         // bytes taken from the context, which may be more than len
+   int window;       // the last read bytes are still in the context's buffer
+   int *starts;      // offset of each restart interval, the first at 0
+   int restarts, max_restarts;
+   int copied;
+} stbi__jpeg_scan_data;
+
+typedef struct
+{
+   stbi__jpeg *z, *copies;
+   stbi__jpeg_scan_data *scan;
+   int total, intervals, per_take;
+   int last, last_end; // copy that decoded the last interval, and where it stopped
+   stbi__counter next, next_copy, failed;
+} stbi__jpeg_threaded_scan;
+
+typedef struct
+{
+   void (*func)(void *);
+   void *user;
+} stbi__thread_job;
+
+#ifdef STBI__THREADS_WIN32
+static DWORD WINAPI stbi__thread_main(LPVOID user)
+{
+   stbi__thread_job *job = (stbi__thread_job *) user;
+   job->func(job->user);
+   return 0;
+}
+#else
+static void *stbi__thread_main(void *user)
+{
+   stbi__thread_job *job = (stbi__thread_job *) user;
+   job->func(job->user);
+   return NULL;
+}
+#endif
+
+// run func on count threads, the calling thread being one of them. if a thread
+// can't be started the others just do its share
+static void stbi__run_threads(void (*func)(void *), void *user, int count)
+{
+   stbi__thread_job job;
+#ifdef STBI__THREADS_WIN32
+   HANDLE threads[STBI__MAX_THREADS];
+#else
+   pthread_t threads[STBI__MAX_THREADS];
+#endif
+   int i, n = 0;
+   job.func = func;
+   job.user = user;
+   for (i=1; i < count && i < STBI__MAX_THREADS; ++i) {
+#ifdef STBI__THREADS_WIN32
+      threads[n] = CreateThread(NULL, 0, stbi__thread_main, &job, 0, NULL);
+      if (threads[n] == NULL) break;
+#else
+      if (pthread_create(&threads[n], NULL, stbi__thread_main, &job) != 0) break;
+#endif
+      ++n;
+   }
+   func(user);
+   for (i=0; i < n; ++i) {
+#ifdef STBI__THREADS_WIN32
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+#else
+      pthread_join(threads[i], NULL);
+#endif
+   }
+}
+
+// number of threads to decode the scan just started on, 1 if it isn't worth it
+static int stbi__jpeg_scan_threads(stbi__jpeg *j)
+{
+   int threads, intervals;
+   if (j->progressive || j->restart_interval <= 0) return 1;
+   if ((int) (j->s->img_x * j->s->img_y) < STBI__JPEG_THREAD_MIN_PIXELS) return 1;
+   threads = stbi__jpeg_threads();
+   if (threads < 2) return 1;
+   intervals = (stbi__jpeg_scan_mcus(j) + j->restart_interval - 1) / j->restart_interval;
+   return threads < intervals ? threads : intervals;
+}
+
+// look through data[*pos..n) for restart markers and the marker that ends the scan,
+// the same way stbi__grow_buffer_unsafe finds them. returns the length of the scan
+// data if it ended, else -1 with *pos where to carry on when there's more
+static int stbi__jpeg_find_restarts(stbi__jpeg_scan_data *d, int *pos, int n)
+{
+   int i = *pos;
+   while (i < n) {
+      stbi_uc *ff = (stbi_uc *) memchr(d->data + i, 0xff, n - i);
+      int r;
+      if (!ff) { i = n; break; }
+      i = (int) (ff - d->data);
+      r = i+1;
+      while (r < n && d->data[r] == 0xff) ++r; // fill bytes
+      if (r == n) break;
+      if (STBI__RESTART(d->data[r])) {
+         if (d->restarts < d->max_restarts)
+            d->starts[++d->restarts] = r+1;
+         else
+            ++d->restarts;
+      } else if (d->data[r] != 0) {
+         return r+1;
+      }
+      i = r+1;
+   }
+   *pos = i;
+   return -1;
+}
+
+// read ahead over the entropy-coded data of a scan. from memory it stays where it
+// is; from callbacks it's copied, a buffer at a time
+static int stbi__jpeg_read_scan(stbi__jpeg *j, stbi__jpeg_scan_data *d, int intervals)
+{
+   stbi__context *s = j->s;
+   int pos = 0, size = 0, len = -1;
+   d->starts = (int *) stbi__malloc_mad2(intervals, sizeof(int), 0);
+   if (!d->starts) return stbi__err("outofmem", "Out of memory");
+   d->starts[0] = 0;
+   d->restarts = 0;
+   d->max_restarts = intervals-1;
+   d->data = NULL;
+   d->read = 0;
+   d->copied = s->read_from_callbacks;
+
+   if (!d->copied) {
+      d->data = s->img_buffer;
+      d->read = d->window = (int) (s->img_buffer_end - s->img_buffer);
+      len = stbi__jpeg_find_restarts(d, &pos, d->read);
+      d->len = len >= 0 ? len : d->read;
+      s->img_buffer = s->img_buffer_end;
+      return 1;
+   }
+
+   for (;;) {
+      d->window = (int) (s->img_buffer_end - s->img_buffer);
+      if (d->read + d->window > size || !d->data) {
+         stbi_uc *data;
+         while (d->read + d->window > size || size == 0) {
+            if (size > (1 << 29)) { STBI_FREE(d->data); return stbi__err("outofmem", "Out of memory"); }
+            size = size ? size*2 : 1 << 16;
+         }
+         data = (stbi_uc *) STBI_REALLOC_SIZED(d->data, d->read, size);
+         if (!data) { STBI_FREE(d->data); return stbi__err("outofmem", "Out of memory"); }
+         d->data = data;
+      }
+      memcpy(d->data + d->read, s->img_buffer, d->window);
+      d->read += d->window;
+      s->img_buffer = s->img_buffer_end;
+      len = stbi__jpeg_find_restarts(d, &pos, d->read);
+      if (len >= 0 || !s->read_from_callbacks) break;
+      stbi__refill_buffer(s);
+   }
+   d->len = len >= 0 ? len : d->read;
+   return 1;
+}
+
+static void stbi__jpeg_interval_worker(void *user)
+{
+   stbi__jpeg_threaded_scan *t = (stbi__jpeg_threaded_scan *) user;
+   int c = (int) stbi__fetch_add(&t->next_copy, 1);
+   stbi__jpeg *z = &t->copies[c];
+   stbi__context s = *t->z->s;
+   int ri = t->z->restart_interval;
+   *z = *t->z;
+   z->s = &s;
+   for (;;) {
+      int k = (int) stbi__fetch_add(&t->next, t->per_take);
+      int e = k + t->per_take < t->intervals ? k + t->per_take : t->intervals;
+      if (k >= t->intervals) return;
+      for (; k < e && !stbi__fetch_add(&t->failed, 0); ++k) {
+         int last = k*ri + ri < t->total ? k*ri + ri : t->total;
+         int start = t->scan->starts[k], result;
+         stbi__start_mem(&s, t->scan->data + start, t->scan->len - start);
+         stbi__jpeg_reset(z);
+         result = stbi__parse_baseline_mcus(z, k*ri, last);
+         // any interval that doesn't end with a restart marker, besides the last,
+         // stops the decode early, so the scan is redone in order
+         if (result == 0 || (result == 2 && k+1 < t->intervals)) {
+            stbi__fetch_add(&t->failed, 1);
+            return;
+         }
+         if (k+1 == t->intervals) {
+            t->last = c;
+            t->last_end = start + (int) (s.img_buffer - s.img_buffer_original);
+         }
+      }
+   }
+}
+
+// decode the restart intervals of the scan data on threads. returns 1 if they all
+// decoded, with j left just as decoding them in order would leave it
+static int stbi__jpeg_decode_intervals(stbi__jpeg *j, stbi__jpeg_scan_data *d, int threads)
+{
+   stbi__jpeg_threaded_scan t;
+   stbi__jpeg *e;
+   int n;
+   t.total = stbi__jpeg_scan_mcus(j);
+   t.intervals = (t.total + j->restart_interval - 1) / j->restart_interval;
+   if (d->restarts < t.intervals-1) return 0;
+   t.copies = (stbi__jpeg *) stbi__malloc_mad2(threads, sizeof(stbi__jpeg), 0);
+   if (!t.copies) return 0;
+   t.z = j;
+   t.scan = d;
+   t.per_take = t.intervals / (threads*8) > 1 ? t.intervals / (threads*8) : 1;
+   t.last = -1;
+   t.last_end = 0;
+   t.next = t.next_copy = t.failed = 0;
+   stbi__run_threads(stbi__jpeg_interval_worker, &t, threads);
+
+   if (t.failed || t.last < 0) {
+      STBI_FREE(t.copies);
+      return 0;
+   }
+   e = &t.copies[t.last];
+   j->code_buffer = e->code_buffer;
+   j->code_bits = e->code_bits;
+   j->marker = e->marker;
+   j->nomore = e->nomore;
+   j->todo = e->todo;
+   j->eob_run = e->eob_run;
+   for (n=0; n < 4; ++n)
+      j->img_comp[n].dc_pred = e->img_comp[n].dc_pred;
+   j->s->img_buffer = j->s->img_buffer_original + t.last_end;
+   STBI_FREE(t.copies);
+   return 1;
+}
+
+// decode a scan with restart intervals on threads. the scan is read ahead into
+// memory and decoded from there; if any interval goes wrong it's decoded again in
+// order, so bad data fails (or is salvaged) exactly as it would on one thread
+static int stbi__jpeg_decode_scan_threaded(stbi__jpeg *j, int threads)
+{
+   stbi__jpeg_scan_data d;
+   stbi__context scan, *s = j->s;
+   int ok, unread;
+   if (!stbi__jpeg_read_scan(j, &d, (stbi__jpeg_scan_mcus(j) + j->restart_interval - 1) / j->restart_interval))
+      return 0;
+
+   scan = *s;
+   stbi__start_mem(&scan, d.data, d.len);
+   j->s = &scan;
+   if (stbi__jpeg_decode_intervals(j, &d, threads)) {
+      ok = 1;
+   } else {
+      stbi__start_mem(&scan, d.data, d.len);
+      ok = stbi__parse_entropy_coded_data(j);
+   }
+   if (ok)
+      stbi__jpeg_skip_to_marker(j);
+   j->s = s;
+
+   // hand back what wasn't used. that's only ever the marker's fill bytes and the
+   // end of the last buffer read, bar data so bad the next marker is rejected anyway
+   unread = d.read - (int) (scan.img_buffer - d.data);
+   s->img_buffer = s->img_buffer_end - (unread < d.window ? unread : d.window);
+   if (d.copied)
+      STBI_FREE(d.data);
+   STBI_FREE(d.starts);
+   return ok;
+}
+#endif
+
+// decode a scan's entropy-coded data, leaving the stream at the marker after it
+static int stbi__jpeg_decode_scan(stbi__jpeg *j)
+{
+#ifdef STBI__THREADS
+   int threads = stbi__jpeg_scan_threads(j);
+   if (threads > 1)
+      return stbi__jpeg_decode_scan_threaded(j, threads);
+#endif
+   if (!stbi__parse_entropy_coded_data(j)) return 0;
+   stbi__jpeg_skip_to_marker(j);
+   return 1;
+}
+
 // decode image to YCbCr format
 static int stbi__decode_jpeg_image(stbi__jpeg *j)
 {
@@ -3306,18 +4137,7 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
    while (!stbi__EOI(m)) {
       if (stbi__SOS(m)) {
          if (!stbi__process_scan_header(j)) return 0;
-         if (!stbi__parse_entropy_coded_data(j)) return 0;
-         if (j->marker == STBI__MARKER_none ) {
-            // handle 0s at the end of image data from IP Kamera 9060
-            while (!stbi__at_eof(j->s)) {
-               int x = stbi__get8(j->s);
-               if (x == 255) {
-                  j->marker = stbi__get8(j->s);
-                  break;
-               }
-            }
-            // if we reach eof without hitting a marker, stbi__get_marker() below will fail and we'll eventually return 0
-         }
+         if (!stbi__jpeg_decode_scan(j)) return 0;
       } else if (stbi__DNL(m)) {
          int Ld = stbi__get16be(j->s);
          stbi__uint32 NL = stbi__get16be(j->s);
@@ -3530,6 +4350,83 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// avx2 version of stbi__resample_row_hv_2_simd, 16 pixels at a time
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   for (; i < ((w-1) & ~15); i += 16) {
+      // load and perform the vertical filtering pass
+      // this uses 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" and "next" are the current row shifted by 1 pixel either way. byte
+      // shifts only work within 128 bits, so the pixel crossing the middle comes in
+      // from a copy with the halves moved over
+      __m256i lo_up = _mm256_permute2x128_si256(curr, curr, 0x08); // 0, low half
+      __m256i hi_dn = _mm256_permute2x128_si256(curr, curr, 0x81); // high half, 0
+      __m256i prv0 = _mm256_alignr_epi8(curr, lo_up, 14);
+      __m256i nxt0 = _mm256_alignr_epi8(hi_dn, curr, 2);
+      __m256i prev = _mm256_insert_epi16(prv0, t1, 0);
+      __m256i next = _mm256_insert_epi16(nxt0, 3*in_near[i+16] + in_far[i+16], 15);
+
+      // horizontal filter, polyphase implementation since it's convenient:
+      // even pixels = 3*cur + prev = cur*4 + (prev - cur)
+      // odd  pixels = 3*cur + next = cur*4 + (next - cur)
+      // note the shared term.
+      __m256i bias  = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave even and odd pixels, then undo scaling. each 128 bits holds
+      // 8 pixels, so this packs straight into output order
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+
+      // pack and write output
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3575,10 +4472,8 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
    int i = 0;
 
 #ifdef STBI_SSE2
-   // step == 3 is pretty ugly on the final interleave, and i'm not convinced
-   // it's useful in practice (you wouldn't use it for textures, for example).
-   // so just accelerate step == 4 case.
-   if (step == 4) {
+   // step == 3 builds the same rgba and packs each 4 pixels down to 12 bytes
+   if (step == 4 || step == 3) {
       // this is a fairly straightforward implementation and not super-optimized.
       __m128i signflip  = _mm_set1_epi8(-0x80);
       __m128i cr_const0 = _mm_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
@@ -3628,9 +4523,20 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
          __m128i o1 = _mm_unpackhi_epi16(t0, t1);
 
          // store
-         _mm_storeu_si128((__m128i *) (out + 0), o0);
-         _mm_storeu_si128((__m128i *) (out + 16), o1);
-         out += 32;
+         if (step == 4) {
+            _mm_storeu_si128((__m128i *) (out + 0), o0);
+            _mm_storeu_si128((__m128i *) (out + 16), o1);
+            out += 32;
+         } else {
+            // the last 12 bytes go out as 8 + 4, so nothing past the 8 pixels is written
+            __m128i p0 = stbi__sse2_pack_rgb(o0);
+            __m128i p1 = stbi__sse2_pack_rgb(o1);
+            int tail = _mm_cvtsi128_si32(_mm_srli_si128(p1, 8));
+            _mm_storeu_si128((__m128i *) (out + 0), p0);
+            _mm_storel_epi64((__m128i *) (out + 12), p1);
+            memcpy(out + 20, &tail, 4);
+            out += 24;
+         }
       }
    }
 #endif
@@ -3704,26 +4610,123 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// avx2 version of the sse2 path in stbi__YCbCr_to_RGB_simd, 16 pixels at a time,
+// which then does whatever is left
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4 || step == 3) {
+      __m128i signflip  = _mm_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      for (; i+15 < count; i += 16) {
+         // load
+         __m128i y_bytes = _mm_loadu_si128((__m128i *) (y+i));
+         __m128i cr_biased = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcr+i)), signflip); // -128
+         __m128i cb_biased = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcb+i)), signflip); // -128
+
+         // widen to short, the same as the sse2 unpacks: y becomes y*256 + 128 and
+         // cr, cb are left-shifted by 8
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_cvtepi8_epi16(cr_biased), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_cvtepi8_epi16(cb_biased), 8);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte, set up for transpose
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+         // transpose to interleave channels. the low 128 bits get pixels 0-7 and
+         // the high 128 bits pixels 8-15, 4 pixels to each half of o0 and o1
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         if (step == 4) {
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+         } else {
+            // 12 bytes for each 4 pixels, the last as 8 + 4 so nothing past the 16 pixels is written
+            __m128i p0 = stbi__sse2_pack_rgb(_mm256_castsi256_si128(o0));
+            __m128i p1 = stbi__sse2_pack_rgb(_mm256_castsi256_si128(o1));
+            __m128i p2 = stbi__sse2_pack_rgb(_mm256_extracti128_si256(o0, 1));
+            __m128i p3 = stbi__sse2_pack_rgb(_mm256_extracti128_si256(o1, 1));
+            int tail = _mm_cvtsi128_si32(_mm_srli_si128(p3, 8));
+            _mm_storeu_si128((__m128i *) (out + 0), p0);
+            _mm_storeu_si128((__m128i *) (out + 12), p1);
+            _mm_storeu_si128((__m128i *) (out + 24), p2);
+            _mm_storel_epi64((__m128i *) (out + 36), p3);
+            memcpy(out + 44, &tail, 4);
+            out += 48;
+         }
+      }
+   }
+
+   stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   int level = stbi__jpeg_simd_level >= 0 ? stbi__jpeg_simd_level : stbi__jpeg_best_simd_level();
+
    j->idct_block_kernel = stbi__idct_block;
+   j->idct_block2_kernel = NULL;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
 
 #ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
+   if (level >= 1) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
    }
 #endif
 
+#ifdef STBI_AVX2
+   if (level >= 2) {
+      j->idct_block2_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   if (level >= 1) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
 #endif
+
+   STBI_NOTUSED(level);
 }
 
 // clean up the temporary component buffers
@@ -3858,12 +4861,18 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
                } else { // YCbCr + alpha?  Ignore the fourth channel for now
                   z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
                }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
+            } else {
+               stbi__uint32 left = z->s->img_x;
+               #ifdef STBI_SSE2
+               if (n == 4 && stbi__sse2_available())
+                  left = (stbi__uint32) stbi__sse2_gray_to_rgba(out, y, (int) left);
+               #endif
+               for (i=0; i < left; ++i) {
                   out[0] = out[1] = out[2] = y[i];
                   out[3] = 255; // not used if n==3
                   out += n;
                }
+            }
          } else {
             if (is_rgb) {
                if (n == 1)
@@ -3967,6 +4976,8 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 // fast-way is faster to check than jpeg huffman, but slow way is slower
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
+#define STBI__ZLIT_BITS   11 // literal pairs decoded in one lookup, see stbi__zbuild_literals
+#define STBI__ZLIT_MASK   ((1 << STBI__ZLIT_BITS) - 1)
 
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
@@ -4054,7 +5065,8 @@ typedef struct
 {
    stbi_uc *zbuffer, *zbuffer_end;
    int num_bits;
-   stbi__uint32 code_buffer;
+   int zeros_read; // zero bytes made up past zbuffer_end
+   stbi__uint64 code_buffer;
 
    char *zout;
    char *zout_start;
@@ -4062,6 +5074,7 @@ typedef struct
    int   z_expandable;
 
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 zlit[1 << STBI__ZLIT_BITS];
 } stbi__zbuf;
 
 stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
@@ -4070,20 +5083,35 @@ stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
    return *z->zbuffer++;
 }
 
+stbi_inline static stbi__uint64 stbi__zget64le(const stbi_uc *p)
+{
+   return  (stbi__uint64) p[0]        | ((stbi__uint64) p[1] <<  8) | ((stbi__uint64) p[2] << 16) | ((stbi__uint64) p[3] << 24) |
+          ((stbi__uint64) p[4] << 32) | ((stbi__uint64) p[5] << 40) | ((stbi__uint64) p[6] << 48) | ((stbi__uint64) p[7] << 56);
+}
+
+// tops the bit buffer up to at least 56 bits. bits above num_bits may hold the start of the
+// next bytes, which the next fill ORs back in unchanged
 static void stbi__fill_bits(stbi__zbuf *z)
 {
+   if (z->zbuffer_end - z->zbuffer >= 8) {
+      // one load for all the whole bytes that fit
+      z->code_buffer |= stbi__zget64le(z->zbuffer) << z->num_bits;
+      z->zbuffer += (63 - z->num_bits) >> 3;
+      z->num_bits |= 56;
+      return;
+   }
    do {
-      STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
-      z->code_buffer |= (unsigned int) stbi__zget8(z) << z->num_bits;
+      if (z->zbuffer >= z->zbuffer_end) ++z->zeros_read;
+      z->code_buffer |= (stbi__uint64) stbi__zget8(z) << z->num_bits;
       z->num_bits += 8;
-   } while (z->num_bits <= 24);
+   } while (z->num_bits <= 56);
 }
 
 stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
 {
    unsigned int k;
    if (z->num_bits < n) stbi__fill_bits(z);
-   k = z->code_buffer & ((1 << n) - 1);
+   k = (unsigned int) (z->code_buffer & ((1 << n) - 1));
    z->code_buffer >>= n;
    z->num_bits -= n;
    return k;
@@ -4094,7 +5122,7 @@ static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
    int b,s,k;
    // not resolved by fast table, so compute it the slow way
    // use jpeg approach, which requires MSbits at top
-   k = stbi__bit_reverse(a->code_buffer, 16);
+   k = stbi__bit_reverse((int) (a->code_buffer & 0xffff), 16);
    for (s=STBI__ZFAST_BITS+1; ; ++s)
       if (k < z->maxcode[s])
          break;
@@ -4154,11 +5182,152 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
+// for every STBI__ZLIT_BITS bits of input, the one or two literals they start with if their codes
+// fit in those bits: the literals in the low 16 bits, the bits their codes take in the next 8 and
+// how many there are in the top 8. 0 if the input starts with a length or a long code
+static void stbi__zbuild_literals(stbi__zbuf *a)
+{
+   int i;
+   for (i=0; i < (1 << STBI__ZLIT_BITS); ++i) {
+      int b = a->z_length.fast[i & STBI__ZFAST_MASK];
+      stbi__uint32 v = 0;
+      if (b && (b & 511) < 256) {
+         int s  = b >> 9;
+         int b2 = a->z_length.fast[(i >> s) & STBI__ZFAST_MASK];
+         int s2 = b2 >> 9;
+         // the second code only counts if it ends inside the bits looked up
+         if (b2 && (b2 & 511) < 256 && s + s2 <= STBI__ZLIT_BITS)
+            v = (2u << 24) | ((stbi__uint32) (s + s2) << 16) | ((stbi__uint32) (b2 & 255) << 8) | (stbi__uint32) (b & 255);
+         else
+            v = (1u << 24) | ((stbi__uint32) s << 16) | (stbi__uint32) (b & 255);
+      }
+      a->zlit[i] = v;
+   }
+}
+
+// decodes a huffman block with the bit buffer and pointers in locals, for as long as there is
+// room to go without checks: 8 bytes of input for a refill and a longest match plus 8 bytes of
+// output. returns 1 at the end of the block, 0 on an error and -1 when it runs out of room
+static int stbi__parse_huffman_fast(stbi__zbuf *a)
+{
+   stbi__uint64 bits = a->code_buffer;
+   int num_bits = a->num_bits;
+   stbi_uc *in = a->zbuffer, *in_end = a->zbuffer_end;
+   char *zout = a->zout, *zout_start = a->zout_start, *zout_end = a->zout_end;
+   int result = -1;
+
+   while (in_end - in >= 8 && zout_end - zout >= 258 + 8) {
+      stbi__uint32 lit;
+      int z,s,len,dist;
+      stbi_uc *p;
+      // 48 bits cover a length code, a distance code and both their extra bits
+      if (num_bits < 48) {
+         bits |= stbi__zget64le(in) << num_bits;
+         in += (63 - num_bits) >> 3;
+         num_bits |= 56;
+      }
+      lit = a->zlit[bits & STBI__ZLIT_MASK];
+      if (lit) {
+         // both bytes are written, the second is written over next if there was one literal
+         s = (lit >> 16) & 255;
+         zout[0] = (char) lit;
+         zout[1] = (char) (lit >> 8);
+         zout += lit >> 24;
+         bits >>= s;
+         num_bits -= s;
+         continue;
+      }
+
+      z = a->z_length.fast[bits & STBI__ZFAST_MASK];
+      if (z) {
+         s = z >> 9;
+         bits >>= s;
+         num_bits -= s;
+         z &= 511;
+      } else {
+         a->code_buffer = bits;
+         a->num_bits = num_bits;
+         z = stbi__zhuffman_decode_slowpath(a, &a->z_length);
+         bits = a->code_buffer;
+         num_bits = a->num_bits;
+      }
+      if (z < 256) {
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+         *zout++ = (char) z;
+         continue;
+      }
+      if (z == 256) { result = 1; break; }
+
+      z -= 257;
+      len = stbi__zlength_base[z];
+      s = stbi__zlength_extra[z];
+      if (s) {
+         len += (int) (bits & ((1 << s) - 1));
+         bits >>= s;
+         num_bits -= s;
+      }
+
+      z = a->z_distance.fast[bits & STBI__ZFAST_MASK];
+      if (z) {
+         s = z >> 9;
+         bits >>= s;
+         num_bits -= s;
+         z &= 511;
+      } else {
+         a->code_buffer = bits;
+         a->num_bits = num_bits;
+         z = stbi__zhuffman_decode_slowpath(a, &a->z_distance);
+         bits = a->code_buffer;
+         num_bits = a->num_bits;
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+      }
+      dist = stbi__zdist_base[z];
+      s = stbi__zdist_extra[z];
+      if (s) {
+         dist += (int) (bits & ((1 << s) - 1));
+         bits >>= s;
+         num_bits -= s;
+      }
+      if (zout - zout_start < dist) { result = stbi__err("bad dist","Corrupt PNG"); break; }
+
+      p = (stbi_uc *) (zout - dist);
+      if (dist == 1) { // run of one byte; common in images.
+         memset(zout, *p, len);
+         zout += len;
+      } else if (dist >= 4) {
+         // whole words while they don't overlap what they copy, running up to 7 bytes past the
+         // match into space that is written over next
+         char *end = zout + len;
+         if (dist >= 8)
+            do { memcpy(zout, p, 8); zout += 8; p += 8; } while (zout < end);
+         else
+            do { memcpy(zout, p, 4); zout += 4; p += 4; } while (zout < end);
+         zout = end;
+      } else {
+         if (len) { do *zout++ = *p++; while (--len); }
+      }
+   }
+
+   a->code_buffer = bits;
+   a->num_bits = num_bits;
+   a->zbuffer = in;
+   a->zout = zout;
+   return result;
+}
+
 static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
-   char *zout = a->zout;
+   char *zout;
+   stbi__zbuild_literals(a);
    for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
+      int z = stbi__parse_huffman_fast(a);
+      if (z >= 0) return z;
+      // near the end of the input or the output buffer, one symbol at a time with every check.
+      // once the zeros made up past the end of the input are being decoded the stream was cut
+      // short, and they could go on decoding forever
+      if (a->zeros_read * 8 > a->num_bits) return stbi__err("unexpected end","Corrupt PNG");
+      zout = a->zout;
+      z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
          if (zout >= a->zout_end) {
@@ -4193,6 +5362,7 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
             if (len) { do *zout++ = *p++; while (--len); }
          }
       }
+      a->zout = zout;
    }
 }
 
@@ -4253,12 +5423,17 @@ static int stbi__parse_uncompressed_block(stbi__zbuf *a)
       stbi__zreceive(a, a->num_bits & 7); // discard
    // drain the bit-packed data into header
    k = 0;
-   while (a->num_bits > 0) {
+   while (a->num_bits > 0 && k < 4) {
       header[k++] = (stbi_uc) (a->code_buffer & 255); // suppress MSVC run-time check
       a->code_buffer >>= 8;
       a->num_bits -= 8;
    }
-   STBI_ASSERT(a->num_bits == 0);
+   // hand any whole bytes still in the bit buffer back to the input, but not the made up zeros
+   if (a->num_bits / 8 > a->zeros_read)
+      a->zbuffer -= a->num_bits / 8 - a->zeros_read;
+   a->num_bits = 0;
+   a->code_buffer = 0;
+   a->zeros_read = 0;
    // now fill header the normal way
    while (k < 4)
       header[k++] = stbi__zget8(a);
@@ -4323,6 +5498,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
       if (!stbi__parse_zlib_header(a)) return 0;
    a->num_bits = 0;
    a->code_buffer = 0;
+   a->zeros_read = 0;
    do {
       final = stbi__zreceive(a,1);
       type = stbi__zreceive(a,2);
@@ -4505,6 +5681,111 @@ static int stbi__paeth(int a, int b, int c)
 
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#if defined(STBI_SSE2) && !defined(STBI_NO_JPEG)
+// a 3 or 4 byte pixel in the low lanes, without reading past it
+stbi_inline static __m128i stbi__sse2_load_pixel(stbi_uc const *p, int n)
+{
+   stbi__uint32 v;
+   if (n == 4) memcpy(&v, p, 4);
+   else v = p[0] | (p[1] << 8) | ((stbi__uint32) p[2] << 16);
+   return _mm_cvtsi32_si128((int) v);
+}
+
+stbi_inline static void stbi__sse2_store_pixel(stbi_uc *p, __m128i pixel, int n)
+{
+   stbi__uint32 v = (stbi__uint32) _mm_cvtsi128_si32(pixel);
+   if (n == 4) memcpy(p, &v, 4);
+   else { p[0] = (stbi_uc) v; p[1] = (stbi_uc) (v >> 8); p[2] = (stbi_uc) (v >> 16); }
+}
+
+// unfilters the rest of an 8-bit row after its first pixel, with all 3 or 4 channels of a pixel
+// at once in the lanes of an SSE2 register; the pixels still depend on each other, but not their
+// channels. raw is filter_bytes a pixel, cur and prior out_n, and the alpha added when out_n is
+// bigger is 255. the arithmetic is the same as the scalar filters, so the bytes are too
+static void stbi__sse2_unfilter_row(stbi_uc *cur, stbi_uc const *raw, stbi_uc const *prior, int filter, stbi__uint32 pixels, int filter_bytes, int out_n)
+{
+   __m128i zero  = _mm_setzero_si128();
+   __m128i alpha = _mm_cvtsi32_si128(out_n > filter_bytes ? (int) 0xff000000 : 0);
+   __m128i a = stbi__sse2_load_pixel(cur - out_n, filter_bytes); // the pixel to the left
+   __m128i b, c;
+   stbi__uint32 i = 0;
+
+   // rgba sub and up four pixels at a time: up doesn't depend on the left, and sub is a running
+   // sum along the row, done within the register in two shifted adds
+   if (filter_bytes == 4 && out_n == 4 && (filter == STBI__F_sub || filter == STBI__F_paeth_first || filter == STBI__F_up)) {
+      for (; i+4 <= pixels; i += 4, raw += 16, cur += 16, prior += 16) {
+         __m128i x = _mm_loadu_si128((__m128i const *) raw);
+         if (filter == STBI__F_up) {
+            x = _mm_add_epi8(x, _mm_loadu_si128((__m128i const *) prior));
+         } else {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, _mm_shuffle_epi32(a, _MM_SHUFFLE(0,0,0,0)));
+            a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3,3,3,3));
+         }
+         _mm_storeu_si128((__m128i *) cur, x);
+      }
+      pixels -= i;
+   }
+
+   #define STBI__CASE(f) \
+       case f:     \
+          for (i=0; i < pixels; ++i, raw += filter_bytes, cur += out_n, prior += out_n)
+   switch (filter) {
+      STBI__CASE(STBI__F_none) {
+         a = stbi__sse2_load_pixel(raw, filter_bytes);
+         stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+      } break;
+      case STBI__F_paeth_first: // paeth(a,0,0) is always a
+      STBI__CASE(STBI__F_sub) {
+         a = _mm_add_epi8(stbi__sse2_load_pixel(raw, filter_bytes), a);
+         stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+      } break;
+      STBI__CASE(STBI__F_up) {
+         a = _mm_add_epi8(stbi__sse2_load_pixel(raw, filter_bytes), stbi__sse2_load_pixel(prior, filter_bytes));
+         stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+      } break;
+      STBI__CASE(STBI__F_avg) {
+         // (a+b)>>1 is the rounded up average less the bit it rounded up by
+         b = stbi__sse2_load_pixel(prior, filter_bytes);
+         b = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+         a = _mm_add_epi8(stbi__sse2_load_pixel(raw, filter_bytes), b);
+         stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+      } break;
+      STBI__CASE(STBI__F_avg_first) {
+         b = _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x7f));
+         a = _mm_add_epi8(stbi__sse2_load_pixel(raw, filter_bytes), b);
+         stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+      } break;
+      case STBI__F_paeth:
+         // in 16-bit lanes: p-a, p-b and p-c are b-c, a-c and the sum of both
+         c = _mm_unpacklo_epi8(stbi__sse2_load_pixel(prior - out_n, filter_bytes), zero);
+         for (i=0; i < pixels; ++i, raw += filter_bytes, cur += out_n, prior += out_n) {
+            __m128i aw = _mm_unpacklo_epi8(a, zero);
+            __m128i pa, pb, pc, least, pick;
+            b  = _mm_unpacklo_epi8(stbi__sse2_load_pixel(prior, filter_bytes), zero);
+            pa = _mm_sub_epi16(b, c);
+            pb = _mm_sub_epi16(aw, c);
+            pc = _mm_add_epi16(pa, pb);
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            least = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            // a on a tie with either, then b on a tie with c
+            pick = _mm_cmpeq_epi16(pb, least);
+            pick = _mm_or_si128(_mm_and_si128(pick, b), _mm_andnot_si128(pick, c));
+            pa   = _mm_cmpeq_epi16(pa, least);
+            pick = _mm_or_si128(_mm_and_si128(pa, aw), _mm_andnot_si128(pa, pick));
+            a = _mm_add_epi8(stbi__sse2_load_pixel(raw, filter_bytes), _mm_packus_epi16(pick, pick));
+            stbi__sse2_store_pixel(cur, _mm_or_si128(a, alpha), out_n);
+            c = b;
+         }
+         break;
+   }
+   #undef STBI__CASE
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4584,6 +5865,14 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          prior += 1;
       }
 
+      #if defined(STBI_SSE2) && !defined(STBI_NO_JPEG)
+      if (depth == 8 && (filter_bytes == 3 || filter_bytes == 4) && stbi__sse2_available()) {
+         stbi__sse2_unfilter_row(cur, raw, prior, filter, x - 1, filter_bytes, out_n);
+         raw += (x - 1) * filter_bytes;
+         continue;
+      }
+      #endif
+
       // this is a little gross, so that we don't switch per-pixel or per-component
       if (depth < 8 || img_n == out_n) {
          int nk = (width - 1)*filter_bytes;
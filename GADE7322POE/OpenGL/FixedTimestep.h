@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+using namespace std;
+
+// Simulation ticks per second
+const double SIMULATION_RATE = 120.0;
+
+// Most ticks run in one frame, so a long stall (window drag, breakpoint) can't snowball
+const int MAX_SIMULATION_STEPS = 8;
+
+// Fixed timestep clock.
+// Real frame time goes into an accumulator and the simulation is stepped in fixed ticks
+// until it has caught up. Whatever is left over becomes the alpha used to blend the last two
+// simulation states when rendering, so motion no longer depends on the render frame rate.
+class FixedTimestep
+{
+private:
+    double step;
+    int maxSteps;
+    double accumulator;
+    double simulationTime;
+    int ticks;
+
+public:
+
+    FixedTimestep(double rate = SIMULATION_RATE, int maxStepsPerFrame = MAX_SIMULATION_STEPS) :
+        step(1.0 / rate), maxSteps(maxStepsPerFrame), accumulator(0.0), simulationTime(0.0), ticks(0)
+    {
+    }
+
+    // Add the real time that passed since the last frame
+    void AddFrameTime(double frameTime)
+    {
+        this->accumulator += min(max(frameTime, 0.0), this->step * this->maxSteps);
+    }
+
+    // Call in a loop, returns true once for every tick that is due
+    bool Step()
+    {
+        if (this->accumulator < this->step)
+        {
+            return false;
+        }
+
+        this->accumulator -= this->step;
+        this->simulationTime += this->step;
+        this->ticks++;
+        return true;
+    }
+
+    // How far the real time is between the previous tick and the latest one, in [0, 1)
+    double GetAlpha()
+    {
+        return this->accumulator / this->step;
+    }
+
+    // Length of one tick in seconds
+    double GetStep()
+    {
+        return this->step;
+    }
+
+    // Time of the latest tick
+    double GetSimulationTime()
+    {
+        return this->simulationTime;
+    }
+
+    // Simulation time blended the same way as the rendered states
+    double GetInterpolatedTime()
+    {
+        return this->simulationTime - this->step + this->GetAlpha() * this->step;
+    }
+
+    int GetTicks()
+    {
+        return this->ticks;
+    }
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "SampleStats.h"
+
+// Swap interval modes, adaptive only tears when a frame misses vblank
+enum VsyncMode
+{
+    VSYNC_OFF,
+    VSYNC_ON,
+    VSYNC_ADAPTIVE
+};
+
+// Frame times kept for the percentile stats
+const int FRAME_HISTORY = 600;
+
+// Frames averaged for the smoothed deltaTime
+const int DELTA_SMOOTHING_FRAMES = 8;
+
+// Longest frame time passed on to the simulation, anything longer is a stall
+const double MAX_DELTA_TIME = 0.25;
+
+// Frame pacer and frame rate limiter.
+// The limiter sleeps in 1 ms steps while the time left is comfortably longer than a sleep
+// usually takes (tracked as mean plus one standard deviation of the observed sleeps, since the
+// OS timer resolution differs per machine), then spins for the rest. That lands on the target
+// frame time far more precisely than sleeping alone, without spinning the whole frame.
+class FramePacer
+{
+private:
+    typedef chrono::steady_clock Clock;
+
+    double targetFrameTime;
+    bool spin;
+    Clock::time_point frameStart;
+    bool started;
+
+    // Sleep overshoot estimate (Welford running mean and variance, seconds)
+    double sleepEstimate;
+    double sleepMean;
+    double sleepM2;
+    long long sleepCount;
+
+    // Frame time history (seconds) and smoothing window
+    vector<double> history;
+    int next;
+    double recent[DELTA_SMOOTHING_FRAMES];
+    int recentCount;
+    double smoothedDelta;
+
+    static double Seconds(Clock::duration duration)
+    {
+        return chrono::duration<double>(duration).count();
+    }
+
+    void SleepUntil(Clock::time_point target)
+    {
+        while (true)
+        {
+            double remaining = Seconds(target - Clock::now());
+            if (remaining <= this->sleepEstimate)
+            {
+                break;
+            }
+
+            Clock::time_point start = Clock::now();
+            this_thread::sleep_for(chrono::milliseconds(1));
+            double observed = Seconds(Clock::now() - start);
+
+            this->sleepCount++;
+            double delta = observed - this->sleepMean;
+            this->sleepMean += delta / this->sleepCount;
+            this->sleepM2 += delta * (observed - this->sleepMean);
+
+            double stddev = sqrt(this->sleepM2 / max(this->sleepCount - 1, 1LL));
+            this->sleepEstimate = this->sleepMean + stddev;
+        }
+
+        if (!this->spin)
+        {
+            // Sleep only, for comparison: one more sleep for whatever is left
+            double remaining = Seconds(target - Clock::now());
+            if (remaining > 0.0)
+            {
+                this_thread::sleep_for(chrono::duration<double>(remaining));
+            }
+            return;
+        }
+
+        while (Clock::now() < target)
+        {
+        }
+    }
+
+public:
+
+    // targetFps of 0 leaves the frame rate uncapped
+    FramePacer(double targetFps = 0.0) : spin(true), started(false),
+        sleepEstimate(0.005), sleepMean(0.005), sleepM2(0.0), sleepCount(1),
+        next(0), recentCount(0), smoothedDelta(1.0 / 60.0)
+    {
+        this->SetTargetFps(targetFps);
+        for (int i = 0; i < DELTA_SMOOTHING_FRAMES; i++)
+        {
+            this->recent[i] = 0.0;
+        }
+    }
+
+    void SetTargetFps(double targetFps)
+    {
+        this->targetFrameTime = targetFps > 0.0 ? 1.0 / targetFps : 0.0;
+    }
+
+    double GetTargetFps()
+    {
+        return this->targetFrameTime > 0.0 ? 1.0 / this->targetFrameTime : 0.0;
+    }
+
+    // Turn the final spin off to compare against plain sleeping
+    void SetSpin(bool enabled)
+    {
+        this->spin = enabled;
+    }
+
+    // Call once at the top of every frame. Records the time since the last call and returns
+    // it smoothed over the last few frames, for use as deltaTime.
+    double BeginFrame()
+    {
+        Clock::time_point now = Clock::now();
+
+        if (!this->started)
+        {
+            this->frameStart = now;
+            this->started = true;
+            return this->smoothedDelta;
+        }
+
+        double frameTime = Seconds(now - this->frameStart);
+        this->frameStart = now;
+
+        if ((int)this->history.size() < FRAME_HISTORY)
+        {
+            this->history.push_back(frameTime);
+        }
+        else
+        {
+            this->history[this->next] = frameTime;
+        }
+        this->next = (this->next + 1) % FRAME_HISTORY;
+
+        // Moving average, so a single late frame doesn't jerk everything forward at once
+        this->recent[this->recentCount % DELTA_SMOOTHING_FRAMES] = min(frameTime, MAX_DELTA_TIME);
+        this->recentCount++;
+
+        int count = min(this->recentCount, DELTA_SMOOTHING_FRAMES);
+        double sum = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            sum += this->recent[i];
+        }
+        this->smoothedDelta = sum / count;
+
+        return this->smoothedDelta;
+    }
+
+    // Call after the frame is done (after swapping). Holds the frame until the target frame
+    // time has passed since BeginFrame, returns straight away when uncapped.
+    void Limit()
+    {
+        if (this->targetFrameTime <= 0.0 || !this->started)
+        {
+            return;
+        }
+
+        Clock::time_point target = this->frameStart + chrono::duration_cast<Clock::duration>(chrono::duration<double>(this->targetFrameTime));
+        this->SleepUntil(target);
+    }
+
+    // Frame time percentile over the recent history, in milliseconds
+    double GetPercentile(double percent)
+    {
+        return SamplePercentile(this->history, percent) * 1000.0;
+    }
+
+    // Mean frame time over the recent history, in milliseconds
+    double GetMean()
+    {
+        return SampleMean(this->history) * 1000.0;
+    }
+
+    double GetSmoothedDelta()
+    {
+        return this->smoothedDelta;
+    }
+
+    void ResetStats()
+    {
+        this->history.clear();
+        this->next = 0;
+    }
+};
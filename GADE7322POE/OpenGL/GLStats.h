@@ -0,0 +1,388 @@
+#pragma once
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Counting is on in debug builds and compiled out in release, define GL_STATS to force it on
+// in release or GL_STATS_DISABLED to force it off in debug
+#if !defined(GL_STATS_DISABLED) && (!defined(NDEBUG) || defined(GL_STATS))
+#define GL_STATS_ENABLED 1
+#else
+#define GL_STATS_ENABLED 0
+#endif
+
+// Texture units tracked for redundant binds
+const int GL_STATS_TEXTURE_UNITS = 16;
+
+// Tracked binding that matches no texture, for when something else has changed the binds
+const GLuint GL_STATS_UNKNOWN_TEXTURE = ~0u;
+
+// Counters for one frame
+struct GLFrameStats
+{
+    unsigned int draws;
+    unsigned int triangles;
+    unsigned int programBinds;
+    unsigned int redundantProgramBinds;
+    unsigned int vertexArrayBinds;
+    unsigned int redundantVertexArrayBinds;
+    unsigned int textureBinds;
+    unsigned int redundantTextureBinds;
+    unsigned int uniformUploads;
+};
+
+// Draw and state change statistics for the GL calls the app makes.
+// Include this right after GLEW and before anything that makes GL calls: it redefines
+// glDrawArrays, glDrawElements, glBindTexture, glActiveTexture, glUseProgram,
+// glBindVertexArray and the glUniform calls as wrappers that count before passing the call
+// straight on. Nothing is ever filtered, a bind that matches the tracked state is only
+// counted as redundant. glDeleteTextures, glDeleteProgram and glDeleteVertexArrays are
+// wrapped too so a recycled name isn't mistaken for the deleted one. Code built outside the
+// app (SOIL) binds without the wrappers, call ForgetTextureBindings after using it. In
+// release builds the wrappers and macros don't exist at all and the counters stay at zero.
+// GL calls are only made from the main thread, so the counters are plain integers.
+class GLStats
+{
+private:
+    GLFrameStats current;
+    GLFrameStats last;
+
+    // Tracked binding state
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint textures2D[GL_STATS_TEXTURE_UNITS];
+    GLuint texturesCube[GL_STATS_TEXTURE_UNITS];
+
+    static void Clear(GLFrameStats& stats)
+    {
+        stats.draws = 0;
+        stats.triangles = 0;
+        stats.programBinds = 0;
+        stats.redundantProgramBinds = 0;
+        stats.vertexArrayBinds = 0;
+        stats.redundantVertexArrayBinds = 0;
+        stats.textureBinds = 0;
+        stats.redundantTextureBinds = 0;
+        stats.uniformUploads = 0;
+    }
+
+    GLStats() : program(0), vertexArray(0), activeUnit(0)
+    {
+        Clear(this->current);
+        Clear(this->last);
+
+        for (int i = 0; i < GL_STATS_TEXTURE_UNITS; i++)
+        {
+            this->textures2D[i] = 0;
+            this->texturesCube[i] = 0;
+        }
+    }
+
+#if GL_STATS_ENABLED
+    void OnDraw(GLenum mode, GLsizei count)
+    {
+        this->current.draws++;
+
+        if (mode == GL_TRIANGLES)
+        {
+            this->current.triangles += count / 3;
+        }
+        else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+        {
+            this->current.triangles += count - 2;
+        }
+    }
+
+    void OnBindTexture(GLenum target, GLuint texture)
+    {
+        this->current.textureBinds++;
+
+        GLuint* bound = nullptr;
+        if (this->activeUnit < (GLuint)GL_STATS_TEXTURE_UNITS)
+        {
+            if (target == GL_TEXTURE_2D)
+            {
+                bound = &this->textures2D[this->activeUnit];
+            }
+            else if (target == GL_TEXTURE_CUBE_MAP)
+            {
+                bound = &this->texturesCube[this->activeUnit];
+            }
+        }
+
+        // Other targets and units aren't tracked, so never count as redundant
+        if (bound != nullptr)
+        {
+            if (*bound == texture)
+            {
+                this->current.redundantTextureBinds++;
+            }
+            *bound = texture;
+        }
+    }
+#endif
+
+public:
+
+    static GLStats& Get()
+    {
+        static GLStats stats;
+        return stats;
+    }
+
+    static bool IsEnabled()
+    {
+        return GL_STATS_ENABLED != 0;
+    }
+
+    // Call once per frame after swapping, the finished frame's counters become GetLastFrame
+    void EndFrame()
+    {
+        this->last = this->current;
+        Clear(this->current);
+    }
+
+    // Texture binds were changed behind the wrappers' back, the next bind on every unit counts
+    // as a real one
+    void ForgetTextureBindings()
+    {
+        for (int i = 0; i < GL_STATS_TEXTURE_UNITS; i++)
+        {
+            this->textures2D[i] = GL_STATS_UNKNOWN_TEXTURE;
+            this->texturesCube[i] = GL_STATS_UNKNOWN_TEXTURE;
+        }
+    }
+
+    // Counters of the last finished frame
+    const GLFrameStats& GetLastFrame()
+    {
+        return this->last;
+    }
+
+    // Counters of the frame in progress
+    const GLFrameStats& GetCurrentFrame()
+    {
+        return this->current;
+    }
+
+#if GL_STATS_ENABLED
+    // Wrappers the GL macros below point at
+    static void DrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        Get().OnDraw(mode, count);
+        glDrawArrays(mode, first, count);
+    }
+
+    static void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        Get().OnDraw(mode, count);
+        glDrawElements(mode, count, type, indices);
+    }
+
+    static void BindTexture(GLenum target, GLuint texture)
+    {
+        Get().OnBindTexture(target, texture);
+        glBindTexture(target, texture);
+    }
+
+    static void ActiveTexture(GLenum texture)
+    {
+        Get().activeUnit = texture - GL_TEXTURE0;
+        glActiveTexture(texture);
+    }
+
+    static void UseProgram(GLuint program)
+    {
+        GLStats& stats = Get();
+        stats.current.programBinds++;
+        if (stats.program == program)
+        {
+            stats.current.redundantProgramBinds++;
+        }
+        stats.program = program;
+        glUseProgram(program);
+    }
+
+    static void BindVertexArray(GLuint vertexArray)
+    {
+        GLStats& stats = Get();
+        stats.current.vertexArrayBinds++;
+        if (stats.vertexArray == vertexArray)
+        {
+            stats.current.redundantVertexArrayBinds++;
+        }
+        stats.vertexArray = vertexArray;
+        glBindVertexArray(vertexArray);
+    }
+
+    // Deleting a bound texture or vertex array binds 0 in its place. A deleted program stays in
+    // use until the next glUseProgram, but its name may come back from glCreateProgram after
+    // that, so it is forgotten as well.
+    static void DeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        GLStats& stats = Get();
+        for (GLsizei t = 0; t < n; t++)
+        {
+            for (int i = 0; i < GL_STATS_TEXTURE_UNITS; i++)
+            {
+                if (stats.textures2D[i] == textures[t])
+                {
+                    stats.textures2D[i] = 0;
+                }
+
+                if (stats.texturesCube[i] == textures[t])
+                {
+                    stats.texturesCube[i] = 0;
+                }
+            }
+        }
+        glDeleteTextures(n, textures);
+    }
+
+    static void DeleteProgram(GLuint program)
+    {
+        GLStats& stats = Get();
+        if (stats.program == program)
+        {
+            stats.program = 0;
+        }
+        glDeleteProgram(program);
+    }
+
+    static void DeleteVertexArrays(GLsizei n, const GLuint* vertexArrays)
+    {
+        GLStats& stats = Get();
+        for (GLsizei i = 0; i < n; i++)
+        {
+            if (stats.vertexArray == vertexArrays[i])
+            {
+                stats.vertexArray = 0;
+            }
+        }
+        glDeleteVertexArrays(n, vertexArrays);
+    }
+
+    static void CountUniform()
+    {
+        Get().current.uniformUploads++;
+    }
+
+    static void Uniform1i(GLint location, GLint v0)
+    {
+        CountUniform();
+        glUniform1i(location, v0);
+    }
+
+    static void Uniform1f(GLint location, GLfloat v0)
+    {
+        CountUniform();
+        glUniform1f(location, v0);
+    }
+
+    static void Uniform2f(GLint location, GLfloat v0, GLfloat v1)
+    {
+        CountUniform();
+        glUniform2f(location, v0, v1);
+    }
+
+    static void Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+    {
+        CountUniform();
+        glUniform3f(location, v0, v1, v2);
+    }
+
+    static void Uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+    {
+        CountUniform();
+        glUniform4f(location, v0, v1, v2, v3);
+    }
+
+    static void Uniform1iv(GLint location, GLsizei count, const GLint* value)
+    {
+        CountUniform();
+        glUniform1iv(location, count, value);
+    }
+
+    static void Uniform1fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        CountUniform();
+        glUniform1fv(location, count, value);
+    }
+
+    static void Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        CountUniform();
+        glUniform2fv(location, count, value);
+    }
+
+    static void Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        CountUniform();
+        glUniform3fv(location, count, value);
+    }
+
+    static void Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        CountUniform();
+        glUniform4fv(location, count, value);
+    }
+
+    static void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        CountUniform();
+        glUniformMatrix3fv(location, count, transpose, value);
+    }
+
+    static void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        CountUniform();
+        glUniformMatrix4fv(location, count, transpose, value);
+    }
+#endif
+};
+
+#if GL_STATS_ENABLED
+// GL 1.1 entry points are plain functions, the rest are GLEW macros that need replacing
+#define glDrawArrays GLStats::DrawArrays
+#define glDrawElements GLStats::DrawElements
+#define glBindTexture GLStats::BindTexture
+#define glDeleteTextures GLStats::DeleteTextures
+
+#undef glActiveTexture
+#define glActiveTexture GLStats::ActiveTexture
+#undef glUseProgram
+#define glUseProgram GLStats::UseProgram
+#undef glBindVertexArray
+#define glBindVertexArray GLStats::BindVertexArray
+#undef glDeleteProgram
+#define glDeleteProgram GLStats::DeleteProgram
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays GLStats::DeleteVertexArrays
+
+#undef glUniform1i
+#define glUniform1i GLStats::Uniform1i
+#undef glUniform1f
+#define glUniform1f GLStats::Uniform1f
+#undef glUniform2f
+#define glUniform2f GLStats::Uniform2f
+#undef glUniform3f
+#define glUniform3f GLStats::Uniform3f
+#undef glUniform4f
+#define glUniform4f GLStats::Uniform4f
+#undef glUniform1iv
+#define glUniform1iv GLStats::Uniform1iv
+#undef glUniform1fv
+#define glUniform1fv GLStats::Uniform1fv
+#undef glUniform2fv
+#define glUniform2fv GLStats::Uniform2fv
+#undef glUniform3fv
+#define glUniform3fv GLStats::Uniform3fv
+#undef glUniform4fv
+#define glUniform4fv GLStats::Uniform4fv
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv GLStats::UniformMatrix3fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv GLStats::UniformMatrix4fv
+#endif
@@ -0,0 +1,482 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "SampleStats.h"
+
+// Frames of timestamps kept in flight before the CPU reads them back
+const int GPU_PROFILER_FRAMES = 4;
+
+// Samples kept per scope for the stats and dumps
+const int GPU_PROFILER_HISTORY = 300;
+
+// Queries created at a time when a frame runs out
+const int GPU_PROFILER_QUERY_BLOCK = 16;
+
+// GPU profiler broken down by named scope.
+// Every Begin and End writes a GL_TIMESTAMP with glQueryCounter, so scopes can nest and can be
+// opened inside other timer queries (dynamic resolution keeps a GL_TIME_ELAPSED query running
+// around the whole frame). Each frame has its own set of queries, used round robin, and a
+// frame is only read back once its last timestamp is available, so the profiler never stalls.
+// Frames that are still not done by the time their queries come round again are dropped.
+class GpuProfiler
+{
+private:
+
+    struct Scope
+    {
+        string name;
+        vector<double> samples;     // milliseconds
+        vector<long long> frames;   // frame each sample came from
+        int next;
+    };
+
+    struct Marker
+    {
+        int scope;
+        int begin;
+        int end;
+    };
+
+    struct Frame
+    {
+        vector<GLuint> queries;
+        int used;
+        vector<Marker> markers;
+        long long number;
+        bool pending;
+    };
+
+    vector<Scope> scopes;
+    Frame frames[GPU_PROFILER_FRAMES];
+    vector<int> open;
+    int current;
+    long long frameNumber;
+    int droppedFrames;
+    int historySize;
+    bool supported;
+
+    int FindScope(const char* name)
+    {
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            if (this->scopes[i].name == name)
+            {
+                return (int)i;
+            }
+        }
+
+        Scope scope;
+        scope.name = name;
+        scope.next = 0;
+        this->scopes.push_back(scope);
+        return (int)this->scopes.size() - 1;
+    }
+
+    // Write a timestamp into the next free query of the current frame
+    int Timestamp()
+    {
+        Frame& frame = this->frames[this->current];
+
+        if (frame.used == (int)frame.queries.size())
+        {
+            frame.queries.resize(frame.used + GPU_PROFILER_QUERY_BLOCK);
+            glGenQueries(GPU_PROFILER_QUERY_BLOCK, &frame.queries[frame.used]);
+        }
+
+        glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+        return frame.used++;
+    }
+
+    void AddSample(Scope& scope, double milliseconds, long long frame)
+    {
+        if ((int)scope.samples.size() < this->historySize)
+        {
+            scope.samples.push_back(milliseconds);
+            scope.frames.push_back(frame);
+        }
+        else
+        {
+            scope.samples[scope.next] = milliseconds;
+            scope.frames[scope.next] = frame;
+        }
+
+        scope.next = (scope.next + 1) % this->historySize;
+    }
+
+    // Read a finished frame's timestamps into the scope histories
+    void Collect(Frame& frame)
+    {
+        if (!frame.pending)
+        {
+            return;
+        }
+        frame.pending = false;
+
+        // Timestamps complete in order, so the last one being ready means they all are
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+        {
+            this->droppedFrames++;
+            return;
+        }
+
+        vector<GLuint64> times(frame.used);
+        for (int i = 0; i < frame.used; i++)
+        {
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+        }
+
+        // Scopes that show up more than once in a frame are added together
+        vector<double> totals(this->scopes.size(), -1.0);
+        for (size_t m = 0; m < frame.markers.size(); m++)
+        {
+            const Marker& marker = frame.markers[m];
+            double milliseconds = (times[marker.end] - times[marker.begin]) / 1.0e6;
+            totals[marker.scope] = max(totals[marker.scope], 0.0) + milliseconds;
+        }
+
+        for (size_t s = 0; s < this->scopes.size(); s++)
+        {
+            if (totals[s] >= 0.0)
+            {
+                this->AddSample(this->scopes[s], totals[s], frame.number);
+            }
+        }
+    }
+
+    // Samples oldest first
+    vector<double> Ordered(const Scope& scope, vector<long long>* frameNumbers)
+    {
+        vector<double> ordered;
+        int count = (int)scope.samples.size();
+        int start = count < this->historySize ? 0 : scope.next;
+
+        for (int i = 0; i < count; i++)
+        {
+            int index = (start + i) % count;
+            ordered.push_back(scope.samples[index]);
+            if (frameNumbers != nullptr)
+            {
+                frameNumbers->push_back(scope.frames[index]);
+            }
+        }
+
+        return ordered;
+    }
+
+public:
+
+    GpuProfiler() : current(0), frameNumber(0), droppedFrames(0), historySize(GPU_PROFILER_HISTORY), supported(false)
+    {
+        for (int i = 0; i < GPU_PROFILER_FRAMES; i++)
+        {
+            this->frames[i].used = 0;
+            this->frames[i].number = 0;
+            this->frames[i].pending = false;
+        }
+    }
+
+    ~GpuProfiler()
+    {
+        this->Release();
+    }
+
+    // Free the queries, call while the context is still current
+    void Release()
+    {
+        for (int i = 0; i < GPU_PROFILER_FRAMES; i++)
+        {
+            if (!this->frames[i].queries.empty())
+            {
+                glDeleteQueries((GLsizei)this->frames[i].queries.size(), &this->frames[i].queries[0]);
+                this->frames[i].queries.clear();
+                this->frames[i].used = 0;
+                this->frames[i].pending = false;
+            }
+        }
+    }
+
+    // Needs a current GL context. Timestamps are core in 3.3, but a driver can still report
+    // zero counter bits, in which case every call is a no-op.
+    bool Init()
+    {
+        this->supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+
+        if (this->supported)
+        {
+            GLint bits = 0;
+            glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+            this->supported = bits > 0;
+        }
+
+        if (!this->supported)
+        {
+            cout << "GPU profiler: timestamp queries are not supported" << endl;
+        }
+
+        return this->supported;
+    }
+
+    // Call at the top of every frame, opens the "Frame" scope around everything else
+    void BeginFrame()
+    {
+        if (!this->supported)
+        {
+            return;
+        }
+
+        this->current = (this->current + 1) % GPU_PROFILER_FRAMES;
+        Frame& frame = this->frames[this->current];
+
+        this->Collect(frame);
+
+        frame.used = 0;
+        frame.markers.clear();
+        frame.number = this->frameNumber++;
+        this->open.clear();
+
+        this->Begin("Frame");
+    }
+
+    // Call once the frame's GL calls are all issued, closes anything left open
+    void EndFrame()
+    {
+        if (!this->supported)
+        {
+            return;
+        }
+
+        while (!this->open.empty())
+        {
+            this->End();
+        }
+
+        this->frames[this->current].pending = true;
+    }
+
+    // Start timing a scope, name must stay the same string for the same scope
+    void Begin(const char* name)
+    {
+        if (!this->supported)
+        {
+            return;
+        }
+
+        Frame& frame = this->frames[this->current];
+
+        Marker marker;
+        marker.scope = this->FindScope(name);
+        marker.begin = this->Timestamp();
+        marker.end = marker.begin;
+
+        frame.markers.push_back(marker);
+        this->open.push_back((int)frame.markers.size() - 1);
+    }
+
+    // Stop timing the innermost open scope
+    void End()
+    {
+        if (!this->supported || this->open.empty())
+        {
+            return;
+        }
+
+        Frame& frame = this->frames[this->current];
+        frame.markers[this->open.back()].end = this->Timestamp();
+        this->open.pop_back();
+    }
+
+    // Read back every frame still in flight, waiting on the GPU to finish them. Only for the
+    // end of a run, e.g. a benchmark, never per frame.
+    void Flush()
+    {
+        if (!this->supported)
+        {
+            return;
+        }
+
+        glFinish();
+
+        for (int i = 1; i <= GPU_PROFILER_FRAMES; i++)
+        {
+            this->Collect(this->frames[(this->current + i) % GPU_PROFILER_FRAMES]);
+        }
+    }
+
+    // Samples kept per scope, set before the first frame (a benchmark keeps its whole run)
+    void SetHistorySize(int samples)
+    {
+        this->historySize = max(samples, 1);
+    }
+
+    // A scope's samples oldest first, leaving out frames before firstFrame (counted from 0 at
+    // the first BeginFrame)
+    vector<double> GetSamples(const char* name, long long firstFrame = 0)
+    {
+        vector<double> result;
+
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            if (this->scopes[i].name == name)
+            {
+                vector<long long> frameNumbers;
+                vector<double> samples = this->Ordered(this->scopes[i], &frameNumbers);
+
+                for (size_t s = 0; s < samples.size(); s++)
+                {
+                    if (frameNumbers[s] >= firstFrame)
+                    {
+                        result.push_back(samples[s]);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    bool IsSupported()
+    {
+        return this->supported;
+    }
+
+    // Frames thrown away because the GPU had not finished them in time
+    int GetDroppedFrames()
+    {
+        return this->droppedFrames;
+    }
+
+    // Stats over the scope's recent history, in milliseconds, 0 for unknown scopes
+    double GetMean(const char* name)
+    {
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            if (this->scopes[i].name == name)
+            {
+                return SampleMean(this->scopes[i].samples);
+            }
+        }
+        return 0.0;
+    }
+
+    double GetPercentile(const char* name, double percent)
+    {
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            if (this->scopes[i].name == name)
+            {
+                return SamplePercentile(this->scopes[i].samples, percent);
+            }
+        }
+        return 0.0;
+    }
+
+    // One line per scope, in the order they were first seen
+    void Report(ostream& out)
+    {
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            const Scope& scope = this->scopes[i];
+            out << "GPU " << scope.name << ": mean " << SampleMean(scope.samples) << " ms, p50 " << SamplePercentile(scope.samples, 50.0)
+                << " ms, p99 " << SamplePercentile(scope.samples, 99.0) << " ms, max " << SamplePercentile(scope.samples, 100.0)
+                << " ms (" << scope.samples.size() << " samples)" << endl;
+        }
+
+        if (this->droppedFrames > 0)
+        {
+            out << "GPU profiler dropped " << this->droppedFrames << " frames" << endl;
+        }
+    }
+
+    // Every sample in the history, one row per scope per frame
+    bool WriteCsv(const char* path)
+    {
+        ofstream file(path);
+        if (!file.is_open())
+        {
+            cout << "GPU profiler: could not write " << path << endl;
+            return false;
+        }
+
+        file << "frame,scope,ms" << endl;
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            vector<long long> frameNumbers;
+            vector<double> samples = this->Ordered(this->scopes[i], &frameNumbers);
+
+            for (size_t s = 0; s < samples.size(); s++)
+            {
+                file << frameNumbers[s] << "," << this->scopes[i].name << "," << samples[s] << endl;
+            }
+        }
+
+        return true;
+    }
+
+    // Summary stats and the sample history for every scope
+    bool WriteJson(const char* path)
+    {
+        ofstream file(path);
+        if (!file.is_open())
+        {
+            cout << "GPU profiler: could not write " << path << endl;
+            return false;
+        }
+
+        file << "{" << endl;
+        file << "  \"droppedFrames\": " << this->droppedFrames << "," << endl;
+        file << "  \"scopes\": [" << endl;
+
+        for (size_t i = 0; i < this->scopes.size(); i++)
+        {
+            const Scope& scope = this->scopes[i];
+            vector<double> samples = this->Ordered(scope, nullptr);
+
+            file << "    { \"name\": \"" << scope.name << "\", \"mean\": " << SampleMean(samples)
+                << ", \"p50\": " << SamplePercentile(samples, 50.0) << ", \"p99\": " << SamplePercentile(samples, 99.0)
+                << ", \"max\": " << SamplePercentile(samples, 100.0) << ", \"samples\": [";
+
+            for (size_t s = 0; s < samples.size(); s++)
+            {
+                file << (s > 0 ? ", " : "") << samples[s];
+            }
+
+            file << "] }" << (i + 1 < this->scopes.size() ? "," : "") << endl;
+        }
+
+        file << "  ]" << endl;
+        file << "}" << endl;
+        return true;
+    }
+};
+
+// Times everything issued until it goes out of scope
+class GpuScope
+{
+private:
+    GpuProfiler& profiler;
+
+public:
+
+    GpuScope(GpuProfiler& gpuProfiler, const char* name) : profiler(gpuProfiler)
+    {
+        this->profiler.Begin(name);
+    }
+
+    ~GpuScope()
+    {
+        this->profiler.End();
+    }
+};
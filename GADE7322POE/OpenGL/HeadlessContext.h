@@ -0,0 +1,183 @@
+#pragma once
+
+#include <iostream>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Frames the CPU may run ahead of the GPU, like a swap chain would allow
+const int HEADLESS_FRAMES_IN_FLIGHT = 2;
+
+#ifdef GADE_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// OpenGL 3.3 core context without a window, for --bench on Linux.
+// Uses Mesa's surfaceless EGL platform, so it needs neither a display server nor a GPU
+// (llvmpipe renders on the CPU). There is no default framebuffer, the scene renders into an
+// offscreen one that stays bound for the whole run, and "swapping" flushes and waits on a
+// fence from HEADLESS_FRAMES_IN_FLIGHT frames back so the CPU can't queue up frames forever.
+class HeadlessContext
+{
+private:
+    EGLDisplay display;
+    EGLContext context;
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+    GLsync fences[HEADLESS_FRAMES_IN_FLIGHT];
+    int frame;
+    bool active;
+
+public:
+
+    HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), framebuffer(0), colorBuffer(0), depthBuffer(0),
+        frame(0), active(false)
+    {
+        for (int i = 0; i < HEADLESS_FRAMES_IN_FLIGHT; i++)
+        {
+            this->fences[i] = 0;
+        }
+    }
+
+    ~HeadlessContext()
+    {
+        if (this->active)
+        {
+            eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(this->display, this->context);
+            eglTerminate(this->display);
+        }
+    }
+
+    // Create the context and make it current, GL calls can't be made before glewInit
+    bool Init()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay == nullptr)
+        {
+            cout << "Headless: eglGetPlatformDisplayEXT is not available" << endl;
+            return false;
+        }
+
+        this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        EGLint major, minor;
+        if (this->display == EGL_NO_DISPLAY || !eglInitialize(this->display, &major, &minor))
+        {
+            cout << "Headless: could not open a surfaceless EGL display" << endl;
+            return false;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            cout << "Headless: EGL has no desktop OpenGL" << endl;
+            eglTerminate(this->display);
+            return false;
+        }
+
+        EGLint attributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        // Surfaceless contexts don't need a config (EGL_KHR_no_config_context)
+        this->context = eglCreateContext(this->display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (this->context == EGL_NO_CONTEXT || !eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context))
+        {
+            cout << "Headless: could not create an OpenGL 3.3 core context" << endl;
+            eglTerminate(this->display);
+            return false;
+        }
+
+        this->active = true;
+        return true;
+    }
+
+    // Create and bind the offscreen framebuffer, after glewInit
+    bool CreateFramebuffer(int width, int height)
+    {
+        glGenRenderbuffers(1, &this->colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+        glGenRenderbuffers(1, &this->depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &this->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            cout << "Headless: framebuffer is not complete" << endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Stands in for glfwSwapBuffers
+    void SwapBuffers()
+    {
+        if (this->fences[this->frame] != 0)
+        {
+            glClientWaitSync(this->fences[this->frame], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(this->fences[this->frame]);
+        }
+
+        this->fences[this->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        this->frame = (this->frame + 1) % HEADLESS_FRAMES_IN_FLIGHT;
+    }
+
+    bool IsActive()
+    {
+        return this->active;
+    }
+
+    // What the frame renders into in place of the window's default framebuffer
+    GLuint GetFramebuffer()
+    {
+        return this->framebuffer;
+    }
+};
+#else
+// Built without EGL (e.g. the Visual Studio project): --bench falls back to a hidden window
+class HeadlessContext
+{
+public:
+
+    bool Init()
+    {
+        cout << "Headless: built without EGL, benchmarking in a hidden window" << endl;
+        return false;
+    }
+
+    bool CreateFramebuffer(int, int)
+    {
+        return false;
+    }
+
+    void SwapBuffers()
+    {
+    }
+
+    bool IsActive()
+    {
+        return false;
+    }
+
+    GLuint GetFramebuffer()
+    {
+        return 0;
+    }
+};
+#endif
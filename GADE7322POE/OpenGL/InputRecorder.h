@@ -0,0 +1,303 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+// Bumped whenever the file layout changes
+const unsigned int INPUT_LOG_VERSION = 1;
+
+// Movement keys held during a tick
+const unsigned char INPUT_KEY_FORWARD = 1 << 0;
+const unsigned char INPUT_KEY_BACKWARD = 1 << 1;
+const unsigned char INPUT_KEY_LEFT = 1 << 2;
+const unsigned char INPUT_KEY_RIGHT = 1 << 3;
+
+// Everything that moves the camera or changes the scene during one simulation tick
+struct TickInput
+{
+    unsigned char keys;        // INPUT_KEY_* bits
+    signed char cameraCycle;   // -1 left, 1 right, 0 none
+    unsigned char toggleAnimation;
+    unsigned char padding;
+    GLfloat mouseX;
+    GLfloat mouseY;
+    GLfloat scroll;
+};
+
+// True when the tick only holds the same keys as the one before it
+inline bool IsIdleTick(const TickInput& input, unsigned char previousKeys)
+{
+    return input.keys == previousKeys && input.cameraCycle == 0 && input.toggleAnimation == 0 &&
+        input.mouseX == 0.0f && input.mouseY == 0.0f && input.scroll == 0.0f;
+}
+
+// Mouse look, zoom and movement for one tick. Camera cycling and animation are handled by the
+// caller since the cycle has to land before the previous state is saved.
+inline void ApplyTickInput(Camera& camera, const TickInput& input, GLfloat timestep)
+{
+    if (input.mouseX != 0.0f || input.mouseY != 0.0f)
+    {
+        camera.ProcessMouseMovement(input.mouseX, input.mouseY);
+    }
+
+    if (input.scroll != 0.0f)
+    {
+        camera.ProcessMouseScroll(input.scroll);
+    }
+
+    if (input.keys & INPUT_KEY_FORWARD)
+    {
+        camera.ProcessKeyboard(FORWARD, timestep);
+    }
+
+    if (input.keys & INPUT_KEY_BACKWARD)
+    {
+        camera.ProcessKeyboard(BACKWARD, timestep);
+    }
+
+    if (input.keys & INPUT_KEY_LEFT)
+    {
+        camera.ProcessKeyboard(LEFT, timestep);
+    }
+
+    if (input.keys & INPUT_KEY_RIGHT)
+    {
+        camera.ProcessKeyboard(RIGHT, timestep);
+    }
+}
+
+// Start of an input log, followed by the records
+struct InputLogHeader
+{
+    char magic[4];             // "GADI"
+    unsigned int version;
+    double tickLength;         // seconds
+    unsigned int ticks;        // ticks covered by the log
+    unsigned int records;
+    CameraState startCamera;
+    CameraState endCamera;     // checked after a replay to catch drift
+    unsigned char startAnimate;
+    unsigned char padding[3];
+};
+
+// One tick that differs from just holding the keys of the record before it
+struct InputLogRecord
+{
+    unsigned int tick;
+    TickInput input;
+};
+
+// Records the input of every simulation tick to a compact binary log.
+// Ticks that only keep holding the same keys aren't written, so a log is a few bytes per
+// change rather than per tick. Everything is kept in memory and written out by Save, so
+// recording costs no file access during the run.
+class InputRecorder
+{
+private:
+    InputLogHeader header;
+    vector<InputLogRecord> records;
+    unsigned char heldKeys;
+    bool recording;
+
+public:
+
+    InputRecorder() : heldKeys(0), recording(false)
+    {
+        this->header = InputLogHeader();
+    }
+
+    // Start with the camera and animation state the replay will have to begin from
+    void Start(double tickLength, const CameraState& camera, bool animate)
+    {
+        memcpy(this->header.magic, "GADI", 4);
+        this->header.version = INPUT_LOG_VERSION;
+        this->header.tickLength = tickLength;
+        this->header.ticks = 0;
+        this->header.startCamera = camera;
+        this->header.startAnimate = animate ? 1 : 0;
+        this->records.clear();
+        this->heldKeys = 0;
+        this->recording = true;
+    }
+
+    // Once per simulation tick, with the input that tick used
+    void Add(const TickInput& input)
+    {
+        if (!this->recording)
+        {
+            return;
+        }
+
+        if (!IsIdleTick(input, this->heldKeys))
+        {
+            InputLogRecord record;
+            record.tick = this->header.ticks;
+            record.input = input;
+            this->records.push_back(record);
+            this->heldKeys = input.keys;
+        }
+
+        this->header.ticks++;
+    }
+
+    // Stop and write the log, endCamera is the camera after the last tick
+    bool Save(const string& path, const CameraState& endCamera)
+    {
+        this->recording = false;
+        this->header.endCamera = endCamera;
+        this->header.records = (unsigned int)this->records.size();
+
+        ofstream file(path.c_str(), ios::binary);
+        if (!file.is_open())
+        {
+            cout << "Input recorder: could not write " << path << endl;
+            return false;
+        }
+
+        file.write((const char*)&this->header, sizeof(this->header));
+        if (!this->records.empty())
+        {
+            file.write((const char*)&this->records[0], this->records.size() * sizeof(InputLogRecord));
+        }
+
+        cout << "Input recorder: " << this->header.ticks << " ticks, " << this->records.size() << " records written to " << path << endl;
+        return file.good();
+    }
+
+    bool IsRecording()
+    {
+        return this->recording;
+    }
+};
+
+// Feeds a recorded input log back one simulation tick at a time.
+// The simulation has to run at the tick length it was recorded at; since input is applied
+// per tick and not per frame, the camera follows the same path at any frame rate.
+class InputReplayer
+{
+private:
+    InputLogHeader header;
+    vector<InputLogRecord> records;
+    size_t next;
+    unsigned int tick;
+    unsigned char heldKeys;
+
+public:
+
+    InputReplayer() : next(0), tick(0), heldKeys(0)
+    {
+        this->header = InputLogHeader();
+    }
+
+    bool Load(const string& path, double tickLength)
+    {
+        ifstream file(path.c_str(), ios::binary);
+        if (!file.is_open())
+        {
+            cout << "Input replay: could not open " << path << endl;
+            return false;
+        }
+
+        file.read((char*)&this->header, sizeof(this->header));
+        if (!file || memcmp(this->header.magic, "GADI", 4) != 0 || this->header.version != INPUT_LOG_VERSION)
+        {
+            cout << "Input replay: " << path << " is not an input log of this version" << endl;
+            return false;
+        }
+
+        if (this->header.tickLength != tickLength)
+        {
+            cout << "Input replay: " << path << " was recorded at " << 1.0 / this->header.tickLength
+                << " ticks per second, the simulation runs at " << 1.0 / tickLength << endl;
+            return false;
+        }
+
+        // Check the record count against the file before allocating for it
+        streamoff start = file.tellg();
+        file.seekg(0, ios::end);
+        streamoff remaining = file.tellg() - start;
+        file.seekg(start);
+
+        if (remaining < 0 || (unsigned long long)this->header.records > (unsigned long long)remaining / sizeof(InputLogRecord))
+        {
+            cout << "Input replay: " << path << " is truncated" << endl;
+            return false;
+        }
+
+        this->records.resize(this->header.records);
+        if (!this->records.empty())
+        {
+            file.read((char*)&this->records[0], this->records.size() * sizeof(InputLogRecord));
+        }
+
+        if (!file)
+        {
+            cout << "Input replay: " << path << " is truncated" << endl;
+            this->records.clear();
+            return false;
+        }
+
+        this->next = 0;
+        this->tick = 0;
+        this->heldKeys = 0;
+        return true;
+    }
+
+    // Camera and animation state the recording started from
+    const CameraState& GetStartCamera()
+    {
+        return this->header.startCamera;
+    }
+
+    bool GetStartAnimate()
+    {
+        return this->header.startAnimate != 0;
+    }
+
+    // Length of the recording in seconds
+    double GetDuration()
+    {
+        return this->header.ticks * this->header.tickLength;
+    }
+
+    bool IsFinished()
+    {
+        return this->tick >= this->header.ticks;
+    }
+
+    // Input for the next tick
+    TickInput Next()
+    {
+        TickInput input = TickInput();
+        input.keys = this->heldKeys;
+
+        if (this->next < this->records.size() && this->records[this->next].tick == this->tick)
+        {
+            input = this->records[this->next].input;
+            this->heldKeys = input.keys;
+            this->next++;
+        }
+
+        this->tick++;
+        return input;
+    }
+
+    // Distance between the camera at the end of the replay and at the end of the recording,
+    // anything but 0 means the replay has drifted
+    float GetDrift(const CameraState& camera)
+    {
+        return glm::length(camera.position - this->header.endCamera.position) +
+            fabs(camera.yaw - this->header.endCamera.yaw) + fabs(camera.pitch - this->header.endCamera.pitch) +
+            fabs(camera.zoom - this->header.endCamera.zoom);
+    }
+};
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <new>
+using namespace std;
+
+#include "CpuProfiler.h"
+
+class JobSystem;
+struct Job;
+
+// A job runs a plain function with a small block of data copied into the job itself
+typedef void (*JobFunction)(Job* job, const void* data);
+
+// Jobs take exactly one cache line so workers never share one
+const size_t JOB_SIZE = 64;
+const size_t JOB_DATA_SIZE = JOB_SIZE - sizeof(JobFunction) - sizeof(Job*) - sizeof(atomic<int>) - sizeof(JobSystem*);
+
+// Jobs each worker can have alive at once before its pool wraps around
+const int JOB_POOL_SIZE = 4096;
+
+struct Job
+{
+    JobFunction function;
+    Job* parent;
+    JobSystem* system;
+
+    // This job plus all children that haven't finished yet
+    atomic<int> unfinishedJobs;
+    char data[JOB_DATA_SIZE];
+};
+
+static_assert(sizeof(Job) == JOB_SIZE, "Job should fill exactly one cache line");
+
+// Chase-Lev work stealing deque.
+// Only the owning worker pushes and pops (at the bottom, LIFO so it stays cache warm), any
+// other worker may steal from the top. Fixed capacity, the same as the job pool.
+class JobDeque
+{
+private:
+    atomic<int64_t> top;
+    char padding[64 - sizeof(atomic<int64_t>)];
+    atomic<int64_t> bottom;
+    atomic<Job*> jobs[JOB_POOL_SIZE];
+
+public:
+
+    JobDeque() : top(0), bottom(0)
+    {
+        for (int i = 0; i < JOB_POOL_SIZE; i++)
+        {
+            this->jobs[i].store(nullptr, memory_order_relaxed);
+        }
+    }
+
+    // Owner only
+    void Push(Job* job)
+    {
+        int64_t b = this->bottom.load(memory_order_relaxed);
+        this->jobs[b & (JOB_POOL_SIZE - 1)].store(job, memory_order_relaxed);
+
+        // Release so a thief that sees the new bottom also sees the job's contents
+        this->bottom.store(b + 1, memory_order_release);
+    }
+
+    // Owner only
+    Job* Pop()
+    {
+        int64_t b = this->bottom.load(memory_order_relaxed) - 1;
+        this->bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = this->top.load(memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            this->bottom.store(b + 1, memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = this->jobs[b & (JOB_POOL_SIZE - 1)].load(memory_order_relaxed);
+
+        if (t == b)
+        {
+            // Last job, race any thief for it
+            if (!this->top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+            this->bottom.store(b + 1, memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    // Any thread
+    Job* Steal()
+    {
+        int64_t t = this->top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t b = this->bottom.load(memory_order_acquire);
+
+        if (t >= b)
+        {
+            return nullptr;
+        }
+
+        Job* job = this->jobs[t & (JOB_POOL_SIZE - 1)].load(memory_order_relaxed);
+
+        if (!this->top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        {
+            // Lost to the owner or another thief
+            return nullptr;
+        }
+
+        return job;
+    }
+};
+
+// Work stealing job system.
+// The thread that creates it becomes worker 0 and helps out whenever it waits, the other
+// workers are background threads. Every worker owns a deque and a ring of jobs, idle workers
+// steal from random victims and go to sleep when there is nothing left to steal.
+// Jobs may only be created and run from worker threads (the creating thread included).
+class JobSystem
+{
+private:
+
+    struct Worker
+    {
+        JobDeque deque;
+        char* poolMemory;
+        Job* pool;
+        unsigned int allocated;
+        unsigned int random;
+
+        // Stats
+        atomic<uint64_t> executed;
+        atomic<uint64_t> stolen;
+    };
+
+    vector<Worker*> workers;
+    vector<thread> threads;
+    atomic<bool> running;
+
+    // Sleeping workers
+    mutex sleepMutex;
+    condition_variable wakeUp;
+    atomic<int> sleepers;
+
+    static int& CurrentWorker()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    Worker* LocalWorker()
+    {
+        int index = CurrentWorker();
+        return (index >= 0 && index < (int)this->workers.size()) ? this->workers[index] : this->workers[0];
+    }
+
+    Job* AllocateJob()
+    {
+        Worker* worker = this->LocalWorker();
+        Job* job = &worker->pool[worker->allocated++ & (JOB_POOL_SIZE - 1)];
+        return job;
+    }
+
+    // Own deque first, then steal from a random victim
+    Job* FindJob()
+    {
+        Worker* worker = this->LocalWorker();
+        Job* job = worker->deque.Pop();
+
+        if (job != nullptr)
+        {
+            return job;
+        }
+
+        int count = (int)this->workers.size();
+        if (count <= 1)
+        {
+            return nullptr;
+        }
+
+        // xorshift, cheap enough to call on every attempt
+        worker->random ^= worker->random << 13;
+        worker->random ^= worker->random >> 17;
+        worker->random ^= worker->random << 5;
+
+        int victim = (int)(worker->random % (unsigned int)count);
+        if (this->workers[victim] == worker)
+        {
+            return nullptr;
+        }
+
+        job = this->workers[victim]->deque.Steal();
+        if (job != nullptr)
+        {
+            worker->stolen.fetch_add(1, memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    void Finish(Job* job)
+    {
+        if (job->unfinishedJobs.fetch_sub(1, memory_order_acq_rel) == 1 && job->parent != nullptr)
+        {
+            this->Finish(job->parent);
+        }
+    }
+
+    void Execute(Job* job)
+    {
+        job->function(job, job->data);
+        this->LocalWorker()->executed.fetch_add(1, memory_order_relaxed);
+        this->Finish(job);
+    }
+
+    void WorkerLoop(int index)
+    {
+        CurrentWorker() = index;
+        CpuProfiler::Get().SetThreadName("Worker");
+        int idleSpins = 0;
+
+        while (this->running.load(memory_order_acquire))
+        {
+            Job* job = this->FindJob();
+
+            if (job != nullptr)
+            {
+                this->Execute(job);
+                idleSpins = 0;
+                continue;
+            }
+
+            // Spin a little before giving the core back
+            if (++idleSpins < 256)
+            {
+                this_thread::yield();
+                continue;
+            }
+
+            unique_lock<mutex> lock(this->sleepMutex);
+            this->sleepers++;
+            this->wakeUp.wait_for(lock, chrono::milliseconds(1));
+            this->sleepers--;
+            idleSpins = 0;
+        }
+    }
+
+    template<typename Function>
+    struct ParallelForData
+    {
+        int begin;
+        int end;
+        int grain;
+        const Function* function;
+    };
+
+    // Split the range in half until it is small enough, then run it
+    template<typename Function>
+    static void ParallelForJob(Job* job, const void* data)
+    {
+        ParallelForData<Function> range;
+        memcpy(&range, data, sizeof(range));
+
+        if (range.end - range.begin > range.grain)
+        {
+            int middle = range.begin + (range.end - range.begin) / 2;
+
+            ParallelForData<Function> left = range, right = range;
+            left.end = middle;
+            right.begin = middle;
+
+            JobSystem* system = job->system;
+            system->Run(system->CreateChildJob(job, &JobSystem::ParallelForJob<Function>, &left, sizeof(left)));
+            system->Run(system->CreateChildJob(job, &JobSystem::ParallelForJob<Function>, &right, sizeof(right)));
+            return;
+        }
+
+        (*range.function)(range.begin, range.end);
+    }
+
+public:
+
+    // threadCount includes the calling thread, 0 means one per core
+    JobSystem(int threadCount = 0) : running(true), sleepers(0)
+    {
+        if (threadCount <= 0)
+        {
+            threadCount = max(1, (int)thread::hardware_concurrency());
+        }
+
+        for (int i = 0; i < threadCount; i++)
+        {
+            Worker* worker = new Worker();
+
+            // Line the pool up with cache lines by hand, C++14 new doesn't honour alignas(64)
+            worker->poolMemory = new char[JOB_POOL_SIZE * sizeof(Job) + 64];
+            worker->pool = reinterpret_cast<Job*>((reinterpret_cast<uintptr_t>(worker->poolMemory) + 63) & ~(uintptr_t)63);
+            for (int j = 0; j < JOB_POOL_SIZE; j++)
+            {
+                new (&worker->pool[j]) Job();
+            }
+
+            worker->allocated = 0;
+            worker->random = 2463534242u + i * 7919u;
+            worker->executed = 0;
+            worker->stolen = 0;
+            this->workers.push_back(worker);
+        }
+
+        CurrentWorker() = 0;
+
+        for (int i = 1; i < threadCount; i++)
+        {
+            this->threads.push_back(thread(&JobSystem::WorkerLoop, this, i));
+        }
+    }
+
+    ~JobSystem()
+    {
+        this->running.store(false, memory_order_release);
+        this->wakeUp.notify_all();
+
+        for (size_t i = 0; i < this->threads.size(); i++)
+        {
+            this->threads[i].join();
+        }
+
+        for (size_t i = 0; i < this->workers.size(); i++)
+        {
+            delete[] this->workers[i]->poolMemory;
+            delete this->workers[i];
+        }
+    }
+
+    // Create a job, optionally copying up to JOB_DATA_SIZE bytes of data into it
+    Job* CreateJob(JobFunction function, const void* data = nullptr, size_t size = 0)
+    {
+        Job* job = this->AllocateJob();
+        job->function = function;
+        job->parent = nullptr;
+        job->system = this;
+        job->unfinishedJobs.store(1, memory_order_relaxed);
+
+        if (data != nullptr && size > 0)
+        {
+            memcpy(job->data, data, min(size, JOB_DATA_SIZE));
+        }
+
+        return job;
+    }
+
+    // Create a job whose parent won't count as finished until this one is
+    Job* CreateChildJob(Job* parent, JobFunction function, const void* data = nullptr, size_t size = 0)
+    {
+        parent->unfinishedJobs.fetch_add(1, memory_order_relaxed);
+
+        Job* job = this->CreateJob(function, data, size);
+        job->parent = parent;
+        return job;
+    }
+
+    // Queue a job on this thread's deque
+    void Run(Job* job)
+    {
+        this->LocalWorker()->deque.Push(job);
+
+        if (this->sleepers.load(memory_order_relaxed) > 0)
+        {
+            this->wakeUp.notify_one();
+        }
+    }
+
+    // Help out with other jobs until this one and all of its children are done
+    void Wait(const Job* job)
+    {
+        while (job->unfinishedJobs.load(memory_order_acquire) > 0)
+        {
+            Job* next = this->FindJob();
+
+            if (next != nullptr)
+            {
+                this->Execute(next);
+            }
+            else
+            {
+                this_thread::yield();
+            }
+        }
+    }
+
+    bool IsFinished(const Job* job)
+    {
+        return job->unfinishedJobs.load(memory_order_acquire) == 0;
+    }
+
+    // Start function(begin, end) over [0, count) in chunks of at least grain items and return
+    // straight away. The function object must stay alive until the returned job is waited on.
+    template<typename Function>
+    Job* ParallelForAsync(int count, int grain, const Function& function)
+    {
+        // Never make more than ~16 chunks per thread so the job pools can't wrap
+        int minimumGrain = count / ((int)this->workers.size() * 16) + 1;
+        ParallelForData<Function> range = { 0, count, max(grain, minimumGrain), &function };
+
+        Job* root = this->CreateJob(&JobSystem::ParallelForJob<Function>, &range, sizeof(range));
+        this->Run(root);
+        return root;
+    }
+
+    // function(begin, end) over [0, count), returns once every chunk is done
+    template<typename Function>
+    void ParallelFor(int count, int grain, const Function& function)
+    {
+        this->Wait(this->ParallelForAsync(count, grain, function));
+    }
+
+    int GetThreadCount()
+    {
+        return (int)this->workers.size();
+    }
+
+    // Stats since the job system started
+    uint64_t GetJobsExecuted()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < this->workers.size(); i++)
+        {
+            total += this->workers[i]->executed.load(memory_order_relaxed);
+        }
+        return total;
+    }
+
+    uint64_t GetJobsStolen()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < this->workers.size(); i++)
+        {
+            total += this->workers[i]->stolen.load(memory_order_relaxed);
+        }
+        return total;
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "SampleStats.h"
+
+// Samples kept for the latency percentiles
+const int LATENCY_HISTORY = 240;
+
+// Measures input to swap latency.
+// Input callbacks stamp the time of the first event not yet seen by the renderer, the frame
+// that latches the camera takes it over, and once that frame's buffers are swapped the gap
+// between the event and the swap becomes a sample. Swap time stands in for photon time, so the
+// numbers are best compared between modes rather than read as absolutes.
+class LatencyTracker
+{
+private:
+    double pendingInput;
+    double latchedInput;
+    double latchTime;
+
+    vector<double> samples;
+    vector<double> latchSamples;
+    int next;
+
+public:
+
+    LatencyTracker() : pendingInput(-1.0), latchedInput(-1.0), latchTime(0.0), next(0)
+    {
+    }
+
+    // An input event arrived (seconds, glfwGetTime)
+    void OnInput(double time)
+    {
+        if (this->pendingInput < 0.0)
+        {
+            this->pendingInput = time;
+        }
+    }
+
+    // The camera for this frame was built from all input so far
+    void OnLatch(double time)
+    {
+        if (this->pendingInput >= 0.0 && this->latchedInput < 0.0)
+        {
+            this->latchedInput = this->pendingInput;
+            this->latchTime = time;
+            this->pendingInput = -1.0;
+        }
+    }
+
+    // The frame that latched the input has been swapped
+    void OnSwap(double time)
+    {
+        if (this->latchedInput < 0.0)
+        {
+            return;
+        }
+
+        double latency = (time - this->latchedInput) * 1000.0;
+        double latchToSwap = (time - this->latchTime) * 1000.0;
+
+        if ((int)this->samples.size() < LATENCY_HISTORY)
+        {
+            this->samples.push_back(latency);
+            this->latchSamples.push_back(latchToSwap);
+        }
+        else
+        {
+            this->samples[this->next] = latency;
+            this->latchSamples[this->next] = latchToSwap;
+        }
+
+        this->next = (this->next + 1) % LATENCY_HISTORY;
+        this->latchedInput = -1.0;
+    }
+
+    void Reset()
+    {
+        this->samples.clear();
+        this->latchSamples.clear();
+        this->next = 0;
+        this->pendingInput = -1.0;
+        this->latchedInput = -1.0;
+    }
+
+    int GetSampleCount()
+    {
+        return (int)this->samples.size();
+    }
+
+    // Input event to swap, in milliseconds
+    double GetPercentile(double percent)
+    {
+        return SamplePercentile(this->samples, percent);
+    }
+
+    // Camera latch to swap, in milliseconds
+    double GetLatchPercentile(double percent)
+    {
+        return SamplePercentile(this->latchSamples, percent);
+    }
+};
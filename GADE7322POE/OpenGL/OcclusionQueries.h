@@ -0,0 +1,238 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.h"
+#include "Bounds.h"
+
+// Number of frames a query is kept in flight before the CPU reads it back
+const GLuint OCCLUSION_QUERY_FRAMES = 3;
+
+// An object drawn this frame whose bounds are tested for the next one
+struct OcclusionBox
+{
+    GLuint slot;
+    glm::mat4 model;
+    Bounds localBounds;
+};
+
+// Hardware occlusion culling for pieces and props.
+// Each object's draw is wrapped in glBeginConditionalRender on the query its bounding box got last
+// frame, so the GPU throws the draw away when no sample of the box passed the depth test. Once the
+// scene is in the depth buffer every box is drawn in one pass (one program and vertex array bind,
+// no colour or depth writes) inside a GL_ANY_SAMPLES_PASSED query for the next frame to use.
+// Nothing ever waits on a result: a query that isn't ready lets the draw through, and the CPU only
+// reads a query back once it is a few frames old and the driver reports it as available, so
+// counting skipped draws never stalls the pipeline either.
+class OcclusionQueries
+{
+private:
+    Shader* boundsShader;
+    GLint mvpLoc;
+    GLuint boxVAO, boxVBO;
+
+    // OCCLUSION_QUERY_FRAMES queries per object slot, used round robin every frame
+    vector<GLuint> queries;
+    vector<bool> issued;
+    GLuint slotCount;
+    GLuint frameIndex;
+
+    // Objects drawn this frame, their boxes are queried by IssueQueries
+    vector<OcclusionBox> boxes;
+
+    bool enabled;
+    bool conditionalActive;
+
+    // Results of the newest frame that has been read back
+    GLuint skippedDraws;
+    GLuint testedDraws;
+
+    GLuint QueryIndex(GLuint slot, GLuint frame)
+    {
+        return slot * OCCLUSION_QUERY_FRAMES + frame % OCCLUSION_QUERY_FRAMES;
+    }
+
+public:
+
+    OcclusionQueries() : boundsShader(nullptr), mvpLoc(-1), boxVAO(0), boxVBO(0), slotCount(0), frameIndex(0),
+        enabled(false), conditionalActive(false), skippedDraws(0), testedDraws(0)
+    {
+    }
+
+    ~OcclusionQueries()
+    {
+        delete this->boundsShader;
+    }
+
+    // Create the queries and the unit box, needs a current GL context
+    void Init(GLuint slots)
+    {
+        this->slotCount = slots;
+        this->queries.resize(slots * OCCLUSION_QUERY_FRAMES);
+        this->issued.assign(slots * OCCLUSION_QUERY_FRAMES, false);
+        glGenQueries((GLsizei)this->queries.size(), &this->queries[0]);
+
+        this->boundsShader = new Shader("Bounds.vs", "Bounds.frag");
+        this->mvpLoc = glGetUniformLocation(this->boundsShader->Program, "mvp");
+
+        // Unit cube from (0,0,0) to (1,1,1), scaled onto each object's bounds when drawn
+        GLfloat boxVertices[] =
+        {
+            0, 0, 0,  1, 0, 0,  1, 1, 0,  1, 1, 0,  0, 1, 0,  0, 0, 0, // Back
+            0, 0, 1,  1, 0, 1,  1, 1, 1,  1, 1, 1,  0, 1, 1,  0, 0, 1, // Front
+            0, 1, 1,  0, 1, 0,  0, 0, 0,  0, 0, 0,  0, 0, 1,  0, 1, 1, // Left
+            1, 1, 1,  1, 1, 0,  1, 0, 0,  1, 0, 0,  1, 0, 1,  1, 1, 1, // Right
+            0, 0, 0,  1, 0, 0,  1, 0, 1,  1, 0, 1,  0, 0, 1,  0, 0, 0, // Bottom
+            0, 1, 0,  1, 1, 0,  1, 1, 1,  1, 1, 1,  0, 1, 1,  0, 1, 0  // Top
+        };
+
+        glGenVertexArrays(1, &this->boxVAO);
+        glGenBuffers(1, &this->boxVBO);
+        glBindVertexArray(this->boxVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->boxVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertices), boxVertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+
+    // Collect the oldest frame's results (only the ones that are ready) and move on a frame
+    void BeginFrame(bool enable)
+    {
+        this->enabled = enable;
+        this->frameIndex++;
+        this->boxes.clear();
+
+        // The slots we are about to reuse this frame were issued OCCLUSION_QUERY_FRAMES frames ago
+        GLuint skipped = 0, tested = 0;
+
+        for (GLuint slot = 0; slot < this->slotCount; slot++)
+        {
+            GLuint index = this->QueryIndex(slot, this->frameIndex);
+
+            if (!this->issued[index])
+            {
+                continue;
+            }
+
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(this->queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                GLuint anySamples = GL_TRUE;
+                glGetQueryObjectuiv(this->queries[index], GL_QUERY_RESULT, &anySamples);
+
+                tested++;
+                if (!anySamples)
+                {
+                    skipped++;
+                }
+            }
+
+            this->issued[index] = false;
+        }
+
+        this->skippedDraws = skipped;
+        this->testedDraws = tested;
+    }
+
+    // Start conditional rendering on the object's box query from last frame and queue its box for
+    // this frame's queries. Objects without a query last frame (just come into view, or the camera
+    // was inside the box) are drawn as normal.
+    void Begin(GLuint slot, const glm::mat4& model, const Bounds& localBounds)
+    {
+        if (!this->enabled || slot >= this->slotCount)
+        {
+            return;
+        }
+
+        OcclusionBox box = { slot, model, localBounds };
+        this->boxes.push_back(box);
+
+        GLuint previous = this->QueryIndex(slot, this->frameIndex - 1);
+        if (this->issued[previous])
+        {
+            // If the result isn't ready the GPU just draws the object
+            glBeginConditionalRender(this->queries[previous], GL_QUERY_NO_WAIT);
+            this->conditionalActive = true;
+        }
+    }
+
+    // Close the conditional render opened by Begin
+    void End()
+    {
+        if (this->conditionalActive)
+        {
+            glEndConditionalRender();
+            this->conditionalActive = false;
+        }
+    }
+
+    // Draw the bounds of every object queued this frame inside a query, against the depth buffer
+    // of the finished scene. Leaves the bounds program and box vertex array bound.
+    void IssueQueries(const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+    {
+        if (!this->enabled || this->boxes.empty())
+        {
+            return;
+        }
+
+        this->boundsShader->Use();
+        glBindVertexArray(this->boxVAO);
+
+        // Test the boxes against the depth buffer without touching it. A box face lying on the
+        // object's own surface still counts as visible.
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+
+        for (size_t i = 0; i < this->boxes.size(); i++)
+        {
+            const OcclusionBox& box = this->boxes[i];
+
+            // A box that contains the camera gets clipped by the near plane and would never pass
+            if (BoundsContain(TransformBounds(box.localBounds, box.model), cameraPos, 0.2f))
+            {
+                continue;
+            }
+
+            glm::mat4 boxModel = glm::translate(box.model, box.localBounds.min);
+            boxModel = glm::scale(boxModel, box.localBounds.max - box.localBounds.min);
+            glm::mat4 mvp = viewProjection * boxModel;
+            glUniformMatrix4fv(this->mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
+
+            GLuint index = this->QueryIndex(box.slot, this->frameIndex);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, this->queries[index]);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            this->issued[index] = true;
+        }
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+
+    // Getters for the last frame that has been read back
+    GLuint GetSkippedDraws()
+    {
+        return this->skippedDraws;
+    }
+
+    GLuint GetTestedDraws()
+    {
+        return this->testedDraws;
+    }
+};
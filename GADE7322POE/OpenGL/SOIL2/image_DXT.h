@@ -45,6 +45,55 @@ convert_image_to_DXT5
     int *out_size
 );
 
+/**
+	Which code path compresses the DXT color blocks.  The SIMD paths
+	give exactly the same output as the plain C one, only faster.
+**/
+#define DXT_SIMD_NONE	0
+#define DXT_SIMD_SSE2	1
+#define DXT_SIMD_AVX2	2
+
+/**
+	\return the DXT_SIMD_ level in use, by default the best this CPU supports
+**/
+int
+get_DXT_SIMD_level
+(
+    void
+);
+
+/**
+	Use a slower DXT_SIMD_ level than the CPU supports, for testing and
+	benchmarks. A level above what the CPU has (or -1) goes back to the best.
+	\return the level now in use
+**/
+int
+set_DXT_SIMD_level
+(
+    int level
+);
+
+/**
+	\return how many threads convert_image_to_DXT1/5 split big images between,
+	by default one per CPU
+**/
+int
+get_DXT_thread_count
+(
+    void
+);
+
+/**
+	Set how many threads convert_image_to_DXT1/5 may use, 0 for one per CPU.
+	Small images still use fewer, the output is the same either way.
+	\return the count now in use
+**/
+int
+set_DXT_thread_count
+(
+    int count
+);
+
 /**	A bunch of DirectDraw Surface structures and flags **/
 typedef struct
 {
@@ -0,0 +1,298 @@
+/*
+	SIMD versions of LSE_master_colors_max_min and compress_DDS_color_block.
+
+	Included by image_DXT.c once for each instruction set, with DXT_SIMD_AVX2_PATH
+	or DXT_SIMD_SSE2_PATH defined.  Every lane compresses its own 4x4 block, doing
+	exactly the float operations of the scalar code in the same order, so the
+	output is bit for bit the same as compress_DDS_color_block's.  (That also
+	means no fused multiply-add: the AVX2 path is built for "avx2" only.)
+
+	Blocks come in as 16 packed pixels each, R | G << 8 | B << 16 | A << 24.
+*/
+
+#if defined(DXT_SIMD_AVX2_PATH)
+
+#define DXT_LANES	8
+#define DXT_NAME( name )	name##_avx2
+#define DXT_TARGET	SOIL_TARGET_AVX2
+
+#define VF	__m256
+#define VI	__m256i
+#define VF_SET1	_mm256_set1_ps
+#define VF_ADD	_mm256_add_ps
+#define VF_SUB	_mm256_sub_ps
+#define VF_MUL	_mm256_mul_ps
+#define VF_DIV	_mm256_div_ps
+#define VF_MIN	_mm256_min_ps
+#define VF_MAX	_mm256_max_ps
+#define VF_GT( a, b )	_mm256_cmp_ps( a, b, _CMP_GT_OS )
+#define VF_AND	_mm256_and_ps
+#define VF_ANDNOT	_mm256_andnot_ps
+#define VF_OR	_mm256_or_ps
+#define VF_FROM_VI	_mm256_cvtepi32_ps
+#define VI_FROM_VF	_mm256_cvttps_epi32
+#define VI_SET1	_mm256_set1_epi32
+#define VI_ZERO	_mm256_setzero_si256
+#define VI_ADD	_mm256_add_epi32
+#define VI_SUB	_mm256_sub_epi32
+#define VI_MUL16	_mm256_mullo_epi16
+#define VI_AND	_mm256_and_si256
+#define VI_ANDNOT	_mm256_andnot_si256
+#define VI_OR	_mm256_or_si256
+#define VI_XOR	_mm256_xor_si256
+#define VI_GT	_mm256_cmpgt_epi32
+#define VI_SLLI	_mm256_slli_epi32
+#define VI_SRLI	_mm256_srli_epi32
+#define VI_SLL( v, n )	_mm256_sll_epi32( v, _mm_cvtsi32_si128( n ) )
+#define VI_STORE( p, v )	_mm256_storeu_si256( (__m256i*)(p), v )
+#define VI_PIXEL( blocks, i )	_mm256_i32gather_epi32( (const int*)((blocks) + (i)), \
+									_mm256_setr_epi32( 0, 16, 32, 48, 64, 80, 96, 112 ), 4 )
+
+#elif defined(DXT_SIMD_SSE2_PATH)
+
+#define DXT_LANES	4
+#define DXT_NAME( name )	name##_sse2
+#define DXT_TARGET
+
+#define VF	__m128
+#define VI	__m128i
+#define VF_SET1	_mm_set1_ps
+#define VF_ADD	_mm_add_ps
+#define VF_SUB	_mm_sub_ps
+#define VF_MUL	_mm_mul_ps
+#define VF_DIV	_mm_div_ps
+#define VF_MIN	_mm_min_ps
+#define VF_MAX	_mm_max_ps
+#define VF_GT	_mm_cmpgt_ps
+#define VF_AND	_mm_and_ps
+#define VF_ANDNOT	_mm_andnot_ps
+#define VF_OR	_mm_or_ps
+#define VF_FROM_VI	_mm_cvtepi32_ps
+#define VI_FROM_VF	_mm_cvttps_epi32
+#define VI_SET1	_mm_set1_epi32
+#define VI_ZERO	_mm_setzero_si128
+#define VI_ADD	_mm_add_epi32
+#define VI_SUB	_mm_sub_epi32
+#define VI_MUL16	_mm_mullo_epi16
+#define VI_AND	_mm_and_si128
+#define VI_ANDNOT	_mm_andnot_si128
+#define VI_OR	_mm_or_si128
+#define VI_XOR	_mm_xor_si128
+#define VI_GT	_mm_cmpgt_epi32
+#define VI_SLLI	_mm_slli_epi32
+#define VI_SRLI	_mm_srli_epi32
+#define VI_SLL( v, n )	_mm_sll_epi32( v, _mm_cvtsi32_si128( n ) )
+#define VI_STORE( p, v )	_mm_storeu_si128( (__m128i*)(p), v )
+#define VI_PIXEL( blocks, i )	_mm_setr_epi32( (int)(blocks)[i], (int)(blocks)[16+(i)], \
+									(int)(blocks)[32+(i)], (int)(blocks)[48+(i)] )
+
+#endif
+
+/*	v clamped to [0,hi], like the if / else if chains of the scalar code	*/
+static DXT_TARGET VI DXT_NAME( clamp_lanes )( VI v, int hi )
+{
+	VI limit = VI_SET1( hi );
+	VI over;
+	v = VI_ANDNOT( VI_GT( VI_ZERO(), v ), v );
+	over = VI_GT( v, limit );
+	return VI_OR( VI_AND( over, limit ), VI_ANDNOT( over, v ) );
+}
+
+/*	convert_bit_range( c, 8, to_bits ), c in [0,255]	*/
+static DXT_TARGET VI DXT_NAME( from_8_bits )( VI c, int to_bits )
+{
+	VI b = VI_ADD( VI_SET1( 128 ), VI_MUL16( c, VI_SET1( (1 << to_bits) - 1 ) ) );
+	return VI_SRLI( VI_ADD( b, VI_SRLI( b, 8 ) ), 8 );
+}
+
+/*	convert_bit_range( c, from_bits, 8 ), c < (1 << from_bits)	*/
+static DXT_TARGET VI DXT_NAME( to_8_bits )( VI c, int from_bits )
+{
+	VI b = VI_ADD( VI_SET1( 1 << (from_bits - 1) ), VI_MUL16( c, VI_SET1( 255 ) ) );
+	return VI_SRLI( VI_ADD( b, VI_SRLI( b, from_bits ) ), from_bits );
+}
+
+static DXT_TARGET VI DXT_NAME( rgb_to_565 )( VI r, VI g, VI b )
+{
+	return VI_OR( VI_OR(
+		VI_SLLI( DXT_NAME( from_8_bits )( r, 5 ), 11 ),
+		VI_SLLI( DXT_NAME( from_8_bits )( g, 6 ), 5 ) ),
+		DXT_NAME( from_8_bits )( b, 5 ) );
+}
+
+/*
+	Compresses DXT_LANES blocks of 16 packed pixels into 8 bytes each,
+	block i going to compressed + i*stride.
+*/
+static DXT_TARGET void DXT_NAME( compress_DDS_color_blocks )(
+		const unsigned int *const blocks,
+		unsigned char *compressed, int stride )
+{
+	const VI mask_8 = VI_SET1( 255 );
+	const VF half = VF_SET1( 0.5f );
+	int i, lane;
+	VF r[16], g[16], b[16];
+	VI sum_r, sum_g, sum_b, sum_rr, sum_gg, sum_bb, sum_rg, sum_rb, sum_gb;
+	VF avg_r, avg_g, avg_b, cov_rr, cov_gg, cov_bb, cov_rg, cov_rb, cov_gb;
+	VF dir_r, dir_g, dir_b, next_r, next_g, next_b;
+	VF vec_len2, dot, dot_max, dot_min;
+	VI c0[3], c1[3], enc_i, enc_j, enc_c0, enc_c1, greater, bits;
+	VF line_r, line_g, line_b, dot_offset;
+	unsigned int lane_c0[DXT_LANES], lane_c1[DXT_LANES], lane_bits[DXT_LANES];
+
+	/*	compute_color_line_STDEV: every partial sum is an integer below 2^24,
+		so summing as ints then converting gives the scalar float sums exactly	*/
+	sum_r = sum_g = sum_b = VI_ZERO();
+	sum_rr = sum_gg = sum_bb = sum_rg = sum_rb = sum_gb = VI_ZERO();
+	for( i = 0; i < 16; ++i )
+	{
+		VI pixel = VI_PIXEL( blocks, i );
+		VI pr = VI_AND( pixel, mask_8 );
+		VI pg = VI_AND( VI_SRLI( pixel, 8 ), mask_8 );
+		VI pb = VI_AND( VI_SRLI( pixel, 16 ), mask_8 );
+		sum_r = VI_ADD( sum_r, pr );
+		sum_g = VI_ADD( sum_g, pg );
+		sum_b = VI_ADD( sum_b, pb );
+		/*	products are below 2^16, so the 16 bit multiply is enough	*/
+		sum_rr = VI_ADD( sum_rr, VI_MUL16( pr, pr ) );
+		sum_gg = VI_ADD( sum_gg, VI_MUL16( pg, pg ) );
+		sum_bb = VI_ADD( sum_bb, VI_MUL16( pb, pb ) );
+		sum_rg = VI_ADD( sum_rg, VI_MUL16( pr, pg ) );
+		sum_rb = VI_ADD( sum_rb, VI_MUL16( pr, pb ) );
+		sum_gb = VI_ADD( sum_gb, VI_MUL16( pg, pb ) );
+		r[i] = VF_FROM_VI( pr );
+		g[i] = VF_FROM_VI( pg );
+		b[i] = VF_FROM_VI( pb );
+	}
+	avg_r = VF_MUL( VF_FROM_VI( sum_r ), VF_SET1( 1.0f / 16.0f ) );
+	avg_g = VF_MUL( VF_FROM_VI( sum_g ), VF_SET1( 1.0f / 16.0f ) );
+	avg_b = VF_MUL( VF_FROM_VI( sum_b ), VF_SET1( 1.0f / 16.0f ) );
+	cov_rr = VF_SUB( VF_FROM_VI( sum_rr ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_r ), avg_r ) );
+	cov_gg = VF_SUB( VF_FROM_VI( sum_gg ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_g ), avg_g ) );
+	cov_bb = VF_SUB( VF_FROM_VI( sum_bb ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_b ), avg_b ) );
+	cov_rg = VF_SUB( VF_FROM_VI( sum_rg ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_r ), avg_g ) );
+	cov_rb = VF_SUB( VF_FROM_VI( sum_rb ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_r ), avg_b ) );
+	cov_gb = VF_SUB( VF_FROM_VI( sum_gb ), VF_MUL( VF_MUL( VF_SET1( 16.0f ), avg_g ), avg_b ) );
+	/*	3 iterations of the power method	*/
+	dir_r = VF_SET1( 1.0f );
+	dir_g = VF_SET1( 2.718281828f );
+	dir_b = VF_SET1( 3.141592654f );
+	for( i = 0; i < 3; ++i )
+	{
+		next_r = VF_ADD( VF_ADD( VF_MUL( dir_r, cov_rr ), VF_MUL( dir_g, cov_rg ) ), VF_MUL( dir_b, cov_rb ) );
+		next_g = VF_ADD( VF_ADD( VF_MUL( dir_r, cov_rg ), VF_MUL( dir_g, cov_gg ) ), VF_MUL( dir_b, cov_gb ) );
+		next_b = VF_ADD( VF_ADD( VF_MUL( dir_r, cov_rb ), VF_MUL( dir_g, cov_gb ) ), VF_MUL( dir_b, cov_bb ) );
+		dir_r = next_r;
+		dir_g = next_g;
+		dir_b = next_b;
+	}
+
+	/*	LSE_master_colors_max_min	*/
+	vec_len2 = VF_DIV( VF_SET1( 1.0f ), VF_ADD( VF_ADD( VF_ADD( VF_SET1( 0.00001f ),
+		VF_MUL( dir_r, dir_r ) ), VF_MUL( dir_g, dir_g ) ), VF_MUL( dir_b, dir_b ) ) );
+	dot_max = dot_min = VF_ADD( VF_ADD( VF_MUL( dir_r, r[0] ), VF_MUL( dir_g, g[0] ) ), VF_MUL( dir_b, b[0] ) );
+	for( i = 1; i < 16; ++i )
+	{
+		dot = VF_ADD( VF_ADD( VF_MUL( dir_r, r[i] ), VF_MUL( dir_g, g[i] ) ), VF_MUL( dir_b, b[i] ) );
+		/*	min / max return their 2nd argument unless the compare holds,
+			the same as the scalar if on a NaN	*/
+		dot_min = VF_MIN( dot, dot_min );
+		dot_max = VF_MAX( dot, dot_max );
+	}
+	dot = VF_ADD( VF_ADD( VF_MUL( dir_r, avg_r ), VF_MUL( dir_g, avg_g ) ), VF_MUL( dir_b, avg_b ) );
+	dot_min = VF_MUL( VF_SUB( dot_min, dot ), vec_len2 );
+	dot_max = VF_MUL( VF_SUB( dot_max, dot ), vec_len2 );
+	c0[0] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_r ), VF_MUL( dot_max, dir_r ) ) ), 255 );
+	c0[1] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_g ), VF_MUL( dot_max, dir_g ) ) ), 255 );
+	c0[2] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_b ), VF_MUL( dot_max, dir_b ) ) ), 255 );
+	c1[0] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_r ), VF_MUL( dot_min, dir_r ) ) ), 255 );
+	c1[1] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_g ), VF_MUL( dot_min, dir_g ) ) ), 255 );
+	c1[2] = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_ADD( half, avg_b ), VF_MUL( dot_min, dir_b ) ) ), 255 );
+	enc_i = DXT_NAME( rgb_to_565 )( c0[0], c0[1], c0[2] );
+	enc_j = DXT_NAME( rgb_to_565 )( c1[0], c1[1], c1[2] );
+	greater = VI_GT( enc_i, enc_j );
+	enc_c0 = VI_OR( VI_AND( greater, enc_i ), VI_ANDNOT( greater, enc_j ) );
+	enc_c1 = VI_OR( VI_AND( greater, enc_j ), VI_ANDNOT( greater, enc_i ) );
+
+	/*	compress_DDS_color_block: reconstitute the master colors	*/
+	c0[0] = DXT_NAME( to_8_bits )( VI_AND( VI_SRLI( enc_c0, 11 ), VI_SET1( 31 ) ), 5 );
+	c0[1] = DXT_NAME( to_8_bits )( VI_AND( VI_SRLI( enc_c0, 5 ), VI_SET1( 63 ) ), 6 );
+	c0[2] = DXT_NAME( to_8_bits )( VI_AND( enc_c0, VI_SET1( 31 ) ), 5 );
+	c1[0] = DXT_NAME( to_8_bits )( VI_AND( VI_SRLI( enc_c1, 11 ), VI_SET1( 31 ) ), 5 );
+	c1[1] = DXT_NAME( to_8_bits )( VI_AND( VI_SRLI( enc_c1, 5 ), VI_SET1( 63 ) ), 6 );
+	c1[2] = DXT_NAME( to_8_bits )( VI_AND( enc_c1, VI_SET1( 31 ) ), 5 );
+	line_r = VF_FROM_VI( VI_SUB( c1[0], c0[0] ) );
+	line_g = VF_FROM_VI( VI_SUB( c1[1], c0[1] ) );
+	line_b = VF_FROM_VI( VI_SUB( c1[2], c0[2] ) );
+	vec_len2 = VF_ADD( VF_ADD( VF_MUL( line_r, line_r ), VF_MUL( line_g, line_g ) ), VF_MUL( line_b, line_b ) );
+	/*	1 / length^2 where it is > 0, the 0 lanes stay 0	*/
+	vec_len2 = VF_AND( VF_GT( vec_len2, VF_SET1( 0.0f ) ), VF_DIV( VF_SET1( 1.0f ), vec_len2 ) );
+	line_r = VF_MUL( line_r, vec_len2 );
+	line_g = VF_MUL( line_g, vec_len2 );
+	line_b = VF_MUL( line_b, vec_len2 );
+	dot_offset = VF_ADD( VF_ADD( VF_MUL( line_r, VF_FROM_VI( c0[0] ) ),
+		VF_MUL( line_g, VF_FROM_VI( c0[1] ) ) ), VF_MUL( line_b, VF_FROM_VI( c0[2] ) ) );
+	/*	2 bit indices, pixel i at bit 2*i	*/
+	bits = VI_ZERO();
+	for( i = 0; i < 16; ++i )
+	{
+		VI value;
+		dot = VF_SUB( VF_ADD( VF_ADD( VF_MUL( line_r, r[i] ), VF_MUL( line_g, g[i] ) ), VF_MUL( line_b, b[i] ) ), dot_offset );
+		value = DXT_NAME( clamp_lanes )( VI_FROM_VF( VF_ADD( VF_MUL( dot, VF_SET1( 3.0f ) ), half ) ), 3 );
+		/*	swizzle { 0, 2, 3, 1 }: high bit is v ^ (v >> 1), low bit is v >> 1	*/
+		value = VI_OR(
+			VI_SLLI( VI_AND( VI_XOR( value, VI_SRLI( value, 1 ) ), VI_SET1( 1 ) ), 1 ),
+			VI_SRLI( value, 1 ) );
+		bits = VI_OR( bits, VI_SLL( value, 2*i ) );
+	}
+
+	VI_STORE( lane_c0, enc_c0 );
+	VI_STORE( lane_c1, enc_c1 );
+	VI_STORE( lane_bits, bits );
+	for( lane = 0; lane < DXT_LANES; ++lane )
+	{
+		unsigned char *out = compressed + lane*stride;
+		out[0] = (lane_c0[lane] >> 0) & 255;
+		out[1] = (lane_c0[lane] >> 8) & 255;
+		out[2] = (lane_c1[lane] >> 0) & 255;
+		out[3] = (lane_c1[lane] >> 8) & 255;
+		out[4] = (lane_bits[lane] >> 0) & 255;
+		out[5] = (lane_bits[lane] >> 8) & 255;
+		out[6] = (lane_bits[lane] >> 16) & 255;
+		out[7] = (lane_bits[lane] >> 24) & 255;
+	}
+}
+
+#undef DXT_LANES
+#undef DXT_NAME
+#undef DXT_TARGET
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_DIV
+#undef VF_MIN
+#undef VF_MAX
+#undef VF_GT
+#undef VF_AND
+#undef VF_ANDNOT
+#undef VF_OR
+#undef VF_FROM_VI
+#undef VI_FROM_VF
+#undef VI_SET1
+#undef VI_ZERO
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_MUL16
+#undef VI_AND
+#undef VI_ANDNOT
+#undef VI_OR
+#undef VI_XOR
+#undef VI_GT
+#undef VI_SLLI
+#undef VI_SRLI
+#undef VI_SLL
+#undef VI_STORE
+#undef VI_PIXEL
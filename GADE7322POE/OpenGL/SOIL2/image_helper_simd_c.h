@@ -0,0 +1,385 @@
+/*
+	SIMD versions of the color space conversions in image_helper.c.
+
+	Included by image_helper.c once for each instruction set, with
+	IMG_SIMD_AVX2_PATH or IMG_SIMD_SSE2_PATH defined.  Each function does
+	as much of the image as fills whole registers and returns how far it
+	got, the scalar loop does the rest.  The YCoCg conversions saturate
+	exactly where clamp_byte does, the NTSC one matches its table, and the
+	RGBE ones do the same float operations as the scalar code in the same
+	order (no fused multiply-add), so every path gives the same bytes.  The AVX2 path also does 3 channel
+	images, which need a byte shuffle SSE2 doesn't have.
+*/
+
+#if defined(IMG_SIMD_AVX2_PATH)
+
+#define IMG_BYTES	32
+#define IMG_NAME( name )	name##_avx2
+#define IMG_TARGET	SOIL_TARGET_AVX2
+
+#define VF	__m256
+#define VI	__m256i
+#define VF_SET1	_mm256_set1_ps
+#define VF_ADD	_mm256_add_ps
+#define VF_MUL	_mm256_mul_ps
+#define VF_DIV	_mm256_div_ps
+#define VF_MAX	_mm256_max_ps
+#define VF_SQRT	_mm256_sqrt_ps
+#define VF_NOT_ZERO( a )	_mm256_castps_si256( _mm256_cmp_ps( a, _mm256_setzero_ps(), _CMP_NEQ_UQ ) )
+#define VF_FROM_VI	_mm256_cvtepi32_ps
+#define VF_FROM_BITS	_mm256_castsi256_ps
+#define VF_STORE	_mm256_storeu_ps
+#define VI_FROM_VF	_mm256_cvttps_epi32
+#define VI_LOAD( p )	_mm256_loadu_si256( (const __m256i*)(p) )
+#define VI_STORE( p, v )	_mm256_storeu_si256( (__m256i*)(p), v )
+#define VI_ZERO	_mm256_setzero_si256
+#define VI_SET1_16	_mm256_set1_epi16
+#define VI_SET1_32	_mm256_set1_epi32
+#define VI_SET_WORDS( a, b, c, d )	_mm256_setr_epi16( a, b, c, d, a, b, c, d, a, b, c, d, a, b, c, d )
+#define VI_ADD16	_mm256_add_epi16
+#define VI_SUB16	_mm256_sub_epi16
+#define VI_SRLI16	_mm256_srli_epi16
+#define VI_SRAI16	_mm256_srai_epi16
+#define VI_SHUFFLE16( v, imm )	_mm256_shufflehi_epi16( _mm256_shufflelo_epi16( v, imm ), imm )
+#define VI_ADD32	_mm256_add_epi32
+#define VI_SUB32	_mm256_sub_epi32
+#define VI_SLLI32	_mm256_slli_epi32
+#define VI_SRLI32	_mm256_srli_epi32
+#define VI_GT32	_mm256_cmpgt_epi32
+#define VI_MADD16	_mm256_madd_epi16
+#define VI_AND	_mm256_and_si256
+#define VI_ANDNOT	_mm256_andnot_si256
+#define VI_OR	_mm256_or_si256
+#define VI_UNPACKLO8	_mm256_unpacklo_epi8
+#define VI_UNPACKHI8	_mm256_unpackhi_epi8
+#define VI_UNPACKLO16	_mm256_unpacklo_epi16
+#define VI_UNPACKHI16	_mm256_unpackhi_epi16
+#define VI_PACKS32	_mm256_packs_epi32
+#define VI_PACKUS16	_mm256_packus_epi16
+#define VI_SRLI_BYTES	_mm256_srli_si256
+
+#elif defined(IMG_SIMD_SSE2_PATH)
+
+#define IMG_BYTES	16
+#define IMG_NAME( name )	name##_sse2
+#define IMG_TARGET
+
+#define VF	__m128
+#define VI	__m128i
+#define VF_SET1	_mm_set1_ps
+#define VF_ADD	_mm_add_ps
+#define VF_MUL	_mm_mul_ps
+#define VF_DIV	_mm_div_ps
+#define VF_MAX	_mm_max_ps
+#define VF_SQRT	_mm_sqrt_ps
+#define VF_NOT_ZERO( a )	_mm_castps_si128( _mm_cmpneq_ps( a, _mm_setzero_ps() ) )
+#define VF_FROM_VI	_mm_cvtepi32_ps
+#define VF_FROM_BITS	_mm_castsi128_ps
+#define VF_STORE	_mm_storeu_ps
+#define VI_FROM_VF	_mm_cvttps_epi32
+#define VI_LOAD( p )	_mm_loadu_si128( (const __m128i*)(p) )
+#define VI_STORE( p, v )	_mm_storeu_si128( (__m128i*)(p), v )
+#define VI_ZERO	_mm_setzero_si128
+#define VI_SET1_16	_mm_set1_epi16
+#define VI_SET1_32	_mm_set1_epi32
+#define VI_SET_WORDS( a, b, c, d )	_mm_setr_epi16( a, b, c, d, a, b, c, d )
+#define VI_ADD16	_mm_add_epi16
+#define VI_SUB16	_mm_sub_epi16
+#define VI_SRLI16	_mm_srli_epi16
+#define VI_SRAI16	_mm_srai_epi16
+#define VI_SHUFFLE16( v, imm )	_mm_shufflehi_epi16( _mm_shufflelo_epi16( v, imm ), imm )
+#define VI_ADD32	_mm_add_epi32
+#define VI_SUB32	_mm_sub_epi32
+#define VI_SLLI32	_mm_slli_epi32
+#define VI_SRLI32	_mm_srli_epi32
+#define VI_GT32	_mm_cmpgt_epi32
+#define VI_MADD16	_mm_madd_epi16
+#define VI_AND	_mm_and_si128
+#define VI_ANDNOT	_mm_andnot_si128
+#define VI_OR	_mm_or_si128
+#define VI_UNPACKLO8	_mm_unpacklo_epi8
+#define VI_UNPACKHI8	_mm_unpackhi_epi8
+#define VI_UNPACKLO16	_mm_unpacklo_epi16
+#define VI_UNPACKHI16	_mm_unpackhi_epi16
+#define VI_PACKS32	_mm_packs_epi32
+#define VI_PACKUS16	_mm_packus_epi16
+#define VI_SRLI_BYTES	_mm_srli_si128
+
+#endif
+
+/*	word 0-3 of each pixel, copied to all 4 words of the pixel	*/
+#define IMG_SPLAT( v, word )	VI_SHUFFLE16( v, (word) * 0x55 )
+
+/*	(a & mask) | (b & ~mask)	*/
+#define IMG_SELECT( mask, a, b )	VI_OR( VI_AND( mask, a ), VI_ANDNOT( mask, b ) )
+
+/*	NTSC safe scaling of whole registers of bytes; count is a multiple of
+	channels, and what's done is too, alpha is left alone.  The scalar
+	table's (unsigned char)(219.998f * i / 255.0f + 15.501f) is exactly
+	(i * 56536 + 1016352) >> 16 for every byte, done here 32 bits wide
+	as i * 28268 + i * 28268 so it fits a signed 16 bit multiply-add.	*/
+IMG_TARGET
+static int IMG_NAME( scale_NTSC_safe )( unsigned char *bytes, int count, int channels )
+{
+	const VI half_scale = VI_SET1_16( 28268 );
+	const VI offset = VI_SET1_32( 1016352 );
+	const VI zero = VI_ZERO();
+	/*	the bytes that are color	*/
+	const VI color = (channels == 4) ? VI_SET1_32( 0x00FFFFFF ) :
+		((channels == 2) ? VI_SET1_16( 0x00FF ) : VI_SET1_32( -1 ));
+	const int step = IMG_BYTES * channels;
+	int done = count - count % step;
+	int i;
+	for( i = 0; i < done; i += IMG_BYTES )
+	{
+		VI x = VI_LOAD( bytes + i );
+		VI lo16 = VI_UNPACKLO8( x, zero );
+		VI hi16 = VI_UNPACKHI8( x, zero );
+		VI a = VI_SRLI32( VI_ADD32( VI_MADD16( VI_UNPACKLO16( lo16, lo16 ), half_scale ), offset ), 16 );
+		VI b = VI_SRLI32( VI_ADD32( VI_MADD16( VI_UNPACKHI16( lo16, lo16 ), half_scale ), offset ), 16 );
+		VI c = VI_SRLI32( VI_ADD32( VI_MADD16( VI_UNPACKLO16( hi16, hi16 ), half_scale ), offset ), 16 );
+		VI d = VI_SRLI32( VI_ADD32( VI_MADD16( VI_UNPACKHI16( hi16, hi16 ), half_scale ), offset ), 16 );
+		VI scaled = VI_PACKUS16( VI_PACKS32( a, b ), VI_PACKS32( c, d ) );
+		VI_STORE( bytes + i, IMG_SELECT( color, scaled, x ) );
+	}
+	return done;
+}
+
+/*	RGBA -> CoCgAY, for pixels as 16 bit words; packing saturates where
+	clamp_byte would	*/
+IMG_TARGET
+static VI IMG_NAME( RGBA_words_to_YCoCg )( VI v )
+{
+	const VI r = IMG_SPLAT( v, 0 );
+	const VI b = IMG_SPLAT( v, 2 );
+	const VI g = VI_SRLI16( VI_ADD16( IMG_SPLAT( v, 1 ), VI_SET1_16( 1 ) ), 1 );
+	const VI tmp = VI_SRLI16( VI_ADD16( VI_ADD16( r, b ), VI_SET1_16( 2 ) ), 2 );
+	const VI co = VI_ADD16( VI_SET1_16( 128 ), VI_SRAI16( VI_ADD16( VI_SUB16( r, b ), VI_SET1_16( 1 ) ), 1 ) );
+	const VI cg = VI_SUB16( VI_ADD16( VI_SET1_16( 128 ), g ), tmp );
+	const VI y = VI_ADD16( g, tmp );
+	VI out = VI_AND( VI_SET_WORDS( -1, 0, 0, 0 ), co );
+	out = VI_OR( out, VI_AND( VI_SET_WORDS( 0, -1, 0, 0 ), cg ) );
+	out = VI_OR( out, VI_AND( VI_SET_WORDS( 0, 0, -1, 0 ), IMG_SPLAT( v, 3 ) ) );
+	return VI_OR( out, VI_AND( VI_SET_WORDS( 0, 0, 0, -1 ), y ) );
+}
+
+/*	CoCgAY -> RGBA, for pixels as 16 bit words	*/
+IMG_TARGET
+static VI IMG_NAME( YCoCg_words_to_RGBA )( VI v )
+{
+	const VI co = VI_SUB16( IMG_SPLAT( v, 0 ), VI_SET1_16( 128 ) );
+	const VI cg = VI_SUB16( IMG_SPLAT( v, 1 ), VI_SET1_16( 128 ) );
+	const VI y = IMG_SPLAT( v, 3 );
+	VI out = VI_AND( VI_SET_WORDS( -1, 0, 0, 0 ), VI_SUB16( VI_ADD16( y, co ), cg ) );
+	out = VI_OR( out, VI_AND( VI_SET_WORDS( 0, -1, 0, 0 ), VI_ADD16( y, cg ) ) );
+	out = VI_OR( out, VI_AND( VI_SET_WORDS( 0, 0, -1, 0 ), VI_SUB16( VI_SUB16( y, co ), cg ) ) );
+	return VI_OR( out, VI_AND( VI_SET_WORDS( 0, 0, 0, -1 ), IMG_SPLAT( v, 2 ) ) );
+}
+
+/*	register sized runs of 4 channel pixels through to_words	*/
+#define IMG_CONVERT_RGBA( pixels, count, to_words )	\
+	{	\
+		const VI zero = VI_ZERO();	\
+		int i;	\
+		for( i = 0; i + IMG_BYTES / 4 <= count; i += IMG_BYTES / 4 )	\
+		{	\
+			VI x = VI_LOAD( pixels + 4*i );	\
+			VI_STORE( pixels + 4*i, VI_PACKUS16(	\
+				to_words( VI_UNPACKLO8( x, zero ) ),	\
+				to_words( VI_UNPACKHI8( x, zero ) ) ) );	\
+		}	\
+		return i;	\
+	}
+
+IMG_TARGET
+static int IMG_NAME( RGBA_to_YCoCg )( unsigned char *pixels, int count )
+IMG_CONVERT_RGBA( pixels, count, IMG_NAME( RGBA_words_to_YCoCg ) )
+
+IMG_TARGET
+static int IMG_NAME( YCoCg_to_RGBA )( unsigned char *pixels, int count )
+IMG_CONVERT_RGBA( pixels, count, IMG_NAME( YCoCg_words_to_RGBA ) )
+
+#if defined(IMG_SIMD_AVX2_PATH)
+/*
+	3 channel pixels, 8 at a time: each 128 bit half loads 4 pixels and
+	spreads them out to the 4 channel layout the conversion works on
+	(expand), then packs the 3 channels wanted back together (compact).
+	Reads 4 bytes past the 24 it converts.
+*/
+#define IMG_CONVERT_RGB( pixels, count, expand, compact, to_words )	\
+	{	\
+		const VI zero = VI_ZERO();	\
+		const VI spread = expand;	\
+		const VI gather = compact;	\
+		const __m256i halves = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 );	\
+		int i;	\
+		for( i = 0; (i + 8) * 3 + 4 <= count * 3; i += 8 )	\
+		{	\
+			VI x = _mm256_inserti128_si256( _mm256_castsi128_si256(	\
+				_mm_loadu_si128( (const __m128i*)(pixels + 3*i) ) ),	\
+				_mm_loadu_si128( (const __m128i*)(pixels + 3*i + 12) ), 1 );	\
+			x = _mm256_shuffle_epi8( x, spread );	\
+			x = VI_PACKUS16(	\
+				to_words( VI_UNPACKLO8( x, zero ) ),	\
+				to_words( VI_UNPACKHI8( x, zero ) ) );	\
+			x = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( x, gather ), halves );	\
+			_mm_storeu_si128( (__m128i*)(pixels + 3*i), _mm256_castsi256_si128( x ) );	\
+			_mm_storel_epi64( (__m128i*)(pixels + 3*i + 16), _mm256_extracti128_si256( x, 1 ) );	\
+		}	\
+		return i;	\
+	}
+
+/*	RGB -> CoYCg: RGB spread to RGB0, converted to CoCg0Y, bytes 0,3,1 kept	*/
+IMG_TARGET
+static int IMG_NAME( RGB_to_YCoCg )( unsigned char *pixels, int count )
+IMG_CONVERT_RGB( pixels, count,
+	_mm256_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 ),
+	_mm256_setr_epi8( 0, 3, 1, 4, 7, 5, 8, 11, 9, 12, 15, 13, -1, -1, -1, -1,
+		0, 3, 1, 4, 7, 5, 8, 11, 9, 12, 15, 13, -1, -1, -1, -1 ),
+	IMG_NAME( RGBA_words_to_YCoCg ) )
+
+/*	CoYCg -> RGB: spread to CoCg0Y, converted to RGB0, bytes 0,1,2 kept	*/
+IMG_TARGET
+static int IMG_NAME( YCoCg_to_RGB )( unsigned char *pixels, int count )
+IMG_CONVERT_RGB( pixels, count,
+	_mm256_setr_epi8( 0, 2, -1, 1, 3, 5, -1, 4, 6, 8, -1, 7, 9, 11, -1, 10,
+		0, 2, -1, 1, 3, 5, -1, 4, 6, 8, -1, 7, 9, 11, -1, 10 ),
+	_mm256_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 ),
+	IMG_NAME( YCoCg_words_to_RGBA ) )
+
+#undef IMG_CONVERT_RGB
+#endif
+
+/*	(float)ldexp( 1.0f / 255.0f, e - 128 ) for exponent bytes e: 2^(e-128)
+	is exact as a float (a denormal for e < 2), so one float multiply
+	rounds the same as the double ldexp cast to float	*/
+IMG_TARGET
+static VF IMG_NAME( RGBE_scale )( VI e )
+{
+	const VI normal = VI_SLLI32( VI_SUB32( e, VI_SET1_32( 1 ) ), 23 );
+	const VI denormal = IMG_SELECT( VI_GT32( e, VI_ZERO() ), VI_SET1_32( 0x00400000 ), VI_SET1_32( 0x00200000 ) );
+	return VF_MUL( VF_SET1( 1.0f / 255.0f ), VF_FROM_BITS( IMG_SELECT( VI_GT32( e, VI_SET1_32( 1 ) ), normal, denormal ) ) );
+}
+
+/*	largest decoded RGBE channel of whole registers of pixels, into *max_val	*/
+IMG_TARGET
+static int IMG_NAME( find_max_RGBE )( const unsigned char *image, int count, float *max_val )
+{
+	const VI low_byte = VI_SET1_32( 255 );
+	VF best = VF_SET1( *max_val );
+	float lanes[IMG_BYTES / 4];
+	int i, lane;
+	for( i = 0; i + IMG_BYTES / 4 <= count; i += IMG_BYTES / 4 )
+	{
+		VI p = VI_LOAD( image + 4*i );
+		VF scale = IMG_NAME( RGBE_scale )( VI_SRLI32( p, 24 ) );
+		best = VF_MAX( VF_MUL( VF_FROM_VI( VI_AND( p, low_byte ) ), scale ), best );
+		best = VF_MAX( VF_MUL( VF_FROM_VI( VI_AND( VI_SRLI32( p, 8 ), low_byte ) ), scale ), best );
+		best = VF_MAX( VF_MUL( VF_FROM_VI( VI_AND( VI_SRLI32( p, 16 ), low_byte ) ), scale ), best );
+	}
+	VF_STORE( lanes, best );
+	for( lane = 0; lane < IMG_BYTES / 4; ++lane )
+	{
+		*max_val = (lanes[lane] > *max_val) ? lanes[lane] : *max_val;
+	}
+	return i;
+}
+
+/*	RGBE -> RGBdivA (or RGBdivA2 with squared set) of whole registers of
+	pixels.  Out of range conversions saturate the way the scalar code's
+	casts do on x86: packing turns the 0x80000000 a too big float gives
+	into 0, as the unsigned char cast does.	*/
+IMG_TARGET
+static int IMG_NAME( RGBE_to_RGBdivA )( unsigned char *image, int count, float scale, int squared )
+{
+	const VI low_byte = VI_SET1_32( 255 );
+	const VI one = VI_SET1_32( 1 );
+	const VF half = VF_SET1( 0.5f );
+	const VF byte_max = VF_SET1( 255.0f );
+	const VF byte_max_squared = VF_SET1( 255.0f * 255.0f );
+	int i;
+	for( i = 0; i + IMG_BYTES / 4 <= count; i += IMG_BYTES / 4 )
+	{
+		VI p = VI_LOAD( image + 4*i );
+		VF e = VF_MUL( VF_SET1( scale ), IMG_NAME( RGBE_scale )( VI_SRLI32( p, 24 ) ) );
+		VF r = VF_MUL( e, VF_FROM_VI( VI_AND( p, low_byte ) ) );
+		VF g = VF_MUL( e, VF_FROM_VI( VI_AND( VI_SRLI32( p, 8 ), low_byte ) ) );
+		VF b = VF_MUL( e, VF_FROM_VI( VI_AND( VI_SRLI32( p, 16 ), low_byte ) ) );
+		VF m = VF_MAX( b, VF_MAX( r, g ) );
+		VF a_scale;
+		VI iv, ri, gi, bi, rb, ga;
+		/*	the divisor, 1 to 255	*/
+		iv = squared ? VI_FROM_VF( VF_SQRT( VF_DIV( byte_max_squared, m ) ) ) : VI_FROM_VF( VF_DIV( byte_max, m ) );
+		iv = IMG_SELECT( VF_NOT_ZERO( m ), iv, one );
+		iv = IMG_SELECT( VI_GT32( one, iv ), one, iv );
+		iv = IMG_SELECT( VI_GT32( iv, low_byte ), low_byte, iv );
+		if( squared )
+		{
+			a_scale = VF_FROM_VI( VI_MADD16( iv, iv ) );
+			ri = VI_FROM_VF( VF_ADD( VF_DIV( VF_MUL( a_scale, r ), byte_max ), half ) );
+			gi = VI_FROM_VF( VF_ADD( VF_DIV( VF_MUL( a_scale, g ), byte_max ), half ) );
+			bi = VI_FROM_VF( VF_ADD( VF_DIV( VF_MUL( a_scale, b ), byte_max ), half ) );
+		} else
+		{
+			a_scale = VF_FROM_VI( iv );
+			ri = VI_FROM_VF( VF_ADD( VF_MUL( a_scale, r ), half ) );
+			gi = VI_FROM_VF( VF_ADD( VF_MUL( a_scale, g ), half ) );
+			bi = VI_FROM_VF( VF_ADD( VF_MUL( a_scale, b ), half ) );
+		}
+		/*	r0-3 b0-3 g0-3 a0-3 in each 128 bits, then interleaved back to pixels	*/
+		rb = VI_PACKUS16( VI_PACKS32( ri, bi ), VI_PACKS32( gi, iv ) );
+		ga = VI_SRLI_BYTES( rb, 8 );
+		rb = VI_UNPACKLO8( rb, ga );
+		VI_STORE( image + 4*i, VI_UNPACKLO16( rb, VI_SRLI_BYTES( rb, 8 ) ) );
+	}
+	return i;
+}
+
+#undef IMG_CONVERT_RGBA
+#undef IMG_SELECT
+#undef IMG_SPLAT
+#undef IMG_BYTES
+#undef IMG_NAME
+#undef IMG_TARGET
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_ADD
+#undef VF_MUL
+#undef VF_DIV
+#undef VF_MAX
+#undef VF_SQRT
+#undef VF_NOT_ZERO
+#undef VF_FROM_VI
+#undef VF_FROM_BITS
+#undef VF_STORE
+#undef VI_FROM_VF
+#undef VI_LOAD
+#undef VI_STORE
+#undef VI_ZERO
+#undef VI_SET1_16
+#undef VI_SET1_32
+#undef VI_SET_WORDS
+#undef VI_ADD16
+#undef VI_SUB16
+#undef VI_SRLI16
+#undef VI_SRAI16
+#undef VI_SHUFFLE16
+#undef VI_ADD32
+#undef VI_SUB32
+#undef VI_SLLI32
+#undef VI_SRLI32
+#undef VI_GT32
+#undef VI_MADD16
+#undef VI_AND
+#undef VI_ANDNOT
+#undef VI_OR
+#undef VI_UNPACKLO8
+#undef VI_UNPACKHI8
+#undef VI_UNPACKLO16
+#undef VI_UNPACKHI16
+#undef VI_PACKS32
+#undef VI_PACKUS16
+#undef VI_SRLI_BYTES
@@ -0,0 +1,72 @@
+/*
+	Which SIMD instruction sets the image code can use, for x86.
+
+	Included by the .c files that use it, everything here is static.
+	SSE2 is there on every x86-64 CPU, so it is used whenever the compiler
+	targets it. AVX and AVX2 code is built into functions marked with
+	SOIL_TARGET_AVX / SOIL_TARGET_AVX2 and only called once the CPU (and the
+	OS, for the wider registers) are checked to support it.
+*/
+
+#ifndef SOIL_CPU_C_H
+#define SOIL_CPU_C_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define SOIL_HAVE_SSE2	1
+	#include <emmintrin.h>
+	#if defined(__GNUC__) || (defined(_MSC_VER) && (_MSC_VER >= 1800))
+		#define SOIL_HAVE_AVX	1
+		#include <immintrin.h>
+		#if defined(_MSC_VER)
+			#include <intrin.h>
+		#endif
+	#endif
+#endif
+
+#if defined(SOIL_HAVE_AVX) && defined(__GNUC__)
+	#define SOIL_TARGET_AVX	__attribute__((target("avx")))
+	#define SOIL_TARGET_AVX2	__attribute__((target("avx2")))
+#else
+	#define SOIL_TARGET_AVX
+	#define SOIL_TARGET_AVX2
+#endif
+
+#if defined(SOIL_HAVE_AVX)
+/*	1 for AVX, 2 for AVX2, 0 for neither	*/
+static int soil_cpu_avx_level( void )
+{
+	int level = 0;
+	#if defined(_MSC_VER)
+	/*	needs the CPU bits and the OS saving the YMM registers	*/
+	int info[4];
+	__cpuid( info, 0 );
+	if( info[0] >= 1 )
+	{
+		int max_leaf = info[0];
+		__cpuid( info, 1 );
+		if( ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) &&
+			((_xgetbv( 0 ) & 6) == 6) )
+		{
+			level = 1;
+			if( max_leaf >= 7 )
+			{
+				__cpuidex( info, 7, 0 );
+				if( (info[1] >> 5) & 1 )
+				{
+					level = 2;
+				}
+			}
+		}
+	}
+	#else
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx" ) )
+	{
+		level = __builtin_cpu_supports( "avx2" ) ? 2 : 1;
+	}
+	#endif
+	return level;
+}
+#endif
+
+#endif /* SOIL_CPU_C_H	*/
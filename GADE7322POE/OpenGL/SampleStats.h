@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+// Summary statistics over timing samples, shared by the profilers, the frame pacer and the
+// benchmark recorder so they all report the same numbers
+
+// Average of the samples, 0 when there are none
+inline double SampleMean(const vector<double>& values)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        sum += values[i];
+    }
+    return sum / values.size();
+}
+
+// Nearest rank percentile (0 to 100, 100 is the max), 0 when there are no samples.
+// Takes a copy since it partly sorts the values.
+inline double SamplePercentile(vector<double> values, double percent)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+
+    size_t index = min((size_t)(percent / 100.0 * (values.size() - 1) + 0.5), values.size() - 1);
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
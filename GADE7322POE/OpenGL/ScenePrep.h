@@ -0,0 +1,222 @@
+#pragma once
+
+#include <vector>
+using namespace std;
+
+// GLM (no GL here, packets only carry handles so this can run on any thread)
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bounds.h"
+#include "JobSystem.h"
+#include "SoftwareOcclusion.h"
+
+// How an object moves while the pieces are animating
+enum SceneAnimation
+{
+    ANIMATION_NONE,
+    ANIMATION_LIFT_TILT,    // Lift off the board and tip over (pawns)
+    ANIMATION_LIFT_SPIN     // Lift off the board and spin in place (knights)
+};
+
+// A mesh every object of a kind shares, with the uniform locations looked up once
+struct SceneMesh
+{
+    // Shown in the GPU profile
+    const char* name;
+
+    unsigned int program;
+    unsigned int vao;
+    int vertexCount;
+
+    // View and projection come from the shared camera buffer
+    int modelLocation;
+    int textureLocation;
+
+    Bounds bounds;
+
+    // Loader asset the geometry streams in from, -1 when it is there from the start
+    int asset;
+
+    // Occluders (the board) are never culled themselves
+    bool cull;
+};
+
+// One instance of a mesh in the scene
+struct SceneObject
+{
+    int mesh;
+    unsigned int texture;
+
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 axis;
+    float angle;
+
+    int animation;
+
+    // Hardware occlusion query slot, -1 for none
+    int occlusionSlot;
+};
+
+// Everything the GL thread needs to submit one draw
+struct DrawPacket
+{
+    int mesh;
+    unsigned int texture;
+    int occlusionSlot;
+    bool visible;
+    glm::mat4 model;
+};
+
+// Per frame inputs to scene preparation
+struct SceneFrame
+{
+    bool animate;
+    float animationTime;
+
+    // Finished occlusion buffer to cull against, nullptr to draw everything
+    SoftwareOcclusion* culler;
+};
+
+// Builds a draw packet for every scene object on the job system.
+// Workers animate, cull and build model matrices for ranges of objects, each writing only
+// its own packets, so the GL thread is left with nothing but submitting them in order.
+class ScenePrep
+{
+private:
+
+    struct PrepareJob
+    {
+        ScenePrep* scene;
+
+        void operator()(int begin, int end) const
+        {
+            this->scene->PrepareRange(begin, end);
+        }
+    };
+
+    vector<SceneMesh> meshes;
+    vector<SceneObject> objects;
+    vector<DrawPacket> packets;
+
+    JobSystem* jobs;
+    PrepareJob prepareJob;
+    SceneFrame frame;
+
+    // Objects handed to a worker at a time
+    int grain;
+
+    void PrepareRange(int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const SceneObject& object = this->objects[i];
+            DrawPacket& packet = this->packets[i];
+
+            glm::vec3 position = object.position;
+            glm::vec3 axis = object.axis;
+            float angle = object.angle;
+
+            if (this->frame.animate && object.animation != ANIMATION_NONE)
+            {
+                position.y += 1.0f;
+                angle = this->frame.animationTime;
+                axis = (object.animation == ANIMATION_LIFT_SPIN) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            }
+
+            glm::mat4 model(1.0f);
+            model = glm::translate(model, position);
+            model = glm::scale(model, object.scale);
+            model = glm::rotate(model, angle, axis);
+
+            packet.mesh = object.mesh;
+            packet.texture = object.texture;
+            packet.occlusionSlot = object.occlusionSlot;
+            packet.model = model;
+            packet.visible = true;
+
+            const SceneMesh& mesh = this->meshes[object.mesh];
+            if (this->frame.culler != nullptr && mesh.cull)
+            {
+                packet.visible = this->frame.culler->IsVisible(model, mesh.bounds);
+            }
+        }
+    }
+
+public:
+
+    ScenePrep(JobSystem* jobSystem, int objectsPerJob = 64) : jobs(jobSystem), grain(objectsPerJob)
+    {
+        this->prepareJob.scene = this;
+        this->frame.animate = false;
+        this->frame.animationTime = 0.0f;
+        this->frame.culler = nullptr;
+    }
+
+    // Returns the index objects use to refer to the mesh
+    int AddMesh(const SceneMesh& mesh)
+    {
+        this->meshes.push_back(mesh);
+        return (int)this->meshes.size() - 1;
+    }
+
+    // Objects are submitted in the order they are added, so keep them grouped by mesh
+    void AddObject(const SceneObject& object)
+    {
+        this->objects.push_back(object);
+        this->packets.resize(this->objects.size());
+    }
+
+    // Build this frame's packets, the calling thread helps until they are all done
+    void Prepare(const SceneFrame& sceneFrame)
+    {
+        this->frame = sceneFrame;
+
+        if (this->jobs == nullptr)
+        {
+            this->PrepareRange(0, (int)this->objects.size());
+            return;
+        }
+
+        this->jobs->ParallelFor((int)this->objects.size(), this->grain, this->prepareJob);
+    }
+
+    const vector<DrawPacket>& GetPackets()
+    {
+        return this->packets;
+    }
+
+    const SceneMesh& GetMesh(int mesh)
+    {
+        return this->meshes[mesh];
+    }
+
+    int GetMeshCount()
+    {
+        return (int)this->meshes.size();
+    }
+
+    // Swap in a mesh's real geometry once it has loaded, between frames only
+    void SetMeshGeometry(int mesh, int vertexCount, const Bounds& bounds)
+    {
+        this->meshes[mesh].vertexCount = vertexCount;
+        this->meshes[mesh].bounds = bounds;
+    }
+
+    // Draw an object with another texture, between frames only
+    void SetObjectTexture(int object, unsigned int texture)
+    {
+        this->objects[object].texture = texture;
+    }
+
+    const SceneObject& GetObject(int object)
+    {
+        return this->objects[object];
+    }
+
+    int GetObjectCount()
+    {
+        return (int)this->objects.size();
+    }
+};
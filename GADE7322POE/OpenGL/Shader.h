@@ -5,6 +5,7 @@
 #include <sstream>
 #include <iostream>
 #include <GL/glew.h>
+#include "CpuProfiler.h"
 using namespace std;
 
 class Shader
@@ -13,6 +14,8 @@ public:
     GLuint Program;
     Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
     {
+        CpuScope scope("Compile Shader", vertexPath);
+
         //Retrieve vertex and fragment source code from file paths
         string vertexCode;
         string fragmentCode;
@@ -3,12 +3,18 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+// Camera matrices, shared by every shader through one uniform buffer
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 skyboxView;
+    mat4 skyboxProjection;
+};
 
 void main()
 {
     TexCoords = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    vec4 pos = skyboxProjection * skyboxView * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 };
\ No newline at end of file
@@ -0,0 +1,418 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+using namespace std;
+
+// GLM
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "JobSystem.h"
+
+// SSE2 is always there on x64, and on x86 when the compiler is told to use it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_OCCLUSION_SSE2 1
+#endif
+
+// Size of the CPU depth buffer, kept small so it can be rebuilt every frame
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 144;
+
+// Pixels per side of a hierarchical depth tile
+const int OCCLUSION_TILE = 8;
+const int OCCLUSION_TILES_X = OCCLUSION_WIDTH / OCCLUSION_TILE;
+const int OCCLUSION_TILES_Y = OCCLUSION_HEIGHT / OCCLUSION_TILE;
+
+// Rows are walked 4 pixels at a time, starting on a multiple of 4
+static_assert(OCCLUSION_WIDTH % OCCLUSION_TILE == 0 && OCCLUSION_HEIGHT % OCCLUSION_TILE == 0 && OCCLUSION_TILE % 4 == 0,
+    "Occlusion buffer must be made of whole tiles");
+
+// CPU occlusion culler.
+// Big occluders (the board slab, terrain chunks) are rasterized into a low resolution depth
+// buffer, then every piece instance's bounds are tested against it before it is submitted.
+// Each 8x8 tile also keeps the farthest depth it contains, so most tests are answered by a
+// single compare per tile. Rasterization is split into horizontal bands of tile rows that
+// run as jobs, so it can happen in the background while the GL thread is busy.
+class SoftwareOcclusion
+{
+private:
+
+    // Occluder triangle after projection: x and y in pixels, z as depth in [0,1]
+    struct ScreenTriangle
+    {
+        glm::vec3 v[3];
+    };
+
+    glm::mat4 viewProjection;
+    float margin;
+    vector<ScreenTriangle> triangles;
+    vector<float> depth;
+    vector<float> tileMaxDepth;
+
+    // Runs bands of tile rows as jobs, rasterizing on the calling thread when there isn't one
+    struct BandJob
+    {
+        SoftwareOcclusion* culler;
+
+        void operator()(int tileRowStart, int tileRowEnd) const
+        {
+            this->culler->RasterizeTileRows(tileRowStart, tileRowEnd);
+        }
+    };
+
+    JobSystem* jobs;
+    BandJob bandJob;
+    Job* pendingRaster;
+
+    // Stats for the last frame, counted atomically as objects are tested from many jobs
+    atomic<int> testedObjects;
+    atomic<int> culledObjects;
+
+    // Project a world space point, returns false if it is behind (or too close to) the camera
+    bool Project(const glm::vec3& world, glm::vec3& screen)
+    {
+        glm::vec4 clip = this->viewProjection * glm::vec4(world, 1.0f);
+
+        if (clip.w <= 0.01f)
+        {
+            return false;
+        }
+
+        float invW = 1.0f / clip.w;
+        screen.x = (clip.x * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        screen.y = (clip.y * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        screen.z = clip.z * invW * 0.5f + 0.5f;
+        return true;
+    }
+
+    // Clear and rasterize every occluder triangle into the tile rows [tileRowStart, tileRowEnd)
+    void RasterizeTileRows(int tileRowStart, int tileRowEnd)
+    {
+        int rowStart = tileRowStart * OCCLUSION_TILE;
+        int rowEnd = tileRowEnd * OCCLUSION_TILE;
+        fill(this->depth.begin() + rowStart * OCCLUSION_WIDTH, this->depth.begin() + rowEnd * OCCLUSION_WIDTH, 1.0f);
+
+        for (size_t t = 0; t < this->triangles.size(); t++)
+        {
+            const ScreenTriangle& tri = this->triangles[t];
+            glm::vec3 v0 = tri.v[0], v1 = tri.v[1], v2 = tri.v[2];
+
+            // Keep every triangle counter clockwise so inside means all edges positive
+            float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+            if (area < 0.0f)
+            {
+                swap(v1, v2);
+                area = -area;
+            }
+            if (area < 1e-6f)
+            {
+                continue;
+            }
+
+            // Pixel bounds of the triangle, clipped to the band
+            int minX = max((int)floor(min(v0.x, min(v1.x, v2.x))), 0);
+            int maxX = min((int)ceil(max(v0.x, max(v1.x, v2.x))), OCCLUSION_WIDTH - 1);
+            int minY = max((int)floor(min(v0.y, min(v1.y, v2.y))), rowStart);
+            int maxY = min((int)ceil(max(v0.y, max(v1.y, v2.y))), rowEnd - 1);
+
+            if (minX > maxX || minY > maxY)
+            {
+                continue;
+            }
+
+            // Start on a group of 4 pixels
+            minX &= ~3;
+
+            // Edge functions e(x, y) = a * x + b * y + c
+            float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+            float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+            float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+            // Depth plane z(x, y) = za * x + zb * y + zc
+            float invArea = 1.0f / area;
+            float za = (a1 * (v1.z - v0.z) + a2 * (v2.z - v0.z)) * invArea;
+            float zb = (b1 * (v1.z - v0.z) + b2 * (v2.z - v0.z)) * invArea;
+            float zc = v0.z + (c1 * (v1.z - v0.z) + c2 * (v2.z - v0.z)) * invArea;
+
+            for (int y = minY; y <= maxY; y++)
+            {
+                float py = y + 0.5f;
+                float* row = &this->depth[y * OCCLUSION_WIDTH];
+
+#ifdef SOFTWARE_OCCLUSION_SSE2
+                const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+                for (int x = minX; x <= maxX; x += 4)
+                {
+                    __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+
+                    __m128 zero = _mm_setzero_ps();
+                    __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+
+                    if (_mm_movemask_ps(inside) == 0)
+                    {
+                        continue;
+                    }
+
+                    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+                    __m128 old = _mm_loadu_ps(row + x);
+                    __m128 nearer = _mm_min_ps(old, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+                }
+#else
+                for (int x = minX; x <= maxX; x++)
+                {
+                    float px = x + 0.5f;
+                    if (a0 * px + b0 * py + c0 >= 0.0f && a1 * px + b1 * py + c1 >= 0.0f && a2 * px + b2 * py + c2 >= 0.0f)
+                    {
+                        float z = za * px + zb * py + zc;
+                        row[x] = min(row[x], z);
+                    }
+                }
+#endif
+            }
+        }
+
+        // Farthest depth per tile for the quick reject
+        for (int ty = tileRowStart; ty < tileRowEnd; ty++)
+        {
+            for (int tx = 0; tx < OCCLUSION_TILES_X; tx++)
+            {
+                float farthest = 0.0f;
+                for (int y = ty * OCCLUSION_TILE; y < (ty + 1) * OCCLUSION_TILE; y++)
+                {
+                    const float* row = &this->depth[y * OCCLUSION_WIDTH + tx * OCCLUSION_TILE];
+                    for (int x = 0; x < OCCLUSION_TILE; x++)
+                    {
+                        farthest = max(farthest, row[x]);
+                    }
+                }
+                this->tileMaxDepth[ty * OCCLUSION_TILES_X + tx] = farthest;
+            }
+        }
+    }
+
+public:
+
+    SoftwareOcclusion(JobSystem* jobSystem = nullptr) : viewProjection(1.0f), margin(0.0f), jobs(jobSystem), pendingRaster(nullptr), testedObjects(0), culledObjects(0)
+    {
+        this->depth.resize(OCCLUSION_WIDTH * OCCLUSION_HEIGHT, 1.0f);
+        this->tileMaxDepth.resize(OCCLUSION_TILES_X * OCCLUSION_TILES_Y, 1.0f);
+        this->bandJob.culler = this;
+    }
+
+    void SetJobSystem(JobSystem* jobSystem)
+    {
+        this->jobs = jobSystem;
+    }
+
+    // Start a new frame with the camera's view projection matrix. A margin covers a camera that
+    // can still move up to that far (in world units) after culling: occluders shrink and the
+    // tested bounds grow by it, so nothing visible from anywhere in reach is culled.
+    void BeginFrame(const glm::mat4& viewProj, float movementMargin = 0.0f)
+    {
+        this->viewProjection = viewProj;
+        this->margin = movementMargin;
+        this->triangles.clear();
+        this->testedObjects.store(0, memory_order_relaxed);
+        this->culledObjects.store(0, memory_order_relaxed);
+    }
+
+    // Add a solid box as an occluder. Boxes that cross the near plane are left out, which
+    // only ever makes the culler more conservative. The margin is taken off in the box's own
+    // space, so occluder boxes shouldn't be scaled.
+    void AddOccluderBox(const glm::mat4& model, const Bounds& occluder)
+    {
+        Bounds box = occluder;
+        box.min += glm::vec3(this->margin);
+        box.max -= glm::vec3(this->margin);
+
+        // Too thin to hide anything once shrunk
+        if (box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z)
+        {
+            return;
+        }
+
+        glm::vec3 corners[8];
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 local(
+                (corner & 1) ? box.max.x : box.min.x,
+                (corner & 2) ? box.max.y : box.min.y,
+                (corner & 4) ? box.max.z : box.min.z);
+
+            if (!this->Project(glm::vec3(model * glm::vec4(local, 1.0f)), corners[corner]))
+            {
+                return;
+            }
+        }
+
+        // Two triangles for each of the six faces
+        static const int faces[12][3] =
+        {
+            { 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 },
+            { 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 },
+            { 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 }
+        };
+
+        for (int f = 0; f < 12; f++)
+        {
+            ScreenTriangle tri;
+            tri.v[0] = corners[faces[f][0]];
+            tri.v[1] = corners[faces[f][1]];
+            tri.v[2] = corners[faces[f][2]];
+            this->triangles.push_back(tri);
+        }
+    }
+
+    // Add an occluder mesh given as a triangle list
+    void AddOccluderTriangles(const vector<glm::vec3>& vertices, const glm::mat4& model)
+    {
+        for (size_t i = 0; i + 2 < vertices.size(); i += 3)
+        {
+            ScreenTriangle tri;
+            if (this->Project(glm::vec3(model * glm::vec4(vertices[i], 1.0f)), tri.v[0]) &&
+                this->Project(glm::vec3(model * glm::vec4(vertices[i + 1], 1.0f)), tri.v[1]) &&
+                this->Project(glm::vec3(model * glm::vec4(vertices[i + 2], 1.0f)), tri.v[2]))
+            {
+                this->triangles.push_back(tri);
+            }
+        }
+    }
+
+    // Clear the depth buffer and rasterize all occluders added this frame
+    void Rasterize()
+    {
+        this->RasterizeAsync();
+        this->WaitForRasterize();
+    }
+
+    // Start rasterizing on the job system's workers, call WaitForRasterize before testing
+    void RasterizeAsync()
+    {
+        if (this->jobs == nullptr || this->jobs->GetThreadCount() <= 1)
+        {
+            this->RasterizeTileRows(0, OCCLUSION_TILES_Y);
+            return;
+        }
+
+        this->pendingRaster = this->jobs->ParallelForAsync(OCCLUSION_TILES_Y, 1, this->bandJob);
+    }
+
+    void WaitForRasterize()
+    {
+        if (this->pendingRaster != nullptr)
+        {
+            this->jobs->Wait(this->pendingRaster);
+            this->pendingRaster = nullptr;
+        }
+    }
+
+    // Test an object's bounds against the occluders. Anything that can't be proven hidden
+    // (crossing the near plane, partly off screen in front of nothing) counts as visible.
+    // Safe to call from several threads at once after rasterization has finished.
+    bool IsVisible(const glm::mat4& model, const Bounds& localBounds)
+    {
+        this->testedObjects.fetch_add(1, memory_order_relaxed);
+
+        // With a margin, test the world space box grown by it instead
+        glm::mat4 boxModel = model;
+        Bounds box = localBounds;
+        if (this->margin > 0.0f)
+        {
+            box = TransformBounds(localBounds, model);
+            box.min -= glm::vec3(this->margin);
+            box.max += glm::vec3(this->margin);
+            boxModel = glm::mat4(1.0f);
+        }
+
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        float nearest = FLT_MAX;
+
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 local(
+                (corner & 1) ? box.max.x : box.min.x,
+                (corner & 2) ? box.max.y : box.min.y,
+                (corner & 4) ? box.max.z : box.min.z);
+
+            glm::vec3 screen;
+            if (!this->Project(glm::vec3(boxModel * glm::vec4(local, 1.0f)), screen))
+            {
+                return true;
+            }
+
+            minX = min(minX, screen.x);
+            minY = min(minY, screen.y);
+            maxX = max(maxX, screen.x);
+            maxY = max(maxY, screen.y);
+            nearest = min(nearest, screen.z);
+        }
+
+        // Round outwards by a pixel to make up for the low resolution
+        int x0 = max((int)floor(minX) - 1, 0);
+        int y0 = max((int)floor(minY) - 1, 0);
+        int x1 = min((int)ceil(maxX) + 1, OCCLUSION_WIDTH - 1);
+        int y1 = min((int)ceil(maxY) + 1, OCCLUSION_HEIGHT - 1);
+
+        // Completely off screen
+        if (x0 > x1 || y0 > y1)
+        {
+            this->culledObjects.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+
+        for (int ty = y0 / OCCLUSION_TILE; ty <= y1 / OCCLUSION_TILE; ty++)
+        {
+            for (int tx = x0 / OCCLUSION_TILE; tx <= x1 / OCCLUSION_TILE; tx++)
+            {
+                // Whole tile is nearer than the object
+                if (nearest > this->tileMaxDepth[ty * OCCLUSION_TILES_X + tx])
+                {
+                    continue;
+                }
+
+                int px0 = max(x0, tx * OCCLUSION_TILE), px1 = min(x1, (tx + 1) * OCCLUSION_TILE - 1);
+                int py0 = max(y0, ty * OCCLUSION_TILE), py1 = min(y1, (ty + 1) * OCCLUSION_TILE - 1);
+
+                for (int y = py0; y <= py1; y++)
+                {
+                    const float* row = &this->depth[y * OCCLUSION_WIDTH];
+                    for (int x = px0; x <= px1; x++)
+                    {
+                        if (nearest <= row[x])
+                        {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        this->culledObjects.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    // Getters for the stats of the current frame
+    int GetTestedObjects()
+    {
+        return this->testedObjects.load(memory_order_relaxed);
+    }
+
+    int GetCulledObjects()
+    {
+        return this->culledObjects.load(memory_order_relaxed);
+    }
+
+    int GetOccluderTriangles()
+    {
+        return (int)this->triangles.size();
+    }
+};
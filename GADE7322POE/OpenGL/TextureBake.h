@@ -0,0 +1,238 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <sys/stat.h>
+using namespace std;
+
+// SOIL2's DXT compressor, mipmap filter and resampler, plain C
+extern "C"
+{
+#include "SOIL2/image_DXT.h"
+#include "SOIL2/image_helper.h"
+}
+
+// Where baked textures go, mirroring res/images
+const string TEXTURE_SOURCE_DIR = "res/images/";
+const string TEXTURE_BAKED_DIR = "res/baked/";
+
+// DDS file a texture is baked to: res/images/Paper.png -> res/baked/Paper.png.dds.
+// The source extension stays in the name since some textures come as both .png and .JPG.
+inline string BakedTexturePath(const string& path)
+{
+    if (path.compare(0, TEXTURE_SOURCE_DIR.size(), TEXTURE_SOURCE_DIR) != 0)
+    {
+        return "";
+    }
+
+    return TEXTURE_BAKED_DIR + path.substr(TEXTURE_SOURCE_DIR.size()) + ".dds";
+}
+
+// Cube maps are baked to one file named after the folder of their faces:
+// res/images/Skyboxs/Pink/px.png... -> res/baked/Skyboxs/Pink.dds
+inline string BakedCubemapPath(const vector<string>& faces)
+{
+    if (faces.empty())
+    {
+        return "";
+    }
+
+    size_t slash = faces[0].find_last_of('/');
+    if (slash == string::npos)
+    {
+        return "";
+    }
+
+    return BakedTexturePath(faces[0].substr(0, slash));
+}
+
+// Most pixels a texture keeps, bigger images are shrunk to fit when they're loaded or baked
+const int TEXTURE_MAX_PIXELS = 2048 * 2048;
+
+// An RGBA image shrunk with Lanczos3 to fit in maxPixels, keeping its shape so cube map faces
+// stay square, and width and height set to the new size. nullptr if it already fits (or the
+// resample fails), otherwise the caller frees the new pixels.
+inline unsigned char* FitPixelBudget(const unsigned char* pixels, int& width, int& height, int maxPixels = TEXTURE_MAX_PIXELS)
+{
+    double pixelCount = (double)width * height;
+    if (pixelCount <= maxPixels)
+    {
+        return nullptr;
+    }
+
+    double scale = sqrt(maxPixels / pixelCount);
+    int fitWidth = max((int)(width * scale), 1);
+    int fitHeight = max((int)(height * scale), 1);
+
+    unsigned char* fitted = (unsigned char*)malloc((size_t)fitWidth * fitHeight * 4);
+    if (fitted == nullptr || !resample_image(pixels, width, height, 4, fitted, fitWidth, fitHeight, RESAMPLE_FILTER_LANCZOS3))
+    {
+        free(fitted);
+        return nullptr;
+    }
+
+    width = fitWidth;
+    height = fitHeight;
+    return fitted;
+}
+
+// Baked image data for one face: every mip level, largest first, DXT1 or DXT5 blocks
+struct BakedFace
+{
+    vector<unsigned char> data;
+    int levels;
+};
+
+// True if any pixel of an RGBA image isn't fully opaque, those need DXT5
+inline bool HasAlpha(const unsigned char* pixels, int width, int height)
+{
+    for (size_t i = 3; i < (size_t)width * height * 4; i += 4)
+    {
+        if (pixels[i] != 255)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compress an RGBA image and each of its mip levels down to 1x1.
+// Level i is (width >> i) x (height >> i), at least 1, which is the layout SOIL2's DDS loader
+// expects. The whole chain is built first, every level box filtered from the one above it.
+inline BakedFace BakeFace(const unsigned char* pixels, int width, int height, bool alpha)
+{
+    BakedFace face;
+    face.levels = 0;
+
+    int levels = 0;
+    int offsets[MIPMAP_CHAIN_MAX_LEVELS];
+    unsigned char* chain = build_mipmap_chain(pixels, width, height, 4, 0, &levels, offsets);
+    if (chain == nullptr)
+    {
+        return face;
+    }
+
+    for (int i = 0; i < levels; i++)
+    {
+        int size = 0;
+        int levelWidth = max(width >> i, 1);
+        int levelHeight = max(height >> i, 1);
+        unsigned char* blocks = alpha ? convert_image_to_DXT5(chain + offsets[i], levelWidth, levelHeight, 4, &size)
+            : convert_image_to_DXT1(chain + offsets[i], levelWidth, levelHeight, 4, &size);
+        if (blocks == nullptr)
+        {
+            face.data.clear();
+            face.levels = 0;
+            break;
+        }
+
+        face.data.insert(face.data.end(), blocks, blocks + size);
+        free(blocks);
+        face.levels++;
+    }
+
+    free(chain);
+    return face;
+}
+
+// FNV-1a over the size and modification time of every source image, stored in a baked file so
+// one made from an older version of its source is noticed. 0 if a source can't be found.
+inline uint64_t SourceStamp(const vector<string>& paths)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        struct stat info;
+        if (stat(paths[i].c_str(), &info) != 0)
+        {
+            return 0;
+        }
+
+        uint64_t values[2] = { (uint64_t)info.st_size, (uint64_t)info.st_mtime };
+        const unsigned char* bytes = (const unsigned char*)values;
+        for (size_t b = 0; b < sizeof(values); b++)
+        {
+            hash ^= bytes[b];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// Source stamp of a file written by WriteDDS, kept in the first two reserved header fields
+inline uint64_t BakedSourceStamp(const DDS_header& header)
+{
+    return (uint64_t)header.dwReserved1[0] | ((uint64_t)header.dwReserved1[1] << 32);
+}
+
+// Write one or six (a cube map, +x -x +y -y +z -z) baked faces as a DDS file
+inline bool WriteDDS(const string& path, const vector<BakedFace>& faces, int width, int height, bool alpha, uint64_t sourceStamp)
+{
+    DDS_header header;
+    memset(&header, 0, sizeof(header));
+    header.dwMagic = ('D' << 0) | ('D' << 8) | ('S' << 16) | (' ' << 24);
+    header.dwSize = 124;
+    header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+    header.dwWidth = width;
+    header.dwHeight = height;
+    header.dwPitchOrLinearSize = ((width + 3) / 4) * ((height + 3) / 4) * (alpha ? 16 : 8);
+    header.dwMipMapCount = faces[0].levels;
+    header.sPixelFormat.dwSize = 32;
+    header.sPixelFormat.dwFlags = DDPF_FOURCC;
+    header.sPixelFormat.dwFourCC = ('D' << 0) | ('X' << 8) | ('T' << 16) | ((alpha ? '5' : '1') << 24);
+    header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    header.dwReserved1[0] = (unsigned int)sourceStamp;
+    header.dwReserved1[1] = (unsigned int)(sourceStamp >> 32);
+
+    if (faces.size() == 6)
+    {
+        header.sCaps.dwCaps2 = DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX | DDSCAPS2_CUBEMAP_NEGATIVEX |
+            DDSCAPS2_CUBEMAP_POSITIVEY | DDSCAPS2_CUBEMAP_NEGATIVEY | DDSCAPS2_CUBEMAP_POSITIVEZ | DDSCAPS2_CUBEMAP_NEGATIVEZ;
+    }
+
+    ofstream file(path.c_str(), ios::binary);
+    if (!file.is_open())
+    {
+        cout << "Texture bake: could not write " << path << endl;
+        return false;
+    }
+
+    file.write((const char*)&header, sizeof(header));
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        file.write((const char*)&faces[i].data[0], faces[i].data.size());
+    }
+
+    return file.good();
+}
+
+// Size a DDS file written by WriteDDS should be, going by its header. 0 if the header isn't
+// one of ours, so a foreign or truncated file is never handed to the GL. Whether it is still
+// up to date is down to BakedSourceStamp.
+inline size_t BakedDDSSize(const DDS_header& header)
+{
+    bool dxt1 = header.sPixelFormat.dwFourCC == (unsigned int)(('D' << 0) | ('X' << 8) | ('T' << 16) | ('1' << 24));
+    bool dxt5 = header.sPixelFormat.dwFourCC == (unsigned int)(('D' << 0) | ('X' << 8) | ('T' << 16) | ('5' << 24));
+    if (header.dwMagic != (unsigned int)(('D' << 0) | ('D' << 8) | ('S' << 16) | (' ' << 24)) || header.dwSize != 124 ||
+        (header.sPixelFormat.dwFlags & DDPF_FOURCC) == 0 || !(dxt1 || dxt5) || header.dwMipMapCount < 1)
+    {
+        return 0;
+    }
+
+    size_t faceSize = 0;
+    for (unsigned int i = 0; i < header.dwMipMapCount; i++)
+    {
+        size_t width = max(header.dwWidth >> i, 1u);
+        size_t height = max(header.dwHeight >> i, 1u);
+        faceSize += ((width + 3) / 4) * ((height + 3) / 4) * (dxt1 ? 8 : 16);
+    }
+
+    return sizeof(DDS_header) + faceSize * ((header.sCaps.dwCaps2 & DDSCAPS2_CUBEMAP) ? 6 : 1);
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+using namespace std;
+
+// GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Load flags that make the same file a different texture
+const unsigned int TEXTURE_CACHE_2D = 0;
+const unsigned int TEXTURE_CACHE_CUBEMAP = 1 << 0;
+
+// FNV-1a, for spotting the same image under two file names
+inline uint64_t HashContent(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Shares GL textures between everything that asks for the same image.
+// Textures are looked up by path and load flags first, and a hit hands back the texture that
+// is already there with one more reference. A file only loaded under a new path can still be
+// matched by the hash of its contents once it has been read, then the earlier texture stands
+// in for it. Counts hits and the texture memory they saved. Thread safe, the loader thread
+// checks contents while the main thread adds textures.
+class TextureCache
+{
+private:
+
+    struct Entry
+    {
+        string key;
+        int references;
+        int hits;
+        size_t bytes;        // texture memory, once uploaded
+        GLuint shared;       // texture with the same contents that is drawn in its place
+    };
+
+    map<string, GLuint> keys;
+    map<uint64_t, GLuint> contents;
+    map<GLuint, Entry> entries;
+    int requests;
+    int hits;
+    mutable mutex lock;
+
+    void Drop(GLuint texture, vector<GLuint>& unused)
+    {
+        map<GLuint, Entry>::iterator entry = this->entries.find(texture);
+        if (entry == this->entries.end() || --entry->second.references > 0)
+        {
+            return;
+        }
+
+        GLuint shared = entry->second.shared;
+        this->keys.erase(entry->second.key);
+        for (map<uint64_t, GLuint>::iterator content = this->contents.begin(); content != this->contents.end(); ++content)
+        {
+            if (content->second == texture)
+            {
+                this->contents.erase(content);
+                break;
+            }
+        }
+        this->entries.erase(entry);
+        unused.push_back(texture);
+
+        if (shared != texture)
+        {
+            this->Drop(shared, unused);
+        }
+    }
+
+    static string MakeKey(const string& path, unsigned int flags)
+    {
+        return to_string(flags) + "|" + path;
+    }
+
+public:
+
+    TextureCache() : requests(0), hits(0)
+    {
+    }
+
+    // Texture already made for the path and flags with one more reference, 0 on a miss
+    GLuint Acquire(const string& path, unsigned int flags)
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->requests++;
+
+        map<string, GLuint>::iterator key = this->keys.find(MakeKey(path, flags));
+        if (key == this->keys.end())
+        {
+            return 0;
+        }
+
+        Entry& entry = this->entries[key->second];
+        entry.references++;
+        this->entries[entry.shared].hits++;
+        this->hits++;
+        return key->second;
+    }
+
+    // After a miss: the texture now made for the path and flags, with one reference
+    void Insert(const string& path, unsigned int flags, GLuint texture)
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        Entry entry;
+        entry.key = MakeKey(path, flags);
+        entry.references = 1;
+        entry.hits = 0;
+        entry.bytes = 0;
+        entry.shared = texture;
+
+        this->keys[entry.key] = texture;
+        this->entries[texture] = entry;
+    }
+
+    // Once a texture's file has been read: the texture already holding the same contents, or
+    // the texture itself if it is the first. From then on that one is drawn in its place.
+    GLuint MatchContent(GLuint texture, uint64_t hash)
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        map<uint64_t, GLuint>::iterator content = this->contents.find(hash);
+        if (content == this->contents.end() || this->entries.count(content->second) == 0)
+        {
+            this->contents[hash] = texture;
+            return texture;
+        }
+
+        if (content->second != texture)
+        {
+            // The first request for this path was a miss that shouldn't have been. The
+            // texture keeps the one it shares alive until it is released itself.
+            Entry& entry = this->entries[texture];
+            Entry& shared = this->entries[content->second];
+            entry.shared = content->second;
+            shared.hits += entry.hits + 1;
+            shared.references++;
+            entry.hits = 0;
+            this->hits++;
+        }
+
+        return content->second;
+    }
+
+    // Texture drawn in place of a texture, itself unless its contents matched another one
+    GLuint GetShared(GLuint texture) const
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        map<GLuint, Entry>::const_iterator entry = this->entries.find(texture);
+        return entry != this->entries.end() ? entry->second.shared : texture;
+    }
+
+    // True while the texture name is in the cache, even if its GL texture was deleted because
+    // another one is drawn in its place
+    bool Contains(GLuint texture) const
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->entries.count(texture) > 0;
+    }
+
+    // Texture memory of an uploaded texture, counted for every hit it had
+    void SetBytes(GLuint texture, size_t bytes)
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->entries[texture].bytes = bytes;
+    }
+
+    // Drop a reference. Textures nobody uses any more are added to unused for the caller to
+    // delete, and forgotten, so asking for their path again loads them again.
+    void Release(GLuint texture, vector<GLuint>& unused)
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->Drop(texture, unused);
+    }
+
+    int GetRequests() const
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->requests;
+    }
+
+    int GetHits() const
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->hits;
+    }
+
+    float GetHitRate() const
+    {
+        lock_guard<mutex> guard(this->lock);
+        return this->requests > 0 ? (float)this->hits / this->requests : 0.0f;
+    }
+
+    // Texture memory not spent on loading the same image twice
+    size_t GetBytesSaved() const
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        size_t saved = 0;
+        for (map<GLuint, Entry>::const_iterator entry = this->entries.begin(); entry != this->entries.end(); ++entry)
+        {
+            saved += entry->second.bytes * entry->second.hits;
+        }
+        return saved;
+    }
+};
@@ -0,0 +1,149 @@
+// Offline texture baker: compresses textures to DXT1 (or DXT5 if they have any alpha) with a
+// full mip chain and writes them as DDS files under res/baked, where the asset loader picks
+// them up in place of the PNG/JPEG. Run from the OpenGL folder:
+//     texture_bake res/images/Paper.png res/images/water.png
+//     texture_bake --cubemap res/images/Skyboxs/Pink/px.png nx.png py.png ny.png pz.png nz.png
+// (with full paths for all six faces), or build the bake_textures target which does all of them.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+// Before stb_image, which pulls in SOIL2's C headers without extern "C"
+#include "TextureBake.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "SOIL2/stb_image.h"
+
+// Load the images (one, or six cube map faces) and write them to one DDS file
+bool Bake(const vector<string>& inputs, const string& output)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<unsigned char*> images;
+    int width = 0;
+    int height = 0;
+    // Size of the first face as loaded, before it is shrunk, for checking the other faces
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    bool alpha = false;
+    bool loaded = true;
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        int imageWidth, imageHeight, channels;
+        unsigned char* pixels = stbi_load(inputs[i].c_str(), &imageWidth, &imageHeight, &channels, 4);
+        if (pixels == nullptr)
+        {
+            cout << "Texture bake: could not load " << inputs[i] << endl;
+            loaded = false;
+            break;
+        }
+
+        if (i == 0)
+        {
+            sourceWidth = imageWidth;
+            sourceHeight = imageHeight;
+        }
+        else if (imageWidth != sourceWidth || imageHeight != sourceHeight)
+        {
+            cout << "Texture bake: " << inputs[i] << " is not the same size as " << inputs[0] << endl;
+            stbi_image_free(pixels);
+            loaded = false;
+            break;
+        }
+
+        // Baked at the size the loader would cut it to
+        unsigned char* fitted = FitPixelBudget(pixels, imageWidth, imageHeight);
+        if (fitted != nullptr)
+        {
+            cout << "Texture bake: " << inputs[i] << " shrunk to " << imageWidth << "x" << imageHeight << endl;
+            stbi_image_free(pixels);
+            pixels = fitted;
+        }
+
+        images.push_back(pixels);
+        width = imageWidth;
+        height = imageHeight;
+        alpha = alpha || HasAlpha(pixels, width, height);
+    }
+
+    bool written = false;
+    if (loaded)
+    {
+        vector<BakedFace> faces;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            faces.push_back(BakeFace(images[i], width, height, alpha));
+        }
+
+        written = WriteDDS(output, faces, width, height, alpha, SourceStamp(inputs));
+
+        if (written)
+        {
+            size_t bytes = 0;
+            for (size_t i = 0; i < faces.size(); i++)
+            {
+                bytes += faces[i].data.size();
+            }
+
+            // RGBA with mips is 4/3 of the top level
+            size_t rawBytes = (size_t)width * height * 4 * faces.size() * 4 / 3;
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << output << "  " << width << "x" << height << (faces.size() == 6 ? " cube map" : "")
+                << "  " << (alpha ? "DXT5" : "DXT1") << "  " << faces[0].levels << " levels  "
+                << bytes / 1024 << " KB (RGBA " << rawBytes / 1024 << " KB)  " << ms << " ms" << endl;
+        }
+    }
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        stbi_image_free(images[i]);
+    }
+
+    return written;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: texture_bake image... | texture_bake --cubemap px nx py ny pz nz" << endl;
+        return EXIT_FAILURE;
+    }
+
+    bool succeeded = true;
+
+    if (strcmp(argv[1], "--cubemap") == 0)
+    {
+        if (argc != 8)
+        {
+            cout << "Texture bake: a cube map needs six faces, +x -x +y -y +z -z" << endl;
+            return EXIT_FAILURE;
+        }
+
+        vector<string> faces(argv + 2, argv + 8);
+        string output = BakedCubemapPath(faces);
+        succeeded = !output.empty() && Bake(faces, output);
+    }
+    else
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string output = BakedTexturePath(argv[i]);
+            if (output.empty())
+            {
+                cout << "Texture bake: " << argv[i] << " is not under " << TEXTURE_SOURCE_DIR << endl;
+                succeeded = false;
+                continue;
+            }
+
+            succeeded = Bake(vector<string>(1, argv[i]), output) && succeeded;
+        }
+    }
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
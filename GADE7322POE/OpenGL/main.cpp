@@ -8,6 +8,9 @@ using namespace std;
 #define GLEW_STATIC
 #include <GL/glew.h>
 
+// Draw and state change counters, wraps the GL calls of everything included after it
+#include "GLStats.h"
+
 //GLFW
 #include <GLFW/glfw3.h>
 
@@ -25,14 +28,64 @@ using namespace std;
 //Link Camera File
 #include "Camera.h"  //camera 
 
+// Hardware occlusion culling
+#include "OcclusionQueries.h"
+
+// CPU occlusion culling
+#include "SoftwareOcclusion.h"
+
+// Jobs for the worker threads
+#include "JobSystem.h"
+
+// Draw packets built in parallel each frame
+#include "ScenePrep.h"
+
+// Fixed rate simulation clock
+#include "FixedTimestep.h"
+
+// Camera uniform buffer and input latency measurement
+#include "CameraBuffer.h"
+#include "LatencyTracker.h"
+
+// Swap interval and frame rate limiting
+#include "FramePacer.h"
+
+// Render resolution scaled to a GPU time budget
+#include "DynamicResolution.h"
+
+// GPU time per render region
+#include "GpuProfiler.h"
+
+// CPU time per startup phase and frame region
+#include "CpuProfiler.h"
+
+// --bench: scripted camera run without a window, timings written as JSON
+#include <chrono>
+#include "BenchMode.h"
+#include "HeadlessContext.h"
+
+// --record/--replay: simulation tick input written to and played back from a file
+#include "InputRecorder.h"
+
+// Textures and meshes streamed in the background, placeholders drawn until they arrive
+#include "AssetLoader.h"
+
 const GLint WIDTH = 1920, HEIGHT = 1080;
 int SCREEN_WIDTH, SCREEN_HEIGHT; // Replace all screenW & screenH with these
 
+// Flat colours textures show while they load
+const glm::vec3 PLACEHOLDER_LIGHT(0.85f, 0.8f, 0.7f);
+const glm::vec3 PLACEHOLDER_DARK(0.25f, 0.2f, 0.2f);
+const glm::vec3 PLACEHOLDER_BORDER(0.6f, 0.6f, 0.6f);
+const glm::vec3 PLACEHOLDER_WATER(0.2f, 0.4f, 0.6f);
+const glm::vec3 PLACEHOLDER_SKY(0.4f, 0.6f, 0.7f);
+
 // Function declaration
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode);
 void MouseCallback(GLFWwindow* window, double xPos, double yPos); // Get mouse pos in order to hide it
 void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset);
-void ProcessInput(GLFWwindow* window);
+TickInput PeekInput();
+TickInput GatherInput();
 
 // Initialise camera values
 Camera camera(glm::vec3(0.0f, 2.0f, 12.0f));
@@ -43,61 +96,162 @@ bool firstMouse = true; // Only handling one type of mouse, thus true
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
 
+// Mouse, scroll, camera cycle and animation input gathered by the callbacks, applied on the next simulation tick
+GLfloat mouseOffsetX = 0.0f;
+GLfloat mouseOffsetY = 0.0f;
+GLfloat scrollOffset = 0.0f;
+int pendingCameraCycle = 0; // -1 left, 1 right
+bool pendingAnimationToggle = false;
+
+// Late latched camera (toggled with L) and input to swap latency reports (toggled with M)
+bool lateLatch = false;
+const GLfloat LATCH_MAX_TURN = 5.0f; // degrees of yaw and pitch the latch may add to the latest tick
+const GLfloat LATCH_MAX_MOVE = 0.1f; // and how far it may move the camera
+bool measureLatency = false;
+GLfloat lastLatencyReport = 0.0f;
+LatencyTracker latency;
+
+// Frame pacing: vsync mode (cycled with V), frame rate cap (cycled with F), frame time stats (toggled with P)
+VsyncMode vsyncMode = VSYNC_ON;
+const double frameRateCaps[] = { 0.0, 30.0, 60.0, 120.0, 144.0 };
+int frameRateCap = 0;
+bool frameStats = false;
+GLfloat lastFrameStatsReport = 0.0f;
+FramePacer framePacer;
+
+// Dynamic resolution scaling (toggled with R)
+bool dynamicResolution = false;
+GLfloat lastResolutionReport = 0.0f;
+
+// Print the GPU profile and write it to gpu_profile.csv/.json (G)
+bool dumpGpuProfile = false;
+
+// Write the CPU profile to cpu_trace.json (T)
+bool dumpCpuTrace = false;
+
+// Per frame draw and state change reports (toggled with I, debug builds only)
+bool glStatsReport = false;
+GLfloat lastGLStatsReport = 0.0f;
+
 // Switch Cameras
 bool camLocked = true;
 bool animate = false;
 
-GLfloat AnimateCPRotation();
-glm::vec3 AnimatePosition(glm::vec3 pos);
-//glm::vec3 LightPos(1.0f, 1.2f, 3.0f);
+// Occlusion culling for pieces and props (toggled with O)
+bool occlusionCulling = false;
+GLfloat lastOcclusionReport = 0.0f;
 
-int main()
+// CPU occlusion culling of pieces and props (toggled with C)
+bool softwareCulling = false;
+GLfloat lastSoftwareCullingReport = 0.0f;
+
+// Occlusion query slots for every piece and prop instance
+enum OcclusionSlot
 {
-	//Initialise GLFW
-	glfwInit();
+	OCC_PAWN = 0,
+	OCC_ROOK = 16,
+	OCC_BISHOP = 20,
+	OCC_KNIGHT = 24,
+	OCC_KING = 28,
+	OCC_SKULL = 30,
+	OCC_PALM = 32,
+	OCC_CHEST = 36,
+	OCC_COUNT = 40
+};
+
+GLfloat AnimateCPRotation(GLfloat time);
+glm::vec3 AnimatePosition(glm::vec3 pos);
 
-	// GLFW Version Hints	
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+unsigned char* LoadImageFile(const char* path, int* width, int* height, int* channels, int forceChannels);
+CameraBlock BuildCameraBlock(Camera& viewCamera);
+void ApplyVsync(VsyncMode mode);
 
+SceneMesh CreateSceneMesh(const char* name, const Shader& shader, GLuint vao, int vertexCount, const Bounds& bounds, bool cull);
+SceneMesh CreateLoadedSceneMesh(const char* name, const Shader& shader, GLuint vao, AssetLoader& assets, int asset);
+void UpdateSceneAssets(ScenePrep& scene, AssetLoader& assets);
+void AddSceneObjects(ScenePrep& scene, SceneObject object, const glm::vec3* positions, int count, GLuint textureW, GLuint textureB, int whiteCount);
+double ClockTime(GLFWwindow* window, chrono::steady_clock::time_point start, chrono::steady_clock::time_point now);
+//glm::vec3 LightPos(1.0f, 1.2f, 3.0f);
 
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "GADE7322", nullptr, nullptr);
+int main(int argc, char* argv[])
+{
+	chrono::steady_clock::time_point processStart = chrono::steady_clock::now();
+	CpuProfiler::Get().SetThreadName("Main");
+	CpuScope startupScope("Startup");
 
-	//Get Screen Resolution
-	glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
+	// --bench renders a fixed camera path on a surfaceless context when there is one
+	BenchOptions bench = ParseBenchOptions(argc, argv);
+	HeadlessContext headless;
+	GLFWwindow* window = nullptr;
 
-	// check if window is created succesfully
-	if (nullptr == window)
+	if (bench.enabled && headless.Init())
 	{
-		std::cout << "Failed to Create Window." << endl;
-		glfwTerminate();
-		return EXIT_FAILURE;
+		SCREEN_WIDTH = WIDTH;
+		SCREEN_HEIGHT = HEIGHT;
 	}
+	else
+	{
+		//Initialise GLFW
+		glfwInit();
+
+		// GLFW Version Hints	
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+
+		// Benchmark without EGL: same scene in a hidden window, never waiting on vsync
+		if (bench.enabled)
+		{
+			glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+			vsyncMode = VSYNC_OFF;
+		}
+
+		window = glfwCreateWindow(WIDTH, HEIGHT, "GADE7322", nullptr, nullptr);
+
+		// check if window is created succesfully
+		if (nullptr == window)
+		{
+			std::cout << "Failed to Create Window." << endl;
+			glfwTerminate();
+			return EXIT_FAILURE;
+		}
+
+		//Get Screen Resolution
+		glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
 
+		glfwMakeContextCurrent(window); //exit
 
-	glfwMakeContextCurrent(window); //exit
+		// Never leave the swap interval up to the driver default
+		ApplyVsync(vsyncMode);
 
-	// Set the required callback functions
-	glfwSetKeyCallback(window, KeyCallback);
-	glfwSetCursorPosCallback(window, MouseCallback);
-	glfwSetScrollCallback(window, ScrollCallback);
-	GLuint CreateSkyboxTexture(GLuint texture, vector<std::string> faces, int width, int height);
+		// Set the required callback functions
+		glfwSetKeyCallback(window, KeyCallback);
+		glfwSetCursorPosCallback(window, MouseCallback);
+		glfwSetScrollCallback(window, ScrollCallback);
 
-	// Center  and Hide cursor
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		// Center  and Hide cursor
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	//enable glew
 	glewExperimental = GL_TRUE;
 
 	//Initialize GLEW
-	if (GLEW_OK != glewInit())
+	// Without an X display GLEW's GLX part fails, but the GL entry points are loaded before that
+	GLenum glewStatus = glewInit();
+	if (GLEW_OK != glewStatus && !(headless.IsActive() && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY))
 	{
 		cout << "FAILED TO INITIALISE GLEW." << endl;
 		return EXIT_FAILURE;
 	}
+
+	// Headless there is no default framebuffer to draw into
+	if (headless.IsActive() && !headless.CreateFramebuffer(SCREEN_WIDTH, SCREEN_HEIGHT))
+	{
+		return EXIT_FAILURE;
+	}
 	// Setup OpenGL viewport
 	glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
@@ -108,13 +262,19 @@ int main()
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+#pragma region Asset Loader
+	// Textures and meshes load on a background thread from here on, most important first
+	AssetLoader assets;
+#pragma endregion
+
 #pragma region Height Map
+	CpuScope heightMapScope("Build Height Map");
 	Shader shaderHM("CoreHM.vs", "CoreHM.frag");
 
 	int widthHM, heightHM, nrChannels;
 
 	//Assign Height map
-	unsigned char* dataHM = SOIL_load_image("res/images/HM1.jpg", &widthHM, &heightHM, &nrChannels, 0);
+	unsigned char* dataHM = LoadImageFile("res/images/HM1.jpg", &widthHM, &heightHM, &nrChannels, 0);
 
 	// Check if Height Map was loaded succesfully
 	if (dataHM)
@@ -167,6 +327,34 @@ int main()
 	cout << "Created lattice of " << numStrips << " strips with " << numTrisPerStrip << " triangles each" << endl;
 	cout << "Created " << numStrips * numTrisPerStrip << " triangles total" << endl;
 
+	// Boxes just under the terrain surface, used as occluders by the CPU culler
+	vector<Bounds> terrainChunks;
+	const int chunkSize = 10;
+
+	for (int ci = 0; ci < heightHM - 1; ci += chunkSize)
+	{
+		for (int cj = 0; cj < widthHM - 1; cj += chunkSize)
+		{
+			int iEnd = min(ci + chunkSize, heightHM - 1);
+			int jEnd = min(cj + chunkSize, widthHM - 1);
+
+			// Lowest point of the chunk so the box never pokes out of the terrain
+			GLfloat lowest = FLT_MAX;
+			for (int i = ci; i <= iEnd; i++)
+			{
+				for (int j = cj; j <= jEnd; j++)
+				{
+					lowest = min(lowest, verticesHM[(j + widthHM * i) * 3 + 1]);
+				}
+			}
+
+			Bounds chunk;
+			chunk.min = glm::vec3(verticesHM[(cj + widthHM * ci) * 3], lowest - 1.0f, verticesHM[(cj + widthHM * ci) * 3 + 2]);
+			chunk.max = glm::vec3(verticesHM[(jEnd + widthHM * iEnd) * 3], lowest, verticesHM[(jEnd + widthHM * iEnd) * 3 + 2]);
+			terrainChunks.push_back(chunk);
+		}
+	}
+
 	// Generate the vertex arrays, vertex buffers and index buffers and save them into variables
 	unsigned int VOA_HM, VBO, IBO;
 	glGenVertexArrays(1, &VOA_HM);
@@ -192,37 +380,15 @@ int main()
 
 #pragma region  Height Map Texture
 
-	GLuint textureHM;
-	int width_HM, height_HM;
-
-	glGenTextures(1, &textureHM);
-	glBindTexture(GL_TEXTURE_2D, textureHM);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* HM_Image = SOIL_load_image("res/images/water.png", &width_HM, &height_HM, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_HM, height_HM, 0, GL_RGBA, GL_UNSIGNED_BYTE, HM_Image);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(HM_Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLuint textureHM = assets.AddTexture("res/images/water.png", PLACEHOLDER_WATER);
 
+	heightMapScope.End();
 #pragma endregion
 
 
 #pragma region SkyBox Shader
 
-	Shader skyboxShader("Skybox.vs", "SkyBox.frag");
+	Shader skyboxShader("SkyBox.vs", "SkyBox.frag");
 	
 	float skyboxVertices[] = {
 		// positions
@@ -295,13 +461,8 @@ int main()
 	};
 
 
-	// Skybox texture variable
-	GLuint skyboxTexture = 0;
-
-	int widthTexture = 1024;
-	int heightTexture = 1024;
-
-	skyboxTexture = CreateSkyboxTexture(skyboxTexture, skyboxFaces, widthTexture, heightTexture);
+	// Skybox texture, the sky colour until all six faces have loaded
+	GLuint skyboxTexture = assets.AddCubemap(skyboxFaces, PLACEHOLDER_SKY);
 
 #pragma endregion 
 
@@ -431,6 +592,11 @@ int main()
 		}
 	}
 
+	// Solid slab inside every board square (lowest top, highest bottom), used as an occluder by the CPU culler
+	Bounds boardOccluder;
+	boardOccluder.min = glm::vec3(-3.5f, 0.1f, -3.5f);
+	boardOccluder.max = glm::vec3(4.5f, 0.4f, 4.5f);
+
 	glm::vec3 borderPositions[] =
 	{
 		glm::vec3(-3.75f, 0, 4.0f),
@@ -487,135 +653,63 @@ int main()
 
 	// Chessboard texture variables
 	GLuint textureWhite, textureBlack, textureGrey;
-	int widthB, heightB;
 
 
 #pragma region White Texture
 
 	// Create and load White texture
-	glGenTextures(1, &textureWhite);
-	glBindTexture(GL_TEXTURE_2D, textureWhite);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* whiteBlock = SOIL_load_image("res/images/Light square.JPG", &widthB, &heightB, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthB, heightB, 0, GL_RGBA, GL_UNSIGNED_BYTE, whiteBlock);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(whiteBlock);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	textureWhite = assets.AddTexture("res/images/Light square.JPG", PLACEHOLDER_LIGHT);
 #pragma endregion
 
 #pragma region Black Texture
 
 	//Create Black texture
-	glGenTextures(1, &textureBlack);
-	glBindTexture(GL_TEXTURE_2D, textureBlack);
-
-	//Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	//Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	//Load texture
-	unsigned char* blackBlock = SOIL_load_image("res/images/Dark Square 2.JPG", &widthB, &heightB, 0, SOIL_LOAD_RGBA);
-
-	//Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthB, heightB, 0, GL_RGBA, GL_UNSIGNED_BYTE, blackBlock);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(blackBlock);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	textureBlack = assets.AddTexture("res/images/Dark square 2.JPG", PLACEHOLDER_DARK);
 
 #pragma endregion
 
 #pragma region Border Texture
 
 	//Create Black texture
-	glGenTextures(1, &textureGrey);
-	glBindTexture(GL_TEXTURE_2D, textureGrey);
-
-	//Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	//Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	textureGrey = assets.AddTexture("res/images/Paper.png", PLACEHOLDER_BORDER);
 
-	//Load texture
-	unsigned char* greyBlock = SOIL_load_image("res/images/Paper.png", &widthB, &heightB, 0, SOIL_LOAD_RGBA);
+#pragma endregion
 
-	//Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthB, heightB, 0, GL_RGBA, GL_UNSIGNED_BYTE, greyBlock);
+#pragma endregion
 
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(greyBlock);
-	glBindTexture(GL_TEXTURE_2D, 0);
+#pragma endregion
 
+#pragma region Job System
+	// One worker per core, this thread included
+	JobSystem jobs;
 #pragma endregion
 
+#pragma region Load Meshes
+	// Pieces and props load on the loader thread, each drawn as a small box until it arrives
+	int meshPawn = assets.AddMesh("res/3D models/OBJ Files/pawn.txt", 24264);
+	int meshRook = assets.AddMesh("res/3D models/OBJ Files/rook.txt", 24876);
+	int meshBishop = assets.AddMesh("res/3D models/OBJ Files/bishop.txt", 65538);
+	int meshKnight = assets.AddMesh("res/3D models/OBJ Files/knight.txt", 60777);
+	int meshKing = assets.AddMesh("res/3D models/OBJ Files/king.txt", 22860);
+	int meshPalm = assets.AddMesh("res/3D models/OBJ Files/PalmTree.txt", 7128);
+	int meshSkull = assets.AddMesh("res/3D models/OBJ Files/Skull.txt", 20916);
+	int meshChest = assets.AddMesh("res/3D models/OBJ Files/Chest.txt", 2016);
 #pragma endregion
 
+#pragma region Occlusion Culling
+	OcclusionQueries occlusion;
+	occlusion.Init(OCC_COUNT);
+
+	// Occluders are rasterized on the job system while the board is drawn
+	SoftwareOcclusion softwareOcclusion(&jobs);
 #pragma endregion
 
 #pragma region Build and Compile Shader - Chess Pieces
 
 #pragma region Pawn
-	int i = 0;
-
 	//Build & Compile Shader Program for Pawn Pieces
 	Shader ourShaderPawn("CoreCB.vs", "CoreCB.frag");
 
-	// Vertex data for our pawn piece
-	GLfloat verticesPawn[24264];
-
-	// Read Vertex data from pawn.txt file //
-
-	ifstream myFile("res/3D models/OBJ Files/pawn.txt");
-	i = 0;
-
-	if (myFile.is_open())
-	{
-		string line;
-
-		while (!myFile.eof())
-		{
-			getline(myFile, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesPawn[i] = stof(line);
-			i++;
-			getline(myFile, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesPawn[i] = stof(line);
-			i++;
-			getline(myFile, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesPawn[i] = stof(line);
-			i++;
-		}
-		myFile.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 pawnPositions[] =
@@ -642,16 +736,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Pawn, VOA_Pawn;
+	GLuint VBA_Pawn = assets.GetBuffer(meshPawn), VOA_Pawn;
 	glGenVertexArrays(1, &VOA_Pawn);
-	glGenBuffers(1, &VBA_Pawn);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Pawn);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Pawn);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPawn), verticesPawn, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -668,59 +760,18 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint pawnTextureW, pawnTextureB;
-	int widthPawn, heightPawn;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &pawnTextureW);
-	glBindTexture(GL_TEXTURE_2D, pawnTextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* pawnImageW = SOIL_load_image("res/images/Light square.png", &widthPawn, &heightPawn, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthPawn, heightPawn, 0, GL_RGBA, GL_UNSIGNED_BYTE, pawnImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(pawnImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	pawnTextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &pawnTextureB);
-	glBindTexture(GL_TEXTURE_2D, pawnTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* pawnImageB = SOIL_load_image("res/images/Dark square 2.png", &widthPawn, &heightPawn, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthPawn, heightPawn, 0, GL_RGBA, GL_UNSIGNED_BYTE, pawnImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(pawnImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	pawnTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
 #pragma endregion
 
@@ -739,39 +790,6 @@ int main()
 	//Build & Compile Shader Program for Pawn Pieces
 	Shader ourShaderRook("CoreCB.vs", "CoreCB.frag");
 
-	// Vertex data for our pawn piece
-	GLfloat verticesRook[24876];
-
-	// Read Vertex data from pawn.txt file //
-	ifstream myFile2("res/3D models/OBJ Files/rook.txt");
-	i = 0;
-
-	if (myFile2.is_open())
-	{
-		string line;
-
-		while (!myFile2.eof())
-		{
-			getline(myFile2, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesRook[i] = stof(line);
-			i++;
-			getline(myFile2, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesRook[i] = stof(line);
-			i++;
-			getline(myFile2, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesRook[i] = stof(line);
-			i++;
-		}
-		myFile2.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 rookPositions[] =
@@ -786,16 +804,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Rook, VOA_Rook;
+	GLuint VBA_Rook = assets.GetBuffer(meshRook), VOA_Rook;
 	glGenVertexArrays(1, &VOA_Rook);
-	glGenBuffers(1, &VBA_Rook);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Rook);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Rook);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesRook), verticesRook, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -812,59 +828,18 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint rookTextureW, rookTextureB;
-	int widthRook, heightRook;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &rookTextureW);
-	glBindTexture(GL_TEXTURE_2D, rookTextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* rookImageW = SOIL_load_image("res/images/Light square.png", &widthRook, &heightRook, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthRook, heightRook, 0, GL_RGBA, GL_UNSIGNED_BYTE, rookImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(rookImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	rookTextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &rookTextureB);
-	glBindTexture(GL_TEXTURE_2D, rookTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* rookImageB = SOIL_load_image("res/images/Dark square 2.png", &widthRook, &heightRook, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthRook, heightRook, 0, GL_RGBA, GL_UNSIGNED_BYTE, rookImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(rookImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	rookTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
 #pragma endregion
 
@@ -878,39 +853,6 @@ int main()
 	//Build & Compile Shader Program for Pawn Pieces
 	Shader ourShaderBishop("CoreCB.vs", "CoreCB.frag");
 
-	// Vertex data for our pawn piece
-	GLfloat verticesBishop[65538];
-
-	// Read Vertex data from pawn.txt file //
-	ifstream myFile3("res/3D models/OBJ Files/bishop.txt");
-	i = 0;
-
-	if (myFile3.is_open())
-	{
-		string line;
-
-		while (!myFile3.eof())
-		{
-			getline(myFile3, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesBishop[i] = stof(line);
-			i++;
-			getline(myFile3, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesBishop[i] = stof(line);
-			i++;
-			getline(myFile3, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesBishop[i] = stof(line);
-			i++;
-		}
-		myFile3.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 bishopPositions[] =
@@ -926,16 +868,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Bishop, VOA_Bishop;
+	GLuint VBA_Bishop = assets.GetBuffer(meshBishop), VOA_Bishop;
 	glGenVertexArrays(1, &VOA_Bishop);
-	glGenBuffers(1, &VBA_Bishop);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Bishop);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Bishop);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesBishop), verticesBishop, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -952,59 +892,18 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint bishopTextureW, bishopTextureB;
-	int widthBishop, heightBishop;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &bishopTextureW);
-	glBindTexture(GL_TEXTURE_2D, bishopTextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* bishopImageW = SOIL_load_image("res/images/Light square.png", &widthBishop, &heightBishop, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthBishop, heightBishop, 0, GL_RGBA, GL_UNSIGNED_BYTE, bishopImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(bishopImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bishopTextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &bishopTextureB);
-	glBindTexture(GL_TEXTURE_2D, bishopTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* bishopImageB = SOIL_load_image("res/images/Dark square 2.png", &widthBishop, &heightBishop, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthBishop, heightBishop, 0, GL_RGBA, GL_UNSIGNED_BYTE, bishopImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(bishopImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bishopTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 #pragma endregion
 
 
@@ -1020,41 +919,8 @@ int main()
 #pragma region Knight
 
 	//Build & Compile Shader Program for Pawn Pieces
-	Shader ourShaderKnight("coreCB.vs", "coreCB.frag");
-
-	// Vertex data for our pawn piece
-	GLfloat verticesKnight[60777];
-
-	// Read Vertex data from pawn.txt file //
-	ifstream myFile4("res/3D models/OBJ Files/knight.txt");
-	i = 0;
-
-	if (myFile4.is_open())
-	{
-		string line;
+	Shader ourShaderKnight("CoreCB.vs", "CoreCB.frag");
 
-		while (!myFile4.eof())
-		{
-			getline(myFile4, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesKnight[i] = stof(line);
-			i++;
-			getline(myFile4, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesKnight[i] = stof(line);
-			i++;
-			getline(myFile4, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesKnight[i] = stof(line);
-			i++;
-		}
-		myFile4.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 knightPositions[] =
@@ -1069,16 +935,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Knight, VOA_Knight;
+	GLuint VBA_Knight = assets.GetBuffer(meshKnight), VOA_Knight;
 	glGenVertexArrays(1, &VOA_Knight);
-	glGenBuffers(1, &VBA_Knight);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Knight);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Knight);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesKnight), verticesKnight, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -1095,59 +959,18 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint knightextureW, knightTextureB;
-	int widthKnight, heightKnight;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &knightextureW);
-	glBindTexture(GL_TEXTURE_2D, knightextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* knightImageW = SOIL_load_image("res/images/Light square.png", &widthKnight, &heightKnight, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthKnight, heightKnight, 0, GL_RGBA, GL_UNSIGNED_BYTE, knightImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(knightImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	knightextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &knightTextureB);
-	glBindTexture(GL_TEXTURE_2D, knightTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* knightImageB = SOIL_load_image("res/images/Dark square 2.png", &widthKnight, &heightKnight, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthKnight, heightKnight, 0, GL_RGBA, GL_UNSIGNED_BYTE, knightImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(knightImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	knightTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
 #pragma endregion
 
@@ -1164,7 +987,7 @@ int main()
 //#pragma region Queen
 //
 //	//Build & Compile Shader Program for Pawn Pieces
-//	Shader ourShaderQueen("coreCB.vs", "coreCB.frag");
+//	Shader ourShaderQueen("CoreCB.vs", "CoreCB.frag");
 //
 //	// Vertex data for our pawn piece
 //	GLfloat verticesQueen[39600];
@@ -1305,41 +1128,8 @@ int main()
 
 #pragma region King
 	//Build & Compile Shader Program for Pawn Pieces
-	Shader ourShaderKing("coreCB.vs", "coreCB.frag");
-
-	// Vertex data for our king piece
-	GLfloat verticesKing[22860];
-
-	// Read Vertex data from pawn.txt file //
-	ifstream myFile6("res/3D models/OBJ Files/King.txt");
-	i = 0;
+	Shader ourShaderKing("CoreCB.vs", "CoreCB.frag");
 
-	if (myFile6.is_open())
-	{
-		string line;
-
-		while (!myFile6.eof())
-		{
-			getline(myFile6, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesKing[i] = stof(line);
-			i++;
-			getline(myFile6, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesKing[i] = stof(line);
-			i++;
-			getline(myFile6, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesKing[i] = stof(line);
-			i++;
-		}
-		myFile6.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 KingPositions[] =
@@ -1352,16 +1142,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_King, VOA_King;
+	GLuint VBA_King = assets.GetBuffer(meshKing), VOA_King;
 	glGenVertexArrays(1, &VOA_King);
-	glGenBuffers(1, &VBA_King);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_King);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_King);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesKing), verticesKing, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -1378,59 +1166,18 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint KingtextureW, KingTextureB;
-	int widthKing, heightKing;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &KingtextureW);
-	glBindTexture(GL_TEXTURE_2D, KingtextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* KingImageW = SOIL_load_image("res/images/Light square.png", &widthKing, &heightKing, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthKing, heightKing, 0, GL_RGBA, GL_UNSIGNED_BYTE, KingImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(KingImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	KingtextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &KingTextureB);
-	glBindTexture(GL_TEXTURE_2D, KingTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* KingImageB = SOIL_load_image("res/images/Dark square 2.png", &widthKing, &heightKing, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthKing, heightKing, 0, GL_RGBA, GL_UNSIGNED_BYTE, KingImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(KingImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	KingTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
 #pragma endregion
 
@@ -1450,41 +1197,8 @@ int main()
 #pragma region Palm
 
 	//Build & Compile Shader Program for Pawn Pieces
-	Shader ourShaderPalm("coreCB.vs", "coreCB.frag");
-
-	// Vertex data for our pawn piece
-	GLfloat verticesPalm[7128];
+	Shader ourShaderPalm("CoreCB.vs", "CoreCB.frag");
 
-	// Read Vertex data from pawn.txt file //
-	ifstream myFile10("res/3D models/OBJ Files/PalmTree.txt");
-	i = 0;
-
-	if (myFile10.is_open())
-	{
-		string line;
-
-		while (!myFile10.eof())
-		{
-			getline(myFile10, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesPalm[i] = stof(line);
-			i++;
-			getline(myFile10, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesPalm[i] = stof(line);
-			i++;
-			getline(myFile10, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesPalm[i] = stof(line);
-			i++;
-		}
-		myFile10.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 PalmPositions[] =
@@ -1499,16 +1213,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Palm, VOA_Palm;
+	GLuint VBA_Palm = assets.GetBuffer(meshPalm), VOA_Palm;
 	glGenVertexArrays(1, &VOA_Palm);
-	glGenBuffers(1, &VBA_Palm);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Palm);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Palm);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPalm), verticesPalm, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -1524,60 +1236,12 @@ int main()
 #pragma region Palm Textures
 
 	//Chess Piece Pawn texture variables
-	GLuint PalmtextureW, PalmTextureB;
-	int widthPalm, heightPalm;
+	GLuint PalmtextureW;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &PalmtextureW);
-	glBindTexture(GL_TEXTURE_2D, PalmtextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* PalmImageW = SOIL_load_image("res/images/Light square.png", &widthPalm, &heightPalm, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthPalm, heightPalm, 0, GL_RGBA, GL_UNSIGNED_BYTE, PalmImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(PalmImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-#pragma endregion
-
-#pragma region Dark Texture 
-
-	// Create and load Black texture
-	glGenTextures(1, &PalmTextureB);
-	glBindTexture(GL_TEXTURE_2D, PalmTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* PalmImageB = SOIL_load_image("res/images/Dark square 2.png", &widthPalm, &heightPalm, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthPalm, heightPalm, 0, GL_RGBA, GL_UNSIGNED_BYTE, PalmImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(PalmImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	PalmtextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
@@ -1593,41 +1257,8 @@ int main()
 
 #pragma region Skull
 	//Build & Compile Shader Program for Pawn Pieces
-	Shader ourShaderSkull("coreCB.vs", "coreCB.frag");
-
-	// Vertex data for our skull piece
-	GLfloat verticesSkull[20916]{};
-
-	// Read Vertex data from skull.txt file //
-	ifstream myFile7("res/3D models/OBJ Files/Skull.txt");
-	i = 0;
+	Shader ourShaderSkull("CoreCB.vs", "CoreCB.frag");
 
-	if (myFile7.is_open())
-	{
-		string line;
-
-		while (!myFile7.eof())
-		{
-			getline(myFile7, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesSkull[i] = stof(line);
-			i++;
-			getline(myFile7, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesSkull[i] = stof(line);
-			i++;
-			getline(myFile7, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesSkull[i] = stof(line);
-			i++;
-		}
-		myFile7.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 SkullPositions[] =
@@ -1640,16 +1271,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Skull, VOA_Skull;
+	GLuint VBA_Skull = assets.GetBuffer(meshSkull), VOA_Skull;
 	glGenVertexArrays(1, &VOA_Skull);
-	glGenBuffers(1, &VBA_Skull);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Skull);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Skull);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesSkull), verticesSkull, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -1665,60 +1294,12 @@ int main()
 #pragma region Skull Textures
 
 	//Chess Piece Pawn texture variables
-	GLuint SkullTextureW, SkullTextureB;
-	int widthSkull, heightSkull;
-
-#pragma region Light Texture
-
-	// Create and load White texture
-	glGenTextures(1, &SkullTextureW);
-	glBindTexture(GL_TEXTURE_2D, SkullTextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* SkullImageW = SOIL_load_image("res/images/Light square.png", &widthSkull, &heightSkull, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthSkull, heightSkull, 0, GL_RGBA, GL_UNSIGNED_BYTE, SkullImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(SkullImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-#pragma endregion
+	GLuint SkullTextureB;
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &SkullTextureB);
-	glBindTexture(GL_TEXTURE_2D, SkullTextureB);
-
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* SkullImageB = SOIL_load_image("res/images/Dark square 2.png", &widthSkull, &heightSkull, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthSkull, heightSkull, 0, GL_RGBA, GL_UNSIGNED_BYTE, SkullImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(SkullImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	SkullTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
 #pragma endregion
 
@@ -1733,41 +1314,8 @@ int main()
 
 #pragma region Chest
 	//Build & Compile Shader Program for Pawn Pieces
-	Shader ourShaderChest("coreCB.vs", "coreCB.frag");
-
-	// Vertex data for our Chest piece
-	GLfloat verticesChest[2016]{};
-
-	// Read Vertex data from Chest.txt file //
-	ifstream myFile11("res/3D models/OBJ Files/Chest.txt");
-	i = 0;
-
-	if (myFile11.is_open())
-	{
-		string line;
+	Shader ourShaderChest("CoreCB.vs", "CoreCB.frag");
 
-		while (!myFile11.eof())
-		{
-			getline(myFile11, line, ' ');
-			//cout << "Val 1: " << line << endl;
-			verticesChest[i] = stof(line);
-			i++;
-			getline(myFile11, line, ' ');
-			//cout << "Val 2: " << line << endl;
-			verticesChest[i] = stof(line);
-			i++;
-			getline(myFile11, line, '\n');
-			//cout << "Val 3: " << line << endl;
-			verticesChest[i] = stof(line);
-			i++;
-		}
-		myFile11.close();
-	}
-	else
-	{
-		cout << "Can't open the file";
-	}
-	// Read Vertex data from pawn.txt file //
 
 	// Positions of pawns
 	glm::vec3 ChestPositions[] =
@@ -1780,16 +1328,14 @@ int main()
 	};
 
 	// Generate the vertex arrays and vertex buffers and save them into variables
-	GLuint VBA_Chest, VOA_Chest;
+	GLuint VBA_Chest = assets.GetBuffer(meshChest), VOA_Chest;
 	glGenVertexArrays(1, &VOA_Chest);
-	glGenBuffers(1, &VBA_Chest);
 
 	// Bind the vertex array object
 	glBindVertexArray(VOA_Chest);
 
-	// Bind and set the vertex buffers
+	// Bind the vertex buffer, the loader fills it in when the mesh arrives
 	glBindBuffer(GL_ARRAY_BUFFER, VBA_Chest);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesChest), verticesChest, GL_STATIC_DRAW);
 
 	// Create the vertex pointer and enable the vertex array
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GL_FLOAT), (GLvoid*)0); //Position
@@ -1806,64 +1352,23 @@ int main()
 
 	//Chess Piece Pawn texture variables
 	GLuint ChestTextureW, ChestTextureB;
-	int widthChest, heightChest;
 
 #pragma region Light Texture
 
 	// Create and load White texture
-	glGenTextures(1, &ChestTextureW);
-	glBindTexture(GL_TEXTURE_2D, ChestTextureW);
-
-	// Set texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Actual texture loading code
-	unsigned char* ChestImageW = SOIL_load_image("res/images/Light square.png", &widthChest, &heightChest, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthChest, heightChest, 0, GL_RGBA, GL_UNSIGNED_BYTE, ChestImageW);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(ChestImageW);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	ChestTextureW = assets.AddTexture("res/images/Light square.png", PLACEHOLDER_LIGHT);
 
 #pragma endregion
 
 #pragma region Dark Texture 
 
 	// Create and load Black texture
-	glGenTextures(1, &ChestTextureB);
-	glBindTexture(GL_TEXTURE_2D, ChestTextureB);
+	ChestTextureB = assets.AddTexture("res/images/Dark square 2.png", PLACEHOLDER_DARK);
 
-	// Set texture parameters 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+#pragma endregion
 
-	// Set texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Actual texture loading code
-	unsigned char* ChestImageB = SOIL_load_image("res/images/Dark square 2.png", &widthChest, &heightChest, 0, SOIL_LOAD_RGBA);
-
-	// Specify 2D texture image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthChest, heightChest, 0, GL_RGBA, GL_UNSIGNED_BYTE, ChestImageB);
-
-	// Generate mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(ChestImageB);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-#pragma endregion
-
-
-#pragma endregion
+#pragma endregion
 
 
 
@@ -1872,685 +1377,477 @@ int main()
 #pragma endregion
 #pragma endregion
 
-	//Game LOOP
-	while (!glfwWindowShouldClose(window))
-	{
-		// Set frame time
-		GLfloat currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		// Checks for events and calls corresponding response
-		glfwPollEvents();
-
-		//Render and clear the colour buffer
-		glClearColor(0.4f, 0.6f, 0.7f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-#pragma region Draw chessBoard
-		// Activate Shader
-		chessboardShader.Use();
-
-		// Create Projection Matrix
-		glm::mat4 projection_Board(1.0f);
-		//Perspective view 
-		projection_Board = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-
-		// Create camera transformation 
-		glm::mat4 view_Board(1.0f);
-		view_Board = camera.GetViewMatrix();
-
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Board = glGetUniformLocation(chessboardShader.Program, "model");
-		GLint viewLoc_Board = glGetUniformLocation(chessboardShader.Program, "view");
-		GLint projLoc_Board = glGetUniformLocation(chessboardShader.Program, "projection");
+#pragma region Scene Packets
+	// Every board square, piece and prop, in draw order
+	ScenePrep scene(&jobs);
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Board, 1, GL_FALSE, glm::value_ptr(view_Board));
-		glUniformMatrix4fv(projLoc_Board, 1, GL_FALSE, glm::value_ptr(projection_Board));
+	SceneObject object;
+	object.scale = glm::vec3(1.0f);
+	object.axis = glm::vec3(1.0f, 0.0f, 0.0f);
+	object.angle = 0.0f;
+	object.animation = ANIMATION_NONE;
+	object.occlusionSlot = -1;
 
+	// Board squares and border, drawn first so they can occlude the pieces
+	Bounds noBounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+	object.mesh = scene.AddMesh(CreateSceneMesh("Board", chessboardShader, VOA_Board, 36, noBounds, false));
 
-		// Draw container
-		glBindVertexArray(VOA_Board);
-
-		for (GLuint i = 0; i < 8; i++)
+	for (int i = 0; i < 8; i++)
+	{
+		for (int j = 0; j < 8; j++)
 		{
-			for (GLuint j = 0; j < 8; j++)
-			{
-				if ((i + j) % 2 == 0)
-				{
-					// Activate White texture
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, textureBlack);
-					glUniform1i(glGetUniformLocation(chessboardShader.Program, "faceTexture"), 0);
-				}
-				else
-				{
-					// Activate Black texture
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, textureWhite);
-					glUniform1i(glGetUniformLocation(chessboardShader.Program, "faceTexture"), 0);
-				}
-
-				// Calculate the model matrix for each object and pass it to the shader before drawing
-				glm::mat4 model_Board(1.0f);
-				glm::vec3 cubePos(cubePositions[i].x, randY[i][j], cubePositions[i].z - j);
-				model_Board = glm::translate(model_Board, cubePos);
-				GLfloat angle = 0.0f;
-				model_Board = glm::rotate(model_Board, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-				glUniformMatrix4fv(modelLoc_Board, 1, GL_FALSE, glm::value_ptr(model_Board));
-
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-			}
+			object.texture = ((i + j) % 2 == 0) ? textureBlack : textureWhite;
+			object.position = glm::vec3(cubePositions[i].x, randY[i][j], cubePositions[i].z - j);
+			scene.AddObject(object);
 		}
+	}
 
-		for (GLuint i = 0; i < 2; i++)
+	object.texture = textureGrey;
+	for (int i = 0; i < 2; i++)
+	{
+		for (int j = 0; j < 8; j++)
 		{
-			for (GLuint j = 0; j < 8; j++)
-			{
-				// Activate White texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, textureGrey);
-				glUniform1i(glGetUniformLocation(chessboardShader.Program, "faceTexture"), 0);
-
-				// Calculate the model matrix for each object and pass it to the shader before drawing
-				glm::mat4 model_Board(1.0f);
-				glm::vec3 cubePos(borderPositions[i].z - j, borderPositions[i].y, borderPositions[i].x);
-				model_Board = glm::translate(model_Board, cubePos);
-				GLfloat angle = 0.0f;
-				glm::vec3 scale(1, 1, 0.5f);
-				model_Board = glm::scale(model_Board, scale);
-				model_Board = glm::rotate(model_Board, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-				glUniformMatrix4fv(modelLoc_Board, 1, GL_FALSE, glm::value_ptr(model_Board));
-
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-			}
+			object.position = glm::vec3(borderPositions[i].z - j, borderPositions[i].y, borderPositions[i].x);
+			object.scale = glm::vec3(1.0f, 1.0f, 0.5f);
+			scene.AddObject(object);
 		}
-		for (GLuint i = 0; i < 2; i++)
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		for (int j = 0; j < 8; j++)
 		{
-			for (GLuint j = 0; j < 8; j++)
-			{
-				// Activate White texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, textureGrey);
-				glUniform1i(glGetUniformLocation(chessboardShader.Program, "faceTexture"), 0);
-
-				// Calculate the model matrix for each object and pass it to the shader before drawing
-				glm::mat4 model_Board(1.0f);
-				glm::vec3 cubePos(borderPositions[i].x, borderPositions[i].y, borderPositions[i].z - j);
-				model_Board = glm::translate(model_Board, cubePos);
-				GLfloat angle = 0.0f;
-				glm::vec3 scale(0.5f, 1, 1);
-				model_Board = glm::scale(model_Board, scale);
-				model_Board = glm::rotate(model_Board, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-				glUniformMatrix4fv(modelLoc_Board, 1, GL_FALSE, glm::value_ptr(model_Board));
-
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-			}
+			object.position = glm::vec3(borderPositions[i].x, borderPositions[i].y, borderPositions[i].z - j);
+			object.scale = glm::vec3(0.5f, 1.0f, 1.0f);
+			scene.AddObject(object);
 		}
+	}
 
-		for (int i = 2; i < 6; i++)
-		{
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, textureGrey);
-			glUniform1i(glGetUniformLocation(chessboardShader.Program, "faceTexture"), 0);
+	for (int i = 2; i < 6; i++)
+	{
+		object.position = borderPositions[i];
+		object.scale = glm::vec3(0.5f, 1.0f, 0.5f);
+		scene.AddObject(object);
+	}
 
-			glm::mat4 model_Board(1.0f);
-			glm::vec3 cubePos(borderPositions[i].x, borderPositions[i].y, borderPositions[i].z);
-			model_Board = glm::translate(model_Board, cubePos);
-			GLfloat angle = 0.0f;
+	// Pieces
+	object.scale = glm::vec3(1.0f);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Pawn", ourShaderPawn, VOA_Pawn, assets, meshPawn));
+	object.animation = ANIMATION_LIFT_TILT;
+	object.occlusionSlot = OCC_PAWN;
+	AddSceneObjects(scene, object, pawnPositions, sizeof(pawnPositions) / sizeof(glm::vec3), pawnTextureW, pawnTextureB, 8);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Rook", ourShaderRook, VOA_Rook, assets, meshRook));
+	object.animation = ANIMATION_NONE;
+	object.occlusionSlot = OCC_ROOK;
+	AddSceneObjects(scene, object, rookPositions, sizeof(rookPositions) / sizeof(glm::vec3), rookTextureW, rookTextureB, 2);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Bishop", ourShaderBishop, VOA_Bishop, assets, meshBishop));
+	object.occlusionSlot = OCC_BISHOP;
+	AddSceneObjects(scene, object, bishopPositions, sizeof(bishopPositions) / sizeof(glm::vec3), bishopTextureW, bishopTextureB, 2);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Knight", ourShaderKnight, VOA_Knight, assets, meshKnight));
+	object.animation = ANIMATION_LIFT_SPIN;
+	object.occlusionSlot = OCC_KNIGHT;
+	AddSceneObjects(scene, object, knightPositions, sizeof(knightPositions) / sizeof(glm::vec3), knightextureW, knightTextureB, 2);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("King", ourShaderKing, VOA_King, assets, meshKing));
+	object.animation = ANIMATION_NONE;
+	object.occlusionSlot = OCC_KING;
+	AddSceneObjects(scene, object, KingPositions, sizeof(KingPositions) / sizeof(glm::vec3), KingtextureW, KingTextureB, 1);
+
+	// Props
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Skull", ourShaderSkull, VOA_Skull, assets, meshSkull));
+	object.axis = glm::vec3(0.0f, 2.0f, 0.0f);
+	object.angle = 21.0f;
+	object.occlusionSlot = OCC_SKULL;
+	AddSceneObjects(scene, object, SkullPositions, sizeof(SkullPositions) / sizeof(glm::vec3), SkullTextureB, SkullTextureB, 1);
+
+	object.axis = glm::vec3(1.0f, 0.0f, 0.0f);
+	object.angle = 0.0f;
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Palm", ourShaderPalm, VOA_Palm, assets, meshPalm));
+	object.scale = glm::vec3(2.0f);
+	object.occlusionSlot = OCC_PALM;
+	AddSceneObjects(scene, object, PalmPositions, sizeof(PalmPositions) / sizeof(glm::vec3), PalmtextureW, PalmtextureW, 1);
+
+	object.mesh = scene.AddMesh(CreateLoadedSceneMesh("Chest", ourShaderChest, VOA_Chest, assets, meshChest));
+	object.scale = glm::vec3(1.0f);
+	object.occlusionSlot = OCC_CHEST;
+	AddSceneObjects(scene, object, ChestPositions, sizeof(ChestPositions) / sizeof(glm::vec3), ChestTextureB, ChestTextureW, 1);
+#pragma endregion
 
-			glm::vec3 scale(0.5f, 1, 0.5f);
-			model_Board = glm::scale(model_Board, scale);
-			model_Board = glm::rotate(model_Board, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-			glUniformMatrix4fv(modelLoc_Board, 1, GL_FALSE, glm::value_ptr(model_Board));
+#pragma region Asset Priorities
+	// Where every loaded mesh and texture is drawn, so the loader can start with what is in view
+	for (int i = 0; i < scene.GetObjectCount(); i++)
+	{
+		const SceneObject& sceneObject = scene.GetObject(i);
+		float radius = max(sceneObject.scale.x, max(sceneObject.scale.y, sceneObject.scale.z));
 
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		int meshAsset = scene.GetMesh(sceneObject.mesh).asset;
+		if (meshAsset >= 0)
+		{
+			assets.AddUse(meshAsset, sceneObject.position, radius);
 		}
-#pragma endregion
-
-#pragma region Draw Chess Pieces
 
-#pragma region Draw Pawn
+		int textureAsset = assets.FindTexture(sceneObject.texture);
+		if (textureAsset >= 0)
+		{
+			assets.AddUse(textureAsset, sceneObject.position, radius);
+		}
+	}
 
-		// Activate Shader
-		ourShaderPawn.Use();
+	// The terrain spreads all round the board and the sky is always in view
+	assets.AddUse(assets.FindTexture(textureHM), glm::vec3(0.0f), glm::length(glm::vec2(widthHM, heightHM)) * 0.5f);
+	assets.AddUse(assets.FindTexture(skyboxTexture), glm::vec3(0.0f), FLT_MAX);
+#pragma endregion
 
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Pawn(1.0f);
-		//Perspective view
-		projection_Pawn = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-		// Create camera transformation
-		glm::mat4 view_Pawn(1.0f);
-		view_Pawn = camera.GetViewMatrix();
+#pragma region Simulation
+	// The simulation steps at a fixed rate, rendering blends between its last two states
+	FixedTimestep simulation;
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Pawn = glGetUniformLocation(ourShaderPawn.Program, "model");
-		GLint viewLoc_Pawn = glGetUniformLocation(ourShaderPawn.Program, "view");
-		GLint projLoc_Pawn = glGetUniformLocation(ourShaderPawn.Program, "projection");
+	// Input recording and replay, both per simulation tick
+	InputRecorder recorder;
+	InputReplayer replayer;
+	bool replaying = false;
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Pawn, 1, GL_FALSE, glm::value_ptr(view_Pawn));
-		glUniformMatrix4fv(projLoc_Pawn, 1, GL_FALSE, glm::value_ptr(projection_Pawn));
+	if (!bench.record.empty())
+	{
+		recorder.Start(simulation.GetStep(), camera.GetState(), animate);
+	}
 
-		// Draw container
-		glBindVertexArray(VOA_Pawn);
+	if (!bench.replay.empty() && replayer.Load(bench.replay, simulation.GetStep()))
+	{
+		camera.SetState(replayer.GetStartCamera());
+		animate = replayer.GetStartAnimate();
+		replaying = true;
 
-		for (GLuint i = 0; i < 16; i++)
+		// The benchmark measures exactly the recorded run
+		if (bench.enabled)
 		{
-			if (i <= 7)
-			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, pawnTextureW);
-				glUniform1i(glGetUniformLocation(ourShaderPawn.Program, "faceTexture"), 0);
-			}
-			else
-			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, pawnTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderPawn.Program, "faceTexture"), 0);
-			}
-
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Pawn(1.0f);
-
-			glm::vec3 newPos = AnimatePosition(pawnPositions[i]);
-			model_Pawn = glm::translate(model_Pawn, newPos); // Original code 
-			GLfloat angle = AnimateCPRotation(); //for animation
-
-			// Handles Piece Rotation
-			model_Pawn = glm::rotate(model_Pawn, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-
-			glUniformMatrix4fv(modelLoc_Pawn, 1, GL_FALSE, glm::value_ptr(model_Pawn));
+			bench.frames = max((int)ceil(replayer.GetDuration() / BENCH_FRAME_TIME), 1);
+		}
+	}
 
-			glDrawArrays(GL_TRIANGLES, 0, 8088); //number of lines times by 2
+	bool benchPath = bench.enabled && !replaying;
+	int benchWarmupTicks = (int)(bench.warmupFrames * BENCH_FRAME_TIME / simulation.GetStep() + 0.5);
 
-		}
-		glBindVertexArray(0);
+	CameraState previousCameraState = camera.GetState();
+	Camera renderCamera = camera;
 #pragma endregion
 
-#pragma region Draw Rook
-		i = 0;
-		// Activate Shader
-		ourShaderRook.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Rook(1.0f);
-		//Perspective view
-		projection_Rook = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-		// Create camera transformation
-		glm::mat4 view_Rook(1.0f);
-		view_Rook = camera.GetViewMatrix();
-
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Rook = glGetUniformLocation(ourShaderRook.Program, "model");
-		GLint viewLoc_Rook = glGetUniformLocation(ourShaderRook.Program, "view");
-		GLint projLoc_Rook = glGetUniformLocation(ourShaderRook.Program, "projection");
-
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Rook, 1, GL_FALSE, glm::value_ptr(view_Rook));
-		glUniformMatrix4fv(projLoc_Rook, 1, GL_FALSE, glm::value_ptr(projection_Rook));
-		//glUniform3f(glGetUniformLocation(LightingShader.Program, "lightPos"), LightPos.x, LightPos.y, LightPos.z);
-
-		// Draw container
-		glBindVertexArray(VOA_Rook);
+#pragma region Camera Buffer
+	// View and projection for every shader come from one uniform buffer
+	CameraBuffer cameraBuffer;
+	cameraBuffer.Init();
 
-		for (GLuint i = 0; i < 4; i++)
-		{
-			if (i <= 1)
-			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, rookTextureW);
-				glUniform1i(glGetUniformLocation(ourShaderRook.Program, "faceTexture"), 0);
-			}
-			else
-			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, rookTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderRook.Program, "faceTexture"), 0);
-			}
+	GLuint cameraPrograms[] =
+	{
+		shaderHM.Program, skyboxShader.Program, chessboardShader.Program,
+		ourShaderPawn.Program, ourShaderRook.Program, ourShaderBishop.Program, ourShaderKnight.Program,
+		ourShaderKing.Program, ourShaderSkull.Program, ourShaderPalm.Program, ourShaderChest.Program
+	};
 
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Rook(1.0f);
-			model_Rook = glm::translate(model_Rook, rookPositions[i]); // Original code 
-			GLfloat angle = 0.0f; // Original code
-			model_Rook = glm::rotate(model_Rook, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
+	for (size_t c = 0; c < sizeof(cameraPrograms) / sizeof(GLuint); c++)
+	{
+		CameraBuffer::BindShader(cameraPrograms[c]);
+	}
+#pragma endregion
 
-			glUniformMatrix4fv(modelLoc_Rook, 1, GL_FALSE, glm::value_ptr(model_Rook));
+#pragma region Dynamic Resolution
+	// Offscreen target the scene renders into at a reduced size when the GPU falls behind
+	DynamicResolution resolution;
+	resolution.Init(SCREEN_WIDTH, SCREEN_HEIGHT, headless.GetFramebuffer());
+#pragma endregion
 
-			glDrawArrays(GL_TRIANGLES, 0, 7620); //number of lines times by 2
+#pragma region GPU Profiler
+	// Timestamps around each render region, read back a few frames late
+	GpuProfiler gpuProfiler;
+	gpuProfiler.Init();
 
-		}
-		glBindVertexArray(0);
+	// A benchmark keeps every frame's GPU time
+	if (bench.enabled)
+	{
+		gpuProfiler.SetHistorySize(bench.warmupFrames + bench.frames);
+	}
 #pragma endregion
 
-#pragma region Draw Bishop
+	startupScope.End();
 
-		// Activate Shader
-		ourShaderBishop.Use();
+	// Time to the first frame and to every asset being in, reported once each
+	bool firstFrame = true;
+	bool assetsLoaded = false;
 
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Bishop(1.0f);
-		//Perspective view
-		projection_Bishop = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+	// Benchmark frames rendered so far, and the timings
+	int benchFrame = 0;
+	BenchRecorder benchRecorder;
+	double benchDuration = bench.frames * BENCH_FRAME_TIME;
+	benchRecorder.SetStartup(chrono::duration<double, milli>(chrono::steady_clock::now() - processStart).count());
 
-		// Create camera transformation
-		glm::mat4 view_Bishop(1.0f);
-		view_Bishop = camera.GetViewMatrix();
+	//Game LOOP
+	while (bench.enabled ? benchFrame < bench.warmupFrames + bench.frames : !glfwWindowShouldClose(window))
+	{
+		CpuScope frameScope("Frame");
+		chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Bishop = glGetUniformLocation(ourShaderBishop.Program, "model");
-		GLint viewLoc_Bishop = glGetUniformLocation(ourShaderBishop.Program, "view");
-		GLint projLoc_Bishop = glGetUniformLocation(ourShaderBishop.Program, "projection");
+		// Set frame time
+		GLfloat currentFrame = (GLfloat)ClockTime(window, processStart, frameStart);
+		deltaTime = (GLfloat)framePacer.BeginFrame(); // smoothed over the last few frames
+		lastFrame = currentFrame;
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Bishop, 1, GL_FALSE, glm::value_ptr(view_Bishop));
-		glUniformMatrix4fv(projLoc_Bishop, 1, GL_FALSE, glm::value_ptr(projection_Bishop));
+		// The benchmark steps the same amount every frame, so every run covers the same path
+		if (bench.enabled)
+		{
+			deltaTime = (GLfloat)BENCH_FRAME_TIME;
+		}
 
-		// Draw container
-		glBindVertexArray(VOA_Bishop);
+		// Checks for events and calls corresponding response
+		if (window != nullptr)
+		{
+			glfwPollEvents();
+		}
 
-		for (GLuint i = 0; i < 4; i++)
+		// Run as many simulation ticks as the real time covers, sampling input once per tick
+		CpuScope simulationScope("Simulation");
+		simulation.AddFrameTime(deltaTime);
+		int ticks = simulation.GetTicks();
+		while (simulation.Step())
 		{
-			if (i <= 1)
+			// This tick's input, live or from the replay (benchmark warmup frames hold the start)
+			TickInput input = GatherInput();
+			if (replaying)
 			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, bishopTextureW);
-				glUniform1i(glGetUniformLocation(ourShaderBishop.Program, "faceTexture"), 0);
+				input = bench.enabled && simulation.GetTicks() <= benchWarmupTicks ? TickInput() : replayer.Next();
 			}
-			else
+			recorder.Add(input);
+
+			// Camera presets jump straight to the new view instead of sliding there
+			if (input.cameraCycle != 0)
 			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, bishopTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderBishop.Program, "faceTexture"), 0);
+				camera.CycleCamera(input.cameraCycle < 0 ? "Left" : "Right");
 			}
 
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Bishop(1.0f);
-			model_Bishop = glm::translate(model_Bishop, bishopPositions[i]); // Original code 
-			GLfloat angle = 0.0f; // Original code
-			model_Bishop = glm::rotate(model_Bishop, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
-
-			glUniformMatrix4fv(modelLoc_Bishop, 1, GL_FALSE, glm::value_ptr(model_Bishop));
-
-			glDrawArrays(GL_TRIANGLES, 0, 21864); //number of lines times by 2
-
-		}
-		glBindVertexArray(0);
-
-#pragma endregion
-
-#pragma region Draw Knight
-		
-		// Activate Shader
-		ourShaderKnight.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Knight(1.0f);
-		//Perspective view
-		projection_Knight = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-
-		// Create camera transformation
-		glm::mat4 view_Knight(1.0f);
-		view_Knight = camera.GetViewMatrix();
-
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Knight = glGetUniformLocation(ourShaderKnight.Program, "model");
-		GLint viewLoc_Knight = glGetUniformLocation(ourShaderKnight.Program, "view");
-		GLint projLoc_Knight = glGetUniformLocation(ourShaderKnight.Program, "projection");
-
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Knight, 1, GL_FALSE, glm::value_ptr(view_Knight));
-		glUniformMatrix4fv(projLoc_Knight, 1, GL_FALSE, glm::value_ptr(projection_Knight));
+			if (input.toggleAnimation)
+			{
+				animate = !animate;
+			}
 
-		// Draw container
-		glBindVertexArray(VOA_Knight);
+			previousCameraState = camera.GetState();
 
-		for (GLuint i = 0; i < 4; i++)
-		{
-			if (i <= 1)
+			if (benchPath)
 			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, knightextureW);
-				glUniform1i(glGetUniformLocation(ourShaderKnight.Program, "faceTexture"), 0);
+				// Warmup frames hold the start of the path
+				double pathTime = max(simulation.GetSimulationTime() - bench.warmupFrames * BENCH_FRAME_TIME, 0.0);
+				camera.SetState(BenchCameraPath((float)(pathTime / benchDuration)));
 			}
 			else
 			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, knightTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderKnight.Program, "faceTexture"), 0);
+				ApplyTickInput(camera, input, (GLfloat)simulation.GetStep());
 			}
 
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Knight(1.0f);
-
-			glm::vec3 newPos = AnimatePosition(knightPositions[i]);
-			model_Knight = glm::translate(model_Knight, newPos); // Original code 
-			GLfloat angleK = AnimateCPRotation(); //for animation
+			// Live input takes over once the replay runs out
+			if (replaying && replayer.IsFinished())
+			{
+				cout << "Input replay: finished, camera drift from the recording " << replayer.GetDrift(camera.GetState()) << endl;
+				replaying = false;
+			}
+		}
 
-			// Handles Piece Rotation
-			model_Knight = glm::rotate(model_Knight, angleK, glm::vec3(0.0f, 1.0f, 0.0f));
+		simulationScope.End();
 
-			glUniformMatrix4fv(modelLoc_Knight, 1, GL_FALSE, glm::value_ptr(model_Knight));
+		// Render the camera part way between the last two ticks
+		renderCamera.SetState(InterpolateCameraState(previousCameraState, camera.GetState(), (GLfloat)simulation.GetAlpha()));
 
-			glDrawArrays(GL_TRIANGLES, 0, 20259); //number of lines times by 2
+		// Camera matrices for this frame, rewritten later on if the camera is late latched
+		cameraBuffer.BeginFrame();
+		cameraBuffer.Write(BuildCameraBlock(renderCamera));
 
+		if (!lateLatch && simulation.GetTicks() != ticks)
+		{
+			latency.OnLatch(ClockTime(window, processStart, chrono::steady_clock::now()));
 		}
-		glBindVertexArray(0);
-#pragma endregion
 
-//#pragma region Draw Queen
-//
-//		// Activate Shader
-//		ourShaderQueen.Use();
-//
-//		// Create Projection Matrix (moved into while loop in order to update zoom)
-//		glm::mat4 projection_Queen(1.0f);
-//		//Perspective view
-//		projection_Queen = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-//
-//		// Create camera transformation
-//		glm::mat4 view_Queen(1.0f);
-//		view_Queen = camera.GetViewMatrix();
-//
-//		// Get the uniform locations for our matrices
-//		GLint modelLoc_Queen = glGetUniformLocation(ourShaderQueen.Program, "model");
-//		GLint viewLoc_Queen = glGetUniformLocation(ourShaderQueen.Program, "view");
-//		GLint projLoc_Queen = glGetUniformLocation(ourShaderQueen.Program, "projection");
-//
-//		// Pass locations to shaders
-//		glUniformMatrix4fv(viewLoc_Queen, 1, GL_FALSE, glm::value_ptr(view_Queen));
-//		glUniformMatrix4fv(projLoc_Queen, 1, GL_FALSE, glm::value_ptr(projection_Queen));
-//
-//		// Draw container
-//		glBindVertexArray(VOA_Queen);
-//
-//		for (GLuint i = 0; i < 2; i++)
-//		{
-//			if (i <= 0)
-//			{
-//				// Activate White Texture
-//				glActiveTexture(GL_TEXTURE0);
-//				glBindTexture(GL_TEXTURE_2D, queentextureW);
-//				glUniform1i(glGetUniformLocation(ourShaderQueen.Program, "faceTexture"), 0);
-//			}
-//			else
-//			{
-//				// Activate Black Texture 
-//				glActiveTexture(GL_TEXTURE0);
-//				glBindTexture(GL_TEXTURE_2D, queenTextureB);
-//				glUniform1i(glGetUniformLocation(ourShaderQueen.Program, "faceTexture"), 0);
-//			}
-//
-//			// Calculate the model matrix for each object and pass it to the shader before drawing
-//			glm::mat4 model_Queen(1.0f);
-//			model_Queen = glm::translate(model_Queen, queenPositions[i]); // Original code 
-//			GLfloat angle = 0.0f; // Original code
-//			model_Queen = glm::rotate(model_Queen, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
-//
-//			glUniformMatrix4fv(modelLoc_Queen, 1, GL_FALSE, glm::value_ptr(model_Queen));
-//
-//			glDrawArrays(GL_TRIANGLES, 0, 13200); //number of lines times by 2
-//
-//		}
-//#pragma endregion
-
-#pragma region Draw King
-
-		// Activate Shader
-		ourShaderKing.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_King(1.0f);
-		//Perspective view
-		projection_King = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+		// Read back old occlusion results and start this frame's queries
+		occlusion.BeginFrame(occlusionCulling);
 
-		// Create camera transformation
-		glm::mat4 view_King(1.0f);
-		view_King = camera.GetViewMatrix();
+		// Camera matrices shared by the board, pieces and props
+		glm::mat4 projection_Scene = glm::perspective(glm::radians(renderCamera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+		glm::mat4 view_Scene = renderCamera.GetViewMatrix();
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_King = glGetUniformLocation(ourShaderKing.Program, "model");
-		GLint viewLoc_King = glGetUniformLocation(ourShaderKing.Program, "view");
-		GLint projLoc_King = glGetUniformLocation(ourShaderKing.Program, "projection");
+		// What the draws end up using, replaced by the late latch
+		glm::mat4 viewProjection_Draw = projection_Scene * view_Scene;
+		glm::vec3 cameraPosition_Draw = renderCamera.GetPosition();
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_King, 1, GL_FALSE, glm::value_ptr(view_King));
-		glUniformMatrix4fv(projLoc_King, 1, GL_FALSE, glm::value_ptr(projection_King));
+		// Reorder what is still loading for this view and swap in whatever has arrived
+		if (assets.Update(renderCamera.GetPosition(), projection_Scene * view_Scene) > 0)
+		{
+			UpdateSceneAssets(scene, assets);
+			textureHM = assets.GetTexture(textureHM);
+			skyboxTexture = assets.GetTexture(skyboxTexture);
+		}
 
-		// Draw container
-		glBindVertexArray(VOA_King);
+#pragma region Prepare Scene
+		CpuScope prepareScope("Prepare Scene");
 
-		for (GLuint i = 0; i < 2; i++)
+		// Parallel phase: rasterize the big occluders, then animate, cull and build a draw packet
+		// for every object on the job system. Nothing in here touches GL.
+		if (softwareCulling)
 		{
-			if (i <= 0)
+			// The late latch draws from the latest tick plus up to LATCH_MAX_TURN and LATCH_MAX_MOVE
+			// of newer input, so cull from that tick with a view widened by twice the turn on every
+			// side and a margin for the move. Nothing the latched camera can see gets culled.
+			if (lateLatch)
 			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, KingtextureW);
-				glUniform1i(glGetUniformLocation(ourShaderKing.Program, "faceTexture"), 0);
+				glm::mat4 projection_Cull = glm::perspective(glm::radians(camera.GetZoom() + 4.0f * LATCH_MAX_TURN), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+				softwareOcclusion.BeginFrame(projection_Cull * camera.GetViewMatrix(), LATCH_MAX_MOVE);
 			}
 			else
 			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, KingTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderKing.Program, "faceTexture"), 0);
+				softwareOcclusion.BeginFrame(projection_Scene * view_Scene);
 			}
 
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_King(1.0f);
-			model_King = glm::translate(model_King, KingPositions[i]); // Original code 
-			GLfloat angle = 0.0f; // Original code
-			model_King = glm::rotate(model_King, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
-
-			glUniformMatrix4fv(modelLoc_King, 1, GL_FALSE, glm::value_ptr(model_King));
+			softwareOcclusion.AddOccluderBox(glm::mat4(1.0f), boardOccluder);
 
-			glDrawArrays(GL_TRIANGLES, 0, 7620); //number of lines times by 2
+			for (size_t c = 0; c < terrainChunks.size(); c++)
+			{
+				softwareOcclusion.AddOccluderBox(glm::mat4(1.0f), terrainChunks[c]);
+			}
 
+			softwareOcclusion.Rasterize();
 		}
 
-		glBindVertexArray(0);
-#pragma endregion
+		SceneFrame sceneFrame;
+		sceneFrame.animate = animate;
+		sceneFrame.animationTime = AnimateCPRotation((GLfloat)simulation.GetInterpolatedTime());
+		sceneFrame.culler = softwareCulling ? &softwareOcclusion : nullptr;
+		scene.Prepare(sceneFrame);
 
+		prepareScope.End();
 #pragma endregion
-		
-#pragma region Draw Custom Models
-
-#pragma region Draw Skull
 
-		// Activate Shader
-		ourShaderSkull.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Skull(1.0f);
-		//Perspective view
-		projection_Skull = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-
-		// Create camera transformation
-		glm::mat4 view_Skull(1.0f);
-		view_Skull = camera.GetViewMatrix();
+		gpuProfiler.BeginFrame();
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Skull = glGetUniformLocation(ourShaderSkull.Program, "model");
-		GLint viewLoc_Skull = glGetUniformLocation(ourShaderSkull.Program, "view");
-		GLint projLoc_Skull = glGetUniformLocation(ourShaderSkull.Program, "projection");
-
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Skull, 1, GL_FALSE, glm::value_ptr(view_Skull));
-		glUniformMatrix4fv(projLoc_Skull, 1, GL_FALSE, glm::value_ptr(projection_Skull));
+		// Render into the scaled offscreen target, otherwise straight to the window
+		if (dynamicResolution)
+		{
+			resolution.BeginFrame();
+		}
+		else if (resolution.GetScale() < RESOLUTION_MAX_SCALE)
+		{
+			resolution.Reset();
+		}
 
-		// Draw container
-		glBindVertexArray(VOA_Skull);
+		//Render and clear the colour buffer
+		glClearColor(0.4f, 0.6f, 0.7f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		for (GLuint i = 0; i < 2; i++)
+#pragma region Late Latch
+		// Everything up to here used the camera from the start of the frame. Pick up any input
+		// that came in while the frame was being prepared and rewrite the camera right before
+		// the draws go out. Uses the latest tick rather than the interpolated camera so the
+		// view never steps backwards once the simulation catches up. The mouse look and held
+		// movement keys since that tick go on top, kept within the room culling left for them.
+		if (lateLatch)
 		{
-			if (i <= 0)
-			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, SkullTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderSkull.Program, "faceTexture"), 0);
-			}
-			else
-			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, SkullTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderSkull.Program, "faceTexture"), 0);
-			}
-
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Skull(1.0f);
-			model_Skull = glm::translate(model_Skull, SkullPositions[i]); // Original code 
-			GLfloat angle = 21.0f; // Original code
-			model_Skull = glm::rotate(model_Skull, angle, glm::vec3(0.0f, 2.0f, 0.0f)); // Original code
+			glfwPollEvents();
 
-			glUniformMatrix4fv(modelLoc_Skull, 1, GL_FALSE, glm::value_ptr(model_Skull));
+			Camera latchCamera = camera;
+			if (!replaying)
+			{
+				// Zoom stays with the ticks, the culling view was widened from the tick's zoom
+				TickInput latchInput = PeekInput();
+				latchInput.scroll = 0.0f;
 
-			glDrawArrays(GL_TRIANGLES, 0, 6972); //number of lines times by 2
+				GLfloat sinceTick = (GLfloat)(simulation.GetAlpha() * simulation.GetStep() + ClockTime(window, processStart, chrono::steady_clock::now()) - currentFrame);
+				ApplyTickInput(latchCamera, latchInput, sinceTick);
+				latchCamera.SetState(LimitCameraState(latchCamera.GetState(), camera.GetState(), LATCH_MAX_TURN, LATCH_MAX_MOVE));
+			}
 
+			CameraBlock latchBlock = BuildCameraBlock(latchCamera);
+			cameraBuffer.Write(latchBlock);
+			viewProjection_Draw = latchBlock.projection * latchBlock.view;
+			cameraPosition_Draw = latchCamera.GetPosition();
+			latency.OnLatch(ClockTime(window, processStart, chrono::steady_clock::now()));
 		}
 #pragma endregion
 
-#pragma region Palm tree
-		// Activate Shader
-		ourShaderPalm.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Palm(1.0f);
-		//Perspective view
-		projection_Palm = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+#pragma region Draw Scene Packets
+		// Serial phase: the GL thread only submits, switching shader and texture when they change
+		const vector<DrawPacket>& packets = scene.GetPackets();
+		int currentMesh = -1;
+		GLuint currentTexture = 0;
 
-		// Create camera transformation
-		glm::mat4 view_Palm(1.0f);
-		view_Palm = camera.GetViewMatrix();
+		CpuScope submitScope("Submit Scene");
+		gpuProfiler.Begin("Scene");
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Palm = glGetUniformLocation(ourShaderPalm.Program, "model");
-		GLint viewLoc_Palm = glGetUniformLocation(ourShaderPalm.Program, "view");
-		GLint projLoc_Palm = glGetUniformLocation(ourShaderPalm.Program, "projection");
+		for (size_t p = 0; p < packets.size(); p++)
+		{
+			const DrawPacket& packet = packets[p];
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Palm, 1, GL_FALSE, glm::value_ptr(view_Palm));
-		glUniformMatrix4fv(projLoc_Palm, 1, GL_FALSE, glm::value_ptr(projection_Palm));
+			// Culled on the CPU
+			if (!packet.visible)
+			{
+				continue;
+			}
 
-		// Draw container
-		glBindVertexArray(VOA_Palm);
+			const SceneMesh& mesh = scene.GetMesh(packet.mesh);
 
-		for (GLuint i = 0; i < 4; i++)
+			if (packet.mesh != currentMesh)
 			{
-				if (i <= 0)
-				{
-					// Activate White Texture
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, PalmtextureW);
-					glUniform1i(glGetUniformLocation(ourShaderPalm.Program, "faceTexture"), 0);
-				}
-				else
+				// One GPU scope per mesh, the packets are grouped by mesh
+				if (currentMesh >= 0)
 				{
-					// Activate Black Texture 
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, PalmtextureW);
-					glUniform1i(glGetUniformLocation(ourShaderPalm.Program, "faceTexture"), 0);
+					gpuProfiler.End();
 				}
-			
-				// Calculate the model matrix for each object and pass it to the shader before drawing
-				glm::mat4 model_Palm(1.0f);
-				model_Palm = glm::translate(model_Palm, PalmPositions[i]); // Original code 
-				GLfloat angle = 0.0f; // Original code
-				model_Palm = glm::scale(model_Palm, glm::vec3(2, 2, 2));
-				model_Palm = glm::rotate(model_Palm, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
-			
-				glUniformMatrix4fv(modelLoc_Palm, 1, GL_FALSE, glm::value_ptr(model_Palm));
-			
-				glDrawArrays(GL_TRIANGLES, 0, 2376); //number of lines times 20916
-			
-			}
-
-		glBindVertexArray(0);
-#pragma endregion
-
-#pragma region Draw Chest tree
-		// Activate Shader
-		ourShaderChest.Use();
-
-		// Create Projection Matrix (moved into while loop in order to update zoom)
-		glm::mat4 projection_Chest(1.0f);
-		//Perspective view
-		projection_Chest = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-
-		// Create camera transformation
-		glm::mat4 view_Chest(1.0f);
-		view_Chest = camera.GetViewMatrix();
+				gpuProfiler.Begin(mesh.name);
 
-		// Get the uniform locations for our matrices
-		GLint modelLoc_Chest = glGetUniformLocation(ourShaderChest.Program, "model");
-		GLint viewLoc_Chest = glGetUniformLocation(ourShaderChest.Program, "view");
-		GLint projLoc_Chest = glGetUniformLocation(ourShaderChest.Program, "projection");
+				glUseProgram(mesh.program);
+				glUniform1i(mesh.textureLocation, 0);
+				glBindVertexArray(mesh.vao);
+				currentMesh = packet.mesh;
+			}
 
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Chest, 1, GL_FALSE, glm::value_ptr(view_Chest));
-		glUniformMatrix4fv(projLoc_Chest, 1, GL_FALSE, glm::value_ptr(projection_Chest));
+			if (packet.texture != currentTexture)
+			{
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, packet.texture);
+				currentTexture = packet.texture;
+			}
 
-		// Draw container
-		glBindVertexArray(VOA_Chest);
+			glUniformMatrix4fv(mesh.modelLocation, 1, GL_FALSE, glm::value_ptr(packet.model));
 
-		for (GLuint i = 0; i < 4; i++)
-		{
-			if (i <= 0)
+			// Let the GPU skip the draw when the bounds were hidden last frame
+			if (packet.occlusionSlot >= 0)
 			{
-				// Activate White Texture
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, ChestTextureB);
-				glUniform1i(glGetUniformLocation(ourShaderChest.Program, "faceTexture"), 0);
+				occlusion.Begin(packet.occlusionSlot, packet.model, mesh.bounds);
+				glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+				occlusion.End();
 			}
 			else
 			{
-				// Activate Black Texture 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, ChestTextureW);
-				glUniform1i(glGetUniformLocation(ourShaderChest.Program, "faceTexture"), 0);
+				glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
 			}
+		}
 
-			// Calculate the model matrix for each object and pass it to the shader before drawing
-			glm::mat4 model_Chest(1.0f);
-			model_Chest = glm::translate(model_Chest, ChestPositions[i]); // Original code 
-			GLfloat angle = 0.0f; // Original code
-			model_Chest = glm::rotate(model_Chest, angle, glm::vec3(1.0f, 0.0f, 0.0f)); // Original code
-
-			glUniformMatrix4fv(modelLoc_Chest, 1, GL_FALSE, glm::value_ptr(model_Chest));
-
-			glDrawArrays(GL_TRIANGLES, 0, 672); //number of lines times 20916
-
+		if (currentMesh >= 0)
+		{
+			gpuProfiler.End();
 		}
+		gpuProfiler.End();
+		submitScope.End();
 
 		glBindVertexArray(0);
 #pragma endregion
-#pragma endregion
 		
-//Terrain Generation
 #pragma region Height Map
+		CpuScope terrainScope("Height Map");
+		gpuProfiler.Begin("Height Map");
 
 		// Activate Shader
 		shaderHM.Use();
 
-		// view/projection transformations
-		glm::mat4 projectionHM = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
-		glm::mat4 viewHM = camera.GetViewMatrix();
-		GLint projLocHM = glGetUniformLocation(shaderHM.Program, "projection");
-		GLint viewLocHM = glGetUniformLocation(shaderHM.Program, "view");
-
-		glUniformMatrix4fv(viewLocHM, 1, GL_FALSE, glm::value_ptr(viewHM));
-		glUniformMatrix4fv(projLocHM, 1, GL_FALSE, glm::value_ptr(projectionHM));
+		// view/projection come from the camera buffer
 
 		// world transformation
 		glm::mat4 modelHM = glm::mat4(1.0f);
@@ -2577,28 +1874,34 @@ int main()
 
 		glBindVertexArray(0); // Unbinding
 
+		gpuProfiler.End();
+		terrainScope.End();
+#pragma endregion
+
+#pragma region Occlusion Queries
+		// Every occluder is in the depth buffer now, test the pieces and props drawn this frame
+		// for the next one
+		if (occlusionCulling)
+		{
+			CpuScope occlusionScope("Occlusion Queries");
+			gpuProfiler.Begin("Occlusion Queries");
+			occlusion.IssueQueries(viewProjection_Draw, cameraPosition_Draw);
+			glBindVertexArray(0);
+			gpuProfiler.End();
+		}
 #pragma endregion
 
 #pragma region SkyBox Creation
+		CpuScope skyboxScope("SkyBox");
+		gpuProfiler.Begin("SkyBox");
+
 		// draw skybox as last
 				// change depth function so depth test passes when values are equal to depth buffer's content
 		glDepthFunc(GL_LEQUAL);
 
+		// Skybox view and projection come from the camera buffer
 		skyboxShader.Use();
-		// Create Projection Matrix
-		glm::mat4 projection_Skybox = glm::perspective(glm::radians(camera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
-
-		// Create camera transformation
-		// remove translation from the view matrix
-		glm::mat4 view_Skybox = glm::mat4(glm::mat3(camera.GetViewMatrix()));
 
-		// Get the uniform locations for our matrices
-		GLint viewLoc_Skybox = glGetUniformLocation(skyboxShader.Program, "view");
-		GLint projLoc_Skybox = glGetUniformLocation(skyboxShader.Program, "projection");
-
-		// Pass locations to shaders
-		glUniformMatrix4fv(viewLoc_Skybox, 1, GL_FALSE, glm::value_ptr(view_Skybox));
-		glUniformMatrix4fv(projLoc_Skybox, 1, GL_FALSE, glm::value_ptr(projection_Skybox));
 		// skybox cube
 		glBindVertexArray(skyboxVAO);
 		glActiveTexture(GL_TEXTURE0);
@@ -2606,14 +1909,179 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 		glBindVertexArray(0);
 		glDepthFunc(GL_LESS); // set depth function back to default
+
+		gpuProfiler.End();
+		skyboxScope.End();
 #pragma endregion
 		
 		
+		// Scale the frame up onto the window
+		if (dynamicResolution)
+		{
+			gpuProfiler.Begin("Upscale");
+			resolution.EndFrame();
+			gpuProfiler.End();
+		}
+
+		gpuProfiler.EndFrame();
+
+		// Every draw reading this frame's camera matrices has been submitted
+		cameraBuffer.EndFrame();
+
 		//DRAW OPENGL WINDOW/VIEWPORT
-		glfwSwapBuffers(window);
+		CpuScope swapScope("Swap");
+		if (headless.IsActive())
+		{
+			headless.SwapBuffers();
+		}
+		else
+		{
+			glfwSwapBuffers(window);
+		}
+		swapScope.End();
+		GLStats::Get().EndFrame();
+		latency.OnSwap(ClockTime(window, processStart, chrono::steady_clock::now()));
+
+		if (firstFrame)
+		{
+			double firstFrameMs = chrono::duration<double, milli>(chrono::steady_clock::now() - processStart).count();
+			cout << "First frame after " << firstFrameMs << " ms, " << assets.GetRemaining() << " assets still loading" << endl;
+			benchRecorder.SetFirstFrame(firstFrameMs);
+			firstFrame = false;
+
+			// Measured frames never include loading
+			if (bench.enabled)
+			{
+				assets.Finish();
+				UpdateSceneAssets(scene, assets);
+				textureHM = assets.GetTexture(textureHM);
+				skyboxTexture = assets.GetTexture(skyboxTexture);
+			}
+		}
+
+		if (!assetsLoaded && assets.IsComplete())
+		{
+			double assetsLoadedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - processStart).count();
+			cout << "All assets loaded after " << assetsLoadedMs << " ms" << endl;
+
+			const TextureCache& textureCache = assets.GetTextureCache();
+			cout << "Texture cache: " << textureCache.GetHits() << " of " << textureCache.GetRequests() << " requests hit ("
+				<< textureCache.GetHitRate() * 100.0f << "%), " << textureCache.GetBytesSaved() / 1024 << " KB of textures saved" << endl;
+			benchRecorder.SetAssetsLoaded(assetsLoadedMs);
+			assetsLoaded = true;
+		}
+
+		if (bench.enabled)
+		{
+			if (benchFrame >= bench.warmupFrames)
+			{
+				benchRecorder.AddCpuFrame(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count());
+			}
+			benchFrame++;
+		}
+
+		// Hold the frame to the cap before the next frame samples input
+		CpuScope limitScope("Limit");
+		framePacer.Limit();
+		limitScope.End();
+
+		// Report frame time percentiles
+		if (frameStats && currentFrame - lastFrameStatsReport >= 1.0f)
+		{
+			cout << "Frame time: mean " << framePacer.GetMean() << " ms, p50 " << framePacer.GetPercentile(50.0)
+				<< " ms, p95 " << framePacer.GetPercentile(95.0) << " ms, p99 " << framePacer.GetPercentile(99.0)
+				<< " ms, max " << framePacer.GetPercentile(100.0) << " ms" << endl;
+			lastFrameStatsReport = currentFrame;
+		}
 
+		// Report the render scale the GPU budget settled on
+		if (dynamicResolution && currentFrame - lastResolutionReport >= 1.0f)
+		{
+			cout << "Dynamic resolution: " << (int)(resolution.GetScale() * 100.0f + 0.5f) << "% (" << resolution.GetRenderWidth() << "x"
+				<< resolution.GetRenderHeight() << "), GPU " << resolution.GetGpuMs() << " ms of " << resolution.GetBudget() << " ms budget" << endl;
+			lastResolutionReport = currentFrame;
+		}
+
+		// Dump the GPU profile when asked for
+		if (dumpGpuProfile)
+		{
+			gpuProfiler.Report(cout);
+			if (gpuProfiler.WriteCsv("gpu_profile.csv") && gpuProfiler.WriteJson("gpu_profile.json"))
+			{
+				cout << "GPU profile written to gpu_profile.csv and gpu_profile.json" << endl;
+			}
+			dumpGpuProfile = false;
+		}
+
+		// Report draw calls and state changes for the last frame
+		if (glStatsReport && currentFrame - lastGLStatsReport >= 1.0f)
+		{
+			const GLFrameStats& stats = GLStats::Get().GetLastFrame();
+			cout << "GL calls: " << stats.draws << " draws, " << stats.triangles << " triangles, "
+				<< stats.programBinds << " program binds (" << stats.redundantProgramBinds << " redundant), "
+				<< stats.vertexArrayBinds << " VAO binds (" << stats.redundantVertexArrayBinds << " redundant), "
+				<< stats.textureBinds << " texture binds (" << stats.redundantTextureBinds << " redundant), "
+				<< stats.uniformUploads << " uniform uploads" << endl;
+			lastGLStatsReport = currentFrame;
+		}
+
+		// Write the CPU trace when asked for, the workers are idle between frames
+		if (dumpCpuTrace)
+		{
+			if (CpuProfiler::Get().WriteChromeTrace("cpu_trace.json"))
+			{
+				cout << "CPU trace written to cpu_trace.json (" << CpuProfiler::Get().GetEventCount() << " events)" << endl;
+			}
+			dumpCpuTrace = false;
+		}
+
+		// Report input to swap latency for the current camera mode
+		if (measureLatency && currentFrame - lastLatencyReport >= 1.0f && latency.GetSampleCount() > 0)
+		{
+			cout << "Input latency (late latch " << (lateLatch ? "on" : "off") << "): p50 " << latency.GetPercentile(50.0)
+				<< " ms, p99 " << latency.GetPercentile(99.0) << " ms, latch to swap p50 " << latency.GetLatchPercentile(50.0)
+				<< " ms (" << latency.GetSampleCount() << " samples)" << endl;
+			lastLatencyReport = currentFrame;
+		}
+
+		// Report how many piece and prop draws the GPU skipped
+		if (occlusionCulling && currentFrame - lastOcclusionReport >= 1.0f)
+		{
+			cout << "Occlusion culling: " << occlusion.GetSkippedDraws() << " of " << occlusion.GetTestedDraws() << " draws skipped per frame" << endl;
+			lastOcclusionReport = currentFrame;
+		}
+
+		if (softwareCulling && currentFrame - lastSoftwareCullingReport >= 1.0f)
+		{
+			cout << "CPU occlusion culling: " << softwareOcclusion.GetCulledObjects() << " of " << softwareOcclusion.GetTestedObjects() << " draws culled per frame" << endl;
+			lastSoftwareCullingReport = currentFrame;
+		}
+
+	}
+
+	if (recorder.IsRecording())
+	{
+		recorder.Save(bench.record, camera.GetState());
+	}
+
+	// Write out the benchmark, the last few frames' GPU times are still in flight
+	if (bench.enabled)
+	{
+		gpuProfiler.Flush();
+		benchRecorder.SetGpuFrames(gpuProfiler.GetSamples("Frame", bench.warmupFrames));
+
+		if (benchRecorder.WriteJson(bench.output, (const char*)glGetString(GL_RENDERER), SCREEN_WIDTH, SCREEN_HEIGHT))
+		{
+			cout << "Benchmark: " << bench.frames << " frames, CPU mean " << benchRecorder.GetCpuMean() << " ms, GPU mean "
+				<< benchRecorder.GetGpuMean() << " ms, written to " << bench.output << endl;
+		}
 	}
 
+	// GL objects owned by the renderer go while the context is still current
+	gpuProfiler.Release();
+	resolution.Release();
+	cameraBuffer.Release();
+
 	// Terminate GLFW and clear recources from GLFW
 	glfwTerminate();
 
@@ -2652,37 +2120,122 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int modi
 		}
 	}
 
-	//Cycle Camera Left
+	//Cycle Camera Left (on the next simulation tick)
 	if (key == GLFW_KEY_LEFT && action == GLFW_PRESS)
 	{
 		camLocked = true;
-		camera.CycleCamera("Left");
+		pendingCameraCycle = -1;
 	}
 
-	//Cycle Camera Right
+	//Cycle Camera Right (on the next simulation tick)
 	if (key == GLFW_KEY_RIGHT && action == GLFW_PRESS)
 	{
 		camLocked = true;
-		camera.CycleCamera("Right");
+		pendingCameraCycle = 1;
 	}
 
-	// for animations
-	// Start and Stop the Chess Piece Animations
-	if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+	// Enable and Disable occlusion culling of pieces and props
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		occlusionCulling = !occlusionCulling;
+		cout << "Occlusion culling " << (occlusionCulling ? "on" : "off") << endl;
+	}
+
+	// Cycle vsync off, on and adaptive
+	if (key == GLFW_KEY_V && action == GLFW_PRESS)
+	{
+		vsyncMode = (VsyncMode)((vsyncMode + 1) % 3);
+		ApplyVsync(vsyncMode);
+		framePacer.ResetStats();
+	}
+
+	// Cycle the frame rate cap
+	if (key == GLFW_KEY_F && action == GLFW_PRESS)
 	{
-		if (animate == true)
+		frameRateCap = (frameRateCap + 1) % (sizeof(frameRateCaps) / sizeof(double));
+		framePacer.SetTargetFps(frameRateCaps[frameRateCap]);
+		framePacer.ResetStats();
+
+		if (frameRateCaps[frameRateCap] > 0.0)
 		{
-			animate = false;
+			cout << "Frame rate cap " << frameRateCaps[frameRateCap] << " fps" << endl;
 		}
 		else
 		{
-			animate = true;
+			cout << "Frame rate cap off" << endl;
 		}
 	}
 
+	// Enable and Disable the frame time reports
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		frameStats = !frameStats;
+		framePacer.ResetStats();
+		cout << "Frame time stats " << (frameStats ? "on" : "off") << endl;
+	}
+
+	// Enable and Disable dynamic resolution scaling
+	if (key == GLFW_KEY_R && action == GLFW_PRESS)
+	{
+		dynamicResolution = !dynamicResolution;
+		cout << "Dynamic resolution " << (dynamicResolution ? "on" : "off") << endl;
+	}
+
+	// Print and save the GPU profile
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+	{
+		dumpGpuProfile = true;
+	}
+
+	// Enable and Disable the GL call reports
+	if (key == GLFW_KEY_I && action == GLFW_PRESS)
+	{
+		glStatsReport = !glStatsReport;
+		cout << "GL call stats " << (glStatsReport ? "on" : "off") << (GLStats::IsEnabled() ? "" : " (compiled out in this build)") << endl;
+	}
+
+	// Save the CPU trace
+	if (key == GLFW_KEY_T && action == GLFW_PRESS)
+	{
+		dumpCpuTrace = true;
+	}
+
+	// Enable and Disable the late latched camera
+	if (key == GLFW_KEY_L && action == GLFW_PRESS)
+	{
+		lateLatch = !lateLatch;
+		latency.Reset();
+		cout << "Late latch " << (lateLatch ? "on" : "off") << (lateLatch && !GLEW_ARB_buffer_storage ? " (no persistent mapping, using glBufferSubData)" : "") << endl;
+	}
+
+	// Enable and Disable the input latency reports
+	if (key == GLFW_KEY_M && action == GLFW_PRESS)
+	{
+		measureLatency = !measureLatency;
+		latency.Reset();
+		cout << "Latency measurement " << (measureLatency ? "on" : "off") << endl;
+	}
+
+	// Enable and Disable the CPU occlusion culler
+	if (key == GLFW_KEY_C && action == GLFW_PRESS)
+	{
+		softwareCulling = !softwareCulling;
+		cout << "CPU occlusion culling " << (softwareCulling ? "on" : "off") << endl;
+	}
+
+	// for animations
+	// Start and Stop the Chess Piece Animations
+	// (on the next simulation tick)
+	if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+	{
+		pendingAnimationToggle = true;
+	}
+
 
 	if (key >= 0 && key < 1024)
 	{
+		latency.OnInput(glfwGetTime());
+
 		if (action == GLFW_PRESS)
 		{
 			keys[key] = true;
@@ -2691,8 +2244,6 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int modi
 		{
 			keys[key] = false;
 		}
-
-		ProcessInput(window);
 	}
 }
 
@@ -2714,7 +2265,10 @@ void MouseCallback(GLFWwindow* window, double xPos, double yPos)
 		lastX = xPos;
 		lastY = yPos;
 		
-		camera.ProcessMouseMovement(xOffset, yOffset);
+		// Applied on the next simulation tick
+		latency.OnInput(glfwGetTime());
+		mouseOffsetX += xOffset;
+		mouseOffsetY += yOffset;
 	}
 
 }
@@ -2722,41 +2276,66 @@ void MouseCallback(GLFWwindow* window, double xPos, double yPos)
 // GLFW: whenever the mouse scroll wheel scrolls, this callback is called
 void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 {
-	camera.ProcessMouseScroll(yOffset);
+	// Applied on the next simulation tick
+	scrollOffset += yOffset;
+}
+
+// Collects the user input for one simulation tick
+// WASD, mouse look, scroll zoom, camera cycling and the animation toggle
+TickInput GatherInput()
+{
+	TickInput input = PeekInput();
+
+	mouseOffsetX = 0.0f;
+	mouseOffsetY = 0.0f;
+	scrollOffset = 0.0f;
+	pendingCameraCycle = 0;
+	pendingAnimationToggle = false;
+
+	return input;
 }
 
-// Moves/alters the camera positions based on user input
-// WASD and Arrow keys
-void ProcessInput(GLFWwindow* window)
+// The input the next tick would get, without using it up
+TickInput PeekInput()
 {
+	TickInput input = TickInput();
+
+	// Mouse look, zoom and key presses gathered since the last tick
+	input.mouseX = mouseOffsetX;
+	input.mouseY = mouseOffsetY;
+	input.scroll = scrollOffset;
+	input.cameraCycle = (signed char)pendingCameraCycle;
+	input.toggleAnimation = pendingAnimationToggle ? 1 : 0;
+
 	// Camera controls
 	if (keys[GLFW_KEY_W])
 	{
-		camera.ProcessKeyboard(FORWARD, deltaTime);
+		input.keys |= INPUT_KEY_FORWARD;
 	}
 
 	if (keys[GLFW_KEY_S])
 	{
-		camera.ProcessKeyboard(BACKWARD, deltaTime);
+		input.keys |= INPUT_KEY_BACKWARD;
 	}
 
 	if (keys[GLFW_KEY_A])
 	{
-		camera.ProcessKeyboard(LEFT, deltaTime);
+		input.keys |= INPUT_KEY_LEFT;
 	}
 
 	if (keys[GLFW_KEY_D])
 	{
-		camera.ProcessKeyboard(RIGHT, deltaTime);
+		input.keys |= INPUT_KEY_RIGHT;
 	}
-	
+
+	return input;
 }
 
-GLfloat AnimateCPRotation()
+GLfloat AnimateCPRotation(GLfloat time)
 {
 	if (animate)
 	{
-		return (GLfloat)glfwGetTime() * 1.0f;
+		return time * 1.0f;
 		// Animate Chess Piece
 	}
 
@@ -2768,6 +2347,17 @@ GLfloat AnimateCPRotation()
 
 }
 
+// Seconds since start, off GLFW's timer when there is a window. The headless bench never
+// initialises GLFW, so it uses the steady clock instead.
+double ClockTime(GLFWwindow* window, chrono::steady_clock::time_point start, chrono::steady_clock::time_point now)
+{
+	if (window != nullptr)
+	{
+		return glfwGetTime();
+	}
+	return chrono::duration<double>(now - start).count();
+}
+
 GLfloat AnimateCPSlide()
 {
 	if (animate)
@@ -2829,34 +2419,95 @@ glm::vec3 AnimatePosition3(glm::vec3 pos)
 	}
 }
 
-GLuint CreateSkyboxTexture(GLuint texture, vector<std::string> faces, int width, int height) // Method for Skybox Texture
+unsigned char* LoadImageFile(const char* path, int* width, int* height, int* channels, int forceChannels) // SOIL_load_image, timed in the CPU profile
+{
+	CpuScope scope("SOIL_load_image", path);
+	return SOIL_load_image(path, width, height, channels, forceChannels);
+}
+
+SceneMesh CreateSceneMesh(const char* name, const Shader& shader, GLuint vao, int vertexCount, const Bounds& bounds, bool cull) // Look up a mesh's uniforms once for the draw packets
 {
-	int widthTexture = 0, heightTexture = 0;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	SceneMesh mesh;
+	mesh.name = name;
+	mesh.program = shader.Program;
+	mesh.vao = vao;
+	mesh.vertexCount = vertexCount;
+	mesh.modelLocation = glGetUniformLocation(shader.Program, "model");
+	mesh.textureLocation = glGetUniformLocation(shader.Program, "faceTexture");
+	mesh.bounds = bounds;
+	mesh.cull = cull;
+	mesh.asset = -1;
+	return mesh;
+}
 
-	int nrChannels;
-	for (unsigned int i = 0; i < faces.size(); i++)
+SceneMesh CreateLoadedSceneMesh(const char* name, const Shader& shader, GLuint vao, AssetLoader& assets, int asset) // Scene mesh for a loader mesh, the placeholder box until it is ready
+{
+	SceneMesh mesh = CreateSceneMesh(name, shader, vao, assets.GetVertexCount(asset), assets.GetBounds(asset), true);
+	mesh.asset = asset;
+	return mesh;
+}
+
+void UpdateSceneAssets(ScenePrep& scene, AssetLoader& assets) // Pick up meshes the loader has finished, and textures it found a copy of
+{
+	for (int m = 0; m < scene.GetMeshCount(); m++)
 	{
-		unsigned char* textureImg = SOIL_load_image(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (textureImg)
+		int asset = scene.GetMesh(m).asset;
+		if (asset >= 0 && assets.IsReady(asset) && scene.GetMesh(m).vertexCount != assets.GetVertexCount(asset))
 		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImg);
-			SOIL_free_image_data(textureImg);
+			scene.SetMeshGeometry(m, assets.GetVertexCount(asset), assets.GetBounds(asset));
 		}
-		else
+	}
+
+	for (int o = 0; o < scene.GetObjectCount(); o++)
+	{
+		GLuint texture = assets.GetTexture(scene.GetObject(o).texture);
+		if (texture != scene.GetObject(o).texture)
 		{
-			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			SOIL_free_image_data(textureImg);
+			scene.SetObjectTexture(o, texture);
 		}
 	}
+}
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void AddSceneObjects(ScenePrep& scene, SceneObject object, const glm::vec3* positions, int count, GLuint textureW, GLuint textureB, int whiteCount) // The first whiteCount positions get the white texture
+{
+	int firstSlot = object.occlusionSlot;
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	for (int i = 0; i < count; i++)
+	{
+		object.position = positions[i];
+		object.texture = (i < whiteCount) ? textureW : textureB;
+		object.occlusionSlot = (firstSlot >= 0) ? firstSlot + i : -1;
+		scene.AddObject(object);
+	}
+}
+
+CameraBlock BuildCameraBlock(Camera& viewCamera) // Matrices for every shader's CameraBlock
+{
+	CameraBlock block;
+	block.view = viewCamera.GetViewMatrix();
+	block.projection = glm::perspective(glm::radians(viewCamera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
+
+	// remove translation from the view matrix
+	block.skyboxView = glm::mat4(glm::mat3(block.view));
+	block.skyboxProjection = glm::perspective(glm::radians(viewCamera.GetZoom()), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+	return block;
+}
+
+void ApplyVsync(VsyncMode mode) // Set the swap interval, adaptive needs the swap_control_tear extension
+{
+	if (mode == VSYNC_ADAPTIVE)
+	{
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			glfwSwapInterval(-1);
+			cout << "Vsync adaptive" << endl;
+			return;
+		}
+
+		cout << "Adaptive vsync not supported, ";
+		mode = VSYNC_ON;
+	}
 
-	return texture;
+	glfwSwapInterval(mode == VSYNC_ON ? 1 : 0);
+	cout << "Vsync " << (mode == VSYNC_ON ? "on" : "off") << endl;
 }